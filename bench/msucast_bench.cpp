@@ -0,0 +1,345 @@
+// Self-contained benchmarks of the optimizer hot paths on synthetic inputs
+// (see synthetic_inputs.h); no /opt/opt4cast data or services are needed.
+// Every benchmark runs once to warm up and then --reps timed times; the
+// results are printed and written as a JSON report for tracking over time.
+//
+// usage: msucast_bench [--sizes 10000,100000,1000000] [--reps 5] [--filter substring]
+//                      [--out msucast_bench.json] [--dir /tmp/msucast_bench]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+#include <nlohmann/json.hpp>
+
+#include "external_archive.h"
+#include "misc_utilities.h"
+#include "particle.h"
+#include "pso.h"
+#include "scenario.h"
+#include "swarm.h"
+#include "synthetic_inputs.h"
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+    // The library logs heavily to stdout; mute it while a benchmark runs.
+    class QuietStdout {
+        public:
+            QuietStdout() {
+                std::cout.flush();
+                std::fflush(stdout);
+                saved_ = ::dup(STDOUT_FILENO);
+                int null_fd = ::open("/dev/null", O_WRONLY);
+                ::dup2(null_fd, STDOUT_FILENO);
+                ::close(null_fd);
+            }
+            ~QuietStdout() {
+                std::cout.flush();
+                std::fflush(stdout);
+                ::dup2(saved_, STDOUT_FILENO);
+                ::close(saved_);
+            }
+            QuietStdout(const QuietStdout&) = delete;
+            QuietStdout& operator=(const QuietStdout&) = delete;
+        private:
+            int saved_;
+    };
+
+    struct BenchResult {
+        std::string name;
+        size_t parcels;
+        size_t items;           ///< work units per run (parcels, rows, insertions, ...)
+        std::vector<double> ms; ///< one entry per timed run
+    };
+
+    class BenchRunner {
+        public:
+            BenchRunner(int reps, std::string filter) : reps_(reps), filter_(std::move(filter)) {}
+
+            bool is_selected(const std::string& name) const {
+                return filter_.empty() || name.find(filter_) != std::string::npos;
+            }
+
+            // f() returns the number of items it processed
+            template <typename F>
+            void run(const std::string& name, size_t parcels, F&& f, int reps = 0) {
+                if (!is_selected(name)) {
+                    return;
+                }
+                BenchResult result{name, parcels, 0, {}};
+                {
+                    QuietStdout quiet;
+                    if (reps == 0) {
+                        reps = reps_;
+                        f();
+                    }
+                    for (int r = 0; r < reps; ++r) {
+                        auto start = std::chrono::steady_clock::now();
+                        result.items = f();
+                        result.ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }
+                auto ms = result.ms;
+                std::sort(ms.begin(), ms.end());
+                fmt::print("{:<32} {:>9} {:>10} {:>12.3f} {:>12.3f} {:>14.0f}\n", name, parcels, result.items,
+                           ms.front(), ms[ms.size() / 2], result.items / (ms.front() / 1e3));
+                std::fflush(stdout);
+                results_.push_back(std::move(result));
+            }
+
+            json report() const {
+                json results = json::array();
+                for (const auto& result : results_) {
+                    auto ms = result.ms;
+                    std::sort(ms.begin(), ms.end());
+                    double mean = 0.0;
+                    for (double t : ms) {
+                        mean += t / ms.size();
+                    }
+                    results.push_back({
+                        {"name", result.name},
+                        {"parcels", result.parcels},
+                        {"items", result.items},
+                        {"reps", ms.size()},
+                        {"min_ms", ms.front()},
+                        {"median_ms", ms[ms.size() / 2]},
+                        {"mean_ms", mean},
+                        {"max_ms", ms.back()},
+                        {"items_per_second", result.items / (ms.front() / 1e3)},
+                    });
+                }
+                return results;
+            }
+        private:
+            int reps_;
+            std::string filter_;
+            std::vector<BenchResult> results_;
+    };
+
+    std::vector<size_t> parse_sizes(const std::string& list) {
+        std::vector<std::string> items;
+        misc_utilities::split_str(list, ',', items);
+        std::vector<size_t> sizes;
+        for (const auto& item : items) {
+            sizes.push_back(std::stoul(item));
+        }
+        return sizes;
+    }
+
+    std::string hostname() {
+        char name[256] = {};
+        ::gethostname(name, sizeof(name) - 1);
+        return name;
+    }
+
+    Particle on_front(const Particle& prototype, double t) {
+        Particle particle(prototype);
+        particle.set_fx(t, 1.0 - std::sqrt(t));
+        particle.set_gx(0.0);
+        return particle;
+    }
+
+    void bench_size(BenchRunner& bench, const std::string& root_dir, size_t n) {
+        auto dir = fmt::format("{}/{}", root_dir, n);
+        fs::remove_all(dir);
+        SyntheticInputs inputs;
+        {
+            QuietStdout quiet;
+            inputs = write_synthetic_inputs(dir, n, 17);
+        }
+        // Scenario reads these when constructed
+        setenv("MSU_CBPO_PATH", dir.c_str(), 1);
+        setenv("SCENARIO_SNAPSHOT_DIR", "", 1);
+
+        Scenario scenario;
+        bench.run("scenario_init", n, [&] {
+            scenario = Scenario();
+            scenario.init(inputs.base_file, inputs.scenario_file, false, true, true, true, inputs.manure_nutrients_file);
+            return scenario.get_nvars();
+        }, 1);
+        if (scenario.get_nvars() == 0) {
+            // scenario_init filtered out; the rest needs a scenario anyway
+            QuietStdout quiet;
+            scenario.init(inputs.base_file, inputs.scenario_file, false, true, true, true, inputs.manure_nutrients_file);
+        }
+        const auto& model = scenario.get_model();
+
+        std::mt19937 gen(5);
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        std::vector<double> x(scenario.get_nvars());
+        for (auto& xi : x) {
+            xi = dist(gen);
+        }
+
+        std::vector<std::tuple<int, int, int, int, double>> lc_x;
+        std::vector<std::tuple<int, int, int, int, int, double>> animal_x;
+        std::vector<std::tuple<int, int, int, int, int, double>> manure_x;
+        std::vector<double> amount_minus;
+        std::vector<double> amount_plus;
+        bench.run("normalize_lc", n, [&] {
+            scenario.normalize_lc(x, lc_x, amount_minus, amount_plus);
+            return model.lc_amount.size();
+        });
+        bench.run("normalize_animal", n, [&] {
+            scenario.normalize_animal(x, animal_x);
+            return model.animal_units.size();
+        });
+        bench.run("normalize_manure", n, [&] {
+            scenario.normalize_manure(x, manure_x);
+            return model.manure_dry_lbs.size();
+        });
+        // the writers and the reader below need the rows even when normalize_* is filtered out
+        scenario.normalize_lc(x, lc_x, amount_minus, amount_plus);
+        scenario.normalize_animal(x, animal_x);
+        scenario.normalize_manure(x, manure_x);
+
+        auto land_file = fmt::format("{}/impbmpsubmittedland.parquet", dir);
+        bench.run("write_land", n, [&] {
+            return static_cast<size_t>(scenario.write_land(lc_x, land_file, inputs.base_land));
+        });
+        bench.run("write_animal", n, [&] {
+            return static_cast<size_t>(scenario.write_animal(animal_x, fmt::format("{}/impbmpsubmittedanimal.parquet", dir), {}));
+        });
+        bench.run("write_manure", n, [&] {
+            return static_cast<size_t>(scenario.write_manure(manure_x, fmt::format("{}/impbmpsubmittedmanuretransport.parquet", dir), {}));
+        });
+        if (bench.is_selected("read_parquet_file_land")) {
+            if (!fs::exists(land_file)) {
+                QuietStdout quiet;
+                scenario.write_land(lc_x, land_file, inputs.base_land);
+            }
+            bench.run("read_parquet_file_land", n, [&] {
+                return read_parquet_file_land(land_file).size();
+            });
+        }
+        bench.run("read_loads", n, [&] {
+            misc_utilities::read_loads(inputs.reportloads_file);
+            return n;
+        });
+
+        // one swarm step over the scenario's decision vector
+        int nparticles = 20;
+        std::vector<Particle> swarm;
+        for (int i = 0; i < nparticles; ++i) {
+            swarm.emplace_back(x.size(), 2, 0.7, 1.5, 1.5, 0.0, 1.0);
+            swarm.back().init();
+            swarm.back().set_fx(dist(gen), dist(gen));
+            swarm.back().init_pbest();
+        }
+        bench.run("particle_update", n, [&] {
+            for (auto& particle : swarm) {
+                particle.update(x);
+            }
+            return swarm.size() * x.size();
+        });
+        Swarm soa(nparticles, x.size(), 0.7, 1.5, 1.5, 0.0, 1.0, 5);
+        soa.init();
+        for (int i = 0; i < nparticles; ++i) {
+            soa.store_pbest(i);
+        }
+        std::vector<std::span<const double>> guides(nparticles, std::span<const double>(x));
+        bench.run("swarm_update", n, [&] {
+            soa.update(guides);
+            return static_cast<size_t>(nparticles) * x.size();
+        });
+
+        // insertions into a full archive of min(n / 10, 10^4) members on one front,
+        // fresh candidates on every run so none is a duplicate
+        size_t archive_size = std::min<size_t>(n / 10, 10000);
+        int ninserts = 1000;
+        Particle prototype(10, 2, 0.7, 1.5, 1.5, 0.0, 1.0);
+        prototype.init();
+        std::vector<Particle> archive;
+        for (size_t i = 0; i < archive_size; ++i) {
+            archive.push_back(on_front(prototype, (i + 0.5) / archive_size));
+        }
+        bench.run("update_non_dominated_solutions", n, [&] {
+            for (int i = 0; i < ninserts; ++i) {
+                update_non_dominated_solutions(archive, on_front(prototype, dist(gen)), archive_size);
+            }
+            return static_cast<size_t>(ninserts);
+        });
+
+        std::vector<CostData> costs;
+        for (size_t i = 0; i < n; ++i) {
+            costs.push_back(CostData{1e6 * dist(gen), 1e4 * dist(gen), std::nullopt, std::to_string(i)});
+        }
+        bench.run("find_pareto_front", n, [&] {
+            find_pareto_front(costs, 2, 1e300);
+            return costs.size();
+        });
+
+        fs::remove_all(dir);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string sizes_arg = "10000";
+    int reps = 5;
+    std::string filter;
+    std::string out_file = "msucast_bench.json";
+    std::string root_dir = (fs::temp_directory_path() / "msucast_bench").string();
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "usage: " << argv[0] << " [--sizes n1,n2,...] [--reps r] [--filter name] [--out report.json] [--dir path]" << std::endl;
+            return -1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--sizes") {
+            sizes_arg = value;
+        } else if (arg == "--reps") {
+            reps = std::max(1, std::stoi(value));
+        } else if (arg == "--filter") {
+            filter = value;
+        } else if (arg == "--out") {
+            out_file = value;
+        } else if (arg == "--dir") {
+            root_dir = value;
+        } else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    BenchRunner bench(reps, filter);
+    fmt::print("{:<32} {:>9} {:>10} {:>12} {:>12} {:>14}\n", "benchmark", "parcels", "items", "min ms", "median ms", "items/s");
+    for (size_t n : parse_sizes(sizes_arg)) {
+        bench_size(bench, root_dir, n);
+    }
+
+    json report = {
+        {"schema_version", 1},
+        {"timestamp", misc_utilities::current_time()},
+        {"host", hostname()},
+        {"compiler", __VERSION__},
+#ifdef NDEBUG
+        {"assertions", false},
+#else
+        {"assertions", true},
+#endif
+        {"hardware_threads", std::thread::hardware_concurrency()},
+        {"reps", reps},
+        {"results", bench.report()},
+    };
+    misc_utilities::write_json_file(out_file, report);
+    fmt::print("report written to {}\n", out_file);
+    return 0;
+}
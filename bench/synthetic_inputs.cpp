@@ -0,0 +1,232 @@
+// Created by: Gregorio Toscano
+
+#include "synthetic_inputs.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/exception.h>
+
+#include "misc_utilities.h"
+
+namespace {
+    constexpr int NSTATES = 6;
+    constexpr int NCOUNTIES = 1000;
+    constexpr int NLOADSRCS = 100;
+    constexpr int MANURE_BMP = 31;
+    const std::vector<int> LC_BMPS = {9, 12, 13, 15, 22, 200};
+    const std::vector<int> ANIMAL_BMPS = {4, 5, 6, 7, 8, 10};
+
+    int county_state(int county) {
+        return county % NSTATES + 1;
+    }
+
+    // "name": {entry(0), ..., entry(n - 1)}
+    template <typename F>
+    void write_object(std::ofstream& out, const std::string& name, size_t n, F&& entry) {
+        out << '"' << name << "\": {";
+        for (size_t i = 0; i < n; ++i) {
+            out << (i == 0 ? "" : ", ") << entry(i);
+        }
+        out << "},\n";
+    }
+
+    std::string int_list(const std::vector<int>& values) {
+        std::string list = "[";
+        for (size_t i = 0; i < values.size(); ++i) {
+            list += fmt::format("{}{}", i == 0 ? "" : ", ", values[i]);
+        }
+        return list + "]";
+    }
+
+    // between 1 and 3 distinct BMPs of `bmps`
+    std::vector<int> pick_bmps(std::mt19937& gen, const std::vector<int>& bmps) {
+        std::vector<int> picked = bmps;
+        std::shuffle(picked.begin(), picked.end(), gen);
+        picked.resize(std::uniform_int_distribution<size_t>(1, 3)(gen));
+        return picked;
+    }
+
+    template <typename Builder, typename T>
+    std::shared_ptr<arrow::Array> make_column(const std::vector<T>& values) {
+        Builder builder;
+        PARQUET_THROW_NOT_OK(builder.AppendValues(values));
+        std::shared_ptr<arrow::Array> array;
+        PARQUET_THROW_NOT_OK(builder.Finish(&array));
+        return array;
+    }
+
+    void write_parquet(const std::string& filename, const std::shared_ptr<arrow::Schema>& schema,
+                       const std::vector<std::shared_ptr<arrow::Array>>& columns) {
+        auto table = arrow::Table::Make(schema, columns);
+        std::shared_ptr<arrow::io::FileOutputStream> outfile;
+        PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(filename));
+        PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(*table, arrow::default_memory_pool(), outfile, 64 * 1024));
+    }
+}
+
+SyntheticInputs write_synthetic_inputs(const std::string& dir, size_t nparcels, unsigned seed) {
+    SyntheticInputs inputs;
+    inputs.dir = dir;
+    inputs.base_file = fmt::format("{}/base.json", dir);
+    inputs.scenario_file = fmt::format("{}/scenario.json", dir);
+    inputs.manure_nutrients_file = fmt::format("{}/manure_nutrients.parquet", dir);
+    inputs.reportloads_file = fmt::format("{}/reportloads.parquet", dir);
+    misc_utilities::mkdir(fmt::format("{}/csvs", dir));
+
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> acres_dist(10.0, 500.0);
+    std::uniform_real_distribution<double> units_dist(1.0, 200.0);
+    std::uniform_real_distribution<double> cost_dist(10.0, 1000.0);
+    std::uniform_real_distribution<double> lbs_dist(1e3, 1e6);
+    std::uniform_real_distribution<double> load_dist(0.0, 1e3);
+    std::uniform_int_distribution<int> loadsrc_dist(1, NLOADSRCS);
+
+    // one lrseg per county at least; lrseg l (from 1) lies in county (l - 1) % NCOUNTIES + 1
+    size_t nlrsegs = std::max<size_t>(NCOUNTIES, nparcels / 10);
+    auto lrseg_county = [](size_t lrseg) {
+        return static_cast<int>((lrseg - 1) % NCOUNTIES) + 1;
+    };
+    // land conversion parcel i: "lrseg_agency_loadsrc"
+    auto lc_key = [&](size_t i) {
+        return fmt::format("{}_{}_{}", i % nlrsegs + 1, 9 + i / (nlrsegs * NLOADSRCS), (i / nlrsegs) % NLOADSRCS + 1);
+    };
+    // animal parcel i: "base_condition_county_loadsrc_animal"
+    auto animal_key = [&](size_t i) {
+        return fmt::format("1_{}_{}_{}", i % NCOUNTIES + 1, (i / NCOUNTIES) % NLOADSRCS + 1, i / (NCOUNTIES * NLOADSRCS) + 1);
+    };
+
+    std::ofstream base(inputs.base_file);
+    if (!base.is_open()) {
+        std::cerr << "Failed to open the file: " << inputs.base_file << std::endl;
+        exit(-1);
+    }
+    base << "{\n\"scenario_id\": 3814,\n"
+         << "\"scenario_data_str\": \"empty_38_6611_256_6_4_59_1_6608_158_2_31_8_294\",\n"
+         << "\"phi\": {},\n\"efficiency\": {},\n";
+    write_object(base, "amount", nparcels, [&](size_t i) {
+        return fmt::format("\"{}\": {}", lc_key(i), acres_dist(gen));
+    });
+    write_object(base, "land_conversion_to", nparcels, [&](size_t i) {
+        std::string to = "[";
+        auto bmps = pick_bmps(gen, LC_BMPS);
+        for (size_t k = 0; k < bmps.size(); ++k) {
+            to += fmt::format("{}\"{}_{}\"", k == 0 ? "" : ", ", bmps[k], loadsrc_dist(gen));
+        }
+        return fmt::format("\"{}\": {}]", lc_key(i), to);
+    });
+    write_object(base, "animal_unit", nparcels, [&](size_t i) {
+        return fmt::format("\"{}\": {}", animal_key(i), units_dist(gen));
+    });
+    write_object(base, "animal_complete", nparcels, [&](size_t i) {
+        return fmt::format("\"{}\": {}", animal_key(i), int_list(pick_bmps(gen, ANIMAL_BMPS)));
+    });
+    std::vector<int> all_bmps = LC_BMPS;
+    all_bmps.insert(all_bmps.end(), ANIMAL_BMPS.begin(), ANIMAL_BMPS.end());
+    all_bmps.push_back(MANURE_BMP);
+    write_object(base, "bmp_cost", NSTATES * all_bmps.size(), [&](size_t i) {
+        return fmt::format("\"{}_{}\": {}", i / all_bmps.size() + 1, all_bmps[i % all_bmps.size()], cost_dist(gen));
+    });
+    write_object(base, "lrseg", nlrsegs, [&](size_t l) {
+        int county = lrseg_county(l + 1);
+        return fmt::format("\"{}\": [{}, {}, {}, {}]", l + 1, 50000 + county, county_state(county), county, 100000 + l);
+    });
+    write_object(base, "u_u_group", NLOADSRCS, [&](size_t i) {
+        return fmt::format("\"{}\": {}", i + 1, i / 10 + 1);
+    });
+    write_object(base, "pct_by_valid_load", NLOADSRCS, [&](size_t i) {
+        return fmt::format("\"{}\": 50.0", i + 1);
+    });
+    write_object(base, "counties2", NCOUNTIES, [&](size_t c) {
+        return fmt::format("\"{}\": {}", c + 1, county_state(c + 1));
+    });
+    write_object(base, "counties", NCOUNTIES, [&](size_t c) {
+        int county = c + 1;
+        return fmt::format("\"{}\": [{}, {}, \"{:05d}\", \"County {}\", \"S{}\"]",
+                           county, 10000 + county, 20000 + county, 50000 + county, county, county_state(county));
+    });
+    base << "\"version\": 1\n}\n";
+    base.close();
+
+    std::ofstream scenario(inputs.scenario_file);
+    scenario << "{\n\"selected_bmps\": " << int_list(all_bmps) << ",\n"
+             << "\"bmp_cost\": {},\n"
+             << "\"selected_reduction_target\": 10,\n"
+             << "\"sel_pollutant\": \"N\",\n"
+             << "\"target_pct\": 10,\n"
+             << "\"manure_counties\": {\"1\": [1, 2, 3]},\n"
+             << "\"selected_manure_counties\": [1, 2, 3]\n}\n";
+    scenario.close();
+
+    std::ofstream neighbors(fmt::format("{}/csvs/cast_neighbors.json", dir));
+    neighbors << "{";
+    for (int county = 1; county <= NCOUNTIES; ++county) {
+        neighbors << (county == 1 ? "" : ", ") << '"' << county << "\": "
+                  << int_list({county % NCOUNTIES + 1, (county + 1) % NCOUNTIES + 1, (county + NCOUNTIES - 2) % NCOUNTIES + 1});
+    }
+    neighbors << "}\n";
+    neighbors.close();
+
+    // manure row i has key "county_loadsrc_animal" as animal parcel i; lrseg `county` lies in `county`
+    std::vector<int32_t> lrseg_ids, load_src_ids, animal_ids, nutrient_ids;
+    std::vector<double> dry_lbs;
+    for (size_t i = 0; i < nparcels; ++i) {
+        lrseg_ids.push_back(i % NCOUNTIES + 1);
+        load_src_ids.push_back((i / NCOUNTIES) % NLOADSRCS + 1);
+        animal_ids.push_back(i / (NCOUNTIES * NLOADSRCS) + 1);
+        nutrient_ids.push_back(1);
+        dry_lbs.push_back(lbs_dist(gen));
+    }
+    write_parquet(inputs.manure_nutrients_file,
+                  arrow::schema({arrow::field("LrsegId", arrow::int32()),
+                                 arrow::field("LoadSourceId", arrow::int32()),
+                                 arrow::field("AnimalId", arrow::int32()),
+                                 arrow::field("NutrientId", arrow::int32()),
+                                 arrow::field("StoredManureDryLbs", arrow::float64())}),
+                  {make_column<arrow::Int32Builder>(lrseg_ids), make_column<arrow::Int32Builder>(load_src_ids),
+                   make_column<arrow::Int32Builder>(animal_ids), make_column<arrow::Int32Builder>(nutrient_ids),
+                   make_column<arrow::DoubleBuilder>(dry_lbs)});
+
+    // read_loads sums columns 7 to 15 (EoS, EoR and EoT loads of N, P and S)
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    for (const auto& name : {"ScenarioId", "LrsegId", "AgencyId", "LoadSourceId", "StateId", "CountyId", "GeographyId"}) {
+        std::vector<int32_t> ids(nparcels);
+        for (size_t i = 0; i < nparcels; ++i) {
+            ids[i] = static_cast<int32_t>(i % nlrsegs + 1);
+        }
+        fields.push_back(arrow::field(name, arrow::int32()));
+        columns.push_back(make_column<arrow::Int32Builder>(ids));
+    }
+    for (const auto& name : {"NLoadEos", "PLoadEos", "SLoadEos", "NLoadEor", "PLoadEor", "SLoadEor", "NLoadEot", "PLoadEot", "SLoadEot"}) {
+        std::vector<double> loads(nparcels);
+        for (auto& load : loads) {
+            load = load_dist(gen);
+        }
+        fields.push_back(arrow::field(name, arrow::float64()));
+        columns.push_back(make_column<arrow::DoubleBuilder>(loads));
+    }
+    write_parquet(inputs.reportloads_file, arrow::schema(fields), columns);
+
+    std::vector<BmpRowLand> base_land;
+    for (size_t k = 0; k < nparcels / 10; ++k) {
+        size_t lrseg = k % nlrsegs + 1;
+        int county = lrseg_county(lrseg);
+        base_land.push_back(BmpRowLand{
+            static_cast<int32_t>(k + 1), 9, fmt::format("SU{}", k), county_state(county),
+            LC_BMPS[k % LC_BMPS.size()], static_cast<int32_t>(100000 + lrseg - 1), static_cast<int32_t>(k % 10 + 1), 1,
+            acres_dist(gen), true, "", static_cast<int32_t>(k + 1)});
+    }
+    inputs.base_land = BmpTableLand::from_rows(base_land);
+    return inputs;
+}
@@ -0,0 +1,35 @@
+// Created by: Gregorio Toscano
+
+#ifndef SYNTHETIC_INPUTS_H
+#define SYNTHETIC_INPUTS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+
+/**
+ * Input files of a synthetic scenario with about nparcels land conversion,
+ * animal and manure transport parcels each, written under one directory in
+ * the formats Scenario::init and the readers expect:
+ *
+ *   {dir}/base.json, {dir}/scenario.json     Scenario::load
+ *   {dir}/csvs/cast_neighbors.json           Scenario::load_neighbors (MSU_CBPO_PATH={dir})
+ *   {dir}/manure_nutrients.parquet           Scenario::read_manure_nutrients
+ *   {dir}/reportloads.parquet                misc_utilities::read_loads
+ *
+ * The same (nparcels, seed) always produces the same files.
+ */
+struct SyntheticInputs {
+    std::string dir;
+    std::string base_file;
+    std::string scenario_file;
+    std::string manure_nutrients_file;
+    std::string reportloads_file;
+    BmpTableLand base_land; ///< nparcels / 10 base submission rows
+};
+
+SyntheticInputs write_synthetic_inputs(const std::string& dir, size_t nparcels, unsigned seed);
+
+#endif
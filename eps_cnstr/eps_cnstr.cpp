@@ -8,8 +8,12 @@
 #include "amqp.h"
 #include "eps_cnstr.h"
 #include "misc_utilities.h"
+#include "results_store.h"
+#include "thread_pool.h"
 #include "fmt/core.h"
 #include <filesystem>
+#include <chrono>
+#include <thread>
 
 namespace fs = std::filesystem;
 
@@ -36,31 +40,70 @@ EpsConstraint::EpsConstraint(const json& base_scenario_json, const json& scenari
     base_scenario_str_ = base_scenario_str;
     pso_exec_uuid_ = pso_exec_uuid;
     exec_path_ = exec_path;
+    // EPS_NTHREADS bounds the epsilon steps solved at once (default 1; 0 means
+    // one per core). Ipopt's HSL interfaces are not known to be safe across
+    // threads, so concurrent steps use mumps, whose calls Ipopt serializes,
+    // unless EPS_LINEAR_SOLVER names another solver.
+    nthreads_ = std::stoi(misc_utilities::get_env_var("EPS_NTHREADS", "1"));
+    if (nthreads_ <= 0) {
+        nthreads_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    linear_solver_ = misc_utilities::get_env_var("EPS_LINEAR_SOLVER", nthreads_ > 1 ? "mumps" : "ma57");
+    if (nthreads_ > 1 && linear_solver_ != "mumps") {
+        std::cerr << "Warning: EPS_NTHREADS=" << nthreads_ << " runs " << linear_solver_
+                  << " from several threads at once; use EPS_NTHREADS=1 unless it is thread-safe" << std::endl;
+    }
+    artifacts_ = ArtifactWriter::from_env();
 }
 
-bool EpsConstraint::evaluate(double reduction, int current_iteration=0) {
-    //app->Options()->SetNumericValue("tol", 1e-8);
-    int desired_verbosity_level = 1;
-    std::string log_filename = fmt::format("{}/ipopt.out", path_out_);
+namespace {
+    ApplicationReturnStatus set_ipopt_options(SmartPtr<IpoptApplication>& app, const std::string& log_filename, const std::string& linear_solver) {
+        //app->Options()->SetNumericValue("tol", 1e-8);
+        int desired_verbosity_level = 1;
+
+        app->Options()->SetIntegerValue("max_iter", 1000);
+        app->Options()->SetStringValue("linear_solver", linear_solver);
+
+        app->Options()->SetStringValue("output_file", log_filename.c_str());
+        app->Options()->SetIntegerValue("print_level", desired_verbosity_level);
+        // EPS_HESSIAN=exact uses EPA_NLP::eval_h instead of the L-BFGS approximation
+        auto hessian = misc_utilities::get_env_var("EPS_HESSIAN", "limited-memory");
+        if (hessian != "exact" && hessian != "limited-memory") {
+            std::cerr << "Unknown EPS_HESSIAN: " << hessian << " (expected \"exact\" or \"limited-memory\")" << std::endl;
+            exit(-1);
+        }
+        app->Options()->SetStringValue("hessian_approximation", hessian);
+        // e.g. EPS_DERIVATIVE_TEST=second-order runs Ipopt's finite-difference checker at the starting point
+        auto derivative_test = misc_utilities::get_env_var("EPS_DERIVATIVE_TEST", "none");
+        if (derivative_test != "none") {
+            app->Options()->SetStringValue("derivative_test", derivative_test);
+        }
+
+        return app->Initialize();
+    }
 
-    mynlp->update_reduction(reduction, current_iteration);
-    app->Options()->SetIntegerValue("max_iter", 1000);
-    app->Options()->SetStringValue("linear_solver", "ma57");
+    int solve(SmartPtr<IpoptApplication>& app, SmartPtr<EPA_NLP>& nlp, double reduction, int current_iteration, const std::string& log_filename, const std::string& linear_solver) {
+        nlp->update_reduction(reduction, current_iteration);
 
-    app->Options()->SetStringValue("output_file", log_filename.c_str());
-    app->Options()->SetIntegerValue("print_level", desired_verbosity_level);
-    app->Options()->SetStringValue("hessian_approximation", "limited-memory");
+        ApplicationReturnStatus status;
+        status = set_ipopt_options(app, log_filename, linear_solver);
+        if (status != Solve_Succeeded) {
+            std::cout << std::endl << std::endl << "*** Error during initialization!" << std::endl;
+            return (int) status;
+        }
 
-    ApplicationReturnStatus status;
-    status = app->Initialize();
-    if (status != Solve_Succeeded) {
-        std::cout << std::endl << std::endl << "*** Error during initialization!" << std::endl;
-        return (int) status;
+        auto solve_start = std::chrono::steady_clock::now();
+        status = app->OptimizeTNLP(nlp);
+        double solve_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - solve_start).count();
+        fmt::print("Ipopt solve (step {}, reduction {}): {:.3f} s\n", current_iteration, reduction, solve_secs);
+        return status;
     }
+}
 
-    status = app->OptimizeTNLP(mynlp);
+bool EpsConstraint::evaluate(double reduction, int current_iteration=0) {
+    std::string log_filename = fmt::format("{}/ipopt.out", path_out_);
     //mynlp->save_files(n, x);
-    return status;
+    return solve(app, mynlp, reduction, current_iteration, log_filename, linear_solver_);
 }
 
 
@@ -77,13 +120,32 @@ bool EpsConstraint::constr_eval(double reduction, int nsteps, const std::vector<
     double step_size = (double)reduction/nsteps;
     auto base_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", uuid);
     misc_utilities::mkdir(fmt::format("{}/ipopt_tmp", base_path));
+
+    // The steps only differ in their reduction target: each one gets its own
+    // EPA_NLP over the loaded data and its own IpoptApplication. Solutions are
+    // written afterwards in step order, so the appended files stay ordered.
+    size_t nworkers = std::min<size_t>(nthreads_, std::max(nsteps, 1));
+    std::vector<SmartPtr<EPA_NLP>> step_nlps(nsteps);
+    std::vector<int> results(nsteps, 0);
+    ThreadPool pool(nworkers);
+    pool.parallel_for(nsteps, [&](size_t i) {
+        int step = static_cast<int>(i);
+        step_nlps[i] = new EPA_NLP(mynlp->get_data(), path_out_, mynlp->pollutant_idx, uuid);
+        step_nlps[i]->set_defer_output(true);
+        SmartPtr<IpoptApplication> step_app = IpoptApplicationFactory();
+        auto log_filename = nworkers > 1 ? fmt::format("{}/ipopt_{}.out", path_out_, step) : fmt::format("{}/ipopt.out", path_out_);
+        results[i] = solve(step_app, step_nlps[i], step_size * (step + 1), step, log_filename, linear_solver_);
+    });
+    for (int i(0); i < nsteps; ++i) {
+        fmt::print("Result: {}\n", results[i] != 0);
+        step_nlps[i]->write_solution();
+    }
+
     //auto [parent_path_part, parent_uuid_part] = misc_utilities::extract_path_and_id(parent_uuid_path);
     //I want to have a dictionary with a uuid as key, and an integer (i) as value;
-    for (int i(0); i< nsteps; ++i) {
-        double lower_bound = step_size*(i+1);
-        auto result = evaluate(lower_bound, i);
-        fmt::print("Result: {}\n", result);
-
+    pool.parallel_for(nsteps, [&](size_t step) {
+        int i = static_cast<int>(step);
+        auto& nlp = step_nlps[i];
         //copy the files from the parent_uuid_path to the base_path 
         auto [parent_path, parent_uuid] = misc_utilities::extract_path_and_id(parent_uuid_path);
         misc_utilities::copy_prefix_in_to_prefix_out(parent_path, base_path, parent_uuid, uuids[i]);
@@ -93,24 +155,30 @@ bool EpsConstraint::constr_eval(double reduction, int nsteps, const std::vector<
         auto parent_land_path = fmt::format("{}_impbmpsubmittedland.parquet", parent_uuid_path);
         auto current_land_path = fmt::format("{}/ipopt_tmp/{}_{}", base_path, i,"impbmpsubmittedland.parquet");
         auto dst_land_path = fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path_, uuids[i]);
-        std::vector<std::tuple<int, int, int, int, int, int, double> > parent_land = mynlp->read_land(parent_land_path);
-        std::vector<std::tuple<int, int, int, int, int, int, double> > current_land = mynlp->read_land(current_land_path);
+        std::vector<std::tuple<int, int, int, int, int, int, double> > parent_land = nlp->read_land(parent_land_path);
+        std::vector<std::tuple<int, int, int, int, int, int, double> > current_land = nlp->read_land(current_land_path);
         parent_land.insert(parent_land.end(), current_land.begin(), current_land.end());
-        mynlp->write_land_barefoot(parent_land, dst_land_path);
+        nlp->write_land_barefoot(parent_land, dst_land_path);
         // merge the new bmps with the new bmps added on the top of the base
         parent_land_path = fmt::format("{}_impbmpsubmittedland_new_bmps.parquet", parent_uuid_path);
         current_land_path = fmt::format("{}/ipopt_tmp/{}_{}", base_path, i,"impbmpsubmittedland.parquet");
+        // CAST only reads the full submission files: the _new_bmps merge and
+        // the JSON copies are written while it evaluates and flushed in send_files
         dst_land_path = fmt::format("{}/{}_impbmpsubmittedland_new_bmps.parquet", exec_path_, uuids[i]);
-        parent_land = mynlp->read_land(parent_land_path);
-        current_land = mynlp->read_land(current_land_path);
-        parent_land.insert(parent_land.end(), current_land.begin(), current_land.end());
-        mynlp->write_land_barefoot(parent_land, dst_land_path); 
+        artifacts_->submit(dst_land_path, [&nlp, parent_land_path, current_land_path](const std::string& filename) {
+            auto new_land = nlp->read_land(parent_land_path);
+            auto current_new_land = nlp->read_land(current_land_path);
+            new_land.insert(new_land.end(), current_new_land.begin(), current_new_land.end());
+            nlp->write_land_barefoot(new_land, filename);
+        });
         auto parent_land_json_path = fmt::format("{}_impbmpsubmittedland.json", parent_uuid_path);
         auto current_land_json_path = fmt::format("{}/ipopt_tmp/{}_{}", base_path, i,"impbmpsubmittedland.json");
         auto dst_land_json_path = fmt::format("{}/{}_impbmpsubmittedland.json", exec_path_, uuids[i]);
-        misc_utilities::merge_json_files(current_land_json_path,
-                        parent_land_json_path,  
-                        dst_land_json_path);
+        artifacts_->submit(dst_land_json_path, [current_land_json_path, parent_land_json_path](const std::string& filename) {
+            misc_utilities::merge_json_files(current_land_json_path,
+                            parent_land_json_path,
+                            filename);
+        });
 
         /*
         json parent_land_json = misc_utilities::read_json_file(parent_land_json_path);
@@ -163,7 +231,9 @@ bool EpsConstraint::constr_eval(double reduction, int nsteps, const std::vector<
         misc_utilities::copy_file(parent_animal_path, dst_animal_path);  
         auto parent_animal_json_path = fmt::format("{}_impbmpsubmittedanimal.json", parent_uuid_path);
         auto dst_animal_json_path = fmt::format("{}/{}_impbmpsubmittedanimal.json", exec_path_, uuids[i]);
-        misc_utilities::copy_file(parent_animal_json_path, dst_animal_json_path);  
+        artifacts_->submit(dst_animal_json_path, [parent_animal_json_path](const std::string& filename) {
+            misc_utilities::copy_file(parent_animal_json_path, filename);
+        });  
 
         //***** MANURE TRANSPORT *****
         auto parent_manure_path = fmt::format("{}_impbmpsubmittedmanuretransport.parquet", parent_uuid_path);
@@ -171,14 +241,20 @@ bool EpsConstraint::constr_eval(double reduction, int nsteps, const std::vector<
         misc_utilities::copy_file(parent_manure_path, dst_manure_path);   
         auto parent_manure_json_path = fmt::format("{}_impbmpsubmittedmanuretransport.json", parent_uuid_path);
         auto dst_manure_json_path = fmt::format("{}/{}_impbmpsubmittedmanuretransport.json", exec_path_, uuids[i]);
-        misc_utilities::copy_file(parent_manure_json_path, dst_manure_json_path);
+        artifacts_->submit(dst_manure_json_path, [parent_manure_json_path](const std::string& filename) {
+            misc_utilities::copy_file(parent_manure_json_path, filename);
+        });
 
 
-    }
+    });
 
     if(evaluate_cast_) {
         send_files(scenario_data, uuid, uuids);
     }
+    // the queued jobs read through step_nlps
+    if (!artifacts_->flush()) {
+        std::cerr << "Some of the _new_bmps or JSON files of " << uuid << " could not be written" << std::endl;
+    }
     return true;
 }
 
@@ -188,16 +264,19 @@ std::vector<std::string>  EpsConstraint::send_files(const std::string& scenario_
     std::cout << "emo ipopt uuid " << base_scenario_uuid_ << "str: "  << base_scenario_str_ << std::endl; 
     fmt ::print("senario_data: {} {}\n", scenario_data, uuid);
 
-    for (const auto& exec_uuid : uuids) {
-        auto current_exec_uuid = fmt::format("{}", exec_uuid);
-        rabbit.send_signal(current_exec_uuid);
-    }
+    rabbit.send_signals(uuids);
 
     auto output_rabbit = rabbit.wait_for_all_data();
+    // the files copied below include the ones still in the artifact writer
+    if (!artifacts_->flush()) {
+        std::cerr << "Some of the _new_bmps or JSON files of " << uuid << " could not be written" << std::endl;
+    }
+    artifacts_->print_stats();
     int i = 0;
     auto base_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", pso_exec_uuid_);
 
     std::unordered_map<std::string, int> uuids_map;
+    ResultsStore results(ResultsStore::run_filename(pso_exec_uuid_));
 
     for (const auto& exec_uuid : uuids) {
         misc_utilities::copy_prefix_in_to_prefix_out(base_path, path_out_, uuids[i], fmt::format("{}",i));
@@ -231,7 +310,32 @@ std::vector<std::string>  EpsConstraint::send_files(const std::string& scenario_
 
         auto dst_cost_file = fmt::format("{}/{}_costs.json", path_out_, i);
         misc_utilities::write_json_file(dst_cost_file, output_json);
+
+        // the PSO takes the front from the results log instead of the *_costs.json files
+        if (!loads_json.contains("EoS-N")) {
+            std::cerr << "No loads for " << output_tmp[0] << ", not logging it" << std::endl;
+            continue;
+        }
+        ResultRecord record;
+        record.uuid = output_tmp[0];
+        record.origin = ResultOrigin::ipopt;
+        record.objectives = {output_json["cost"].get<double>(), loads_json["EoS-N"].get<double>()};
+        for (const auto& name : {"ef_cost", "lc_cost", "animal_cost", "manure_cost"}) {
+            record.values.emplace_back(name, output_json[name].get<double>());
+        }
+        for (const auto& [name, value] : loads_json.items()) {
+            record.values.emplace_back(name, value.get<double>());
+        }
+        record.directory = path_out_;
+        record.prefix = std::to_string(i);
+        for (const auto& suffix : misc_utilities::solution_file_suffixes()) {
+            if (fs::exists(fmt::format("{}/{}{}", path_out_, i, suffix))) {
+                record.files.push_back(suffix);
+            }
+        }
+        results.append(record);
     }
+    results.sync();
 
 
     nlohmann::json j;
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <coin-or/IpSmartPtr.hpp>
 #include <coin-or/IpIpoptApplication.hpp>
 #include "nlp.hpp"
+#include "artifact_writer.h"
 #include <nlohmann/json.hpp>
 
 #ifndef EPS_CNSTR_HPP
@@ -23,6 +25,11 @@ class EpsConstraint {
     std::string base_scenario_str_;
     std::string pso_exec_uuid_;
     std::string exec_path_;
+    int nthreads_;
+    /** Ipopt linear_solver; ma57 unless steps are solved concurrently */
+    std::string linear_solver_;
+    /** merged _new_bmps and JSON copies, written while CAST evaluates the steps */
+    std::shared_ptr<ArtifactWriter> artifacts_;
     //EPA_NLP *mynlp;
 public:
 
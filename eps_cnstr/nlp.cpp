@@ -56,6 +56,11 @@ namespace {
     std::string REDIS_DB_OPT = misc_utilities::get_env_var("REDIS_DB_OPT", "1");
     std::string REDIS_URL = fmt::format("tcp://{}:{}/{}", REDIS_HOST, REDIS_PORT, REDIS_DB_OPT);
 
+    // the data is shared read-only between instances, so missing groups read as 0 instead of being inserted
+    int load_src_group(const EpaNlpData& d, const std::string& load_src) {
+        auto it = d.u_u_group.find(load_src);
+        return it != d.u_u_group.end() ? it->second : 0;
+    }
 }
 namespace rnd
 {
@@ -124,16 +129,40 @@ EPA_NLP::EPA_NLP(const json& base_scenario_json, const json& scenario_json, cons
     //update_reduction(max_constr, current_iteration_);
     fmt::print("Max constr: {}, {}\n", this->max_constr, max_constr);
     has_content = false;
+    defer_output_ = false;
+    has_solution_ = false;
+}
+
+EPA_NLP::EPA_NLP(std::shared_ptr<const EpaNlpData> data, const std::string& path_out, int pollutant_idx, const std::string& uuid) {
+    uuid_ = uuid;
+    path_out_ = path_out;
+    data_ = std::move(data);
+    this->pollutant_idx = pollutant_idx;
+    this->total_cost = 1.0;
+    this->total_acres = 1.0;
+    this->max_constr = 0.0;
+    current_iteration_ = 0;
+    has_content = false;
+    defer_output_ = false;
+    has_solution_ = false;
 }
 
 
 void EPA_NLP::update_reduction(double max_constr, int current_iteration) {
     current_iteration_ = current_iteration;
-    this->max_constr = (1.0 - max_constr) * sum_load_valid_[pollutant_idx];
+    this->max_constr = (1.0 - max_constr) * data_->sum_load_valid[pollutant_idx];
 }
 
 EPA_NLP::~EPA_NLP() {}
 
+void EPA_NLP::set_defer_output(bool defer) {
+    defer_output_ = defer;
+}
+
+std::shared_ptr<const EpaNlpData> EPA_NLP::get_data() const {
+    return data_;
+}
+
 bool EPA_NLP::get_nlp_info(
         Index &n,
         Index &m,
@@ -143,53 +172,53 @@ bool EPA_NLP::get_nlp_info(
 ) {
 
     
-    n = nvars_;
-    m = ncons_;
+    n = data_->nvars;
+    m = data_->ncons;
 
     int tmp_limit_bmp_counter = 0;
-    for (auto const&[key, val]: limit_bmps_dict) {
-        tmp_limit_bmp_counter += limit_vars_dict[key].size();
+    for (auto const&[key, val]: data_->limit_bmps) {
+        tmp_limit_bmp_counter += data_->limit_vars.at(key).size();
     }
 
-    nnz_jac_g = nvars_ * 2 + tmp_limit_bmp_counter;
-    nnz_h_lag = (int) (nvars_ * (nvars_ + 1)) / 2.0;
+    nnz_jac_g = data_->nvars * 2 + tmp_limit_bmp_counter;
+    nnz_h_lag = data_->model.hessian_nnz();
     index_style = TNLP::C_STYLE;
 
     return true;
 }
 
 //=============================================================================
-void EPA_NLP::compute_efficiency_keys() {
-    for (const auto& pair : efficiency_) {
-        ef_keys_.push_back(pair.first);
+void EPA_NLP::compute_efficiency_keys(EpaNlpData& d) {
+    for (const auto& pair : d.efficiency) {
+        d.ef_keys.push_back(pair.first);
     }
     // Sort the vector of keys
-    std::sort(ef_keys_.begin(), ef_keys_.end());
+    std::sort(d.ef_keys.begin(), d.ef_keys.end());
 }
 /*
  * *
  */
-void EPA_NLP::filter_efficiency_keys() {
+void EPA_NLP::filter_efficiency_keys(EpaNlpData& d) {
     auto redis = sw::redis::Redis(REDIS_URL);
 
     std::vector<std::string> keys_to_remove;
     size_t bmps_removed = 0;
     size_t bmps_sum = 0;
     size_t bmps_sum2 = 0;
-    for (const auto &key: ef_keys_) {
+    for (const auto &key: d.ef_keys) {
         std::vector <std::string> out;
         misc_utilities::split_str(key, '_', out);
         auto lrseg = out[0];
         auto load_src = out[2];
-        auto state_id = lrseg_.at(lrseg)[1];
-        auto& bmp_groups =  efficiency_[key];
-        if (amount_.find(key) == amount_.end() ||
-            phi_dict_.find(key) == phi_dict_.end() ||
+        auto state_id = d.lrseg.at(lrseg)[1];
+        auto& bmp_groups =  d.efficiency[key];
+        if (d.amount.find(key) == d.amount.end() ||
+            d.phi_dict.find(key) == d.phi_dict.end() ||
             bmp_groups.size() <= 0 ) {
             keys_to_remove.push_back(key);
             continue;
         }
-        auto alpha = amount_[key];
+        auto alpha = d.amount[key];
         
         if (alpha <= 1.0){
             keys_to_remove.push_back(key);
@@ -201,8 +230,8 @@ void EPA_NLP::filter_efficiency_keys() {
                 std::string s_tmp = fmt::format("{}_{}_{}", bmp, lrseg, load_src);
                 auto bmp_cost_key = fmt::format("{}_{}", state_id, bmp);
                 if (!redis.hexists("ETA", s_tmp) ||
-                    bmp_cost_.find(bmp_cost_key) == bmp_cost_.end() ||
-                    bmp_cost_[bmp_cost_key] <= 0.0 ) {
+                    d.bmp_cost.find(bmp_cost_key) == d.bmp_cost.end() ||
+                    d.bmp_cost[bmp_cost_key] <= 0.0 ) {
                     //remove bmp from bmp_group
                     bmps_to_remove.push_back(bmp);
                 }
@@ -221,37 +250,37 @@ void EPA_NLP::filter_efficiency_keys() {
     std::sort(keys_to_remove.begin(), keys_to_remove.end());
     
     // Use erase-remove idiom with a lambda function
-    ef_keys_.erase(std::remove_if(ef_keys_.begin(), ef_keys_.end(), 
+    d.ef_keys.erase(std::remove_if(d.ef_keys.begin(), d.ef_keys.end(), 
         [&keys_to_remove](const std::string& key) {
             return std::binary_search(keys_to_remove.begin(), keys_to_remove.end(), key);
         }), 
-        ef_keys_.end());
+        d.ef_keys.end());
     fmt::print("bmps_remove {} out from {} total {}\n", bmps_removed, bmps_sum, bmps_sum2);
     fmt::print("keys_to_remove size: {}\n", keys_to_remove.size());
 }
 
 // different from the original
-void EPA_NLP::compute_efficiency_size() {
-    nvars_ = 0;
-    ncons_ = 1;
+void EPA_NLP::compute_efficiency_size(EpaNlpData& d) {
+    d.nvars = 0;
+    d.ncons = 1;
 
-    for (const auto &key: ef_keys_) {
-        auto& bmp_groups =  efficiency_[key];
+    for (const auto &key: d.ef_keys) {
+        auto& bmp_groups =  d.efficiency[key];
         for (const auto &bmp_group : bmp_groups) {
             for (const auto &bmp : bmp_group) {
-                ++nvars_;
+                ++d.nvars;
             }
-            ++ncons_;
+            ++d.ncons;
         }
     }
 }
 
 
-void EPA_NLP::compute_eta() {
+void EPA_NLP::compute_eta(EpaNlpData& d) {
     auto redis = sw::redis::Redis(REDIS_URL);
 
-    for (const auto &key: ef_keys_) {
-        auto& bmp_groups =  efficiency_[key];
+    for (const auto &key: d.ef_keys) {
+        auto& bmp_groups =  d.efficiency[key];
         std::vector <std::string> out;
         misc_utilities::split_str(key, '_', out);
         auto lrseg = out[0];
@@ -273,7 +302,7 @@ void EPA_NLP::compute_eta() {
 
                 if(!eta_tmp.empty()) {
                    std::vector<double> content_eta({stof(eta_tmp[0]), stof(eta_tmp[1]), stof(eta_tmp[2])});
-                   eta_dict_[s_tmp] = content_eta;
+                   d.eta_dict[s_tmp] = content_eta;
                 }
             }
         }
@@ -309,7 +338,7 @@ std::vector<double> compute_loads(std::vector<std::string>& parcel_keys, std::un
     return ret;
 }
 std::string EPA_NLP::get_scenario_data() {
-    return scenario_data_;
+    return data_->scenario_data;
 }
 
 std::string EPA_NLP::get_uuid() {
@@ -318,6 +347,8 @@ std::string EPA_NLP::get_uuid() {
 
 
 void EPA_NLP::load(const json& base_scenario_json, const json& scenario_json) {
+    auto data = std::make_shared<EpaNlpData>();
+    auto& d = *data;
 
     std::vector<std::string> keys_to_check = {"amount", "phi", "efficiency", "lrseg", "bmp_cost", "u_u_group", "sum_load_valid", "sum_load_invalid", "ef_bmps", "scenario_data_str" };
     for (const auto& key : keys_to_check) {
@@ -326,7 +357,7 @@ void EPA_NLP::load(const json& base_scenario_json, const json& scenario_json) {
             exit(-1);
         }
     }
-    scenario_data_ = base_scenario_json["scenario_data_str"].get<std::string>();
+    d.scenario_data = base_scenario_json["scenario_data_str"].get<std::string>();
     std::vector<std::string> keys_to_check_scenario = {"selected_bmps", "bmp_cost", "selected_reduction_target", "sel_pollutant", "target_pct", "uuid"};
 
     for (const auto& key : keys_to_check_scenario) {
@@ -345,15 +376,15 @@ void EPA_NLP::load(const json& base_scenario_json, const json& scenario_json) {
 
 
     // Access the JSON data
-    amount_ = base_scenario_json["amount"].get<std::unordered_map<std::string, double>>();
-    phi_dict_ = base_scenario_json["phi"].get<std::unordered_map<std::string, std::vector<double>>>();
-    efficiency_ = base_scenario_json["efficiency"].get<std::unordered_map<std::string, std::vector<std::vector<int>>>>();
+    d.amount = base_scenario_json["amount"].get<std::unordered_map<std::string, double>>();
+    d.phi_dict = base_scenario_json["phi"].get<std::unordered_map<std::string, std::vector<double>>>();
+    d.efficiency = base_scenario_json["efficiency"].get<std::unordered_map<std::string, std::vector<std::vector<int>>>>();
     
     std::unordered_map<std::string, std::vector<double>> phi_dict = base_scenario_json["phi"].get<std::unordered_map<std::string, std::vector<double>>>();
 
     std::unordered_map<std::string, std::vector<std::vector<int>>> filtered_efficiency;
     std::vector<std::string> filtered_valid_ef_keys;
-    for (const auto&[key, val]: efficiency_) {
+    for (const auto&[key, val]: d.efficiency) {
         std::vector<std::vector<int>> filtered_bmps;
         for (const auto& bmp_group: val) {
             std::vector<int> filtered_bmps_group;
@@ -373,17 +404,17 @@ void EPA_NLP::load(const json& base_scenario_json, const json& scenario_json) {
     }
 
     std::vector<std::string> filtered_invalid_ef_keys;
-    for (const auto&[key, val]: efficiency_) {
+    for (const auto&[key, val]: d.efficiency) {
         if (std::find(filtered_valid_ef_keys.begin(), filtered_valid_ef_keys.end(), key) == filtered_valid_ef_keys.end()) {
             filtered_invalid_ef_keys.push_back(key);
         }
     }
 
-    efficiency_ = filtered_efficiency; 
+    d.efficiency = filtered_efficiency; 
 
 
-    auto sum_load_valid = compute_loads(filtered_valid_ef_keys, phi_dict, amount_);
-    auto sum_load_invalid = compute_loads(filtered_invalid_ef_keys, phi_dict, amount_);
+    auto sum_load_valid = compute_loads(filtered_valid_ef_keys, phi_dict, d.amount);
+    auto sum_load_invalid = compute_loads(filtered_invalid_ef_keys, phi_dict, d.amount);
 
 
     //print filtered_efficiency
@@ -401,30 +432,69 @@ void EPA_NLP::load(const json& base_scenario_json, const json& scenario_json) {
     }
     */
 
-    bmp_cost_ = base_scenario_json["bmp_cost"].get<std::unordered_map<std::string, double>>();
+    d.bmp_cost = base_scenario_json["bmp_cost"].get<std::unordered_map<std::string, double>>();
     // replace bmp_cost with updated_bmp_cost 
     for (const auto&[key, val]: updated_bmp_cost) {
-        if (bmp_cost_.find(key) != bmp_cost_.end()) {
-            bmp_cost_[key] = updated_bmp_cost[key];
+        if (d.bmp_cost.find(key) != d.bmp_cost.end()) {
+            d.bmp_cost[key] = updated_bmp_cost[key];
 
         }
     }
 
-    lrseg_ = base_scenario_json["lrseg"].get<std::unordered_map<std::string, std::vector<int>>>();
+    d.lrseg = base_scenario_json["lrseg"].get<std::unordered_map<std::string, std::vector<int>>>();
 
 
-    u_u_group_dict = base_scenario_json["u_u_group"].get<std::unordered_map<std::string, int>>();
+    d.u_u_group = base_scenario_json["u_u_group"].get<std::unordered_map<std::string, int>>();
 
 
-    sum_load_valid_ = base_scenario_json["sum_load_valid"].get<std::vector<double>>();
-    sum_load_invalid_ = base_scenario_json["sum_load_invalid"].get<std::vector<double>>();
-    sum_load_valid_ = sum_load_valid;
-    sum_load_invalid_ = sum_load_invalid;
+    d.sum_load_valid = base_scenario_json["sum_load_valid"].get<std::vector<double>>();
+    d.sum_load_invalid = base_scenario_json["sum_load_invalid"].get<std::vector<double>>();
+    d.sum_load_valid = sum_load_valid;
+    d.sum_load_invalid = sum_load_invalid;
 
-    compute_efficiency_keys();
-    filter_efficiency_keys();
-    compute_efficiency_size();
-    compute_eta();
+    compute_efficiency_keys(d);
+    filter_efficiency_keys(d);
+    compute_efficiency_size(d);
+    compute_eta(d);
+    compile_model(d);
+    data_ = data;
+}
+
+/*
+ * Flattens the per-variable coefficients used by the Ipopt callbacks so they
+ * no longer split keys or probe the string-keyed maps on every iteration.
+ */
+void EPA_NLP::compile_model(EpaNlpData& d) {
+    d.model = NlpModel();
+    d.model.group_begin.push_back(0);
+    d.model.parcel_group_begin.push_back(0);
+
+    for (const auto &key: d.ef_keys) {
+        std::vector <std::string> out;
+        misc_utilities::split_str(key, '_', out);
+        auto lrseg = out[0];
+        auto load_src = out[2];
+        auto state_id = d.lrseg.at(lrseg)[1];
+        auto alpha = d.amount[key];
+        auto& phi = d.phi_dict[key];
+        auto& bmp_groups =  d.efficiency[key];
+        for (const auto &bmp_group: bmp_groups) {
+            for (const auto &bmp: bmp_group) {
+                d.model.alpha.push_back(alpha);
+                d.model.unit_cost.push_back(d.bmp_cost[fmt::format("{}_{}", state_id, bmp)]);
+                auto eta = d.eta_dict.find(fmt::format("{}_{}_{}", bmp, lrseg, load_src));
+                for (int k = 0; k < NlpModel::NPOLLUTANTS; ++k) {
+                    d.model.eta.push_back(eta != d.eta_dict.end() ? eta->second[k] : 0.0);
+                }
+            }
+            d.model.group_begin.push_back(d.model.alpha.size());
+        }
+        d.model.parcel_group_begin.push_back(d.model.group_begin.size() - 1);
+        d.model.parcel_alpha.push_back(alpha);
+        for (int k = 0; k < NlpModel::NPOLLUTANTS; ++k) {
+            d.model.parcel_phi.push_back(phi[k]);
+        }
+    }
 }
 
 
@@ -449,8 +519,8 @@ bool EPA_NLP::get_bounds_info(
         g_u[i] = 1.0;
     }
     /*
-    int cnstr_counter = m - limit_bmps_dict.size();
-    for (auto const&[key, val]: limit_bmps_dict) {
+    int cnstr_counter = m - data_->limit_bmps.size();
+    for (auto const&[key, val]: data_->limit_bmps) {
         g_l[cnstr_counter] = val[0];
 
         g_u[cnstr_counter] = val[1];
@@ -475,27 +545,8 @@ bool EPA_NLP::get_starting_point(
     assert(init_x == true);
     assert(init_z == false);
     assert(init_lambda == false);
-    // initialize to the given starting point
-    for (int i = 0; i < nvars_; ++i) {
-        //x[i] = initial_x[i];
-        x[i] = 0.0; 
-    }
-
-    //start with greedy solution
-    size_t idx = 0;
-    for (const auto &key: ef_keys_) {
-        auto& bmp_groups =  efficiency_[key];
-        for (const auto &bmp_group : bmp_groups) {
-            bool flag = true;
-            for (const auto &bmp : bmp_group) {
-                if(flag == true) {
-                    x[idx] = 1.0;
-                    flag = false;
-                }
-                ++idx;
-            }
-        }
-    }
+    // initialize to the given starting point: start with greedy solution
+    data_->model.starting_point(x);
 
     return true;
 }
@@ -506,43 +557,8 @@ bool EPA_NLP::eval_f(
         bool new_x,
         Number &obj_value
 ) {
-    assert(n == nvars_);
-    double fitness = 0.0;
-    int idx = 0;
-
-    for (const auto &key: ef_keys_) {
-        std::vector <std::string> out;
-        misc_utilities::split_str(key, '_', out);
-        auto lrseg = out[0];
-        auto load_src = out[2];
-        auto state_id = lrseg_.at(lrseg)[1];
-        auto alpha = amount_[key];
-        auto& bmp_groups =  efficiency_[key];
-        for (const auto &bmp_group : bmp_groups) {
-            for (const auto &bmp : bmp_group) {
-                double pct = x[idx];
-                ++idx;
-                if (pct < 0.0) {
-                    pct = 0.0;
-                }
-
-                auto bmp_cost_key = fmt::format("{}_{}", state_id, bmp);
-                double cost = pct * alpha * bmp_cost_[bmp_cost_key];
-                if(cost < 0.0){
-                    fmt::print("cost: {}\n", cost);
-                    fmt::print("pct: {}\n", pct);
-                    fmt::print("alpha: {}\n", alpha);
-                    fmt::print("bmp_cost_key: {} = {} \n", bmp_cost_key, bmp_cost_[bmp_cost_key]);
-                    exit(0);
-                }
-
-                fitness += cost;
-            }
-        }
-    }
-
-
-    obj_value = fitness;
+    assert(n == data_->nvars);
+    obj_value = data_->model.objective(x);
     assert(obj_value>0);
     return true;
 }
@@ -553,25 +569,7 @@ bool EPA_NLP::eval_grad_f(
         bool new_x,
         Number *grad_f
 ) {
-    int idx = 0;
-
-    for (const auto &key: ef_keys_) {
-        std::vector <std::string> out;
-        misc_utilities::split_str(key, '_', out);
-        auto lrseg = out[0];
-        auto state_id = lrseg_.at(lrseg)[1];
-        auto alpha = amount_[key];
-        auto& bmp_groups =  efficiency_[key];
-        for (const auto &bmp_group : bmp_groups) {
-            for (const auto &bmp : bmp_group) {
-                auto bmp_cost_key = fmt::format("{}_{}", state_id, bmp);
-                grad_f[idx] =  alpha* bmp_cost_[bmp_cost_key];
-                ++idx;
-            }
-        }
-    }
-
-
+    data_->model.gradient(grad_f);
     return true;
 }
 
@@ -593,59 +591,10 @@ bool EPA_NLP::eval_g_proxy(
         Number *g,
         bool is_final 
 ) {
-    assert(n == nvars_);
+    assert(n == data_->nvars);
 
-    double total_cost = 0;
-    std::vector<double> fx(2, 0.0);
-    int nconstraints = 1;
-
-    std::vector<double> pt_load(3, 0.0);
-    size_t idx = 0;
-    for (const auto &key: ef_keys_) {
-        auto& bmp_groups =  efficiency_[key];
-        std::vector<double> prod(3, 1);
-        std::vector <std::string> out;
-        misc_utilities::split_str(key, '_', out);
-        auto lrseg = out[0];
-        auto load_src = out[2];
-        for (const auto &bmp_group: bmp_groups) {
-            std::vector<double> sigma(3, 0.0);
-            auto sigma_cnstr = 0.0;
-            for (const auto &bmp: bmp_group) {
-                auto pct = x[idx];
-                idx++;
-                std::string s_tmp = fmt::format("{}_{}_{}", bmp, lrseg, load_src);
-                std::vector<double> eta(3,0.0);
-                if (eta_dict_.find(s_tmp) != eta_dict_.end()) {
-                    eta[0] = eta_dict_[s_tmp][0];
-                    eta[1] = eta_dict_[s_tmp][1];
-                    eta[2] = eta_dict_[s_tmp][2];
-                }
-                sigma[0] += eta[0] * pct;
-                sigma[1] += eta[1] * pct;
-                sigma[2] += eta[2] * pct;
-                sigma_cnstr += pct;
-                std::cout << "NLP.cpp Sigma_cnstr " << sigma_cnstr << std::endl; 
-            }
-
-
-            prod[0] *= (1.0 - sigma[0]);
-            prod[1] *= (1.0 - sigma[1]);
-            prod[2] *= (1.0 - sigma[2]);
-
-            g[nconstraints] = sigma_cnstr;
-            ++nconstraints;
-        }
-        if(!phi_dict_.contains(key)) {
-            std::cout<<"nooooooo.... no key here\n"<<key<<"\n";
-        }
-        auto phi = phi_dict_[key];
-        auto alpha = amount_[key];
-        pt_load[0] += phi[0] * alpha * prod[0];
-        pt_load[1] += phi[1] * alpha * prod[1];
-        pt_load[2] += phi[2] * alpha * prod[2];
-
-    }
+    double pt_load[NlpModel::NPOLLUTANTS];
+    data_->model.constraints(x, g, pt_load);
     g[0] = pt_load[pollutant_idx];
 
     if (is_final == true) {
@@ -653,33 +602,6 @@ bool EPA_NLP::eval_g_proxy(
         g[1] = pt_load[1];
         g[2] = pt_load[2];
     }
-    /*
-
-    for (auto const&[key, val]: limit_bmps_dict) {
-        auto vars = limit_vars_dict[key];
-        auto alphas = limit_alpha_dict[key];
-        double tmp_sum = 0.0;
-        for (int i(0); i < vars.size(); ++i) {
-            tmp_sum += x[vars[i]] * alphas[i];
-        }
-        g[nconstraints] = tmp_sum;
-        ++nconstraints;
-    }
-    */
-
-    /*
-    //g[0] =  (sum_load_invalid_[0] + pt_load[0]) - 0.8*(sum_load_invalid_[0] + sum_load_valid_[0]) ;
-    double load_ub = sum_load_invalid_[load_to_opt_] + sum_load_valid_[load_to_opt_];
-    double load_obtained = sum_load_invalid_[load_to_opt_] + pt_load[load_to_opt_];
-
-    double load_lb = 0.8 * load_ub; //20% reduction
-    g[0] = (load_obtained < load_lb)?(load_obtained-load_lb)/load_ub:0;
-
-    double cost_ub = 1000000.0;
-    double cost_steps = 1000000.0;
-    g[1] = (total_cost > cost_ub)? (cost_ub-total_cost)/cost_steps:0;
-    fx[1] = sum_load_invalid_[load_to_opt_] + pt_load[load_to_opt_];
-    */
 
     return true;
 }
@@ -695,33 +617,16 @@ bool EPA_NLP::eval_jac_g(
         Index *jCol,
         Number *values
 ) {
-    assert(n == nvars_);
+    assert(n == data_->nvars);
     if (values == NULL) {
         // return the structure of the Jacobian
         // this particular Jacobian is not dense
-        
-        for (int i = 0; i < nvars_; ++i) {
-            iRow[i] = 0;
-            jCol[i] = i;
-        }
-
-        int jac_index = nvars_;
-        int jac_row = 1;
-        for (const auto &key: ef_keys_) {
-            auto& bmp_groups =  efficiency_[key];
-            for (const auto &bmp_group: bmp_groups) {
-                for (const auto &bmp: bmp_group) {
-                        iRow[jac_index] = jac_row;
-                        jCol[jac_index] = jac_index - nvars_;
-                        ++jac_index;
-                }
-                ++jac_row;
-            }
-        }
+        data_->model.jacobian_structure(iRow, jCol);
 
-
-        for (auto const&[key, val]: limit_bmps_dict) {
-            for (auto &var_idx: limit_vars_dict[key]) {
+        int jac_index = data_->nvars * 2;
+        int jac_row = data_->model.ngroups() + 1;
+        for (auto const&[key, val]: data_->limit_bmps) {
+            for (auto &var_idx: data_->limit_vars.at(key)) {
                 iRow[jac_index] = jac_row;
                 jCol[jac_index] = var_idx;
                 ++jac_index;
@@ -731,95 +636,12 @@ bool EPA_NLP::eval_jac_g(
         }
     } else {
         // return the values of the Jacobian of the constraints
-        size_t parcel_idx = 0;
-        size_t idx = 0;
-        size_t j = 0;
-
-        for (const auto &key: ef_keys_) {
-            std::vector<double> prod(3, 1);
-            std::vector <std::string> out;
-            misc_utilities::split_str(key, '_', out);
-            std::vector<std::vector<double>> sigma_less;
-            std::vector<std::vector<double>> sigma_full;
-            auto lrseg = out[0];
-            auto load_src = out[2];
-            auto alpha = amount_[key];
-            auto phi = phi_dict_[key];
-            auto& bmp_groups =  efficiency_[key];
-
-            size_t grp_counter = 0;
-            for (const auto &bmp_group: bmp_groups) {
-                std::vector<double> sigma(3, 0.0);
-                auto saved_idx = idx;
-                for (const auto &bmp: bmp_group) {
-                    double pct = x[idx];
-                    ++idx;
-                    std::string s_tmp = fmt::format("{}_{}_{}", bmp, lrseg, load_src);
-
-                    if (eta_dict_.find(s_tmp) != eta_dict_.end()) {
-                        auto eta = eta_dict_[s_tmp];
-                        sigma[0] += eta[0] * pct;
-                        sigma[1] += eta[1] * pct;
-                        sigma[2] += eta[2] * pct;
-                    }
-                }
-                idx = saved_idx;
-                sigma_full.push_back({sigma[0], sigma[1], sigma[2]});
-                for (const auto &bmp: bmp_group) {
-                    double pct = x[idx];
-                    ++idx;
-                    std::string s_tmp = fmt::format("{}_{}_{}", bmp, lrseg, load_src);
-                    std::vector<double> eta(3,0.0);
-                    if (eta_dict_.find(s_tmp) != eta_dict_.end()) {
-                        eta[0] = eta_dict_[s_tmp][0];
-                        eta[1] = eta_dict_[s_tmp][1];
-                        eta[2] = eta_dict_[s_tmp][2];
-                    }
-                    sigma_less.push_back({sigma[0] - eta[0] * pct, sigma[1] - eta[1] * pct, sigma[2] - eta[2] * pct});
-                }
-
-                prod[0] *= 1.0 - sigma[0];
-                prod[1] *= 1.0 - sigma[1];
-                prod[2] *= 1.0 - sigma[2];
-                ++grp_counter;
-            }
-            grp_counter = 0;
-            size_t k = 0;
-            for (const auto &bmp_group: bmp_groups) {
-                for (const auto &bmp: bmp_group) {
-                    std::string s_tmp = fmt::format("{}_{}_{}", bmp, lrseg, load_src);
-                    std::vector<double> eta (3, 0.0);
-                    if (eta_dict_.find(s_tmp) != eta_dict_.end()) {
-                        eta[0] = eta_dict_[s_tmp][0];
-                        eta[1] = eta_dict_[s_tmp][1];
-                        eta[2] = eta_dict_[s_tmp][2];
-                    }
-                    values[j] = prod[pollutant_idx] / (1.0 - sigma_full[grp_counter][pollutant_idx]);
-                    values[j] *= (1.0 - sigma_less[k][pollutant_idx]);
-                    values[j] *= alpha * phi[pollutant_idx] * (-eta[pollutant_idx]);
-                    
-                    ++j;
-                    ++k;
-                }
-                ++grp_counter;
-            }
-        }
+        data_->model.jacobian_values(x, pollutant_idx, values);
 
-        int var_counter = 0;
+        int limit_cnstr_counter = data_->nvars * 2;
 
-        for (const auto &key: ef_keys_) {
-            auto& bmp_groups =  efficiency_[key];
-            for (const auto &bmp_group: bmp_groups) {
-                for (const auto &bmp: bmp_group) {
-                    values[nvars_+ var_counter] = 1;
-                    ++var_counter;
-                }
-            }
-        }
-        int limit_cnstr_counter = nvars_ * 2;
-
-        for (auto const&[key, val]: limit_bmps_dict) {
-            for (auto &my_alpha: limit_alpha_dict[key]) {
+        for (auto const&[key, val]: data_->limit_bmps) {
+            for (auto &my_alpha: data_->limit_alpha.at(key)) {
                 values[limit_cnstr_counter] = my_alpha;
                 ++limit_cnstr_counter;
             }
@@ -843,91 +665,17 @@ bool EPA_NLP::eval_h(
         Index *jCol,
         Number *values
 ) {
-    assert(n == nvars_);
+    assert(n == data_->nvars);
 
+    // the objective, the group rows and the BMP limit rows are linear: only the load row (lambda[0]) has curvature
     if (values == NULL) {
-        Index idx = 0;
-        for (Index row = 0; row < nvars_; row++) {
-            for (Index col = 0; col <= row; col++) {
-                iRow[idx] = row;
-                jCol[idx] = col;
-                idx++;
-            }
-        }
-
-        assert(idx == nele_hess);
+        data_->model.hessian_structure(iRow, jCol);
+        assert((size_t) nele_hess == data_->model.hessian_nnz());
     } else {
-        int parcel_idx = 0;
-        /*
-        for (int j(0); j < nvars_;) {
-            double alpha = alpha_vec[parcel_idx];
-            double phi = phi_vec[parcel_idx][pollutant_idx];
-            int s = s_h_u_vec[parcel_idx][0];
-            int u = s_h_u_vec[parcel_idx][2];
-            int acc_idx = 0;
-            auto bmps = bmp_grp_src_links_vec[parcel_idx];
-            double prod = 1.0;
-            int ngroups = (int) bmp_grp_src_counter_vec[parcel_idx].size();
-            std::vector<double> sigma_less(bmps.size(), 0.0);
-            std::vector<double> sigma_full(ngroups, 0.0);
-            int j_saved = j;
-            int grp_counter = 0;
-            for (auto &&bmp_counter: bmp_grp_src_counter_vec[parcel_idx]) {
-                double sigma = 0.0;
-                for (int bc = 0; bc < bmp_counter; ++bc) {
-                    int bmp_idx = bmps[acc_idx + bc];
-                    double pct = x[j];
-                    std::string s_tmp = fmt::format("{}_{}_{}", bmp_idx, s, u);
-                    sigma += eta_dict_[s_tmp][pollutant_idx] * pct;
-                    ++j;
-                }
-
-                sigma_full[grp_counter] = sigma;
-                j -= bmp_counter;
-
-                for (int bc = 0; bc < bmp_counter; ++bc) {
-                    int bmp_idx = bmps[acc_idx + bc];
-                    double pct = x[j];
-                    ++j;
-                    std::string s_tmp = fmt::format("{}_{}_{}", bmp_idx, s, u);
-                    double eta_value = 0.0;
-                    if (eta_dict_.find(s_tmp) != eta_dict_.end()) {
-                        eta_value = eta_dict_[s_tmp][pollutant_idx];
-                    }
-                    sigma_less[acc_idx + bc] = sigma - eta_value * pct;
-                    //values[nvars_+cnstr_counter] = sigma_less[acc_idx + bc];
-                }
-                acc_idx += bmp_counter;
-                prod *= 1.0 - sigma;
-                ++grp_counter;
-            }
-            grp_counter = 0;
-            j = j_saved;
-            acc_idx = 0;
-            for (auto &&bmp_counter: bmp_grp_src_counter_vec[parcel_idx]) {
-                for (int bc = 0; bc < bmp_counter; ++bc) {
-                    int bmp_idx = bmps[acc_idx + bc];
-                    ++j;
-                }
-                acc_idx += bmp_counter;
-                ++grp_counter;
-            }
-
-            ++parcel_idx;
-        }
-        int nparcels = bmp_grp_src_counter_vec.size();
-        int var_counter = 0;
-        for (int my_parcel_idx(0); my_parcel_idx < nparcels; ++my_parcel_idx) {
-            for (auto &&bmp_counter: bmp_grp_src_counter_vec[my_parcel_idx]) {
-                for (int bc = 0; bc < bmp_counter; ++bc) {
-                    ++var_counter;
-                }
-            }
-        }
-        */
+        data_->model.hessian_values(x, pollutant_idx, lambda[0], values);
     }
 
-    return false;
+    return true;
 }
 
 
@@ -960,15 +708,15 @@ void EPA_NLP::save_files(
     // Iterate through each line and split the content using delimeter
     bool flag = false;
 
-    for (const auto &key: ef_keys_) {
+    for (const auto &key: data_->ef_keys) {
         std::vector <std::string> out;
         misc_utilities::split_str(key, '_', out);
         auto lrseg = out[0];
         auto agency = out[1];
         auto load_src = out[2];
-        auto state_id = lrseg_.at(lrseg)[1];
-        auto alpha = amount_[key];
-        auto& bmp_groups =  efficiency_[key];
+        auto state_id = data_->lrseg.at(lrseg)[1];
+        auto alpha = data_->amount.at(key);
+        auto& bmp_groups =  data_->efficiency.at(key);
         auto unit_id = 1;
         for (const auto &bmp_group : bmp_groups) {
             for (const auto &bmp : bmp_group) {
@@ -1210,15 +958,15 @@ void EPA_NLP::save_files2(
     bool flag = false;
     ef_x_.clear();
 
-    for (const auto &key: ef_keys_) {
+    for (const auto &key: data_->ef_keys) {
         std::vector <std::string> out;
         misc_utilities::split_str(key, '_', out);
         auto lrseg = out[0];
         auto agency = out[1];
         auto load_src = out[2];
-        auto state_id = lrseg_.at(lrseg)[1];
-        auto alpha = amount_[key];
-        auto& bmp_groups =  efficiency_[key];
+        auto state_id = data_->lrseg.at(lrseg)[1];
+        auto alpha = data_->amount.at(key);
+        auto& bmp_groups =  data_->efficiency.at(key);
         auto unit_id = 1;
         for (const auto &bmp_group : bmp_groups) {
             for (const auto &bmp : bmp_group) {
@@ -1232,10 +980,10 @@ void EPA_NLP::save_files2(
                     }
                     amount *= alpha;
 
-                    int state = lrseg_.at(lrseg)[1];
-                    int geography = lrseg_.at(lrseg)[3];
+                    int state = data_->lrseg.at(lrseg)[1];
+                    int geography = data_->lrseg.at(lrseg)[3];
                     int unit = 1;
-                    int load_src_grp = u_u_group_dict[load_src];
+                    int load_src_grp = load_src_group(*data_, load_src);
                     //std::tuple<int, int, int, int, double, int, int, int, int> newTuple(std::stoi(lrseg), std::stoi(agency), std::stoi(load_src), bmp, amount, load_src_grp, geography, state, unit);
                     ef_x_.push_back({std::stoi(lrseg), std::stoi(agency), std::stoi(load_src), bmp, amount, load_src_grp, geography, state, unit});
 
@@ -1250,7 +998,7 @@ void EPA_NLP::save_files2(
 void EPA_NLP::write_files(Index n,const Number *x, Index m, Number obj_value) {
 
     bool new_x = true;
-    Number *g_constr = new Number[ncons_];
+    Number *g_constr = new Number[data_->ncons];
     eval_g_proxy(n, x, new_x, m, g_constr, true);
 
     std::cout.precision(10);
@@ -1265,20 +1013,20 @@ void EPA_NLP::write_files(Index n,const Number *x, Index m, Number obj_value) {
     std::ofstream file(filename);
     file.precision(15);
 
-    std::cout << "g_constr[NLoadEos] = " << g_constr[0] + sum_load_invalid_[0] << "\n";
-    std::cout << "g_constr[PLoadEos] = " << g_constr[1] + sum_load_invalid_[1] << "\n";
-    std::cout << "g_constr[SLoadEos] = " << g_constr[2] + sum_load_invalid_[2] << "\n";
-    std::cout << "Original NLoadEos = " << sum_load_valid_[0] + sum_load_invalid_[0] << "\n";
-    std::cout << "Original PLoadEos = " << sum_load_valid_[1] + sum_load_invalid_[1] << "\n";
-    std::cout << "Original SLoadEos = " << sum_load_valid_[2] + sum_load_invalid_[2] << "\n";
+    std::cout << "g_constr[NLoadEos] = " << g_constr[0] + data_->sum_load_invalid[0] << "\n";
+    std::cout << "g_constr[PLoadEos] = " << g_constr[1] + data_->sum_load_invalid[1] << "\n";
+    std::cout << "g_constr[SLoadEos] = " << g_constr[2] + data_->sum_load_invalid[2] << "\n";
+    std::cout << "Original NLoadEos = " << data_->sum_load_valid[0] + data_->sum_load_invalid[0] << "\n";
+    std::cout << "Original PLoadEos = " << data_->sum_load_valid[1] + data_->sum_load_invalid[1] << "\n";
+    std::cout << "Original SLoadEos = " << data_->sum_load_valid[2] + data_->sum_load_invalid[2] << "\n";
 
     filename = fmt::format("{}/pareto_front.txt", path_out_);
     std::ofstream file_results(filename, std::ios::app);
     file_results.precision(15);
 
-    file_results << obj_value << "," << g_constr[0] + sum_load_invalid_[0] << "," << g_constr[1] + sum_load_invalid_[1] << ","
-          << g_constr[2] + sum_load_invalid_[2] << "," << sum_load_valid_[0] + sum_load_invalid_[0] << ","
-          << sum_load_valid_[1] + sum_load_invalid_[1] << "," << sum_load_valid_[2] + sum_load_invalid_[2] << "\n";
+    file_results << obj_value << "," << g_constr[0] + data_->sum_load_invalid[0] << "," << g_constr[1] + data_->sum_load_invalid[1] << ","
+          << g_constr[2] + data_->sum_load_invalid[2] << "," << data_->sum_load_valid[0] + data_->sum_load_invalid[0] << ","
+          << data_->sum_load_valid[1] + data_->sum_load_invalid[1] << "," << data_->sum_load_valid[2] + data_->sum_load_invalid[2] << "\n";
     file_results.close();
     
     // Iterate through each line and split the content using delimeter
@@ -1289,26 +1037,26 @@ void EPA_NLP::write_files(Index n,const Number *x, Index m, Number obj_value) {
     std::unordered_map<std::string, double> bmp_sum;
     total_cost = 0.0;
 
-    for (const auto &key: ef_keys_) {
+    for (const auto &key: data_->ef_keys) {
         std::vector <std::string> out;
         misc_utilities::split_str(key, '_', out);
         auto lrseg = out[0];
         auto agency = out[1];
         auto load_src = out[2];
-        auto alpha = amount_[key];
-        auto& bmp_groups =  efficiency_[key];
-        auto state_id = lrseg_.at(lrseg)[1];
-        auto geography = lrseg_.at(lrseg)[3];
+        auto alpha = data_->amount.at(key);
+        auto& bmp_groups =  data_->efficiency.at(key);
+        auto state_id = data_->lrseg.at(lrseg)[1];
+        auto geography = data_->lrseg.at(lrseg)[3];
         auto unit_id = 1;
         for (const auto &bmp_group : bmp_groups) {
             for (const auto &bmp : bmp_group) {
                 if (x[idx] * alpha > 1.0) {
                     double amount = x[idx] * alpha;
                     auto bmp_cost_key = fmt::format("{}_{}", state_id, bmp);
-                    double cost = amount * bmp_cost_[bmp_cost_key];
+                    double cost = amount * data_->bmp_cost.at(bmp_cost_key);
 
                     file << counter + 1 << "," << agency << ",SU" << counter << "," << state_id << "," << bmp << ","
-                         << geography << "," << u_u_group_dict[load_src] << "," << unit_id << "," << amount << ",True,,"
+                         << geography << "," << load_src_group(*data_, load_src) << "," << unit_id << "," << amount << ",True,,"
                          << counter + 1 << "," << cost << "," << lrseg << "," << load_src << "," << alpha <<"\n";
                     counter++;
                     if (bmp_sum.find(bmp_cost_key) != bmp_sum.end()) {
@@ -1333,7 +1081,7 @@ void EPA_NLP::write_files(Index n,const Number *x, Index m, Number obj_value) {
     file3 << "Bmp_id,Acres,Cost" << std::endl;
 
     for (auto const&[key, sum]: bmp_sum) {
-        file3 << key << "," << sum << "," <<  bmp_cost_[key] * sum <<  '\n';
+        file3 << key << "," << sum << "," <<  data_->bmp_cost.at(key) * sum <<  '\n';
     }
     file3.close();
     std::cout << "# Bmps: " << counter << std::endl;
@@ -1368,6 +1116,24 @@ void EPA_NLP::finalize_solution(
 ) {
     status_result= (int) status;
     std::cout<<"Status: "<<status<<std::endl;
+
+    solution_x_.assign(x, x + n);
+    solution_m_ = m;
+    solution_obj_ = obj_value;
+    has_solution_ = true;
+    if (!defer_output_) {
+        write_solution();
+    }
+}
+
+void EPA_NLP::write_solution() {
+    if (!has_solution_) {
+        return;
+    }
+    Index n = (Index) solution_x_.size();
+    const Number *x = solution_x_.data();
+    Index m = solution_m_;
+    Number obj_value = solution_obj_;
     //create a json file that will store sobj_value in the 'cost' key
     
     write_files(n, x, m, obj_value);
@@ -7,15 +7,48 @@
 #ifndef __EPA_NLP_HPP__
 #define __EPA_NLP_HPP__
 
+#include <memory>
 #include <unordered_map>
 #include <sw/redis++/redis++.h>
 #include "IpTNLP.hpp"
+#include "nlp_model.hpp"
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
 using namespace Ipopt;
 
+/**
+ * Everything EPA_NLP::load() derives from the base scenario and scenario JSON
+ * (and the ETA table in Redis). It does not change once loaded, so several
+ * EPA_NLP instances -- one per epsilon step -- can solve on the same data.
+ */
+struct EpaNlpData {
+    size_t nvars = 0;
+    size_t ncons = 0;
+
+    std::vector<double> sum_load_invalid;
+    std::vector<double> sum_load_valid;
+
+    std::vector<std::string> ef_keys;
+
+    std::unordered_map<std::string, double> amount;
+    std::unordered_map<std::string, std::vector<std::vector<int>>> efficiency;
+    std::unordered_map<std::string, std::vector<int>> lrseg;
+    std::unordered_map<std::string, std::vector<double>> eta_dict;
+    std::unordered_map<std::string, std::vector<double>> phi_dict;
+    std::unordered_map<std::string, double> bmp_cost;
+    std::unordered_map<std::string, int> u_u_group;
+    NlpModel model;
+
+    //From misc.cpp
+    std::unordered_map<int, std::vector<double>> limit_bmps;
+    std::unordered_map<int, std::vector<double> > limit_alpha;
+    std::unordered_map<int, std::vector<int> > limit_vars;
+
+    std::string scenario_data;
+};
+
 /** C++ Example NLP for interfacing a problem with IPOPT.
  *
  */
@@ -32,6 +65,8 @@ public:
    /** Default constructor */
 
    EPA_NLP(const json& base_scenario_json, const json& scenario_json, const std::string& path_out, int pollutant_idx, std::string& uuid);
+   /** Shares data already loaded by another instance; used for concurrent epsilon steps */
+   EPA_NLP(std::shared_ptr<const EpaNlpData> data, const std::string& path_out, int pollutant_idx, const std::string& uuid);
    /** Default destructor */
    virtual ~EPA_NLP();
 
@@ -175,6 +210,13 @@ public:
    //@}
 
    void update_reduction(double,int);
+   /**
+    * When deferred, finalize_solution only keeps the solution and write_solution()
+    * writes the files later, so concurrent steps can still write in step order.
+    */
+   void set_defer_output(bool defer);
+   void write_solution();
+   std::shared_ptr<const EpaNlpData> get_data() const;
 
     std::string get_scenario_data();
     std::string get_uuid();
@@ -207,40 +249,26 @@ private:
    );
    //Efficiency
    //
-    void filter_efficiency_keys();
-    void compute_efficiency_keys();
-    void compute_efficiency_size();
+    void filter_efficiency_keys(EpaNlpData& d);
+    void compute_efficiency_keys(EpaNlpData& d);
+    void compute_efficiency_size(EpaNlpData& d);
     void normalize_efficiency();
     //int compute_efficiency();
-    void compute_eta();
+    void compute_eta(EpaNlpData& d);
 
     void load(const json& base_scenario_json, const json& scenario_json);
+    void compile_model(EpaNlpData& d);
 
+    std::shared_ptr<const EpaNlpData> data_;
 
     size_t ef_size_;
-
-    size_t nvars_;
-    size_t ncons_;
-
-    std::vector<double> sum_load_invalid_;
-    std::vector<double> sum_load_valid_;
-
-    std::vector<std::string> ef_keys_;
-
-    std::unordered_map<std::string, double> amount_;
-    std::unordered_map<std::string, std::vector<std::vector<int>>> efficiency_;
-    //a partir de aqui hay que revisar
-    std::unordered_map<std::string, std::vector<int>> lrseg_;
-    std::unordered_map<std::string, std::vector<double>> eta_dict_;
-    std::unordered_map<std::string, std::vector<double>> phi_dict_;
-    std::unordered_map<std::string, double> bmp_cost_;
-    std::unordered_map<std::string, int> u_u_group_dict;
     std::vector<double> initial_x;
 
-    //From misc.cpp
-    std::unordered_map<int, std::vector<double>> limit_bmps_dict;
-    std::unordered_map<int, std::vector<double> > limit_alpha_dict;
-    std::unordered_map<int, std::vector<int> > limit_vars_dict;
+    bool defer_output_;
+    bool has_solution_;
+    std::vector<double> solution_x_;
+    Index solution_m_;
+    Number solution_obj_;
 
     std::vector<std::tuple<int, int, int, int, double, int, int, int, int>> ef_x_;
     std::vector<std::tuple<int, int, int, int, double, int, int, int, int>> lc_x_;
@@ -253,7 +281,6 @@ private:
     ); 
     int current_iteration_;
 
-    std::string scenario_data_;
     std::string path_out_;
    //@}
 };
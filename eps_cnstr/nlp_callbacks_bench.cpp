@@ -0,0 +1,175 @@
+// Micro-benchmark of the EPA_NLP callback kernels (NlpModel) on a synthetic
+// model, without Ipopt. The constraint kernel is also compared against the
+// string-keyed loop it replaced, which must give the same loads.
+//
+// usage: nlp_callbacks_bench [nparcels] [ncalls]
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "nlp_model.hpp"
+
+namespace {
+    struct Synthetic {
+        NlpModel model;
+        std::vector<std::string> keys;                         // "lrseg_agency_loadsrc"
+        std::vector<std::vector<std::vector<int>>> bmp_groups; // per key
+        std::unordered_map<std::string, std::vector<double>> eta_dict;
+        std::unordered_map<std::string, std::vector<double>> phi_dict;
+        std::unordered_map<std::string, double> amount;
+    };
+
+    Synthetic make_model(int nparcels) {
+        std::mt19937 gen(11);
+        std::uniform_int_distribution<int> ngroups_dist(1, 3);
+        std::uniform_int_distribution<int> nbmps_dist(1, 4);
+        std::uniform_real_distribution<double> eta_dist(0.0, 0.3);
+        std::uniform_real_distribution<double> amount_dist(2.0, 500.0);
+
+        Synthetic s;
+        auto& m = s.model;
+        m.group_begin.push_back(0);
+        m.parcel_group_begin.push_back(0);
+        for (int p = 0; p < nparcels; ++p) {
+            int lrseg = 1000 + p / 10;
+            int load_src = p % 10;
+            auto key = fmt::format("{}_{}_{}", lrseg, 9, load_src);
+            double alpha = amount_dist(gen);
+            std::vector<double> phi = {eta_dist(gen) * 10, eta_dist(gen), eta_dist(gen) * 100};
+            s.keys.push_back(key);
+            s.amount[key] = alpha;
+            s.phi_dict[key] = phi;
+
+            std::vector<std::vector<int>> groups;
+            int bmp = 1;
+            for (int g = ngroups_dist(gen); g > 0; --g) {
+                std::vector<int> group;
+                for (int b = nbmps_dist(gen); b > 0; --b, ++bmp) {
+                    std::vector<double> eta = {eta_dist(gen), eta_dist(gen), eta_dist(gen)};
+                    s.eta_dict[fmt::format("{}_{}_{}", bmp, lrseg, load_src)] = eta;
+                    group.push_back(bmp);
+                    m.alpha.push_back(alpha);
+                    m.unit_cost.push_back(10.0 + bmp);
+                    m.eta.insert(m.eta.end(), eta.begin(), eta.end());
+                }
+                groups.push_back(group);
+                m.group_begin.push_back(m.alpha.size());
+            }
+            s.bmp_groups.push_back(groups);
+            m.parcel_group_begin.push_back(m.group_begin.size() - 1);
+            m.parcel_alpha.push_back(alpha);
+            m.parcel_phi.insert(m.parcel_phi.end(), phi.begin(), phi.end());
+        }
+        return s;
+    }
+
+    // the loop EPA_NLP::eval_g_proxy used to run on every call
+    void keyed_constraints(Synthetic& s, const double* x, double* g, double* pt_load) {
+        pt_load[0] = pt_load[1] = pt_load[2] = 0.0;
+        size_t idx = 0;
+        int nconstraints = 1;
+        for (size_t p = 0; p < s.keys.size(); ++p) {
+            const auto& key = s.keys[p];
+            std::vector<double> prod(3, 1);
+            auto lrseg = key.substr(0, key.find('_'));
+            auto load_src = key.substr(key.rfind('_') + 1);
+            for (const auto& bmp_group : s.bmp_groups[p]) {
+                std::vector<double> sigma(3, 0.0);
+                auto sigma_cnstr = 0.0;
+                for (const auto& bmp : bmp_group) {
+                    auto pct = x[idx];
+                    idx++;
+                    std::string s_tmp = fmt::format("{}_{}_{}", bmp, lrseg, load_src);
+                    std::vector<double> eta(3, 0.0);
+                    if (s.eta_dict.find(s_tmp) != s.eta_dict.end()) {
+                        eta[0] = s.eta_dict[s_tmp][0];
+                        eta[1] = s.eta_dict[s_tmp][1];
+                        eta[2] = s.eta_dict[s_tmp][2];
+                    }
+                    sigma[0] += eta[0] * pct;
+                    sigma[1] += eta[1] * pct;
+                    sigma[2] += eta[2] * pct;
+                    sigma_cnstr += pct;
+                }
+                prod[0] *= (1.0 - sigma[0]);
+                prod[1] *= (1.0 - sigma[1]);
+                prod[2] *= (1.0 - sigma[2]);
+                g[nconstraints] = sigma_cnstr;
+                ++nconstraints;
+            }
+            auto phi = s.phi_dict[key];
+            auto alpha = s.amount[key];
+            pt_load[0] += phi[0] * alpha * prod[0];
+            pt_load[1] += phi[1] * alpha * prod[1];
+            pt_load[2] += phi[2] * alpha * prod[2];
+        }
+    }
+
+    template <typename F>
+    double us_per_call(int ncalls, F&& f) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ncalls; ++i) {
+            f();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ncalls;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int nparcels = argc > 1 ? std::stoi(argv[1]) : 20000;
+    int ncalls = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    auto s = make_model(nparcels);
+    const auto& m = s.model;
+    size_t n = m.nvars();
+    size_t ncons = m.ngroups() + 1;
+    fmt::print("parcels: {}, groups: {}, variables: {}\n", m.nparcels(), m.ngroups(), n);
+
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<double> dist(0.0, 0.5);
+    std::vector<double> x(n);
+    for (auto& xi : x) {
+        xi = dist(gen);
+    }
+    std::vector<double> grad(n);
+    std::vector<double> g(ncons);
+    std::vector<double> g_ref(ncons);
+    std::vector<double> jac(2 * n);
+    std::vector<int> rows(2 * n);
+    std::vector<int> cols(2 * n);
+    double pt_load[3];
+    double pt_load_ref[3];
+    double obj = 0.0;
+
+    fmt::print("eval_f:          {:>10.2f} us\n", us_per_call(ncalls, [&] { obj += m.objective(x.data()); }));
+    fmt::print("eval_grad_f:     {:>10.2f} us\n", us_per_call(ncalls, [&] { m.gradient(grad.data()); }));
+    double flat_us = us_per_call(ncalls, [&] { m.constraints(x.data(), g.data(), pt_load); });
+    fmt::print("eval_g:          {:>10.2f} us\n", flat_us);
+    double keyed_us = us_per_call(ncalls, [&] { keyed_constraints(s, x.data(), g_ref.data(), pt_load_ref); });
+    fmt::print("eval_g (keyed):  {:>10.2f} us ({:.1f}x slower)\n", keyed_us, keyed_us / flat_us);
+    fmt::print("eval_jac_g:      {:>10.2f} us\n", us_per_call(ncalls, [&] { m.jacobian_values(x.data(), 0, jac.data()); }));
+    fmt::print("jac structure:   {:>10.2f} us\n", us_per_call(ncalls, [&] { m.jacobian_structure(rows.data(), cols.data()); }));
+    std::vector<double> hess(m.hessian_nnz());
+    fmt::print("eval_h ({} nnz): {:>10.2f} us\n", hess.size(), us_per_call(ncalls, [&] { m.hessian_values(x.data(), 0, 1.0, hess.data()); }));
+
+    for (int k = 0; k < 3; ++k) {
+        if (pt_load[k] != pt_load_ref[k]) {
+            std::cerr << "load " << k << " differs: " << pt_load[k] << " vs " << pt_load_ref[k] << std::endl;
+            return -1;
+        }
+    }
+    for (size_t i = 1; i < ncons; ++i) {
+        if (g[i] != g_ref[i]) {
+            std::cerr << "constraint " << i << " differs" << std::endl;
+            return -1;
+        }
+    }
+    fmt::print("flat and keyed constraints agree (objective checksum {})\n", obj);
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Finite-difference check of the NlpModel derivatives (objective gradient,
+// load row of the Jacobian and the sparse Hessian of the Lagrangian) on a
+// small synthetic model, without Ipopt. The Hessian is compared densely, so
+// entries outside the declared sparsity pattern must also be zero.
+//
+// usage: nlp_derivative_test [nparcels]
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "nlp_model.hpp"
+
+namespace {
+    NlpModel make_model(int nparcels) {
+        std::mt19937 gen(3);
+        std::uniform_int_distribution<int> ngroups_dist(1, 4);
+        std::uniform_int_distribution<int> nbmps_dist(1, 3);
+        std::uniform_real_distribution<double> eta_dist(0.0, 0.4);
+        std::uniform_real_distribution<double> amount_dist(2.0, 50.0);
+
+        NlpModel m;
+        m.group_begin.push_back(0);
+        m.parcel_group_begin.push_back(0);
+        for (int p = 0; p < nparcels; ++p) {
+            double alpha = amount_dist(gen);
+            for (int g = ngroups_dist(gen); g > 0; --g) {
+                for (int b = nbmps_dist(gen); b > 0; --b) {
+                    m.alpha.push_back(alpha);
+                    m.unit_cost.push_back(amount_dist(gen));
+                    for (int k = 0; k < NlpModel::NPOLLUTANTS; ++k) {
+                        m.eta.push_back(eta_dist(gen));
+                    }
+                }
+                m.group_begin.push_back(m.alpha.size());
+            }
+            m.parcel_group_begin.push_back(m.group_begin.size() - 1);
+            m.parcel_alpha.push_back(alpha);
+            for (int k = 0; k < NlpModel::NPOLLUTANTS; ++k) {
+                m.parcel_phi.push_back(eta_dist(gen) * 10);
+            }
+        }
+        return m;
+    }
+
+    bool close(double analytic, double numeric) {
+        return std::fabs(analytic - numeric) <= 1e-5 * std::max(1.0, std::fabs(numeric));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int nparcels = argc > 1 ? std::stoi(argv[1]) : 40;
+    auto m = make_model(nparcels);
+    size_t n = m.nvars();
+    size_t ncons = m.ngroups() + 1;
+    fmt::print("parcels: {}, groups: {}, variables: {}, hessian nonzeros: {}\n",
+               m.nparcels(), m.ngroups(), n, m.hessian_nnz());
+
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<double> dist(0.05, 0.6);
+    std::vector<double> x(n);
+    for (auto& xi : x) {
+        xi = dist(gen);
+    }
+
+    const double h = 1e-6;
+    const double lambda_load = 0.7;
+    int errors = 0;
+    std::vector<double> g(ncons);
+    double pt_load[NlpModel::NPOLLUTANTS];
+
+    // objective
+    std::vector<double> grad(n);
+    m.gradient(grad.data());
+    for (size_t v = 0; v < n; ++v) {
+        auto xp = x;
+        auto xm = x;
+        xp[v] += h;
+        xm[v] -= h;
+        double fd = (m.objective(xp.data()) - m.objective(xm.data())) / (2 * h);
+        if (!close(grad[v], fd)) {
+            std::cerr << "grad_f[" << v << "]: " << grad[v] << " vs " << fd << std::endl;
+            ++errors;
+        }
+    }
+
+    for (int pollutant_idx = 0; pollutant_idx < NlpModel::NPOLLUTANTS; ++pollutant_idx) {
+        auto load = [&](const std::vector<double>& at) {
+            m.constraints(at.data(), g.data(), pt_load);
+            return pt_load[pollutant_idx];
+        };
+        auto load_row = [&](const std::vector<double>& at) {
+            std::vector<double> jac(2 * n);
+            m.jacobian_values(at.data(), pollutant_idx, jac.data());
+            jac.resize(n);
+            return jac;
+        };
+
+        // Jacobian, load row
+        auto jac = load_row(x);
+        for (size_t v = 0; v < n; ++v) {
+            auto xp = x;
+            auto xm = x;
+            xp[v] += h;
+            xm[v] -= h;
+            double fd = (load(xp) - load(xm)) / (2 * h);
+            if (!close(jac[v], fd)) {
+                std::cerr << "pollutant " << pollutant_idx << " jac[0][" << v << "]: " << jac[v] << " vs " << fd << std::endl;
+                ++errors;
+            }
+        }
+
+        // Hessian: dense lower triangle from the sparse values
+        std::vector<int> rows(m.hessian_nnz());
+        std::vector<int> cols(m.hessian_nnz());
+        std::vector<double> values(m.hessian_nnz());
+        m.hessian_structure(rows.data(), cols.data());
+        m.hessian_values(x.data(), pollutant_idx, lambda_load, values.data());
+        std::vector<double> dense(n * n, 0.0);
+        for (size_t k = 0; k < values.size(); ++k) {
+            if (rows[k] < cols[k] || dense[rows[k] * n + cols[k]] != 0.0) {
+                std::cerr << "bad hessian entry (" << rows[k] << ", " << cols[k] << ")" << std::endl;
+                ++errors;
+            }
+            dense[rows[k] * n + cols[k]] += values[k];
+        }
+
+        // the load row is exact, so differentiate it once more
+        for (size_t w = 0; w < n; ++w) {
+            auto xp = x;
+            auto xm = x;
+            xp[w] += h;
+            xm[w] -= h;
+            auto jp = load_row(xp);
+            auto jm = load_row(xm);
+            for (size_t v = 0; v <= w; ++v) {
+                double fd = lambda_load * (jp[v] - jm[v]) / (2 * h);
+                if (!close(dense[w * n + v], fd)) {
+                    std::cerr << "pollutant " << pollutant_idx << " hess[" << w << "][" << v << "]: "
+                              << dense[w * n + v] << " vs " << fd << std::endl;
+                    ++errors;
+                }
+            }
+        }
+    }
+
+    // a saturated group (sigma == 1) must not break the derivatives of its parcel
+    std::fill(x.begin(), x.end(), 0.0);
+    x[0] = 1.0 / m.eta[0];
+    auto saturated = std::vector<double>(2 * n);
+    m.jacobian_values(x.data(), 0, saturated.data());
+    for (size_t v = 0; v < n; ++v) {
+        if (!std::isfinite(saturated[v])) {
+            std::cerr << "jac[0][" << v << "] is not finite at a saturated group" << std::endl;
+            ++errors;
+        }
+    }
+
+    if (errors > 0) {
+        std::cerr << errors << " derivative mismatches" << std::endl;
+        return -1;
+    }
+    fmt::print("analytic and finite-difference derivatives agree\n");
+    return 0;
+}
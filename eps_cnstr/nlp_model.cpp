@@ -0,0 +1,172 @@
+// Created by: Gregorio Toscano
+
+#include "nlp_model.hpp"
+
+#include <algorithm>
+
+double NlpModel::objective(const double* x) const {
+    double fitness = 0.0;
+    for (size_t v = 0; v < nvars(); ++v) {
+        double pct = std::max(x[v], 0.0);
+        fitness += pct * alpha[v] * unit_cost[v];
+    }
+    return fitness;
+}
+
+void NlpModel::gradient(double* grad_f) const {
+    for (size_t v = 0; v < nvars(); ++v) {
+        grad_f[v] = alpha[v] * unit_cost[v];
+    }
+}
+
+void NlpModel::constraints(const double* x, double* g, double* pt_load) const {
+    for (int k = 0; k < NPOLLUTANTS; ++k) {
+        pt_load[k] = 0.0;
+    }
+    for (size_t p = 0; p < nparcels(); ++p) {
+        double prod[NPOLLUTANTS] = {1.0, 1.0, 1.0};
+        for (size_t grp = parcel_group_begin[p]; grp < parcel_group_begin[p + 1]; ++grp) {
+            double sigma[NPOLLUTANTS] = {0.0, 0.0, 0.0};
+            double sigma_cnstr = 0.0;
+            for (size_t v = group_begin[grp]; v < group_begin[grp + 1]; ++v) {
+                const double* eta_v = &eta[NPOLLUTANTS * v];
+                sigma[0] += eta_v[0] * x[v];
+                sigma[1] += eta_v[1] * x[v];
+                sigma[2] += eta_v[2] * x[v];
+                sigma_cnstr += x[v];
+            }
+            prod[0] *= (1.0 - sigma[0]);
+            prod[1] *= (1.0 - sigma[1]);
+            prod[2] *= (1.0 - sigma[2]);
+            g[1 + grp] = sigma_cnstr;
+        }
+        const double* phi = &parcel_phi[NPOLLUTANTS * p];
+        pt_load[0] += phi[0] * parcel_alpha[p] * prod[0];
+        pt_load[1] += phi[1] * parcel_alpha[p] * prod[1];
+        pt_load[2] += phi[2] * parcel_alpha[p] * prod[2];
+    }
+}
+
+void NlpModel::jacobian_structure(int* iRow, int* jCol) const {
+    int n = static_cast<int>(nvars());
+    for (int v = 0; v < n; ++v) {
+        iRow[v] = 0;
+        jCol[v] = v;
+    }
+    for (size_t grp = 0; grp < ngroups(); ++grp) {
+        for (size_t v = group_begin[grp]; v < group_begin[grp + 1]; ++v) {
+            iRow[n + v] = static_cast<int>(grp) + 1;
+            jCol[n + v] = static_cast<int>(v);
+        }
+    }
+}
+
+namespace {
+    // (1 - sigma) of every group of parcel p, for the selected pollutant
+    void group_factors(const NlpModel& m, size_t p, const double* x, int pollutant_idx, std::vector<double>& factors) {
+        factors.clear();
+        for (size_t grp = m.parcel_group_begin[p]; grp < m.parcel_group_begin[p + 1]; ++grp) {
+            double sigma = 0.0;
+            for (size_t v = m.group_begin[grp]; v < m.group_begin[grp + 1]; ++v) {
+                sigma += m.eta[NlpModel::NPOLLUTANTS * v + pollutant_idx] * x[v];
+            }
+            factors.push_back(1.0 - sigma);
+        }
+    }
+
+    // product of factors outside [first, last]
+    double product_without(const std::vector<double>& factors, size_t first, size_t last) {
+        double prod = 1.0;
+        for (size_t k = 0; k < factors.size(); ++k) {
+            if (k < first || k > last) {
+                prod *= factors[k];
+            }
+        }
+        return prod;
+    }
+}
+
+void NlpModel::jacobian_values(const double* x, int pollutant_idx, double* values) const {
+    std::vector<double> factors;
+    for (size_t p = 0; p < nparcels(); ++p) {
+        group_factors(*this, p, x, pollutant_idx, factors);
+        double load_factor = parcel_alpha[p] * parcel_phi[NPOLLUTANTS * p + pollutant_idx];
+        size_t first_group = parcel_group_begin[p];
+        for (size_t grp = first_group; grp < parcel_group_begin[p + 1]; ++grp) {
+            // products over the other groups, so a saturated group (sigma == 1) does not divide by zero
+            double others = product_without(factors, grp - first_group, grp - first_group);
+            for (size_t v = group_begin[grp]; v < group_begin[grp + 1]; ++v) {
+                values[v] = -load_factor * eta[NPOLLUTANTS * v + pollutant_idx] * others;
+            }
+        }
+    }
+    for (size_t v = 0; v < nvars(); ++v) {
+        values[nvars() + v] = 1.0;
+    }
+}
+
+size_t NlpModel::hessian_nnz() const {
+    size_t nnz = 0;
+    for (size_t p = 0; p < nparcels(); ++p) {
+        size_t vars_before = 0;
+        for (size_t grp = parcel_group_begin[p]; grp < parcel_group_begin[p + 1]; ++grp) {
+            size_t group_size = group_begin[grp + 1] - group_begin[grp];
+            nnz += group_size * vars_before;
+            vars_before += group_size;
+        }
+    }
+    return nnz;
+}
+
+void NlpModel::hessian_structure(int* iRow, int* jCol) const {
+    size_t idx = 0;
+    for (size_t p = 0; p < nparcels(); ++p) {
+        size_t parcel_begin = group_begin[parcel_group_begin[p]];
+        for (size_t grp = parcel_group_begin[p]; grp < parcel_group_begin[p + 1]; ++grp) {
+            // row w pairs with every variable of the parcel's earlier groups
+            for (size_t w = group_begin[grp]; w < group_begin[grp + 1]; ++w) {
+                for (size_t v = parcel_begin; v < group_begin[grp]; ++v) {
+                    iRow[idx] = static_cast<int>(w);
+                    jCol[idx] = static_cast<int>(v);
+                    ++idx;
+                }
+            }
+        }
+    }
+}
+
+void NlpModel::hessian_values(const double* x, int pollutant_idx, double lambda_load, double* values) const {
+    std::vector<double> factors;
+    size_t idx = 0;
+    for (size_t p = 0; p < nparcels(); ++p) {
+        group_factors(*this, p, x, pollutant_idx, factors);
+        double load_factor = lambda_load * parcel_alpha[p] * parcel_phi[NPOLLUTANTS * p + pollutant_idx];
+        size_t first_group = parcel_group_begin[p];
+        for (size_t grp = first_group; grp < parcel_group_begin[p + 1]; ++grp) {
+            for (size_t w = group_begin[grp]; w < group_begin[grp + 1]; ++w) {
+                double eta_w = eta[NPOLLUTANTS * w + pollutant_idx];
+                for (size_t other = first_group; other < grp; ++other) {
+                    // groups strictly between `other` and `grp` still multiply in
+                    double between = 1.0;
+                    for (size_t k = other + 1; k < grp; ++k) {
+                        between *= factors[k - first_group];
+                    }
+                    double rest = product_without(factors, other - first_group, grp - first_group) * between;
+                    for (size_t v = group_begin[other]; v < group_begin[other + 1]; ++v) {
+                        values[idx] = load_factor * eta_w * eta[NPOLLUTANTS * v + pollutant_idx] * rest;
+                        ++idx;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void NlpModel::starting_point(double* x) const {
+    std::fill(x, x + nvars(), 0.0);
+    for (size_t grp = 0; grp < ngroups(); ++grp) {
+        if (group_begin[grp] < group_begin[grp + 1]) {
+            x[group_begin[grp]] = 1.0;
+        }
+    }
+}
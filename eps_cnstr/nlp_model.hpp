@@ -0,0 +1,75 @@
+// Created by: Gregorio Toscano
+
+#ifndef __EPA_NLP_MODEL_HPP__
+#define __EPA_NLP_MODEL_HPP__
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Flat form of the efficiency model solved by EPA_NLP, built once in EPA_NLP::load().
+ *
+ * Variables follow Ipopt's x order (ef_keys_ order, then BMP groups, then BMPs).
+ * Groups and parcels are stored in CSR form: the variables of group g are
+ * [group_begin[g], group_begin[g+1]) and the groups of parcel p are
+ * [parcel_group_begin[p], parcel_group_begin[p+1]). Constraint row 0 is the
+ * load; group g owns row g + 1.
+ *
+ * The kernels below are what the Ipopt callbacks run on every iteration; they
+ * do not depend on Ipopt so they can be benchmarked on their own.
+ */
+struct NlpModel {
+    static constexpr int NPOLLUTANTS = 3; // N, P, S
+
+    // per variable
+    std::vector<double> alpha;      ///< amount of the variable's parcel
+    std::vector<double> unit_cost;  ///< cost per unit of the variable's BMP
+    std::vector<double> eta;        ///< NPOLLUTANTS values per variable, 0.0 when the BMP has no ETA
+
+    // per BMP group
+    std::vector<size_t> group_begin;
+
+    // per parcel
+    std::vector<size_t> parcel_group_begin;
+    std::vector<double> parcel_alpha;
+    std::vector<double> parcel_phi; ///< NPOLLUTANTS values per parcel
+
+    size_t nvars() const {
+        return alpha.size();
+    }
+    size_t ngroups() const {
+        return group_begin.empty() ? 0 : group_begin.size() - 1;
+    }
+    size_t nparcels() const {
+        return parcel_group_begin.empty() ? 0 : parcel_group_begin.size() - 1;
+    }
+
+    double objective(const double* x) const;
+    void gradient(double* grad_f) const;
+    /**
+     * g[1 + group] receives the sum of the group's variables and pt_load[0..2]
+     * the N, P and S loads of the valid parcels.
+     */
+    void constraints(const double* x, double* g, double* pt_load) const;
+    /**
+     * Row 0 (d load / d x, nvars entries) followed by the group rows (nvars ones).
+     */
+    void jacobian_structure(int* iRow, int* jCol) const;
+    void jacobian_values(const double* x, int pollutant_idx, double* values) const;
+    /**
+     * Lower triangle of the Hessian of the Lagrangian. The objective and the
+     * group rows are linear, so only the load row contributes:
+     * d2 load / dx_v dx_w = phi * alpha * eta_v * eta_w * prod(1 - sigma_K) over
+     * the parcel's other groups K, nonzero only when v and w sit in different
+     * groups of the same parcel.
+     */
+    size_t hessian_nnz() const;
+    void hessian_structure(int* iRow, int* jCol) const;
+    void hessian_values(const double* x, int pollutant_idx, double lambda_load, double* values) const;
+    /**
+     * Greedy start: the first BMP of every group fully applied.
+     */
+    void starting_point(double* x) const;
+};
+
+#endif
@@ -4,12 +4,16 @@
 
 #ifndef CBO_EVALUATION_AMQP_CPP_H
 #define CBO_EVALUATION_AMQP_CPP_H
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <SimpleAmqpClient/SimpleAmqpClient.h>
 #include <sw/redis++/redis++.h>
 
+#include "evaluation_wait.h"
+
 class RabbitMQClient {
 public:
     RabbitMQClient(std::string emo_data, std::string emo_uuid);
@@ -19,18 +23,62 @@ public:
     void get_opts();
     bool send_message(std::string routing_name, std::string msg);
     void send_signal(std::string exec_uuid);
+    /**
+     * Dispatches a whole generation: the Redis bookkeeping for every exec_uuid
+     * is sent in two pipelined round trips and the messages are published on
+     * the client's long-lived channel. Produces the same keys and messages as
+     * calling send_signal() for each exec_uuid.
+     */
+    void send_signals(const std::vector<std::string>& exec_uuids);
     std::string wait_for_data();
+    /**
+     * Waits for every solution sent so far. Each one has its own deadline
+     * (OPT4CAST_WAIT_MILLISECS_IN_CAST) and is re-dispatched through
+     * send_signal() up to OPT4CAST_EVAL_RETRIES times before it is given up,
+     * so a lost message cannot block the run forever.
+     */
+    WaitOutcome wait_with_deadlines();
+    /**
+     * wait_with_deadlines() reduced to the "exec_uuid_result" entries of the
+     * scored solutions; the unscored ones are left out.
+     */
     std::vector<std::string> wait_for_all_data();
-    std::vector<std::string> safe_wait_for_all_data(); 
+    /**
+     * Opens the long-lived consumer the waits read from. Idempotent, and
+     * called by send_signal(s) so that no completion is published before the
+     * queue is bound.
+     */
+    void subscribe();
+    /**
+     * Blocks until at least one outstanding solution is settled, then also
+     * takes every completion already delivered. Returns "exec_uuid_result"
+     * entries, "exec_uuid_" for a solution given up after its retries, or an
+     * empty vector when nothing is outstanding.
+     */
+    std::vector<std::string> wait_for_any_data();
+    void set_wait_options(const WaitOptions& options) {
+        pending_.set_options(options);
+    }
     int transfers_remaining();
     bool is_init();
 
 private:
+    AmqpClient::Channel::ptr_t channel();
+    sw::redis::Pipeline& pipeline();
+    // adapts this client to PendingEvaluations::wait()
+    struct Transport;
+    std::optional<std::string> fetch_result(const std::string& exec_uuid);
+
     AmqpClient::Channel::OpenOpts opts_;
+    AmqpClient::Channel::ptr_t channel_; // publishing channel, opened once with the exchange declared
+    AmqpClient::Channel::ptr_t consumer_channel_; // opened by subscribe()
+    std::string consumer_tag_;
     sw::redis::Redis redis_;
+    std::optional<sw::redis::Pipeline> pipeline_;
     std::string emo_uuid_;
     std::string emo_data_;
     std::unordered_map<std::string, std::string> sent_list_;
+    PendingEvaluations pending_;
     bool is_initialized;
 };
 
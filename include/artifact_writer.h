@@ -0,0 +1,94 @@
+// Created by: Gregorio Toscano
+
+#ifndef ARTIFACT_WRITER_H
+#define ARTIFACT_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ArtifactWriter
+ * @brief Writes the files nobody waits for (JSON mirrors, _new_bmps copies) on
+ * I/O threads, off the optimization thread.
+ *
+ * submit() queues a write and returns; once the queue holds `capacity` files
+ * it blocks until a worker takes one, and that time is counted as a stall.
+ * flush() is the barrier: it returns when every file submitted so far is
+ * written. The destructor flushes. With no threads, submit() writes the file
+ * itself.
+ */
+class ArtifactWriter {
+public:
+    /**
+     * Writes the file it is given; an exception is reported and counted as a
+     * failed file.
+     */
+    using Write = std::function<void(const std::string&)>;
+
+    struct Stats {
+        uint64_t files = 0;          ///< written
+        uint64_t failed = 0;
+        uint64_t bytes = 0;          ///< in the files written
+        size_t max_depth = 0;        ///< most files waiting in the queue at once
+        double stall_seconds = 0.0;  ///< spent in submit() waiting for room in the queue
+        double flush_seconds = 0.0;  ///< spent in flush() waiting for the workers
+    };
+
+    /**
+     * @param nthreads I/O workers; 0 writes every file in submit()
+     * @param capacity most files waiting in the queue
+     * @param sync fsync every file once written
+     */
+    explicit ArtifactWriter(size_t nthreads = 1, size_t capacity = 64, bool sync = false);
+    ~ArtifactWriter();
+    ArtifactWriter(const ArtifactWriter&) = delete;
+    ArtifactWriter& operator=(const ArtifactWriter&) = delete;
+
+    /**
+     * The writer of a run: PSO_ARTIFACT_THREADS workers (default 1),
+     * PSO_ARTIFACT_QUEUE files (default 64), fsync if PSO_ARTIFACT_FSYNC is 1.
+     */
+    static std::shared_ptr<ArtifactWriter> from_env();
+
+    void submit(std::string filename, Write write);
+    /**
+     * Waits for every file submitted so far; false if one of the files since
+     * the previous flush could not be written.
+     */
+    bool flush();
+
+    Stats stats() const;
+    void print_stats() const;
+
+private:
+    struct Job {
+        std::string filename;
+        Write write;
+    };
+
+    void worker_loop();
+    void run(Job& job);
+
+    size_t capacity_;
+    bool sync_;
+    std::vector<std::thread> workers_;
+    std::queue<Job> queue_;
+    size_t pending_ = 0; ///< queued or being written
+    bool has_failed_ = false;
+    bool stop_ = false;
+    Stats stats_;
+    mutable std::mutex mtx_;
+    std::condition_variable work_;
+    std::condition_variable room_;
+    std::condition_variable done_;
+};
+
+#endif // ARTIFACT_WRITER_H
@@ -0,0 +1,251 @@
+// Created by: Gregorio Toscano
+
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Flat binary encoding shared by the scenario snapshot and the PSO
+ * checkpoint. Scalars are stored in native byte order, strings and
+ * containers as a uint64 element count followed by the elements, tuples and
+ * pairs field by field.
+ */
+namespace binary_io {
+
+    template <typename T>
+    struct is_vector : std::false_type {};
+    template <typename T>
+    struct is_vector<std::vector<T>> : std::true_type {};
+
+    template <typename T>
+    struct is_map : std::false_type {};
+    template <typename K, typename V>
+    struct is_map<std::unordered_map<K, V>> : std::true_type {};
+
+    template <typename T>
+    struct is_tuple : std::false_type {};
+    template <typename... Ts>
+    struct is_tuple<std::tuple<Ts...>> : std::true_type {};
+
+    // vectors copied as one block; vector<bool> is not contiguous
+    template <typename T>
+    struct is_contiguous_arithmetic : std::false_type {};
+    template <typename T>
+    struct is_contiguous_arithmetic<std::vector<T>>
+        : std::bool_constant<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>> {};
+
+    class Writer {
+        public:
+            template <typename T>
+            void put(const T& value) {
+                if constexpr (std::is_arithmetic_v<T>) {
+                    buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+                } else if constexpr (std::is_same_v<T, std::string>) {
+                    put<uint64_t>(value.size());
+                    buffer_.append(value);
+                } else if constexpr (is_contiguous_arithmetic<T>::value) {
+                    put_array(value.data(), value.size());
+                } else if constexpr (is_vector<T>::value || is_map<T>::value) {
+                    put<uint64_t>(value.size());
+                    for (const auto& element : value) {
+                        put(element);
+                    }
+                } else if constexpr (is_tuple<T>::value) {
+                    std::apply([this](const auto&... fields) { (put(fields), ...); }, value);
+                } else {
+                    put(value.first);
+                    put(value.second);
+                }
+            }
+            /**
+             * Same encoding as a vector of n elements.
+             */
+            template <typename T>
+            void put_array(const T* data, size_t n) {
+                put<uint64_t>(n);
+                buffer_.append(reinterpret_cast<const char*>(data), n * sizeof(T));
+            }
+            void reserve(size_t size) {
+                buffer_.reserve(size);
+            }
+            const std::string& bytes() const {
+                return buffer_;
+            }
+        private:
+            std::string buffer_;
+    };
+
+    /**
+     * Throws std::runtime_error on truncated or corrupt data.
+     */
+    class Reader {
+        public:
+            Reader(const char* data, size_t size) : data_(data), end_(data + size) {}
+
+            template <typename T>
+            void get(T& value) {
+                if constexpr (std::is_arithmetic_v<T>) {
+                    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+                } else if constexpr (std::is_same_v<T, std::string>) {
+                    size_t size = count(1);
+                    value.assign(take(size), size);
+                } else if constexpr (is_contiguous_arithmetic<T>::value) {
+                    size_t size = count(sizeof(typename T::value_type));
+                    value.resize(size);
+                    std::memcpy(value.data(), take(size * sizeof(typename T::value_type)), size * sizeof(typename T::value_type));
+                } else if constexpr (is_vector<T>::value) {
+                    size_t size = count(1);
+                    value.clear();
+                    value.resize(size);
+                    for (auto& element : value) {
+                        get(element);
+                    }
+                } else if constexpr (is_map<T>::value) {
+                    size_t size = count(1);
+                    value.clear();
+                    value.reserve(size);
+                    for (size_t i = 0; i < size; ++i) {
+                        typename T::key_type key;
+                        typename T::mapped_type mapped;
+                        get(key);
+                        get(mapped);
+                        value.emplace(std::move(key), std::move(mapped));
+                    }
+                } else if constexpr (is_tuple<T>::value) {
+                    std::apply([this](auto&... fields) { (get(fields), ...); }, value);
+                } else {
+                    get(value.first);
+                    get(value.second);
+                }
+            }
+            /**
+             * Reads an array written by put_array, which must hold exactly n elements.
+             */
+            template <typename T>
+            void get_array(T* data, size_t n) {
+                if (count(sizeof(T)) != n) {
+                    throw std::runtime_error("unexpected array size");
+                }
+                std::memcpy(data, take(n * sizeof(T)), n * sizeof(T));
+            }
+            template <typename T>
+            T get() {
+                T value{};
+                get(value);
+                return value;
+            }
+            bool at_end() const {
+                return data_ == end_;
+            }
+        private:
+            const char* take(size_t size) {
+                if (static_cast<size_t>(end_ - data_) < size) {
+                    throw std::runtime_error("truncated data");
+                }
+                const char* at = data_;
+                data_ += size;
+                return at;
+            }
+            // element count, rejected early when the remaining bytes cannot hold it
+            size_t count(size_t min_element_size) {
+                uint64_t size = 0;
+                get(size);
+                if (size > static_cast<uint64_t>(end_ - data_) / min_element_size) {
+                    throw std::runtime_error("corrupt data");
+                }
+                return size;
+            }
+            const char* data_;
+            const char* end_;
+    };
+
+    /**
+     * Read-only mapping of a whole file; data() is null when it cannot be read.
+     */
+    class MappedFile {
+        public:
+            explicit MappedFile(const std::string& filename) {
+                int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd < 0) {
+                    return;
+                }
+                struct stat st;
+                if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (addr != MAP_FAILED) {
+                        data_ = static_cast<const char*>(addr);
+                        size_ = st.st_size;
+                    }
+                }
+                ::close(fd);
+            }
+            ~MappedFile() {
+                if (data_ != nullptr) {
+                    ::munmap(const_cast<char*>(data_), size_);
+                }
+            }
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const char* data() const {
+                return data_;
+            }
+            size_t size() const {
+                return size_;
+            }
+        private:
+            const char* data_ = nullptr;
+            size_t size_ = 0;
+    };
+
+    /**
+     * Writes the parts to a temporary file next to filename and renames it into
+     * place, so readers see the old file or the new one, never a partial one.
+     * With durable set the data is fsync'ed before the rename.
+     */
+    inline bool write_file_atomically(const std::string& filename, const std::vector<std::pair<const void*, size_t>>& parts,
+                                      bool durable = false) {
+        auto tmp_filename = filename + "." + std::to_string(::getpid()) + ".tmp";
+        int fd = ::open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = true;
+        for (const auto& [data, size] : parts) {
+            const char* at = static_cast<const char*>(data);
+            size_t left = size;
+            while (ok && left > 0) {
+                ssize_t written = ::write(fd, at, left);
+                ok = written > 0;
+                at += ok ? written : 0;
+                left -= ok ? written : 0;
+            }
+        }
+        if (ok && durable) {
+            ok = ::fsync(fd) == 0;
+        }
+        ok = ::close(fd) == 0 && ok;
+        if (!ok || ::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+            ::unlink(tmp_filename.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+#endif
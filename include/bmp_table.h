@@ -0,0 +1,299 @@
+// Created by: Gregorio Toscano
+
+#ifndef BMP_TABLE_H
+#define BMP_TABLE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace arrow {
+    class Table;
+}
+
+// Define a plain‐old‐data struct matching your schema
+struct BmpRowLand {
+  int32_t  BmpSubmittedId;
+  int32_t  AgencyId;
+  std::string StateUniqueIdentifier;
+  int32_t  StateId;
+  int32_t  BmpId;
+  int32_t  GeographyId;
+  int32_t  LoadSourceGroupId;
+  int32_t  UnitId;
+  double   Amount;
+  bool     IsValid;
+  std::string ErrorMessage;
+  int32_t  RowIndex;
+};
+
+struct BmpRowAnimal {
+  int32_t         BmpSubmittedId;
+  int32_t         BmpId;
+  int32_t         AgencyId;
+  std::string StateUniqueIdentifier;
+  int32_t         StateId;
+  int32_t         GeographyId;
+  int32_t         AnimalGroupId;
+  int32_t         LoadSourceGroupId;
+  int32_t         UnitId;
+  double          Amount;
+  double          NReductionFraction;
+  double          PReductionFraction;
+  bool            IsValid;
+  std::string     ErrorMessage;
+  int32_t         RowIndex;
+};
+
+struct BmpRowManure {
+    int32_t         BmpSubmittedId;
+    int32_t         BmpId;
+    int32_t         AgencyId;
+    std::string StateUniqueIdentifier;
+    int32_t         StateId;
+    bool            HasStateReference;
+    int32_t         CountyIdFrom;
+    int32_t         CountyIdTo;
+    std::string     FIPSFrom;
+    std::string     FIPSTo;
+    int32_t         AnimalGroupId;
+    int32_t         LoadSourceGroupId;
+    int32_t         UnitId;
+    double          Amount;
+    bool            IsValid;
+    std::string     ErrorMessage;
+    int32_t         RowIndex;
+};
+
+namespace bmp_table {
+    /**
+     * Pointers into the buffers of one column; the BmpTable that handed them
+     * out keeps the buffers alive.
+     */
+    template <typename T>
+    class Column {
+    public:
+        T operator[](int64_t i) const {
+            return values_[i];
+        }
+
+    private:
+        friend class Table;
+        const T* values_ = nullptr;
+    };
+
+    template <>
+    class Column<bool> {
+    public:
+        bool operator[](int64_t i) const {
+            int64_t bit = offset_ + i;
+            return (bits_[bit >> 3] >> (bit & 7)) & 1;
+        }
+
+    private:
+        friend class Table;
+        const uint8_t* bits_ = nullptr;
+        int64_t offset_ = 0;
+    };
+
+    /**
+     * A utf8 column; a null value reads as "".
+     */
+    template <>
+    class Column<std::string_view> {
+    public:
+        std::string_view operator[](int64_t i) const {
+            if (validity_ != nullptr && !((validity_[(offset_ + i) >> 3] >> ((offset_ + i) & 7)) & 1)) {
+                return {};
+            }
+            return {data_ + offsets_[i], static_cast<size_t>(offsets_[i + 1] - offsets_[i])};
+        }
+
+    private:
+        friend class Table;
+        const int32_t* offsets_ = nullptr;
+        const char* data_ = nullptr;
+        const uint8_t* validity_ = nullptr;
+        int64_t offset_ = 0;
+    };
+
+    /**
+     * @class Table
+     * @brief An Arrow table with its columns resolved once, read-only.
+     *
+     * Copies share the table. Columns are found by name, ignoring case, or
+     * else by their position in the submission schema, and must have the
+     * type of that schema; anything else throws std::runtime_error.
+     */
+    class Table {
+    public:
+        Table() = default;
+
+        int64_t size() const {
+            return size_;
+        }
+        bool empty() const {
+            return size_ == 0;
+        }
+        const std::shared_ptr<arrow::Table>& table() const {
+            return table_;
+        }
+
+    protected:
+        explicit Table(std::shared_ptr<arrow::Table> table);
+
+        Column<int32_t> int32_column(const std::string& name, int position) const;
+        Column<double> double_column(const std::string& name, int position) const;
+        Column<bool> bool_column(const std::string& name, int position) const;
+        Column<std::string_view> string_column(const std::string& name, int position) const;
+
+    private:
+        std::shared_ptr<arrow::Table> table_;
+        int64_t size_ = 0;
+    };
+}
+
+/**
+ * @class BmpTableLand
+ * @brief The rows of a base land submission file, one accessor per column.
+ */
+class BmpTableLand : public bmp_table::Table {
+public:
+    BmpTableLand() = default;
+    explicit BmpTableLand(std::shared_ptr<arrow::Table> table);
+    /**
+     * The same rows as a table, for inputs that are not read from a file.
+     */
+    static BmpTableLand from_rows(const std::vector<BmpRowLand>& rows);
+
+    int32_t BmpSubmittedId(int64_t i) const { return bmp_submitted_id_[i]; }
+    int32_t AgencyId(int64_t i) const { return agency_id_[i]; }
+    std::string_view StateUniqueIdentifier(int64_t i) const { return state_unique_identifier_[i]; }
+    int32_t StateId(int64_t i) const { return state_id_[i]; }
+    int32_t BmpId(int64_t i) const { return bmp_id_[i]; }
+    int32_t GeographyId(int64_t i) const { return geography_id_[i]; }
+    int32_t LoadSourceGroupId(int64_t i) const { return load_source_group_id_[i]; }
+    int32_t UnitId(int64_t i) const { return unit_id_[i]; }
+    double Amount(int64_t i) const { return amount_[i]; }
+    bool IsValid(int64_t i) const { return is_valid_[i]; }
+    std::string_view ErrorMessage(int64_t i) const { return error_message_[i]; }
+    int32_t RowIndex(int64_t i) const { return row_index_[i]; }
+
+private:
+    bmp_table::Column<int32_t> bmp_submitted_id_;
+    bmp_table::Column<int32_t> agency_id_;
+    bmp_table::Column<std::string_view> state_unique_identifier_;
+    bmp_table::Column<int32_t> state_id_;
+    bmp_table::Column<int32_t> bmp_id_;
+    bmp_table::Column<int32_t> geography_id_;
+    bmp_table::Column<int32_t> load_source_group_id_;
+    bmp_table::Column<int32_t> unit_id_;
+    bmp_table::Column<double> amount_;
+    bmp_table::Column<bool> is_valid_;
+    bmp_table::Column<std::string_view> error_message_;
+    bmp_table::Column<int32_t> row_index_;
+};
+
+/**
+ * @class BmpTableAnimal
+ * @brief The rows of a base animal submission file, one accessor per column.
+ */
+class BmpTableAnimal : public bmp_table::Table {
+public:
+    BmpTableAnimal() = default;
+    explicit BmpTableAnimal(std::shared_ptr<arrow::Table> table);
+    static BmpTableAnimal from_rows(const std::vector<BmpRowAnimal>& rows);
+
+    int32_t BmpSubmittedId(int64_t i) const { return bmp_submitted_id_[i]; }
+    int32_t BmpId(int64_t i) const { return bmp_id_[i]; }
+    int32_t AgencyId(int64_t i) const { return agency_id_[i]; }
+    std::string_view StateUniqueIdentifier(int64_t i) const { return state_unique_identifier_[i]; }
+    int32_t StateId(int64_t i) const { return state_id_[i]; }
+    int32_t GeographyId(int64_t i) const { return geography_id_[i]; }
+    int32_t AnimalGroupId(int64_t i) const { return animal_group_id_[i]; }
+    int32_t LoadSourceGroupId(int64_t i) const { return load_source_group_id_[i]; }
+    int32_t UnitId(int64_t i) const { return unit_id_[i]; }
+    double Amount(int64_t i) const { return amount_[i]; }
+    double NReductionFraction(int64_t i) const { return n_reduction_fraction_[i]; }
+    double PReductionFraction(int64_t i) const { return p_reduction_fraction_[i]; }
+    bool IsValid(int64_t i) const { return is_valid_[i]; }
+    std::string_view ErrorMessage(int64_t i) const { return error_message_[i]; }
+    int32_t RowIndex(int64_t i) const { return row_index_[i]; }
+
+private:
+    bmp_table::Column<int32_t> bmp_submitted_id_;
+    bmp_table::Column<int32_t> bmp_id_;
+    bmp_table::Column<int32_t> agency_id_;
+    bmp_table::Column<std::string_view> state_unique_identifier_;
+    bmp_table::Column<int32_t> state_id_;
+    bmp_table::Column<int32_t> geography_id_;
+    bmp_table::Column<int32_t> animal_group_id_;
+    bmp_table::Column<int32_t> load_source_group_id_;
+    bmp_table::Column<int32_t> unit_id_;
+    bmp_table::Column<double> amount_;
+    bmp_table::Column<double> n_reduction_fraction_;
+    bmp_table::Column<double> p_reduction_fraction_;
+    bmp_table::Column<bool> is_valid_;
+    bmp_table::Column<std::string_view> error_message_;
+    bmp_table::Column<int32_t> row_index_;
+};
+
+/**
+ * @class BmpTableManure
+ * @brief The rows of a base manure transport submission file, one accessor
+ * per column.
+ */
+class BmpTableManure : public bmp_table::Table {
+public:
+    BmpTableManure() = default;
+    explicit BmpTableManure(std::shared_ptr<arrow::Table> table);
+    static BmpTableManure from_rows(const std::vector<BmpRowManure>& rows);
+
+    int32_t BmpSubmittedId(int64_t i) const { return bmp_submitted_id_[i]; }
+    int32_t BmpId(int64_t i) const { return bmp_id_[i]; }
+    int32_t AgencyId(int64_t i) const { return agency_id_[i]; }
+    std::string_view StateUniqueIdentifier(int64_t i) const { return state_unique_identifier_[i]; }
+    int32_t StateId(int64_t i) const { return state_id_[i]; }
+    bool HasStateReference(int64_t i) const { return has_state_reference_[i]; }
+    int32_t CountyIdFrom(int64_t i) const { return county_id_from_[i]; }
+    int32_t CountyIdTo(int64_t i) const { return county_id_to_[i]; }
+    std::string_view FIPSFrom(int64_t i) const { return fips_from_[i]; }
+    std::string_view FIPSTo(int64_t i) const { return fips_to_[i]; }
+    int32_t AnimalGroupId(int64_t i) const { return animal_group_id_[i]; }
+    int32_t LoadSourceGroupId(int64_t i) const { return load_source_group_id_[i]; }
+    int32_t UnitId(int64_t i) const { return unit_id_[i]; }
+    double Amount(int64_t i) const { return amount_[i]; }
+    bool IsValid(int64_t i) const { return is_valid_[i]; }
+    std::string_view ErrorMessage(int64_t i) const { return error_message_[i]; }
+    int32_t RowIndex(int64_t i) const { return row_index_[i]; }
+
+private:
+    bmp_table::Column<int32_t> bmp_submitted_id_;
+    bmp_table::Column<int32_t> bmp_id_;
+    bmp_table::Column<int32_t> agency_id_;
+    bmp_table::Column<std::string_view> state_unique_identifier_;
+    bmp_table::Column<int32_t> state_id_;
+    bmp_table::Column<bool> has_state_reference_;
+    bmp_table::Column<int32_t> county_id_from_;
+    bmp_table::Column<int32_t> county_id_to_;
+    bmp_table::Column<std::string_view> fips_from_;
+    bmp_table::Column<std::string_view> fips_to_;
+    bmp_table::Column<int32_t> animal_group_id_;
+    bmp_table::Column<int32_t> load_source_group_id_;
+    bmp_table::Column<int32_t> unit_id_;
+    bmp_table::Column<double> amount_;
+    bmp_table::Column<bool> is_valid_;
+    bmp_table::Column<std::string_view> error_message_;
+    bmp_table::Column<int32_t> row_index_;
+};
+
+/**
+ * Reads a base submission file; an empty file gives an empty table.
+ */
+BmpTableLand read_parquet_file_land(const std::string& file_name);
+BmpTableAnimal read_parquet_file_animal(const std::string& file_name);
+BmpTableManure read_parquet_file_manure(const std::string& file_name);
+
+#endif
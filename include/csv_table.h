@@ -0,0 +1,211 @@
+// Created by: Gregorio Toscano
+
+#ifndef CSV_TABLE_H
+#define CSV_TABLE_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "binary_io.h"
+
+class ThreadPool;
+
+namespace csv_table {
+    constexpr size_t CHUNK_BYTES = size_t{4} << 20;
+
+    /**
+     * A row that was not loaded: a missing file or column (line 0), a row with
+     * the wrong number of fields, or a value that does not convert.
+     */
+    struct RowError {
+        std::string file;
+        size_t line; ///< 1-based, the header being line 1
+        std::string message;
+    };
+
+    /**
+     * The requested columns of one row. get<T>(k) converts column k the way
+     * csv.hpp's CSVField::get<T>() does (int, double or std::string), except
+     * that a failed conversion marks the row as failed and returns T{}
+     * instead of throwing.
+     */
+    class Row {
+    public:
+        template <typename T>
+        T get(size_t column);
+
+        bool failed() const {
+            return !error_.empty();
+        }
+        const std::string& error() const {
+            return error_;
+        }
+
+    private:
+        friend class File;
+
+        std::string_view field(size_t column) const {
+            return fields_[(*index_)[column]];
+        }
+        void fail(size_t column, const std::string& message);
+
+        std::vector<std::string_view> fields_; ///< every field of the line
+        std::deque<std::string> unescaped_;    ///< quoted fields with "" in them
+        const std::vector<size_t>* index_ = nullptr;
+        const std::vector<std::string>* columns_ = nullptr;
+        std::string error_;
+    };
+
+    template <> int Row::get<int>(size_t column);
+    template <> double Row::get<double>(size_t column);
+    template <> std::string Row::get<std::string>(size_t column);
+
+    /**
+     * @class File
+     * @brief A comma-separated file mapped in memory and cut into chunks of
+     * whole rows, so that the chunks can be parsed on different threads.
+     *
+     * The header is parsed once and the requested columns are resolved to
+     * field indices there. Quoting follows csv.hpp: a field starting with a
+     * quote runs to the next quote followed by a comma or a newline, "" is a
+     * quote, and empty lines are skipped.
+     */
+    class File {
+    public:
+        File(std::string filename, std::vector<std::string> columns, size_t chunk_bytes = CHUNK_BYTES);
+
+        size_t chunks() const {
+            return chunks_.size();
+        }
+        const std::string& filename() const {
+            return filename_;
+        }
+        /**
+         * Calls visit on every row of chunk k that has as many fields as the
+         * header, and adds an error for every other row and for every row
+         * visit left failed. Returns the rows visited, failed ones included.
+         */
+        size_t scan(size_t k, const std::function<void(Row&)>& visit, std::vector<RowError>& errors) const;
+        /**
+         * Why the file loads nothing, if it does not.
+         */
+        const std::vector<RowError>& open_errors() const {
+            return open_errors_;
+        }
+
+    private:
+        std::string filename_;
+        std::vector<std::string> columns_;
+        std::unique_ptr<binary_io::MappedFile> file_;
+        std::vector<size_t> index_; ///< field of each requested column
+        size_t width_ = 0;          ///< fields in the header
+        struct Chunk {
+            size_t begin;
+            size_t end;
+            size_t line; ///< of the first row
+        };
+        std::vector<Chunk> chunks_;
+        std::vector<RowError> open_errors_;
+    };
+
+    /**
+     * What parse_all() needs of a Table, whatever its row type.
+     */
+    class Parsed {
+    public:
+        virtual ~Parsed() = default;
+        virtual size_t chunks() const = 0;
+        virtual void parse(size_t k) = 0;
+        virtual std::vector<RowError> errors() const = 0;
+    };
+
+    /**
+     * @class Table
+     * @brief The rows of a File converted to T, chunk by chunk.
+     *
+     * parse(k) fills chunk k only, so different chunks can be parsed at the
+     * same time. Once every chunk is parsed, for_each() visits the values in
+     * file order.
+     */
+    template <typename T>
+    class Table : public Parsed {
+    public:
+        using Convert = std::function<T(Row&)>;
+
+        Table(std::string filename, std::vector<std::string> columns, Convert convert, size_t chunk_bytes = CHUNK_BYTES)
+            : file_(std::move(filename), std::move(columns), chunk_bytes), convert_(std::move(convert)),
+              values_(file_.chunks()), rows_(file_.chunks(), 0), errors_(file_.chunks()) {}
+
+        size_t chunks() const override {
+            return file_.chunks();
+        }
+        void parse(size_t k) override {
+            values_[k].clear();
+            errors_[k].clear();
+            rows_[k] = file_.scan(k, [&](Row& row) {
+                T value = convert_(row);
+                if (!row.failed()) {
+                    values_[k].push_back(std::move(value));
+                }
+            }, errors_[k]);
+        }
+
+        template <typename F>
+        void for_each(F&& visit) const {
+            for (const auto& chunk : values_) {
+                for (const auto& value : chunk) {
+                    visit(value);
+                }
+            }
+        }
+        /**
+         * Rows with the right number of fields, the ones that failed to
+         * convert included: what iterating the file with csv.hpp visits.
+         */
+        size_t rows() const {
+            size_t total = 0;
+            for (auto n : rows_) {
+                total += n;
+            }
+            return total;
+        }
+        size_t size() const {
+            size_t total = 0;
+            for (const auto& chunk : values_) {
+                total += chunk.size();
+            }
+            return total;
+        }
+        std::vector<RowError> errors() const override {
+            auto all = file_.open_errors();
+            for (const auto& chunk : errors_) {
+                all.insert(all.end(), chunk.begin(), chunk.end());
+            }
+            return all;
+        }
+        const std::string& filename() const {
+            return file_.filename();
+        }
+
+    private:
+        File file_;
+        Convert convert_;
+        std::vector<std::vector<T>> values_;
+        std::vector<size_t> rows_;
+        std::vector<std::vector<RowError>> errors_;
+    };
+
+    /**
+     * Parses every chunk of every table, all of them at once on pool, or one
+     * after another if pool is null.
+     */
+    void parse_all(const std::vector<Parsed*>& tables, ThreadPool* pool);
+}
+
+#endif
@@ -5,10 +5,14 @@
 #ifndef DATA_READER_H
 #define DATA_READER_H
 
+#include <memory>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
+#include "csv_table.h"
+
 /**
  * @class DataReader
  * @brief A class to read all required data
@@ -28,9 +32,15 @@ public:
      */
     DataReader(std::string path);
     /**
-     * Reads all CSV files.
+     * Reads all CSV files: every file is parsed at once, in chunks on
+     * CSV_NTHREADS threads (0, the default, means one per core), then each
+     * table is loaded in file order.
      */
     void read_all();
+    /**
+     * The rows that could not be loaded by the reads so far.
+     */
+    const std::vector<csv_table::RowError>& get_errors() const;
 
     void read_scenario();
 
@@ -166,6 +176,37 @@ public:
     double get_bmp_cost(int profile, int bmp) const;
 
 private:
+    enum : unsigned {
+        LOAD_SRC_GROUPS = 1u << 0,
+        LRSEG_GEOGRAPHY = 1u << 1,
+        LOAD_SRC_BMPS = 1u << 2,
+        ANIMAL_POPULATION = 1u << 3,
+        ANIMAL_GRP_BMPS = 1u << 4,
+        LAND_COST = 1u << 5,
+        ANIMAL_COST = 1u << 6,
+        LAND_BMP_COST = 1u << 7,
+        ANIMAL_BMP_COST = 1u << 8,
+        LRSEG = 1u << 9,
+        SCENARIO = 1u << 10,
+        GEOGRAPHY_COUNTY = 1u << 11,
+        ALL_TABLES = (1u << 12) - 1,
+    };
+    struct BmpCost {
+        int profile;
+        int bmp;
+        double cost;
+        std::string key; ///< profile_bmp
+    };
+    static std::unique_ptr<csv_table::Table<BmpCost>> bmp_cost_table(const std::string& filename);
+    int add_bmp_cost(const csv_table::Table<BmpCost>& table);
+    int add_bmp_cost2(const csv_table::Table<BmpCost>& table);
+    /**
+     * Parses the files of the tables in the mask concurrently, then loads
+     * them; the result is the same as reading them one after another.
+     */
+    void read_tables(unsigned tables);
+    void add_errors(const std::vector<csv_table::RowError>& errors);
+
     std::unordered_map<int, int> u_u_group_dict; ///< A map<int,int>: load source -> load source group.
     std::unordered_map<int, int> s_geography_dict; ///< A map<int,int>: lrseg -> geography.
     std::unordered_map<int, std::tuple<int, int, std::string, std::string, std::string> > geography_county_;
@@ -183,6 +224,7 @@ private:
     std::unordered_map<int, std::string> scenario_data_;
     std::unordered_map<int, std::string> scenario_data2_;
     std::string csvs_path; ///< stores the path where the CSV files are stored.
+    std::vector<csv_table::RowError> errors_;
 };
 
 #endif //DATA_READER_H
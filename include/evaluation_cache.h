@@ -0,0 +1,81 @@
+// Created by: Gregorio Toscano
+
+#ifndef EVALUATION_CACHE_H
+#define EVALUATION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class EvaluationCache
+ * @brief Loads already returned by CAST, keyed on the canonical form of the
+ * submitted BMP decisions.
+ *
+ * Two solutions get the same key when their decision rows are equal as a set:
+ * the rows are sorted and hashed field by field. Amounts are taken bit for bit
+ * because the Parquet writer emits them unrounded, so only submissions CAST
+ * would see as identical share a key. The context seeds the key with
+ * everything else the load depends on (scenario, base submissions, enabled
+ * categories).
+ *
+ * Every insertion is appended to the cache file, which is read back when the
+ * cache is opened, so later runs on the same context reuse the results. A
+ * truncated last record, e.g. from a killed run, is ignored.
+ */
+class EvaluationCache {
+public:
+    struct Entry {
+        double load;
+        std::string exec_uuid; ///< the solution that was evaluated; its files carry this uuid
+        std::string directory; ///< where its files were written
+    };
+
+    /**
+     * @param filename cache file, created if missing; empty keeps the cache in memory only
+     */
+    explicit EvaluationCache(std::string filename = "");
+
+    static uint64_t solution_key(uint64_t context,
+                                 const std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+                                 const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x,
+                                 const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x);
+
+    /**
+     * Counts a hit or a miss.
+     */
+    std::optional<Entry> find(uint64_t key);
+    void insert(uint64_t key, double load, const std::string& exec_uuid, const std::string& directory = "");
+
+    size_t size() const {
+        return entries_.size();
+    }
+    size_t hits() const {
+        return hits_;
+    }
+    size_t misses() const {
+        return misses_;
+    }
+    double hit_rate() const {
+        return hits_ + misses_ == 0 ? 0.0 : static_cast<double>(hits_) / (hits_ + misses_);
+    }
+    const std::string& filename() const {
+        return filename_;
+    }
+
+private:
+    void load();
+
+    std::string filename_;
+    std::ofstream out_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+};
+
+#endif
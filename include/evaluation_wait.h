@@ -0,0 +1,169 @@
+// Created by: Gregorio Toscano
+
+#ifndef EVALUATION_WAIT_H
+#define EVALUATION_WAIT_H
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @struct WaitOptions
+ * @brief How long a dispatched solution may stay without a result.
+ */
+struct WaitOptions {
+    std::chrono::milliseconds deadline{3600000}; ///< per attempt, counted from its dispatch
+    int max_retries = 2;                         ///< re-dispatches before a solution is given up
+    std::chrono::milliseconds poll{1000};        ///< longest single receive, so deadlines are checked
+};
+
+/**
+ * @struct WaitOutcome
+ * @brief What one PendingEvaluations::wait() call settled.
+ */
+struct WaitOutcome {
+    std::vector<std::string> scored;   ///< "exec_uuid_load", the format the CAST worker replies with
+    std::vector<std::string> unscored; ///< exec_uuids given up after max_retries re-dispatches
+    std::vector<double> latency_ms;    ///< first dispatch to result, one entry per scored solution
+    int redispatched = 0;
+};
+
+/**
+ * @class PendingEvaluations
+ * @brief Dispatched solutions that have no result yet, each with its own deadline.
+ *
+ * wait() is written against a Transport with four members:
+ *
+ *   std::optional<std::string> receive(std::chrono::milliseconds timeout);
+ *       next completion notice (an exec_uuid), or nullopt after timeout
+ *   bool resend(const std::string& exec_uuid);
+ *       dispatches the solution again; false if it could not be sent
+ *   std::optional<std::string> collect(const std::string& exec_uuid);
+ *       its stored result, or nullopt when the worker stored none
+ *   void drop(const std::string& exec_uuid);
+ *       forgets a solution that was given up, or a late duplicate notice
+ *
+ * A solution whose deadline passes, or that completes without a stored result,
+ * is re-dispatched up to max_retries times and then reported as unscored. The
+ * first notice of a solution wins; later ones are dropped.
+ */
+class PendingEvaluations {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PendingEvaluations(WaitOptions options = {}) : options_(options) {}
+
+    void set_options(const WaitOptions& options) {
+        options_ = options;
+    }
+    const WaitOptions& options() const {
+        return options_;
+    }
+
+    /**
+     * Starts the deadline of a solution that was just sent; for a solution
+     * already pending, restarts it.
+     */
+    void dispatched(const std::string& exec_uuid) {
+        auto now = Clock::now();
+        auto [it, inserted] = pending_.try_emplace(exec_uuid, Entry{now, now + options_.deadline, 0});
+        if (!inserted) {
+            it->second.deadline = now + options_.deadline;
+        }
+    }
+
+    bool empty() const {
+        return pending_.empty();
+    }
+    size_t size() const {
+        return pending_.size();
+    }
+
+    /**
+     * Blocks until every pending solution is scored or given up. With any set,
+     * returns as soon as at least one is settled, together with every notice
+     * already delivered.
+     */
+    template <typename Transport>
+    WaitOutcome wait(Transport& transport, bool any = false) {
+        WaitOutcome outcome;
+        auto settled = [&] {
+            return outcome.scored.size() + outcome.unscored.size();
+        };
+        while (!pending_.empty()) {
+            expire(transport, outcome);
+            if (pending_.empty()) {
+                break;
+            }
+            auto now = Clock::now();
+            std::chrono::milliseconds timeout(0);
+            if (!(any && settled() > 0)) {
+                auto earliest = std::min_element(pending_.begin(), pending_.end(), [](const auto& a, const auto& b) {
+                    return a.second.deadline < b.second.deadline;
+                })->second.deadline;
+                auto until_deadline = std::chrono::ceil<std::chrono::milliseconds>(std::max(earliest - now, Clock::duration::zero()));
+                timeout = std::min(options_.poll, until_deadline);
+            }
+
+            auto received = transport.receive(timeout);
+            if (!received) {
+                if (any && settled() > 0) {
+                    break;
+                }
+                continue;
+            }
+            auto it = pending_.find(*received);
+            if (it == pending_.end()) {
+                transport.drop(*received);
+                continue;
+            }
+            auto load = transport.collect(*received);
+            if (!load) {
+                // completed without a result: retry it right away
+                it->second.deadline = Clock::now();
+                continue;
+            }
+            outcome.scored.push_back(*received + "_" + *load);
+            outcome.latency_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - it->second.first_dispatch).count());
+            pending_.erase(it);
+        }
+        return outcome;
+    }
+
+private:
+    struct Entry {
+        Clock::time_point first_dispatch;
+        Clock::time_point deadline;
+        int retries;
+    };
+
+    template <typename Transport>
+    void expire(Transport& transport, WaitOutcome& outcome) {
+        auto now = Clock::now();
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            auto& entry = it->second;
+            if (entry.deadline > now) {
+                ++it;
+                continue;
+            }
+            if (entry.retries < options_.max_retries && transport.resend(it->first)) {
+                ++entry.retries;
+                ++outcome.redispatched;
+                entry.deadline = Clock::now() + options_.deadline;
+                ++it;
+                continue;
+            }
+            transport.drop(it->first);
+            outcome.unscored.push_back(it->first);
+            it = pending_.erase(it);
+        }
+    }
+
+    WaitOptions options_;
+    std::unordered_map<std::string, Entry> pending_;
+};
+
+#endif
@@ -0,0 +1,159 @@
+// Created by: Gregorio Toscano
+
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "scenario.h"
+
+/**
+ * @struct EvaluationRequest
+ * @brief One solution handed to an Evaluator: its exec_uuid and the rows that were
+ * written to its impbmpsubmitted* files. Row pointers may be null when a
+ * category is disabled; they must outlive the evaluate() call.
+ */
+struct EvaluationRequest {
+    std::string exec_uuid;
+    const std::vector<std::tuple<int, int, int, int, double>>* lc_x = nullptr;
+    const std::vector<std::tuple<int, int, int, int, int, double>>* animal_x = nullptr;
+    const std::vector<std::tuple<int, int, int, int, int, double>>* manure_x = nullptr;
+    /** the file lc_x was written to by Scenario::write_land; empty if none was */
+    std::string land_file;
+};
+
+/**
+ * @class Evaluator
+ * @brief Computes the load of a generation of solutions whose submission files are
+ * already on disk.
+ *
+ * evaluate() returns one "exec_uuid_load" entry per evaluated solution, the format
+ * the CAST worker replies with. Solutions that could not be evaluated are left out.
+ */
+class Evaluator {
+public:
+    virtual ~Evaluator() = default;
+    /** The PSO_EVALUATOR name of the backend; loads of different backends are never mixed. */
+    virtual std::string name() const = 0;
+    virtual std::vector<std::string> evaluate(Scenario& scenario, const std::string& emo_uuid,
+                                              const std::vector<EvaluationRequest>& requests) = 0;
+
+    /**
+     * Asynchronous form used by the steady-state PSO: submit() dispatches the
+     * solutions without waiting for them, and wait_any() blocks until at least
+     * one submitted solution has completed and returns every completion
+     * available so far. A solution that completed without a load is returned
+     * as "exec_uuid_" so the caller can dispatch it again.
+     *
+     * The defaults run evaluate() inside submit() and queue its results.
+     */
+    virtual void submit(Scenario& scenario, const std::string& emo_uuid,
+                        const std::vector<EvaluationRequest>& requests);
+    virtual std::vector<std::string> wait_any(Scenario& scenario, const std::string& emo_uuid);
+
+protected:
+    std::vector<std::string> completed_;
+};
+
+/**
+ * @class AmqpEvaluator
+ * @brief Sends the solutions to the external CAST worker through Redis/RabbitMQ
+ * (Scenario::send_files) and waits for its replies.
+ */
+class AmqpEvaluator : public Evaluator {
+public:
+    std::string name() const override {
+        return "cast";
+    }
+    std::vector<std::string> evaluate(Scenario& scenario, const std::string& emo_uuid,
+                                      const std::vector<EvaluationRequest>& requests) override;
+    void submit(Scenario& scenario, const std::string& emo_uuid,
+                const std::vector<EvaluationRequest>& requests) override;
+    std::vector<std::string> wait_any(Scenario& scenario, const std::string& emo_uuid) override;
+};
+
+/**
+ * @class ModelEvaluator
+ * @brief In-process load model built from the scenario's phi (load per unit of
+ * amount) and eta (BMP efficiency) coefficients, as in the nsga3 mathmodel mode.
+ *
+ * Land conversion rows move their acres from "lrseg_agency_loadsrc" to the
+ * converted load source; rows of efficiency BMPs with an eta coefficient reduce
+ * the load of their parcel by prod(1 - eta * pct). Animal and manure transport
+ * rows have no coefficients in the scenario and leave the load unchanged.
+ * No network access is needed, so it serves benchmarks and regression tests.
+ *
+ * When a request names its land_file, evaluate() takes the agency, BMP and
+ * amount of every new row from that file, as CAST would, and leaves the
+ * solution out if the file is missing or does not hold one row per lc_x
+ * row. The file only keeps the geography and load source group of a row,
+ * so the lrseg and load source still come from lc_x, row by row.
+ */
+class ModelEvaluator : public Evaluator {
+public:
+    using LandRows = std::vector<std::tuple<int, int, int, int, double>>;
+
+    explicit ModelEvaluator(const Scenario& scenario);
+    std::string name() const override {
+        return "model";
+    }
+    std::vector<std::string> evaluate(Scenario& scenario, const std::string& emo_uuid,
+                                      const std::vector<EvaluationRequest>& requests) override;
+    /** The load of the request's lc_x rows, without reading any file. */
+    double compute_load(const EvaluationRequest& request) const;
+    double compute_load(const LandRows& lc_x) const;
+    /**
+     * lc_x with the agency, BMP and amount of the last lc_x.size() rows of
+     * the land submission file; throws if the file cannot be read or has
+     * fewer rows.
+     */
+    static LandRows read_submitted_land(const std::string& filename, const LandRows& lc_x);
+    double get_base_load() const {
+        return base_load_;
+    }
+
+private:
+    struct RowKey {
+        int lrseg;
+        int agency;
+        int load_src;
+        int bmp;
+        bool operator==(const RowKey&) const = default;
+    };
+    struct RowKeyHash {
+        size_t operator()(const RowKey& key) const;
+    };
+    struct Parcel {
+        double phi;    ///< load per unit of amount of the selected pollutant
+        double amount;
+    };
+    struct Conversion {
+        size_t from;
+        size_t to;
+    };
+    size_t parcel_index(const std::string& key, const std::unordered_map<std::string, std::vector<double>>& phi_dict,
+                        const std::unordered_map<std::string, double>& amount);
+
+    int load_to_opt_;
+    double base_load_;
+    std::vector<Parcel> parcels_;
+    std::unordered_map<std::string, size_t> parcel_idx_;
+    // unused fields of a key are 0
+    std::unordered_map<RowKey, size_t, RowKeyHash> parcel_of_;        ///< (lrseg, agency, load_src) -> parcel
+    std::unordered_map<RowKey, Conversion, RowKeyHash> conversions_;  ///< (lrseg, agency, load_src, bmp) -> parcels
+    std::unordered_map<RowKey, double, RowKeyHash> efficiency_;       ///< (lrseg, load_src, bmp) -> eta
+};
+
+/**
+ * Builds the evaluator named by `name`: "cast" (AmqpEvaluator) or "model" (ModelEvaluator).
+ *
+ * @throws std::invalid_argument for any other name
+ */
+std::shared_ptr<Evaluator> make_evaluator(const std::string& name, const Scenario& scenario);
+
+#endif // EVALUATOR_H
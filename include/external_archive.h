@@ -19,8 +19,27 @@ void update_non_dominated_solutions(
     std::vector<double>& archive_gx,
     const double new_solution_gx);
     
-void update_non_dominated_solutions(
+/**
+ * Inserts new_solution_x into the non-dominated archive in place: members it
+ * dominates are removed, and it is copied in only if no member dominates or
+ * equals it. With a capacity > 0, an archive that grows past capacity is pruned
+ * by crowding distance down to 90% of it, so pruning is not repeated on every
+ * insertion.
+ *
+ * @return true if the new solution was added (it may still be the one pruned)
+ */
+bool update_non_dominated_solutions(
     std::vector<Particle>& archive, 
-    const Particle& new_solution_x);
+    const Particle& new_solution_x,
+    size_t capacity = 0);
+
+/**
+ * Removes members one at a time, always the one with the smallest crowding
+ * distance (lowest index on ties), updating only its neighbours' distances,
+ * until target_size remain. The extremes of every objective are kept. The
+ * survivors keep their relative order.
+ */
+void prune_by_crowding(std::vector<Particle>& archive, size_t target_size);
+
 
 #endif
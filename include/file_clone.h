@@ -0,0 +1,69 @@
+// Created by: Gregorio Toscano
+
+#ifndef FILE_CLONE_H
+#define FILE_CLONE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Copies of files that are not changed afterwards: the base submission files
+ * of disabled BMP categories, the parent files of the eps-constraint steps,
+ * the front and config directories. Each copy is made the cheapest way the
+ * filesystem allows:
+ *
+ *  - reflink: the destination shares the blocks of the source until either
+ *    is written (FICLONE; btrfs, xfs with reflink=1)
+ *  - hardlink: the destination is the source; only for immutable sources
+ *  - kernel: copy_file_range, which the kernel may turn into a reflink or a
+ *    server-side copy and otherwise copies without a round trip to user space
+ *  - copy: read and write
+ *
+ * The destination is built under a temporary name and renamed over the old
+ * one, so an existing destination (and any file hardlinked to it) is never
+ * written in place.
+ */
+namespace file_clone {
+    enum class Method : uint8_t {
+        reflink,
+        hardlink,
+        kernel,
+        copy,
+    };
+
+    constexpr size_t nmethods = 4;
+
+    const char* to_string(Method method);
+
+    /**
+     * Makes destination a copy of source, overwriting it.
+     *
+     * @param immutable source is never written again (it may be replaced or
+     * removed), so destination may be a hardlink to it
+     * @return how the copy was made
+     * @throws std::filesystem::filesystem_error if no method worked
+     */
+    Method clone(const std::string& source, const std::string& destination, bool immutable = false);
+
+    /**
+     * Makes destination a copy of source with the given method only.
+     *
+     * @return false if the filesystem does not support it
+     * @throws std::filesystem::filesystem_error for any other error
+     */
+    bool clone_with(Method method, const std::string& source, const std::string& destination);
+
+    /** Files and bytes cloned with each method since the last reset_stats(). */
+    struct Stats {
+        std::array<uint64_t, nmethods> files{};
+        std::array<uint64_t, nmethods> bytes{};
+    };
+
+    Stats stats();
+    void reset_stats();
+    void print_stats();
+}
+
+#endif // FILE_CLONE_H
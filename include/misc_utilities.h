@@ -5,6 +5,8 @@
 #ifndef CBO_EVALUATION_MISC_UTILITIES_H
 #define CBO_EVALUATION_MISC_UTILITIES_H
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <tuple>
@@ -24,6 +26,8 @@ namespace misc_utilities {
     std::unordered_map<std::string, double> read_loads(std::string loads_filename);
     bool copy_prefix_in_to_prefix_out(const std::string& source, const std::string& destination, const std::string& prefix_in, const std::string& prefix_out);
     std::string change_extension(const std::string& filename, const std::string& new_extension);
+    // files a solution leaves next to its {prefix}: submissions, loads, costs
+    const std::vector<std::string>& solution_file_suffixes();
     void move_files(const std::string& source_dir, const std::string& destination_dir, int n_sets, int delta_counter);
 
     void move_pf(const std::string& source_dir, const std::string& destination_dir, std::vector<std::string> pf_files);
@@ -31,6 +35,16 @@ namespace misc_utilities {
 
     std::tuple<std::string, std::string> extract_path_and_id(const std::string& path); 
     void merge_parquet_files(const std::string& file1, const std::string& file2, const std::string& output_file);
+    /**
+     * Rebuilds a full impbmpsubmitted* parquet file from a delta submission.
+     *
+     * The delta file (see SubmissionLayout::Delta) stores the path of its
+     * shared base file in the parquet footer; base and delta rows are
+     * concatenated into output_file. Nothing is done if output_file exists.
+     *
+     * @return false if the delta or its base file cannot be read.
+     */
+    bool materialize_submission(const std::string& delta_file, const std::string& output_file);
 
     std::string get_env_var(std::string const &key, std::string const &default_value);
 
@@ -43,10 +57,30 @@ namespace misc_utilities {
                    std::vector<std::string> &out);
 
     bool copy_full_directory(const std::string& source, const std::string& destination);
+    /**
+     * Copies source over destination with file_clone::clone.
+     *
+     * @param immutable source is never written again, so destination may be
+     * a hardlink to it
+     * @return false if source does not exist or cannot be copied.
+     */
     bool copy_file(const std::string& source,
-                   const std::string& destination);
+                   const std::string& destination,
+                   bool immutable = false);
     std::string current_time();
 
+    /**
+     * Fast 64-bit hashes used to key cached state (scenario snapshots,
+     * evaluation results). They detect changed inputs; they are not meant to
+     * resist tampering.
+     */
+    uint64_t mix64(uint64_t k);
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t seed);
+    uint64_t hash_file(const std::string& filename, uint64_t seed);
+
+    /**
+     * Uniform in [lower_bound, upper_bound), drawn from the run seed (rng.h).
+     */
     double rand_double(double lower_bound, double upper_bound);
     void mkdir(std::string dir_path);
 
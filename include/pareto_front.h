@@ -0,0 +1,36 @@
+// Created by: Gregorio Toscano
+
+#ifndef PARETO_FRONT_H
+#define PARETO_FRONT_H
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Objective values of one evaluated solution, read from its *_costs.json file.
+struct CostData {
+    double objective1;
+    double objective2;
+    std::optional<double> objective3; // Optional third objective
+    std::string file_index;
+};
+
+bool dominates(const CostData& a, const CostData& b, int num_objectives, double max_budget);
+
+/**
+ * File indices of the records no other record dominates, in input order.
+ * Same result as testing every pair with dominates(), in O(n log n).
+ */
+std::vector<std::string> find_pareto_front(const std::vector<CostData>& data, int num_objectives, double max_budget);
+
+/**
+ * Calls visit with the record of every *_costs.json file in directory, one
+ * file at a time, in directory order.
+ */
+void for_each_cost_record(const std::vector<std::string>& objs, const std::string& directory,
+                          const std::function<void(CostData&&)>& visit);
+std::vector<CostData> readCostFiles(const std::vector<std::string>& objs, const std::string& directory);
+std::vector<std::string> findParetoFrontFiles(const std::vector<std::string>& objs, const std::string& directory, double max_budget);
+
+#endif
@@ -1,9 +1,17 @@
 #ifndef PSO_H
 #define PSO_H
 #include <iostream>
+#include <optional>
+#include <string>
 #include <vector>
+#include "pareto_front.h"
 #include "particle.h"
+#include "swarm.h"
 #include "scenario.h" 
+#include "evaluation_cache.h"
+#include "results_store.h"
+#include "artifact_writer.h"
+#include "evaluator.h"
 #include "execute.h"
 #include <nlohmann/json.hpp>
 
@@ -31,7 +39,7 @@ using json = nlohmann::json;
 //   int32_t  RowIndex;
 // };
 
-// declaration of your reader
+
 class PSO {
 public:
 
@@ -64,6 +72,100 @@ public:
         return gbest_;
     }
     void save_gbest(std::string out_dir);
+
+    /**
+     * Number of worker threads used to build the particles' files in evaluate().
+     * Defaults to the PSO_NTHREADS environment variable (0: all hardware threads).
+     */
+    void set_nthreads(int nthreads) {
+        nthreads_ = nthreads > 0 ? nthreads : 1;
+    }
+    int get_nthreads() const {
+        return nthreads_;
+    }
+
+    /**
+     * Backend that computes the loads in evaluate(). Defaults to the PSO_EVALUATOR
+     * environment variable: "cast" (the CAST worker over AMQP) or "model" (in-process).
+     * The evaluation cache is reopened for the new backend.
+     */
+    void set_evaluator(std::shared_ptr<Evaluator> evaluator);
+
+    /**
+     * Maximum size of the gbest archive; beyond it the most crowded solutions are
+     * dropped. Defaults to the PSO_ARCHIVE_SIZE environment variable (0: unbounded).
+     */
+    void set_archive_capacity(size_t capacity) {
+        archive_capacity_ = capacity;
+    }
+
+    /**
+     * Asynchronous (steady-state) mode: each particle is re-dispatched as soon
+     * as its own result arrives instead of waiting for the whole generation.
+     * Defaults to the PSO_MODE environment variable ("generational" or "async").
+     */
+    void set_async(bool is_async) {
+        is_async_ = is_async;
+    }
+
+    /**
+     * Async mode only: maximum number of evaluations outstanding at once and
+     * total number of evaluations, which replaces max_iter. Default to
+     * PSO_MAX_IN_FLIGHT (0: nparts) and PSO_MAX_EVALUATIONS (0: nparts * (max_iter + 1)).
+     */
+    void set_max_in_flight(size_t max_in_flight) {
+        max_in_flight_ = max_in_flight;
+    }
+    void set_max_evaluations(size_t max_evaluations) {
+        max_evaluations_ = max_evaluations;
+    }
+
+    /**
+     * Results of earlier evaluations; a particle whose submission is found
+     * there is neither written nor dispatched. Defaults to one file per
+     * evaluation context under PSO_EVAL_CACHE_DIR (default
+     * {MSU_CBPO_PATH}/eval_cache); nullptr or an empty directory disables it.
+     */
+    void set_evaluation_cache(std::shared_ptr<EvaluationCache> cache) {
+        cache_ = std::move(cache);
+    }
+    const std::shared_ptr<EvaluationCache>& get_evaluation_cache() const {
+        return cache_;
+    }
+
+    /**
+     * Every evaluated solution of the run is appended there, and the
+     * end-of-run steps (Ipopt fronts, file moves, clean-up) query it instead
+     * of scanning the output directory. Defaults to
+     * ResultsStore::run_filename(exec_uuid); nullptr disables it.
+     */
+    void set_results_store(std::shared_ptr<ResultsStore> results) {
+        results_ = std::move(results);
+    }
+    const std::shared_ptr<ResultsStore>& get_results_store() const {
+        return results_;
+    }
+
+    /**
+     * Swarm state is written to filename after every `every` generations (in
+     * async mode, every `every` * nparts evaluations); 0 disables it. Default
+     * to {exec_uuid dir}/pso_checkpoint.bin and PSO_CHECKPOINT_EVERY (1).
+     */
+    void set_checkpoint(const std::string& filename, size_t every) {
+        checkpoint_file_ = filename;
+        checkpoint_every_ = every;
+    }
+    const std::string& get_checkpoint_file() const {
+        return checkpoint_file_;
+    }
+    /**
+     * Loads the checkpoint file, so that optimize() continues from it instead
+     * of starting over. Exits if the checkpoint belongs to another scenario,
+     * swarm size or set of BMP categories; returns false if there is no
+     * usable checkpoint.
+     */
+    bool resume();
+    bool save_checkpoint() const;
     
 
 private:
@@ -77,6 +179,7 @@ private:
 
     Scenario scenario_;
     std::vector<Particle> particles;
+    Swarm swarm_; ///< positions, velocities and pbest positions; particles[i] holds a copy of its row
     std::vector<Particle> gbest_;
     std::vector<std::vector<double>> gbest_x;
     std::vector<std::vector<double>> gbest_fx;
@@ -93,8 +196,43 @@ private:
     int animal_size_;
     int manure_size_;
     
+    void create_particles();
+    void optimize_async();
+    void move_particle(int i);
+    void move_particles();
+    int choose_leader(int i) const;
     void evaluate();
+    std::vector<int> write_particles(const std::vector<int>& indices, const std::string& exec_path, std::vector<double>& total_cost_vec);
+    double normalize_particle(int i);
+    bool write_particle_files(int i, const std::string& exec_path, double& total_cost);
+    bool clone_solution_files(const std::string& directory, const std::string& uuid,
+                              const std::string& exec_path, const std::string& new_uuid) const;
+    void record_result(int i, double total_cost, double load);
+    void store_result(int i);
+    std::vector<std::string> solution_files(const std::string& directory, const std::string& uuid) const;
+    void print_cache_stats() const;
+    void flush_artifacts();
+    void open_cache();
+    uint64_t evaluation_context() const;
     void update_pbest();
+    int nthreads_;
+    std::shared_ptr<Evaluator> evaluator_;
+    size_t archive_capacity_;
+    bool is_async_;
+    size_t max_in_flight_;
+    size_t max_evaluations_;
+    std::shared_ptr<EvaluationCache> cache_;
+    uint64_t cache_context_;
+    std::shared_ptr<ResultsStore> results_;
+    std::shared_ptr<ArtifactWriter> artifacts_; ///< JSON mirrors and _new_bmps copies, written off the optimization thread
+    std::vector<uint64_t> solution_keys_; ///< cache key of each particle's current submission
+    std::string checkpoint_file_;
+    size_t checkpoint_every_;
+    size_t iteration_;           ///< generations completed; evaluations completed in async mode
+    bool resumed_;
+    std::vector<char> has_pbest_;
+    std::vector<char> pending_;  ///< async: dispatched from its current position, no result yet
+    bool load_checkpoint(const std::string& filename);
     bool is_ef_enabled_;
     bool is_lc_enabled_;
     bool is_animal_enabled_;
@@ -109,12 +247,15 @@ private:
     double find_gx(const double& cost);
     Execute execute;
     std::vector<std::vector<std::string>> exec_uuid_log_;
-    std::vector<BmpRowLand> base_land_bmp_inputs_;
-    std::vector<BmpRowAnimal> base_animal_bmp_inputs_;
-    std::vector<BmpRowManure> base_manure_bmp_inputs_;
+    BmpTableLand base_land_bmp_inputs_;
+    BmpTableAnimal base_animal_bmp_inputs_;
+    BmpTableManure base_manure_bmp_inputs_;
     // Ipopt functions used 
     void exec_ipopt();
     void exec_ipopt_all_sols();
+    size_t relocate_ipopt_sols(const std::string& source_path, const std::string& ipopt_path, int delta_counter);
+    void materialize_submissions(const std::string& path, const std::string& uuid);
+    void materialize_for_cast(const std::string& path, const std::vector<EvaluationRequest>& requests);
     void delete_tmp_files();
     std::vector<Particle> get_min_mid_max_ipopt_position();
 
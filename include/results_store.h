@@ -0,0 +1,144 @@
+// Created by: Gregorio Toscano
+
+#ifndef RESULTS_STORE_H
+#define RESULTS_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pareto_front.h"
+
+enum class ResultOrigin : uint8_t {
+    pso = 1,   ///< a particle evaluated by the swarm
+    ipopt = 2, ///< a solution of the eps-constraint runs
+    front = 3, ///< a solution moved to the final front
+};
+
+const char* to_string(ResultOrigin origin);
+
+/**
+ * One evaluated solution. Its files are named {prefix}{suffix} in directory,
+ * one per entry of files.
+ */
+struct ResultRecord {
+    std::string uuid;
+    ResultOrigin origin = ResultOrigin::pso;
+    std::vector<double> objectives; ///< total cost, then the load
+    double constraint = 0.0;
+    std::vector<std::pair<std::string, double>> values; ///< cost breakdown, loads
+    std::string directory;
+    std::string prefix;
+    std::vector<std::string> files;
+};
+
+/**
+ * @class ResultsStore
+ * @brief Append-only log of the solutions of one run, indexed by uuid.
+ *
+ * Every append is one framed record (size, hash, payload) written with a
+ * single write() to a file opened in append mode, so the PSO and the
+ * eps_cnstr process can take turns appending to the same log. A later
+ * record for a uuid replaces the earlier one in the index, which is how a
+ * solution is relocated. Opening the log replays the records and cuts off a
+ * torn or corrupt tail, so a killed run leaves a log that resumes cleanly;
+ * refresh() and append() only index the intact records and leave a partial
+ * tail alone, since it may be a record another process is still writing.
+ */
+class ResultsStore {
+public:
+    struct Entry {
+        ResultOrigin origin;
+        std::vector<double> objectives;
+        double constraint;
+        uint64_t offset; ///< of the record in the log
+        uint32_t size;
+        std::string directory;
+        std::string prefix;
+    };
+
+    /**
+     * @param filename log file, created if missing
+     */
+    explicit ResultsStore(std::string filename);
+    ~ResultsStore();
+    ResultsStore(const ResultsStore&) = delete;
+    ResultsStore& operator=(const ResultsStore&) = delete;
+
+    /**
+     * The log of a PSO run: results.log in its output directory.
+     */
+    static std::string run_filename(const std::string& exec_uuid);
+
+    bool append(const ResultRecord& record);
+    /**
+     * Appends the record of uuid again with its files in directory/prefix.
+     */
+    bool relocate(const std::string& uuid, const std::string& directory, const std::string& prefix,
+                  std::vector<std::string> files, ResultOrigin origin);
+    /**
+     * Indexes the records appended by other processes since the last call,
+     * up to the first one that is not complete yet.
+     */
+    void refresh();
+    /**
+     * Flushes the log to disk.
+     */
+    bool sync();
+
+    const Entry* find(const std::string& uuid) const;
+    std::optional<ResultRecord> read(const std::string& uuid) const;
+    /**
+     * uuids in the order they were first appended, optionally of one origin.
+     */
+    std::vector<std::string> uuids(std::optional<ResultOrigin> origin = std::nullopt) const;
+    /**
+     * The objectives of the solutions of one origin, file_index being the uuid.
+     */
+    std::vector<CostData> cost_data(ResultOrigin origin) const;
+
+    size_t size() const {
+        return index_.size();
+    }
+    size_t records() const {
+        return records_;
+    }
+    bool is_open() const {
+        return fd_ >= 0;
+    }
+    const std::string& filename() const {
+        return filename_;
+    }
+
+    static std::string encode(const ResultRecord& record);
+    /**
+     * Calls visit with the offset and the record of every intact record of the
+     * log at filename, in order; returns the offset where they end.
+     */
+    static uint64_t scan(const std::string& filename, const std::function<void(uint64_t, ResultRecord&&)>& visit);
+
+private:
+    void index(uint64_t offset, uint32_t size, ResultRecord&& record);
+    void replay();
+
+    std::string filename_;
+    int fd_ = -1;
+    uint64_t end_ = 0;
+    size_t records_ = 0;
+    std::unordered_map<std::string, Entry> index_;
+    std::vector<std::string> order_;
+};
+
+/**
+ * Moves (or copies) the files of a record to directory/prefix; returns the
+ * suffixes that were there to transfer.
+ */
+std::vector<std::string> transfer_solution_files(const ResultRecord& record, const std::string& directory,
+                                                 const std::string& prefix, bool copy);
+
+#endif
@@ -0,0 +1,194 @@
+// Created by: Gregorio Toscano
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/**
+ * Counter-based random numbers (Philox4x32-10, Salmon et al., SC'11).
+ *
+ * A draw is a pure function of (run seed, domain, two stream indices,
+ * position): nothing is shared between threads, so there is no lock and no
+ * race, and a run gives the same numbers for a given seed whatever the
+ * thread count or the order the streams are consumed in. The optimizer keys
+ * streams by (iteration, particle) and uses the dimension as the position.
+ */
+namespace rng {
+
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    /**
+     * Separates the uses of one run seed; every domain is an independent
+     * family of streams.
+     */
+    enum class Domain : uint32_t {
+        shared = 1,   ///< misc_utilities::rand_double
+        particle,     ///< Particle::init/update, one stream per Particle
+        swarm_init,   ///< Swarm::init
+        velocity,     ///< Swarm::update coefficients
+        leader,       ///< gbest member each particle moves towards
+    };
+
+    inline uint64_t splitmix64(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    inline Counter philox4x32(Counter ctr, Key key) {
+        constexpr uint32_t M0 = 0xD2511F53;
+        constexpr uint32_t M1 = 0xCD9E8D57;
+        constexpr uint32_t W0 = 0x9E3779B9;
+        constexpr uint32_t W1 = 0xBB67AE85;
+        for (int round = 0; round < 10; ++round) {
+            if (round > 0) {
+                key[0] += W0;
+                key[1] += W1;
+            }
+            uint64_t p0 = static_cast<uint64_t>(M0) * ctr[0];
+            uint64_t p1 = static_cast<uint64_t>(M1) * ctr[2];
+            ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<uint32_t>(p1),
+                   static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<uint32_t>(p0)};
+        }
+        return ctr;
+    }
+
+    /**
+     * 53 bits of (hi, lo) mapped to [0, 1).
+     */
+    inline double to_unit(uint32_t hi, uint32_t lo) {
+        return static_cast<double>(((static_cast<uint64_t>(hi) << 32) | lo) >> 11) * 0x1.0p-53;
+    }
+
+    namespace detail {
+        inline std::atomic<uint64_t>& seed_storage() {
+            static std::atomic<uint64_t> seed{0};
+            return seed;
+        }
+    }
+
+    /**
+     * Seeds every stream created afterwards.
+     */
+    inline void set_run_seed(uint64_t seed) {
+        detail::seed_storage().store(seed);
+    }
+
+    /**
+     * The run seed; drawn from std::random_device on first use when
+     * set_run_seed() was not called.
+     */
+    inline uint64_t run_seed() {
+        auto& storage = detail::seed_storage();
+        uint64_t seed = storage.load();
+        if (seed == 0) {
+            std::random_device rd;
+            uint64_t drawn = (static_cast<uint64_t>(rd()) << 32) | rd();
+            drawn += drawn == 0;
+            // another thread may have won the race; every caller sees the same seed
+            storage.compare_exchange_strong(seed, drawn);
+            seed = storage.load();
+        }
+        return seed;
+    }
+
+    /**
+     * @class Stream
+     * @brief The positions of one (seed, domain, a, b) stream; each position is a
+     * Philox block of two 64-bit outputs.
+     *
+     * Satisfies std::uniform_random_bit_generator, so it can also drive the
+     * standard distributions. Copying a stream copies its position.
+     */
+    class Stream {
+    public:
+        using result_type = uint64_t;
+
+        Stream() : Stream(run_seed(), Domain::shared, 0, 0) {}
+        Stream(uint64_t seed, Domain domain, uint32_t a, uint32_t b) {
+            uint64_t k = splitmix64(seed ^ (static_cast<uint64_t>(domain) << 56));
+            key_ = {static_cast<uint32_t>(k), static_cast<uint32_t>(k >> 32)};
+            a_ = a;
+            b_ = b;
+        }
+
+        static constexpr result_type min() {
+            return 0;
+        }
+        static constexpr result_type max() {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        /**
+         * The two outputs at a position, without moving the stream.
+         */
+        std::array<uint64_t, 2> block(uint64_t position) const {
+            auto r = philox4x32({static_cast<uint32_t>(position), static_cast<uint32_t>(position >> 32), a_, b_}, key_);
+            return {(static_cast<uint64_t>(r[0]) << 32) | r[1], (static_cast<uint64_t>(r[2]) << 32) | r[3]};
+        }
+        /**
+         * The two [0, 1) numbers at a position, without moving the stream.
+         */
+        std::array<double, 2> uniform2(uint64_t position) const {
+            auto r = philox4x32({static_cast<uint32_t>(position), static_cast<uint32_t>(position >> 32), a_, b_}, key_);
+            return {to_unit(r[0], r[1]), to_unit(r[2], r[3])};
+        }
+
+        result_type operator()() {
+            if (has_spare_) {
+                has_spare_ = false;
+                return spare_;
+            }
+            auto outputs = block(position_++);
+            spare_ = outputs[1];
+            has_spare_ = true;
+            return outputs[0];
+        }
+        double uniform() {
+            return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+        }
+        double uniform(double lower_bound, double upper_bound) {
+            return lower_bound + uniform() * (upper_bound - lower_bound);
+        }
+        /**
+         * Uniform integer in [0, n), n > 0.
+         */
+        uint64_t below(uint64_t n) {
+            return static_cast<uint64_t>((static_cast<unsigned __int128>((*this)()) * n) >> 64);
+        }
+
+        /**
+         * Fills out[0, n) with the [0, 1) numbers at positions [first, first + n / 2);
+         * does not move the stream.
+         */
+        void fill_uniform(double* out, size_t n, uint64_t first = 0) const {
+            size_t pairs = n / 2;
+            for (size_t k = 0; k < pairs; ++k) {
+                auto u = uniform2(first + k);
+                out[2 * k] = u[0];
+                out[2 * k + 1] = u[1];
+            }
+            if (n % 2 == 1) {
+                out[n - 1] = uniform2(first + pairs)[0];
+            }
+        }
+
+    private:
+        Key key_{};
+        uint32_t a_ = 0;
+        uint32_t b_ = 0;
+        uint64_t position_ = 0;
+        uint64_t spare_ = 0;
+        bool has_spare_ = false;
+    };
+}
+
+#endif
@@ -2,64 +2,45 @@
 
 #ifndef SCENARIO_H
 #define SCENARIO_H
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 #include <unordered_map>
 
-// Define a plain‐old‐data struct matching your schema
-struct BmpRowLand {
-  int32_t  BmpSubmittedId;
-  int32_t  AgencyId;
-  std::string StateUniqueIdentifier;
-  int32_t  StateId;
-  int32_t  BmpId;
-  int32_t  GeographyId;
-  int32_t  LoadSourceGroupId;
-  int32_t  UnitId;
-  double   Amount;
-  bool     IsValid;
-  std::string ErrorMessage;
-  int32_t  RowIndex;
-};
+#include "bmp_table.h"
+#include "scenario_model.h"
 
-struct BmpRowAnimal {
-  int32_t         BmpSubmittedId;
-  int32_t         BmpId;
-  int32_t         AgencyId;
-  std::string StateUniqueIdentifier;
-  int32_t         StateId;
-  int32_t         GeographyId;
-  int32_t         AnimalGroupId;
-  int32_t         LoadSourceGroupId;
-  int32_t         UnitId;
-  double          Amount;
-  double          NReductionFraction;
-  double          PReductionFraction;
-  bool            IsValid;
-  std::string     ErrorMessage;
-  int32_t         RowIndex;
-};
+class ArtifactWriter;
+class RabbitMQClient;
 
-struct BmpRowManure {
-    int32_t         BmpSubmittedId;
-    int32_t         BmpId;
-    int32_t         AgencyId;
-    std::string StateUniqueIdentifier;
-    int32_t         StateId;
-    bool            HasStateReference;
-    int32_t         CountyIdFrom;
-    int32_t         CountyIdTo;
-    std::string     FIPSFrom;
-    std::string     FIPSTo;
-    int32_t         AnimalGroupId;
-    int32_t         LoadSourceGroupId;
-    int32_t         UnitId;
-    double          Amount;
-    bool            IsValid;
-    std::string     ErrorMessage;
-    int32_t         RowIndex;
-};
+namespace arrow {
+    class Buffer;
+    class Table;
+}
 
+/**
+ * Layout of the per-particle BMP submission files.
+ *
+ * Full: every {uuid}_impbmpsubmitted*.parquet holds the base rows followed by
+ * the particle's rows (plus the _new_bmps copy of the latter).
+ * Delta: only the {uuid}_impbmpsubmitted*_new_bmps.parquet file is written. Its
+ * footer names the shared base file of the run (see write_*_base), and
+ * Scenario::materialize_submission merges both into the full layout. The CAST
+ * worker only reads full files, so with it the PSO splices them right before
+ * the solutions are sent; the in-process ModelEvaluator reads the delta.
+ */
+enum class SubmissionLayout { Full, Delta };
+
+/**
+ * The base rows of a run encoded once as a whole Parquet file (see
+ * Scenario::set_base_inputs). Its row groups are copied as they are in front
+ * of every full submission file.
+ */
+struct BaseRowGroups {
+    const arrow::Table* table = nullptr; ///< of the inputs they were encoded from
+    std::shared_ptr<arrow::Buffer> file;
+};
 
 class Scenario {
     public:
@@ -106,32 +87,124 @@ class Scenario {
         size_t get_scenario_id() {
             return scenario_id_;
         }
-        std::string get_scenario_string(){
+        std::string get_scenario_string() const {
             return scenario_data_str_;
         }
 
+        /**
+         * Lowers the string-keyed tables into the integer-indexed ScenarioModel.
+         * Called at the end of init(); afterwards normalize_* and compute_cost*
+         * run on the compiled arrays.
+         */
+        void compile();
+        const ScenarioModel& get_model() const {
+            return model_;
+        }
+
         double normalize_lc(const std::vector<double>& x, 
             std::vector<std::tuple<int, int, int, int, double>>& lc_x,
             std::unordered_map<std::string, double>& amount_minus,
-            std::unordered_map<std::string, double>& amount_plus);
+            std::unordered_map<std::string, double>& amount_plus) const;
+        // Allocation-free form: amount_minus is indexed like model.lc_keys, amount_plus like model.lc_to_keys.
+        double normalize_lc(const std::vector<double>& x, 
+            std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+            std::vector<double>& amount_minus,
+            std::vector<double>& amount_plus) const;
+
+        // normalize_*, write_* and compute_cost* only read the scenario tables,
+        // so a single Scenario can be shared by concurrent particle evaluations.
+        double normalize_animal(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& animal_x) const; 
+        double normalize_manure(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& manure_x) const; 
 
-        double normalize_animal(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& animal_x); 
-        double normalize_manure(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& manure_x); 
-        int write_land(const std::vector<std::tuple<int, int, int, int, double>>& lc_x,const std::string& out_filename,std::vector<BmpRowLand> base_land_bmp_input );
-        int write_animal(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, const std::string& out_filename, std::vector<BmpRowAnimal> base_animal_bmp_inputs);
-        int write_manure(const std::vector<std::tuple<int,int,int,int,int,double>>& manure_x,const std::string& out_filename,const std::vector<BmpRowManure>& base_manure_bmp_inputs);        std::vector<std::string> send_files(const std::string& emo_uuid, const std::vector<std::string>& exec_uuid_vec);
-        size_t write_land_json( const std::vector<std::tuple<int, int, int, int, double>>& lc_x, const std::string& out_filename);
-        size_t write_animal_json(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x , const std::string& out_filename);
-        size_t write_manure_json(const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x , const std::string& out_filename);
+        // Reference implementations working on the string-keyed tables.
+        double normalize_lc_keyed(const std::vector<double>& x, 
+            std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+            std::unordered_map<std::string, double>& amount_minus,
+            std::unordered_map<std::string, double>& amount_plus) const;
+        double normalize_animal_keyed(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& animal_x) const; 
+        double normalize_manure_keyed(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& manure_x) const; 
+        int write_land(const std::vector<std::tuple<int, int, int, int, double>>& lc_x,const std::string& out_filename,const BmpTableLand& base_land_bmp_input) const;
+        int write_animal(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, const std::string& out_filename, const BmpTableAnimal& base_animal_bmp_inputs) const;
+        int write_manure(const std::vector<std::tuple<int,int,int,int,int,double>>& manure_x,const std::string& out_filename,const BmpTableManure& base_manure_bmp_inputs) const;
+        std::vector<std::string> send_files(const std::string& emo_uuid, const std::vector<std::string>& exec_uuid_vec);
+        /**
+         * Asynchronous counterpart of send_files: dispatch_files signals the
+         * solutions and returns at once; receive_files blocks until at least one
+         * dispatched solution has completed and returns every "exec_uuid_result"
+         * available, or nothing when none is outstanding.
+         */
+        void dispatch_files(const std::string& emo_uuid, const std::vector<std::string>& exec_uuid_vec);
+        std::vector<std::string> receive_files(const std::string& emo_uuid);
+        int write_land_base(const std::string& out_filename, const BmpTableLand& base_land_bmp_inputs);
+        int write_animal_base(const std::string& out_filename, const BmpTableAnimal& base_animal_bmp_inputs);
+        int write_manure_base(const std::string& out_filename, const BmpTableManure& base_manure_bmp_inputs);
+        /**
+         * Encodes the base rows once. write_* and write_*_base reuse them when
+         * handed these tables, or copies of them, and encode any other table
+         * themselves.
+         */
+        void set_base_inputs(const BmpTableLand& land, const BmpTableAnimal& animal, const BmpTableManure& manure);
+        /**
+         * In the full layout the _new_bmps files are only copies; with a
+         * writer, write_* queue them on it instead of writing them in place.
+         */
+        void set_artifact_writer(std::shared_ptr<ArtifactWriter> writer) {
+            artifacts_ = std::move(writer);
+        }
+        void set_submission_layout(SubmissionLayout layout) {
+            submission_layout_ = layout;
+        }
+        SubmissionLayout get_submission_layout() const {
+            return submission_layout_;
+        }
+        // File actually produced by write_* for out_filename under the current layout.
+        std::string submission_filename(const std::string& out_filename) const;
+        static std::string delta_filename(const std::string& out_filename);
+        /**
+         * Writes the full out_filename of a delta layout submission: the base
+         * row groups encoded by set_base_inputs, copied as they are, followed
+         * by the rows of its _new_bmps file. The category is taken from the
+         * file name. A delta whose base is not this run's is merged with
+         * misc_utilities::materialize_submission.
+         *
+         * @return false if the _new_bmps file is missing or cannot be merged.
+         */
+        bool materialize_submission(const std::string& out_filename) const;
+        size_t write_land_json( const std::vector<std::tuple<int, int, int, int, double>>& lc_x, const std::string& out_filename) const;
+        size_t write_animal_json(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x , const std::string& out_filename) const;
+        size_t write_manure_json(const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x , const std::string& out_filename) const;
 
         double get_alpha(std::string key) {return amount_[key];}
         const std::unordered_map<std::string, double> get_alpha() const {return amount_;}
+        const std::unordered_map<std::string, std::vector<double>>& get_phi() const {return phi_dict_;}
+        const std::unordered_map<std::string, std::vector<double>>& get_eta() const {return eta_dict_;}
+        int get_load_to_opt() const {return load_to_opt_;}
 
-        double compute_cost(const std::vector<std::tuple<int, int, int, int, double>>& parcel);
+        double compute_cost(const std::vector<std::tuple<int, int, int, int, double>>& parcel) const;
 
-        double compute_cost_animal(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel);
-        double compute_cost_manure(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel);
+        double compute_cost_animal(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel) const;
+        double compute_cost_manure(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel) const;
         std::unordered_map<std::string, double> read_manure_nutrients(const std::string& filename);
+        double bmp_unit_cost(int state, int bmp) const;
+
+        /**
+         * Binary snapshot of the tables filled by load(), load_neighbors() and
+         * read_manure_nutrients() (layout in scenario_snapshot.cpp).
+         *
+         * init() looks for {SCENARIO_SNAPSHOT_DIR}/scenario_{key}.snapshot, where the
+         * key hashes the content of the input files, and only parses the inputs
+         * when it is missing or does not validate; the snapshot is then written
+         * for the next run. An empty SCENARIO_SNAPSHOT_DIR disables it.
+         */
+        static uint64_t snapshot_key(const std::vector<std::string>& input_files, bool is_manure_enabled);
+        bool save_snapshot(const std::string& filename, uint64_t key) const;
+        // Returns false, leaving the scenario untouched, if the file is missing, stale or corrupt.
+        bool load_snapshot(const std::string& filename, uint64_t key);
+        bool is_loaded_from_snapshot() const {
+            return loaded_from_snapshot_;
+        }
+        // True if both scenarios hold the same loaded tables (order-independent).
+        bool same_loaded_state(const Scenario& other) const;
 
     private:
         size_t scenario_id_;
@@ -187,7 +260,7 @@ class Scenario {
         void compute_lc(); 
         void load_alpha(std::vector<double>& my_alpha); 
         */
-        void sum_alpha(std::unordered_map<std::string, double>& am,  const std::string& key, double acreage);
+        void sum_alpha(std::unordered_map<std::string, double>& am,  const std::string& key, double acreage) const;
         std::vector<std::string> valid_lc_bmps_;
         //double inject_lc_x();
         //
@@ -212,6 +285,25 @@ class Scenario {
         std::unordered_map<std::string, std::vector<int>> manure_all_; 
         std::unordered_map<std::string, double> manure_dry_lbs_;
 
+        std::string snapshot_dir_;
+        bool loaded_from_snapshot_;
+        void load_inputs(const std::string& filename, const std::string& filename_scenario, const std::string& manure_nutrients_file);
+
+        ScenarioModel model_;
+        SubmissionLayout submission_layout_;
+        std::string base_land_file_;
+        std::string base_animal_file_;
+        std::string base_manure_file_;
+        BaseRowGroups base_land_row_groups_;
+        BaseRowGroups base_animal_row_groups_;
+        BaseRowGroups base_manure_row_groups_;
+        std::shared_ptr<ArtifactWriter> artifacts_;
+
+        // reused by send_files across generations of the same emo_uuid
+        RabbitMQClient& rabbit(const std::string& emo_uuid);
+        std::shared_ptr<RabbitMQClient> rabbit_;
+        std::string rabbit_emo_uuid_;
+
 };
 #endif
 
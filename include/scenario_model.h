@@ -0,0 +1,68 @@
+// Created by: Gregorio Toscano
+
+#ifndef SCENARIO_MODEL_H
+#define SCENARIO_MODEL_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @struct ScenarioModel
+ * @brief Integer-indexed form of a loaded Scenario, built by Scenario::compile().
+ *
+ * Parcels are numbered in the order of the Scenario's sorted key vectors, which
+ * is also the layout of the decision vector. The BMP group of parcel p lives in
+ * [offsets[p], offsets[p+1]) of the per-group arrays (CSR form), so the
+ * normalize and cost loops only touch contiguous arrays.
+ */
+struct ScenarioModel {
+    bool is_compiled = false;
+
+    // Land conversion: one parcel per "lrseg_agency_loadsrc" key.
+    std::vector<int> lc_lrseg;
+    std::vector<int> lc_agency;
+    std::vector<int> lc_load_src;
+    std::vector<double> lc_amount;
+    std::vector<size_t> lc_offsets;
+    std::vector<int> lc_bmp;
+    std::vector<double> lc_unit_cost;
+    std::vector<size_t> lc_to;                ///< slot in lc_to_keys receiving the converted acres
+    std::vector<std::string> lc_keys;         ///< names of the amount_minus slots (one per parcel)
+    std::vector<std::string> lc_to_keys;      ///< names of the amount_plus slots
+
+    // Animal: one parcel per "base_condition_county_loadsrc_animal" key.
+    std::vector<int> animal_base_condition;
+    std::vector<int> animal_county;
+    std::vector<int> animal_load_src;
+    std::vector<int> animal_id;
+    std::vector<double> animal_units;
+    std::vector<size_t> animal_offsets;
+    std::vector<int> animal_bmp;
+    std::vector<double> animal_unit_cost;
+
+    // Manure transport: one parcel per "county_loadsrc_animal" key, grouped by destination county.
+    std::vector<int> manure_county;
+    std::vector<int> manure_load_src;
+    std::vector<int> manure_animal_id;
+    std::vector<double> manure_dry_lbs;
+    std::vector<double> manure_unit_cost;
+    std::vector<size_t> manure_offsets;
+    std::vector<int> manure_county_to;
+
+    // BMP cost per unit by (state, bmp); 0.0 when the pair has no cost, as with the string keys.
+    std::vector<double> bmp_cost;
+    int max_state = -1;
+    int max_bmp = -1;
+
+    bool operator==(const ScenarioModel&) const = default;
+
+    double unit_cost(int state, int bmp) const {
+        if (state < 0 || bmp < 0 || state > max_state || bmp > max_bmp) {
+            return 0.0;
+        }
+        return bmp_cost[static_cast<size_t>(state) * (max_bmp + 1) + bmp];
+    }
+};
+
+#endif // SCENARIO_MODEL_H
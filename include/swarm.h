@@ -0,0 +1,132 @@
+// Created by: Gregorio Toscano
+
+#ifndef SWARM_H
+#define SWARM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * @class Swarm
+ * @brief Positions, velocities and personal bests of a whole swarm, stored as
+ * contiguous nparts x dim row-major matrices.
+ *
+ * Rows are padded to a multiple of a cache line and the storage is
+ * cache-line aligned, so rows updated by different threads never share a
+ * line. The random coefficients of a step are counter-based (rng.h), keyed
+ * by the particle, its step count and the dimension: a swarm step gives the
+ * same result whichever thread updates which row.
+ */
+class Swarm {
+public:
+    Swarm() = default;
+
+    /**
+     * @param seed seeds the random coefficients; 0 takes rng::run_seed()
+     */
+    Swarm(int nparts, int dim, double w, double c1, double c2, double lb, double ub, uint64_t seed = 0);
+
+    int size() const {
+        return nparts_;
+    }
+    int dim() const {
+        return dim_;
+    }
+
+    /**
+     * Random positions within the bounds and zero velocities.
+     */
+    void init();
+    /**
+     * Sets the position of particle i and zeroes its velocity.
+     */
+    void init(int i, std::span<const double> x);
+
+    std::span<const double> x(int i) const {
+        return {x_.data() + row(i), static_cast<size_t>(dim_)};
+    }
+    std::span<const double> v(int i) const {
+        return {v_.data() + row(i), static_cast<size_t>(dim_)};
+    }
+    std::span<const double> pbest_x(int i) const {
+        return {pbest_x_.data() + row(i), static_cast<size_t>(dim_)};
+    }
+    /**
+     * Number of update() steps particle i has taken.
+     */
+    uint64_t steps(int i) const {
+        return steps_[i];
+    }
+    uint64_t seed() const {
+        return seed_;
+    }
+    /**
+     * Puts particle i back in a saved state, e.g. from a checkpoint; its next
+     * update() draws what it would have drawn after `steps` steps.
+     */
+    void restore(int i, std::span<const double> x, std::span<const double> v, std::span<const double> pbest_x, uint64_t steps);
+
+    /**
+     * Makes the current position of particle i its personal best.
+     */
+    void store_pbest(int i);
+
+    /**
+     * One velocity and position step of particle i towards its personal best
+     * and guide (a gbest member), clamped to the bounds.
+     */
+    void update(int i, std::span<const double> guide);
+    /**
+     * Steps every particle, particle i towards guides[i], across the pool's
+     * workers; serially without a pool.
+     */
+    void update(const std::vector<std::span<const double>>& guides, ThreadPool* pool = nullptr);
+
+private:
+    static constexpr size_t ALIGNMENT = 64;
+
+    template <typename T>
+    struct AlignedAllocator {
+        using value_type = T;
+        AlignedAllocator() = default;
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U>&) {}
+        T* allocate(size_t n) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGNMENT)));
+        }
+        void deallocate(T* p, size_t) {
+            ::operator delete(p, std::align_val_t(ALIGNMENT));
+        }
+        template <typename U>
+        bool operator==(const AlignedAllocator<U>&) const {
+            return true;
+        }
+    };
+    using Matrix = std::vector<double, AlignedAllocator<double>>;
+
+    size_t row(int i) const {
+        return static_cast<size_t>(i) * stride_;
+    }
+
+    int nparts_ = 0;
+    int dim_ = 0;
+    size_t stride_ = 0;
+    double w_ = 0.0;
+    double c1_ = 0.0;
+    double c2_ = 0.0;
+    double lower_bound_ = 0.0;
+    double upper_bound_ = 1.0;
+    Matrix x_;
+    Matrix v_;
+    Matrix pbest_x_;
+    Matrix coefficients_; ///< per particle, a row of r1 followed by a row of r2
+    uint64_t seed_ = 0;
+    std::vector<uint64_t> steps_;
+};
+
+#endif
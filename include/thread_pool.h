@@ -0,0 +1,124 @@
+// Created by: Gregorio Toscano
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed-size pool of worker threads consuming a FIFO task queue.
+ *
+ * Tasks are submitted with submit(), which returns a std::future holding
+ * the task result (or the exception it threw). parallel_for() runs an
+ * index range across the workers and blocks until every index is done.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param nthreads number of workers; 0 means std::thread::hardware_concurrency()
+     */
+    explicit ThreadPool(size_t nthreads = 0) {
+        if (nthreads == 0) {
+            nthreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+        workers_.reserve(nthreads);
+        for (size_t i = 0; i < nthreads; ++i) {
+            workers_.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers_.size();
+    }
+
+    template <typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        auto result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            tasks_.emplace([task] { (*task)(); });
+        }
+        cv_.notify_one();
+        return result;
+    }
+
+    /**
+     * Calls fn(i) for every i in [0, n) on the pool and waits for all of them.
+     * The first exception thrown by a task is rethrown after every task finished.
+     */
+    template <typename F>
+    void parallel_for(size_t n, F&& fn) {
+        std::vector<std::future<void>> pending;
+        pending.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            pending.push_back(submit([&fn, i] { fn(i); }));
+        }
+        std::exception_ptr error;
+        for (auto& p : pending) {
+            try {
+                p.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void worker_loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+#endif // THREAD_POOL_H
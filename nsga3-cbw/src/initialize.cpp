@@ -153,11 +153,7 @@ void read_json_file(std::vector<std::vector<double> > &init_pop, std::string jso
 
 }
 int get_random_number(int n) {
-    std::random_device rd;                          // Obtain a random seed from the hardware
-    std::mt19937 gen(rd());                         // Seed the random number generator
-    std::uniform_int_distribution<int> dist(0, n);   // Define the range of the distribution
-
-    return dist(gen);                               // Generate a random number within the defined range
+    return rnd(0, n);                               // from the run seed, so injected runs are reproducible
 }
 
 void initialize_pop(population *pop)
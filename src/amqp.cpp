@@ -6,9 +6,8 @@
 #include <iostream>
 #include <string>
 
-#include <thread>
+#include <algorithm>
 #include <chrono>
-#include <mutex>
 #include <fmt/core.h>
 #include <sw/redis++/redis++.h>
 
@@ -19,22 +18,57 @@ namespace {
     std::string AMQP_PASSWORD= misc_utilities::get_env_var("AMQP_PASSWORD", "guest");
     std::string AMQP_PORT = misc_utilities::get_env_var("AMQP_PORT", "5672");
     std::string OPT4CAST_WAIT_MILLISECS_IN_CAST = misc_utilities::get_env_var("OPT4CAST_WAIT_MILLISECS_IN_CAST", "3600000");
+    std::string OPT4CAST_EVAL_RETRIES = misc_utilities::get_env_var("OPT4CAST_EVAL_RETRIES", "2");
     std::string REDIS_HOST = misc_utilities::get_env_var("REDIS_HOST", "127.0.0.1");
     std::string REDIS_PORT = misc_utilities::get_env_var("REDIS_PORT", "6379");
     std::string REDIS_DB_OPT = misc_utilities::get_env_var("REDIS_DB_OPT", "1");
     std::string REDIS_URL = fmt::format("tcp://{}:{}/{}", REDIS_HOST, REDIS_PORT, REDIS_DB_OPT);
 
+    WaitOptions wait_options() {
+        WaitOptions options;
+        options.deadline = std::chrono::milliseconds(std::stol(OPT4CAST_WAIT_MILLISECS_IN_CAST));
+        options.max_retries = std::stoi(OPT4CAST_EVAL_RETRIES);
+        return options;
+    }
 }
 
-// Mutex and condition variable for synchronizing threads
-std::mutex mtx;
-std::condition_variable cv;
+struct RabbitMQClient::Transport {
+    RabbitMQClient& client;
+
+    std::optional<std::string> receive(std::chrono::milliseconds timeout) {
+        AmqpClient::Envelope::ptr_t envelope;
+        if (!client.consumer_channel_->BasicConsumeMessage(client.consumer_tag_, envelope, static_cast<int>(timeout.count()))
+                || envelope->RoutingKey() != client.emo_uuid_) {
+            return std::nullopt;
+        }
+        return envelope->Message()->Body();
+    }
 
-RabbitMQClient::RabbitMQClient(std::string emo_data, std::string emo_uuid) : redis_(REDIS_URL) {
+    bool resend(const std::string& exec_uuid) {
+        std::cerr << "No result for " << exec_uuid << " before its deadline, dispatching it again" << std::endl;
+        client.sent_list_.erase(exec_uuid);
+        client.send_signal(exec_uuid);
+        return client.sent_list_.contains(exec_uuid);
+    }
+
+    std::optional<std::string> collect(const std::string& exec_uuid) {
+        return client.fetch_result(exec_uuid);
+    }
+
+    void drop(const std::string& exec_uuid) {
+        client.sent_list_.erase(exec_uuid);
+        client.pipeline()
+            .hdel("executed_results", exec_uuid)
+            .hdel("emo_data", exec_uuid)
+            .exec();
+    }
+};
+
+RabbitMQClient::RabbitMQClient(std::string emo_data, std::string emo_uuid) : redis_(REDIS_URL), pending_(wait_options()) {
     init(emo_data, emo_uuid);
 }
 
-RabbitMQClient::RabbitMQClient(): redis_(REDIS_URL) {
+RabbitMQClient::RabbitMQClient(): redis_(REDIS_URL), pending_(wait_options()) {
     is_initialized = false;
 
 }
@@ -65,37 +99,137 @@ void RabbitMQClient::get_opts() {
     opts_.auth = AmqpClient::Channel::OpenOpts::BasicAuth(AMQP_USERNAME, AMQP_PASSWORD);
 }
 
-bool RabbitMQClient::send_message(std::string routing_name, std::string msg) {
-    try {
-        auto channel = AmqpClient::Channel::Open(opts_);
-        channel->DeclareExchange(EXCHANGE_NAME, AmqpClient::Channel::EXCHANGE_TYPE_DIRECT, false, true, false);
-        auto message = AmqpClient::BasicMessage::Create(msg);
-        channel->BasicPublish(EXCHANGE_NAME, routing_name, message, false, false);
-        //channel->reset()
+AmqpClient::Channel::ptr_t RabbitMQClient::channel() {
+    if (!channel_) {
+        channel_ = AmqpClient::Channel::Open(opts_);
+        channel_->DeclareExchange(EXCHANGE_NAME, AmqpClient::Channel::EXCHANGE_TYPE_DIRECT, false, true, false);
     }
-    catch (const std::exception &error) {
-        std::clog << "error\n" << error.what() << "\n";
-        std::cerr << "error\n" << error.what() << "\n";
+    return channel_;
+}
+
+sw::redis::Pipeline& RabbitMQClient::pipeline() {
+    if (!pipeline_) {
+        pipeline_.emplace(redis_.pipeline());
+    }
+    return *pipeline_;
+}
+
+bool RabbitMQClient::send_message(std::string routing_name, std::string msg) {
+    // a broken channel is dropped and reopened once before giving up
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        try {
+            auto message = AmqpClient::BasicMessage::Create(msg);
+            channel()->BasicPublish(EXCHANGE_NAME, routing_name, message, false, false);
+            return true;
+        }
+        catch (const std::exception &error) {
+            std::clog << "error\n" << error.what() << "\n";
+            std::cerr << "error\n" << error.what() << "\n";
+            channel_.reset();
+        }
     }
-    return true;
+    return false;
 }
 
 void RabbitMQClient::send_signal(std::string exec_uuid) {
+    subscribe();
     redis_.hset("emo_data", exec_uuid, emo_data_);
-    auto scenario_id = *redis_.lpop("scenario_ids");
+    auto reserved = redis_.lpop("scenario_ids");
+    if (!reserved) {
+        std::cerr << "No scenario id available for " << exec_uuid << std::endl;
+        redis_.hdel("emo_data", exec_uuid);
+        return;
+    }
+    auto scenario_id = *reserved;
     //std::cout<<"Current Scenario ID: "<<scenario_id<<std::endl;
     redis_.hset("solution_to_execute_dict", exec_uuid, fmt::format("{}_{}", emo_uuid_, scenario_id));
     try {
         auto msg = exec_uuid;
         auto routing_name = "opt4cast_execution";
-        send_message(routing_name, msg);
-        sent_list_[exec_uuid] = scenario_id;
+        if (send_message(routing_name, msg)) {
+            sent_list_[exec_uuid] = scenario_id;
+            pending_.dispatched(exec_uuid);
+        }
     }
     catch (const std::exception &error) {
         std::cerr << "Error in evaluate parallel " << error.what() << std::endl;
     }
 }
 
+void RabbitMQClient::send_signals(const std::vector<std::string>& exec_uuids) {
+    if (exec_uuids.empty()) {
+        return;
+    }
+    try {
+        subscribe();
+        auto& pipe = pipeline();
+
+        // round trip 1: register every solution and reserve one scenario id each
+        std::vector<std::pair<std::string, std::string>> emo_data_fields;
+        emo_data_fields.reserve(exec_uuids.size());
+        for (const auto& exec_uuid : exec_uuids) {
+            emo_data_fields.emplace_back(exec_uuid, emo_data_);
+        }
+        pipe.hset("emo_data", emo_data_fields.begin(), emo_data_fields.end());
+        for (size_t i = 0; i < exec_uuids.size(); ++i) {
+            pipe.lpop("scenario_ids");
+        }
+        auto reserved = pipe.exec();
+
+        std::vector<std::pair<std::string, std::string>> to_execute;
+        std::vector<std::string> scenario_ids;
+        std::vector<std::string> unassigned;
+        for (size_t i = 0; i < exec_uuids.size(); ++i) {
+            auto scenario_id = reserved.get<sw::redis::OptionalString>(i + 1);
+            if (!scenario_id) {
+                std::cerr << "No scenario id available for " << exec_uuids[i] << std::endl;
+                unassigned.push_back(exec_uuids[i]);
+                continue;
+            }
+            to_execute.emplace_back(exec_uuids[i], fmt::format("{}_{}", emo_uuid_, *scenario_id));
+            scenario_ids.push_back(*scenario_id);
+        }
+
+        // round trip 2: map the solutions to their scenarios before any worker is signaled
+        if (!to_execute.empty()) {
+            pipe.hset("solution_to_execute_dict", to_execute.begin(), to_execute.end());
+        }
+        if (!unassigned.empty()) {
+            pipe.hdel("emo_data", unassigned.begin(), unassigned.end());
+        }
+        pipe.exec();
+
+        auto routing_name = "opt4cast_execution";
+        for (size_t i = 0; i < to_execute.size(); ++i) {
+            const auto& exec_uuid = to_execute[i].first;
+            if (send_message(routing_name, exec_uuid)) {
+                sent_list_[exec_uuid] = scenario_ids[i];
+                pending_.dispatched(exec_uuid);
+            }
+        }
+    }
+    catch (const std::exception &error) {
+        std::cerr << "Error in evaluate parallel " << error.what() << std::endl;
+        pipeline_.reset();
+    }
+}
+
+std::optional<std::string> RabbitMQClient::fetch_result(const std::string& exec_uuid) {
+    // fetch the result and clean up after it in a single round trip
+    auto replies = pipeline()
+        .hget("executed_results", exec_uuid)
+        .hdel("executed_results", exec_uuid)
+        .hdel("emo_data", exec_uuid)
+        .exec();
+    auto exec_results = replies.get<sw::redis::OptionalString>(0);
+    if (!exec_results) {
+        std::cerr << "No executed_results entry for " << exec_uuid << std::endl;
+        return std::nullopt;
+    }
+    sent_list_.erase(exec_uuid);
+    return *exec_results;
+}
+
 std::string RabbitMQClient::wait_for_data() {
     std::string exec_results_str;
     auto channel = AmqpClient::Channel::Open(opts_);
@@ -131,121 +265,65 @@ std::string RabbitMQClient::wait_for_data() {
     return exec_results_str;
 }
 
-std::vector<std::string> RabbitMQClient::wait_for_all_data() {
-
-    std::vector<std::string> exec_results_str_all;
-    auto channel = AmqpClient::Channel::Open(opts_);
-    auto passive = false; //meaning you want the server to create the exchange if it does not already exist.
-    auto durable = true; //meaning the exchange will survive a broker restart
-    auto auto_delete = false; //meaning the queue will not be deleted once the channel is closed
-    channel->DeclareExchange(EXCHANGE_NAME, AmqpClient::Channel::EXCHANGE_TYPE_DIRECT, passive, durable, auto_delete);
-    auto generate_queue_name ="";
-    auto exclusive = false; //meaning the queue can be accessed in other channels
-    auto queue_name = channel->DeclareQueue(generate_queue_name, passive, durable, exclusive, auto_delete);
-    channel->BindQueue(queue_name, EXCHANGE_NAME, emo_uuid_);
-    auto no_local = false; 
-    auto no_ack = true; //meaning the server will expect an acknowledgement of messages delivered to the consumer
-    auto message_prefetch_count = 1;
-    auto consumer_tag = channel->BasicConsume(queue_name, generate_queue_name, no_local, no_ack, exclusive, message_prefetch_count);
-
-
-    while(sent_list_.size() > 0) {
-
-        fmt::print("Remaining scenarios: {}\n", sent_list_.size());
-        fmt::print("[*] Waiting for execution service: {} \n", emo_uuid_);
-
-        auto envelope = channel->BasicConsumeMessage(consumer_tag);
-        auto message_payload = envelope->Message()->Body();
-        auto routing_key = envelope->RoutingKey();
-        std::string received_exec_uuid = message_payload;
-        fmt::print("Received: {}\n", received_exec_uuid);
-
-        if (routing_key == emo_uuid_) {
-            
-            std::string exec_results_str = *redis_.hget("executed_results", received_exec_uuid);
-            std::vector<std::string> to_return = {received_exec_uuid, exec_results_str};
-            exec_results_str_all.push_back(fmt::format("{}_{}", received_exec_uuid, exec_results_str));
-            auto scenario_id = sent_list_[received_exec_uuid];
-            sent_list_.erase(received_exec_uuid);
-            //redis_.lpush("scenario_ids", scenario_id);
-            redis_.hdel("executed_results", received_exec_uuid);
-            redis_.hdel("emo_data", received_exec_uuid);
-        }
+WaitOutcome RabbitMQClient::wait_with_deadlines() {
+    if (pending_.empty()) {
+        return {};
     }
-
-
-    return exec_results_str_all;
+    subscribe();
+    fmt::print("[*] Waiting for execution service: {} ({} solutions)\n", emo_uuid_, pending_.size());
+    Transport transport{*this};
+    auto outcome = pending_.wait(transport);
+
+    auto latency = outcome.latency_ms;
+    std::sort(latency.begin(), latency.end());
+    fmt::print("{} scored, {} unscored, {} re-dispatched, slowest {:.0f} ms\n", outcome.scored.size(),
+               outcome.unscored.size(), outcome.redispatched, latency.empty() ? 0.0 : latency.back());
+    for (const auto& exec_uuid : outcome.unscored) {
+        std::cerr << "Giving up on " << exec_uuid << " after " << pending_.options().max_retries << " retries" << std::endl;
+    }
+    return outcome;
 }
 
-
-
-int RabbitMQClient::transfers_remaining() {
-    return sent_list_.size();
+std::vector<std::string> RabbitMQClient::wait_for_all_data() {
+    return wait_with_deadlines().scored;
 }
 
-void consume_with_timeout(AmqpClient::Channel::ptr_t channel, const std::string& consumer_tag, int timeout_ms) {
-    std::string received_exec_uuid;
-    std::string routing_key;
-    AmqpClient::Envelope::ptr_t envelope;
-    {
-        std::unique_lock<std::mutex> lock(mtx);
-        // Wait for a message or timeout
-        if (cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&](){ return channel->BasicConsumeMessage(consumer_tag, envelope); })) {
-            auto message_payload = envelope->Message()->Body();
-            routing_key = envelope->RoutingKey();
-            received_exec_uuid = message_payload;
-            fmt::print("Received: {}\n", received_exec_uuid);
-
-        } else {
-            std::cout << "Timeout reached, no message received within " << timeout_ms << " milliseconds." << std::endl;
-        }
+void RabbitMQClient::subscribe() {
+    if (consumer_channel_) {
+        return;
     }
+    consumer_channel_ = AmqpClient::Channel::Open(opts_);
+    consumer_channel_->DeclareExchange(EXCHANGE_NAME, AmqpClient::Channel::EXCHANGE_TYPE_DIRECT, false, true, false);
+    // the reply queue is private to this client and deleted with its channel
+    auto passive = false;
+    auto durable = false;
+    auto exclusive = true;
+    auto auto_delete = true;
+    auto queue_name = consumer_channel_->DeclareQueue("", passive, durable, exclusive, auto_delete);
+    consumer_channel_->BindQueue(queue_name, EXCHANGE_NAME, emo_uuid_);
+    auto no_local = false;
+    auto no_ack = true;
+    auto message_prefetch_count = 1;
+    consumer_tag_ = consumer_channel_->BasicConsume(queue_name, "", no_local, no_ack, exclusive, message_prefetch_count);
 }
 
-std::vector<std::string> RabbitMQClient::safe_wait_for_all_data() {
+std::vector<std::string> RabbitMQClient::wait_for_any_data() {
     std::vector<std::string> exec_results_str_all;
-    auto channel = AmqpClient::Channel::Open(opts_);
-    auto passive = false; //meaning you want the server to create the exchange if it does not already exist.
-    auto durable = true; //meaning the exchange will survive a broker restart
-    auto auto_delete = false; //meaning the queue will not be deleted once the channel is closed
-    channel->DeclareExchange(EXCHANGE_NAME, AmqpClient::Channel::EXCHANGE_TYPE_DIRECT, passive, durable, auto_delete);
-    auto generate_queue_name ="";
-    auto exclusive = false; //meaning the queue can be accessed in other channels
-    auto queue_name = channel->DeclareQueue(generate_queue_name, passive, durable, exclusive, auto_delete);
-    channel->BindQueue(queue_name, EXCHANGE_NAME, emo_uuid_);
-    auto no_local = false; 
-    auto no_ack = false; //meaning the server will expect an acknowledgement of messages delivered to the consumer
-    auto message_prefetch_count = 1;
-    auto consumer_tag = channel->BasicConsume(queue_name, generate_queue_name, no_local, no_ack, exclusive, message_prefetch_count);
-
-    while(sent_list_.size() > 0) {
-
-        fmt::print("Remaining scenarios: {}\n", sent_list_.size());
-        fmt::print("[*] Waiting for execution service: {} \n", emo_uuid_);
-
-        auto envelope = channel->BasicConsumeMessage(consumer_tag);
-        auto timeout_ms = 1000;
-        std::thread consumer_thread(consume_with_timeout, channel, queue_name, timeout_ms);
-        consumer_thread.join();
-
-        auto message_payload = envelope->Message()->Body();
-        auto routing_key = envelope->RoutingKey();
-        std::string received_exec_uuid = message_payload;
-        fmt::print("Received: {}\n", received_exec_uuid);
-
-        if (routing_key == emo_uuid_) {
-            
-            std::string exec_results_str = *redis_.hget("executed_results", received_exec_uuid);
-            std::vector<std::string> to_return = {received_exec_uuid, exec_results_str};
-            exec_results_str_all.push_back(fmt::format("{}_{}", received_exec_uuid, exec_results_str));
-            auto scenario_id = sent_list_[received_exec_uuid];
-            sent_list_.erase(received_exec_uuid);
-            //redis_.lpush("scenario_ids", scenario_id);
-            redis_.hdel("executed_results", received_exec_uuid);
-            redis_.hdel("emo_data", received_exec_uuid);
-        }
+    if (pending_.empty()) {
+        return exec_results_str_all;
+    }
+    subscribe();
+    fmt::print("[*] Waiting for execution service: {} ({} in flight)\n", emo_uuid_, pending_.size());
+    Transport transport{*this};
+    auto outcome = pending_.wait(transport, true);
+    exec_results_str_all = std::move(outcome.scored);
+    for (const auto& exec_uuid : outcome.unscored) {
+        std::cerr << "Giving up on " << exec_uuid << " after " << pending_.options().max_retries << " retries" << std::endl;
+        exec_results_str_all.push_back(exec_uuid + "_");
     }
-
-
     return exec_results_str_all;
 }
+
+int RabbitMQClient::transfers_remaining() {
+    return sent_list_.size();
+}
@@ -0,0 +1,158 @@
+// Created by: Gregorio Toscano
+
+#include "artifact_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "misc_utilities.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    bool sync_file(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+}
+
+ArtifactWriter::ArtifactWriter(size_t nthreads, size_t capacity, bool sync)
+        : capacity_(std::max<size_t>(capacity, 1)), sync_(sync) {
+    workers_.reserve(nthreads);
+    for (size_t i = 0; i < nthreads; ++i) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ArtifactWriter::~ArtifactWriter() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    work_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<ArtifactWriter> ArtifactWriter::from_env() {
+    return std::make_shared<ArtifactWriter>(
+            std::stoul(misc_utilities::get_env_var("PSO_ARTIFACT_THREADS", "1")),
+            std::stoul(misc_utilities::get_env_var("PSO_ARTIFACT_QUEUE", "64")),
+            misc_utilities::get_env_var("PSO_ARTIFACT_FSYNC", "0") == "1");
+}
+
+void ArtifactWriter::submit(std::string filename, Write write) {
+    Job job{std::move(filename), std::move(write)};
+    if (workers_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            ++pending_;
+        }
+        run(job);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (queue_.size() >= capacity_) {
+            auto start = Clock::now();
+            room_.wait(lock, [this] { return queue_.size() < capacity_; });
+            stats_.stall_seconds += seconds_since(start);
+        }
+        queue_.push(std::move(job));
+        ++pending_;
+        stats_.max_depth = std::max(stats_.max_depth, queue_.size());
+    }
+    work_.notify_one();
+}
+
+bool ArtifactWriter::flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (pending_ > 0) {
+        auto start = Clock::now();
+        done_.wait(lock, [this] { return pending_ == 0; });
+        stats_.flush_seconds += seconds_since(start);
+    }
+    return !std::exchange(has_failed_, false);
+}
+
+ArtifactWriter::Stats ArtifactWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
+
+void ArtifactWriter::print_stats() const {
+    auto s = stats();
+    fmt::print("artifact writer: {} files ({:.1f} MB), {} failed, queue depth up to {}, "
+               "{:.3f} s stalled on a full queue, {:.3f} s waiting in flush\n",
+               s.files, s.bytes / 1e6, s.failed, s.max_depth, s.stall_seconds, s.flush_seconds);
+}
+
+void ArtifactWriter::worker_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            work_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_ && queue_.empty()) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop();
+        }
+        room_.notify_one();
+        run(job);
+    }
+}
+
+void ArtifactWriter::run(Job& job) {
+    bool ok = true;
+    try {
+        job.write(job.filename);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to write " << job.filename << ": " << e.what() << std::endl;
+        ok = false;
+    }
+    std::error_code ec;
+    uint64_t bytes = ok ? std::filesystem::file_size(job.filename, ec) : 0;
+    if (ok && ec) {
+        std::cerr << "Failed to write " << job.filename << ": it is not there" << std::endl;
+        ok = false;
+    }
+    if (ok && sync_ && !sync_file(job.filename)) {
+        std::cerr << "Failed to sync " << job.filename << std::endl;
+        ok = false;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (ok) {
+        ++stats_.files;
+        stats_.bytes += bytes;
+    }
+    else {
+        ++stats_.failed;
+        has_failed_ = true;
+    }
+    if (--pending_ == 0) {
+        done_.notify_all();
+    }
+}
@@ -0,0 +1,293 @@
+// Created by: Gregorio Toscano
+
+#include "bmp_table.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <stdexcept>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+
+namespace {
+    bool same_name(const std::string& a, const std::string& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    // The only chunk of the column name, or of the column at position.
+    std::shared_ptr<arrow::Array> find_column(const arrow::Table& table, const std::string& name, int position,
+                                              const std::shared_ptr<arrow::DataType>& type) {
+        const auto& fields = table.schema()->fields();
+        int idx = table.schema()->GetFieldIndex(name);
+        for (int k = 0; idx < 0 && k < static_cast<int>(fields.size()); ++k) {
+            if (same_name(fields[k]->name(), name)) {
+                idx = k;
+            }
+        }
+        if (idx < 0 && position < table.num_columns()) {
+            idx = position;
+        }
+        if (idx < 0) {
+            throw std::runtime_error("Column not found: " + name);
+        }
+        if (fields[idx]->type()->id() != type->id()) {
+            throw std::runtime_error("Column " + fields[idx]->name() + " is " + fields[idx]->type()->ToString()
+                                     + ", expected " + type->ToString());
+        }
+        return table.column(idx)->chunk(0);
+    }
+
+    template <typename Builder, typename Rows, typename Get>
+    std::shared_ptr<arrow::Array> rows_column(const Rows& rows, Get&& get) {
+        Builder builder;
+        PARQUET_THROW_NOT_OK(builder.Reserve(rows.size()));
+        for (const auto& row : rows) {
+            PARQUET_THROW_NOT_OK(builder.Append(get(row)));
+        }
+        std::shared_ptr<arrow::Array> array;
+        PARQUET_THROW_NOT_OK(builder.Finish(&array));
+        return array;
+    }
+
+    std::shared_ptr<arrow::Table> read_table(const std::string& file_name) {
+        std::shared_ptr<arrow::io::ReadableFile> infile;
+        PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(file_name, arrow::default_memory_pool()));
+
+        std::unique_ptr<parquet::arrow::FileReader> reader;
+        PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader));
+
+        std::shared_ptr<arrow::Table> table;
+        PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+        return table;
+    }
+}
+
+namespace bmp_table {
+    Table::Table(std::shared_ptr<arrow::Table> table) {
+        if (table == nullptr || table->num_rows() == 0) {
+            return;
+        }
+        // one chunk per column, so that a row is an index into its buffers
+        PARQUET_ASSIGN_OR_THROW(table_, table->CombineChunks(arrow::default_memory_pool()));
+        size_ = table_->num_rows();
+    }
+
+    Column<int32_t> Table::int32_column(const std::string& name, int position) const {
+        Column<int32_t> column;
+        if (size_ > 0) {
+            auto array = std::static_pointer_cast<arrow::Int32Array>(find_column(*table_, name, position, arrow::int32()));
+            column.values_ = array->raw_values();
+        }
+        return column;
+    }
+
+    Column<double> Table::double_column(const std::string& name, int position) const {
+        Column<double> column;
+        if (size_ > 0) {
+            auto array = std::static_pointer_cast<arrow::DoubleArray>(find_column(*table_, name, position, arrow::float64()));
+            column.values_ = array->raw_values();
+        }
+        return column;
+    }
+
+    Column<bool> Table::bool_column(const std::string& name, int position) const {
+        Column<bool> column;
+        if (size_ > 0) {
+            auto array = std::static_pointer_cast<arrow::BooleanArray>(find_column(*table_, name, position, arrow::boolean()));
+            column.bits_ = array->values()->data();
+            column.offset_ = array->offset();
+        }
+        return column;
+    }
+
+    Column<std::string_view> Table::string_column(const std::string& name, int position) const {
+        Column<std::string_view> column;
+        if (size_ > 0) {
+            auto array = std::static_pointer_cast<arrow::StringArray>(find_column(*table_, name, position, arrow::utf8()));
+            column.offsets_ = array->raw_value_offsets();
+            column.data_ = reinterpret_cast<const char*>(array->value_data()->data());
+            column.validity_ = array->null_count() > 0 ? array->null_bitmap_data() : nullptr;
+            column.offset_ = array->offset();
+        }
+        return column;
+    }
+}
+
+BmpTableLand::BmpTableLand(std::shared_ptr<arrow::Table> table) : Table(std::move(table)) {
+    bmp_submitted_id_ = int32_column("BmpSubmittedId", 0);
+    agency_id_ = int32_column("AgencyId", 1);
+    state_unique_identifier_ = string_column("StateUniqueIdentifier", 2);
+    state_id_ = int32_column("StateId", 3);
+    bmp_id_ = int32_column("BmpId", 4);
+    geography_id_ = int32_column("GeographyId", 5);
+    load_source_group_id_ = int32_column("LoadSourceGroupId", 6);
+    unit_id_ = int32_column("UnitId", 7);
+    amount_ = double_column("Amount", 8);
+    is_valid_ = bool_column("IsValid", 9);
+    error_message_ = string_column("ErrorMessage", 10);
+    row_index_ = int32_column("RowIndex", 11);
+}
+
+BmpTableLand BmpTableLand::from_rows(const std::vector<BmpRowLand>& rows) {
+    auto schema = arrow::schema({
+        arrow::field("BmpSubmittedId", arrow::int32()), arrow::field("AgencyId", arrow::int32()),
+        arrow::field("StateUniqueIdentifier", arrow::utf8()), arrow::field("StateId", arrow::int32()),
+        arrow::field("BmpId", arrow::int32()), arrow::field("GeographyId", arrow::int32()),
+        arrow::field("LoadSourceGroupId", arrow::int32()), arrow::field("UnitId", arrow::int32()),
+        arrow::field("Amount", arrow::float64()), arrow::field("IsValid", arrow::boolean()),
+        arrow::field("ErrorMessage", arrow::utf8()), arrow::field("RowIndex", arrow::int32()),
+    });
+    return BmpTableLand(arrow::Table::Make(schema, {
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.BmpSubmittedId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.AgencyId; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.StateUniqueIdentifier; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.StateId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.BmpId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.GeographyId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.LoadSourceGroupId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.UnitId; }),
+        rows_column<arrow::DoubleBuilder>(rows, [](const auto& row) { return row.Amount; }),
+        rows_column<arrow::BooleanBuilder>(rows, [](const auto& row) { return row.IsValid; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.ErrorMessage; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.RowIndex; }),
+    }, rows.size()));
+}
+
+BmpTableAnimal::BmpTableAnimal(std::shared_ptr<arrow::Table> table) : Table(std::move(table)) {
+    bmp_submitted_id_ = int32_column("BmpSubmittedId", 0);
+    bmp_id_ = int32_column("BmpId", 1);
+    agency_id_ = int32_column("AgencyId", 2);
+    state_unique_identifier_ = string_column("StateUniqueIdentifier", 3);
+    state_id_ = int32_column("StateId", 4);
+    geography_id_ = int32_column("GeographyId", 5);
+    animal_group_id_ = int32_column("AnimalGroupId", 6);
+    load_source_group_id_ = int32_column("LoadSourceGroupId", 7);
+    unit_id_ = int32_column("UnitId", 8);
+    amount_ = double_column("Amount", 9);
+    n_reduction_fraction_ = double_column("NReductionFraction", 10);
+    p_reduction_fraction_ = double_column("PReductionFraction", 11);
+    is_valid_ = bool_column("IsValid", 12);
+    error_message_ = string_column("ErrorMessage", 13);
+    row_index_ = int32_column("RowIndex", 14);
+}
+
+BmpTableAnimal BmpTableAnimal::from_rows(const std::vector<BmpRowAnimal>& rows) {
+    auto schema = arrow::schema({
+        arrow::field("BmpSubmittedId", arrow::int32()), arrow::field("BmpId", arrow::int32()),
+        arrow::field("AgencyId", arrow::int32()), arrow::field("StateUniqueIdentifier", arrow::utf8()),
+        arrow::field("StateId", arrow::int32()), arrow::field("GeographyId", arrow::int32()),
+        arrow::field("AnimalGroupId", arrow::int32()), arrow::field("LoadSourceGroupId", arrow::int32()),
+        arrow::field("UnitId", arrow::int32()), arrow::field("Amount", arrow::float64()),
+        arrow::field("NReductionFraction", arrow::float64()), arrow::field("PReductionFraction", arrow::float64()),
+        arrow::field("IsValid", arrow::boolean()), arrow::field("ErrorMessage", arrow::utf8()),
+        arrow::field("RowIndex", arrow::int32()),
+    });
+    return BmpTableAnimal(arrow::Table::Make(schema, {
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.BmpSubmittedId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.BmpId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.AgencyId; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.StateUniqueIdentifier; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.StateId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.GeographyId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.AnimalGroupId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.LoadSourceGroupId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.UnitId; }),
+        rows_column<arrow::DoubleBuilder>(rows, [](const auto& row) { return row.Amount; }),
+        rows_column<arrow::DoubleBuilder>(rows, [](const auto& row) { return row.NReductionFraction; }),
+        rows_column<arrow::DoubleBuilder>(rows, [](const auto& row) { return row.PReductionFraction; }),
+        rows_column<arrow::BooleanBuilder>(rows, [](const auto& row) { return row.IsValid; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.ErrorMessage; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.RowIndex; }),
+    }, rows.size()));
+}
+
+BmpTableManure::BmpTableManure(std::shared_ptr<arrow::Table> table) : Table(std::move(table)) {
+    bmp_submitted_id_ = int32_column("BmpSubmittedId", 0);
+    bmp_id_ = int32_column("BmpId", 1);
+    agency_id_ = int32_column("AgencyId", 2);
+    state_unique_identifier_ = string_column("StateUniqueIdentifier", 3);
+    state_id_ = int32_column("StateId", 4);
+    has_state_reference_ = bool_column("HasStateReference", 5);
+    county_id_from_ = int32_column("CountyIdFrom", 6);
+    county_id_to_ = int32_column("CountyIdTo", 7);
+    fips_from_ = string_column("FipsFrom", 8);
+    fips_to_ = string_column("FipsTo", 9);
+    animal_group_id_ = int32_column("AnimalGroupId", 10);
+    load_source_group_id_ = int32_column("LoadSourceGroupId", 11);
+    unit_id_ = int32_column("UnitId", 12);
+    amount_ = double_column("Amount", 13);
+    is_valid_ = bool_column("IsValid", 14);
+    error_message_ = string_column("ErrorMessage", 15);
+    row_index_ = int32_column("RowIndex", 16);
+}
+
+BmpTableManure BmpTableManure::from_rows(const std::vector<BmpRowManure>& rows) {
+    auto schema = arrow::schema({
+        arrow::field("BmpSubmittedId", arrow::int32()), arrow::field("BmpId", arrow::int32()),
+        arrow::field("AgencyId", arrow::int32()), arrow::field("StateUniqueIdentifier", arrow::utf8()),
+        arrow::field("StateId", arrow::int32()), arrow::field("HasStateReference", arrow::boolean()),
+        arrow::field("CountyIdFrom", arrow::int32()), arrow::field("CountyIdTo", arrow::int32()),
+        arrow::field("FipsFrom", arrow::utf8()), arrow::field("FipsTo", arrow::utf8()),
+        arrow::field("AnimalGroupId", arrow::int32()), arrow::field("LoadSourceGroupId", arrow::int32()),
+        arrow::field("UnitId", arrow::int32()), arrow::field("Amount", arrow::float64()),
+        arrow::field("IsValid", arrow::boolean()), arrow::field("ErrorMessage", arrow::utf8()),
+        arrow::field("RowIndex", arrow::int32()),
+    });
+    return BmpTableManure(arrow::Table::Make(schema, {
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.BmpSubmittedId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.BmpId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.AgencyId; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.StateUniqueIdentifier; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.StateId; }),
+        rows_column<arrow::BooleanBuilder>(rows, [](const auto& row) { return row.HasStateReference; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.CountyIdFrom; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.CountyIdTo; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.FIPSFrom; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.FIPSTo; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.AnimalGroupId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.LoadSourceGroupId; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.UnitId; }),
+        rows_column<arrow::DoubleBuilder>(rows, [](const auto& row) { return row.Amount; }),
+        rows_column<arrow::BooleanBuilder>(rows, [](const auto& row) { return row.IsValid; }),
+        rows_column<arrow::StringBuilder>(rows, [](const auto& row) -> const std::string& { return row.ErrorMessage; }),
+        rows_column<arrow::Int32Builder>(rows, [](const auto& row) { return row.RowIndex; }),
+    }, rows.size()));
+}
+
+BmpTableLand read_parquet_file_land(const std::string& file_name) {
+    /**
+    @brief Load the base land submission rows from a Parquet file using Apache Arrow
+    @param file_name path to the Parquet file to read
+    @return BmpTableLand the rows of the file, left in the Arrow buffers
+    */
+    return BmpTableLand(read_table(file_name));
+}
+
+BmpTableAnimal read_parquet_file_animal(const std::string& file_name) {
+    /**
+        @brief Load the base animal submission rows from a Parquet file using Apache Arrow
+        @param file_name path to the Parquet file to read
+        @return BmpTableAnimal the rows of the file, left in the Arrow buffers
+    */
+    std::cout << "file_name: " << file_name << std::endl;
+    BmpTableAnimal result(read_table(file_name));
+    std::cout << "result size Animal: " << result.size() << std::endl;
+    return result;
+}
+
+BmpTableManure read_parquet_file_manure(const std::string& file_name) {
+    /**
+        @brief Load the base manure transport submission rows from a Parquet file using Apache Arrow
+        @param file_name path to the Parquet file to read
+        @return BmpTableManure the rows of the file, left in the Arrow buffers
+    */
+    std::cout << "file_name: " << file_name << std::endl;
+    BmpTableManure result(read_table(file_name));
+    std::cout << "result size Manure: " << result.size() << std::endl;
+    return result;
+}
@@ -0,0 +1,223 @@
+// Created by: Gregorio Toscano
+
+#include "csv_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fmt/core.h>
+
+#include "csv.hpp"
+#include "thread_pool.h"
+
+namespace {
+    bool is_newline(char c) {
+        return c == '\n' || c == '\r';
+    }
+
+    // The record starting at pos, split into fields; returns where the next
+    // record starts, past its newlines, and counts the '\n' it went over.
+    size_t parse_record(const char* data, size_t pos, size_t end, std::vector<std::string_view>& fields,
+                        std::deque<std::string>& unescaped, size_t& newlines) {
+        fields.clear();
+        unescaped.clear();
+        for (;;) {
+            if (pos < end && data[pos] == '"') {
+                size_t start = ++pos;
+                size_t piece = start;
+                std::string* owned = nullptr;
+                for (;;) {
+                    auto quote = static_cast<const char*>(std::memchr(data + pos, '"', end - pos));
+                    size_t at = quote == nullptr ? end : quote - data;
+                    newlines += std::count(data + pos, data + at, '\n');
+                    if (at == end || at + 1 == end || data[at + 1] == ',' || is_newline(data[at + 1])) {
+                        // the closing quote, or a field left open at the end of the file
+                        if (owned != nullptr) {
+                            owned->append(data + piece, at - piece);
+                            fields.emplace_back(*owned);
+                        }
+                        else {
+                            fields.emplace_back(data + start, at - start);
+                        }
+                        pos = std::min(at + 1, end);
+                        break;
+                    }
+                    if (data[at + 1] == '"') {
+                        if (owned == nullptr) {
+                            owned = &unescaped.emplace_back();
+                        }
+                        owned->append(data + piece, at + 1 - piece);
+                        pos = piece = at + 2;
+                        continue;
+                    }
+                    // a lone quote inside a quoted field is kept
+                    pos = at + 1;
+                }
+            }
+            else {
+                size_t start = pos;
+                while (pos < end && data[pos] != ',' && !is_newline(data[pos])) {
+                    ++pos;
+                }
+                fields.emplace_back(data + start, pos - start);
+            }
+            if (pos < end && data[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            break;
+        }
+        while (pos < end && is_newline(data[pos])) {
+            newlines += data[pos] == '\n';
+            ++pos;
+        }
+        return pos;
+    }
+}
+
+namespace csv_table {
+    void Row::fail(size_t column, const std::string& message) {
+        if (error_.empty()) {
+            error_ = fmt::format("{}: {}", (*columns_)[column], message);
+        }
+    }
+
+    // the checks of CSVField::get<int>(), on the value csv.hpp itself parses
+    template <>
+    int Row::get<int>(size_t column) {
+        long double value = 0;
+        auto type = csv::internals::data_type(field(column), &value);
+        if (type <= csv::DataType::CSV_STRING) {
+            fail(column, csv::internals::ERROR_NAN);
+            return 0;
+        }
+        if (type == csv::DataType::CSV_DOUBLE) {
+            fail(column, csv::internals::ERROR_FLOAT_TO_INT);
+            return 0;
+        }
+        if (type > csv::DataType::CSV_INT32) {
+            fail(column, csv::internals::ERROR_OVERFLOW);
+            return 0;
+        }
+        return static_cast<int>(value);
+    }
+
+    template <>
+    double Row::get<double>(size_t column) {
+        long double value = 0;
+        if (csv::internals::data_type(field(column), &value) <= csv::DataType::CSV_STRING) {
+            fail(column, csv::internals::ERROR_NAN);
+            return 0.0;
+        }
+        return static_cast<double>(value);
+    }
+
+    template <>
+    std::string Row::get<std::string>(size_t column) {
+        return std::string(field(column));
+    }
+
+    File::File(std::string filename, std::vector<std::string> columns, size_t chunk_bytes)
+        : filename_(std::move(filename)), columns_(std::move(columns)) {
+        file_ = std::make_unique<binary_io::MappedFile>(filename_);
+        const char* data = file_->data();
+        size_t size = file_->size();
+        if (data == nullptr) {
+            open_errors_.push_back({filename_, 0, "cannot read the file"});
+            return;
+        }
+        size_t pos = 0;
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            pos = 3;
+        }
+        std::vector<std::string_view> header;
+        std::deque<std::string> unescaped;
+        size_t line = 1;
+        pos = parse_record(data, pos, size, header, unescaped, line);
+        width_ = header.size();
+        for (const auto& column : columns_) {
+            auto it = std::find(header.begin(), header.end(), column);
+            if (it == header.end()) {
+                open_errors_.push_back({filename_, 0, fmt::format("no column {}", column)});
+            }
+            index_.push_back(it - header.begin());
+        }
+        if (!open_errors_.empty()) {
+            return;
+        }
+
+        // chunks end on a row boundary; with quotes in the file, only
+        // walking the rows tells where one is
+        bool quoted = std::memchr(data + pos, '"', size - pos) != nullptr;
+        std::vector<std::string_view> fields;
+        chunk_bytes = std::max<size_t>(chunk_bytes, 1);
+        while (pos < size) {
+            size_t begin = pos;
+            size_t first_line = line;
+            if (size - pos <= chunk_bytes) {
+                line += std::count(data + pos, data + size, '\n');
+                pos = size;
+            }
+            else if (!quoted) {
+                auto newline = static_cast<const char*>(std::memchr(data + pos + chunk_bytes, '\n', size - pos - chunk_bytes));
+                pos = newline == nullptr ? size : newline - data + 1;
+                line += std::count(data + begin, data + pos, '\n');
+            }
+            else {
+                while (pos < size && pos - begin < chunk_bytes) {
+                    pos = parse_record(data, pos, size, fields, unescaped, line);
+                }
+            }
+            chunks_.push_back({begin, pos, first_line});
+        }
+    }
+
+    size_t File::scan(size_t k, const std::function<void(Row&)>& visit, std::vector<RowError>& errors) const {
+        const char* data = file_->data();
+        size_t size = file_->size();
+        const auto& chunk = chunks_[k];
+        Row row;
+        row.index_ = &index_;
+        row.columns_ = &columns_;
+        size_t pos = chunk.begin;
+        size_t line = chunk.line;
+        size_t visited = 0;
+        while (pos < chunk.end && is_newline(data[pos])) {
+            line += data[pos] == '\n';
+            ++pos;
+        }
+        while (pos < chunk.end) {
+            size_t row_line = line;
+            pos = parse_record(data, pos, size, row.fields_, row.unescaped_, line);
+            if (row.fields_.size() != width_) {
+                errors.push_back({filename_, row_line, fmt::format("{} fields, the header has {}", row.fields_.size(), width_)});
+                continue;
+            }
+            row.error_.clear();
+            visit(row);
+            ++visited;
+            if (row.failed()) {
+                errors.push_back({filename_, row_line, row.error_});
+            }
+        }
+        return visited;
+    }
+
+    void parse_all(const std::vector<Parsed*>& tables, ThreadPool* pool) {
+        std::vector<std::pair<Parsed*, size_t>> chunks;
+        for (auto* table : tables) {
+            for (size_t k = 0; k < table->chunks(); ++k) {
+                chunks.emplace_back(table, k);
+            }
+        }
+        if (pool == nullptr) {
+            for (auto& [table, k] : chunks) {
+                table->parse(k);
+            }
+            return;
+        }
+        pool->parallel_for(chunks.size(), [&](size_t i) {
+            chunks[i].first->parse(chunks[i].second);
+        });
+    }
+}
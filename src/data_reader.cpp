@@ -5,12 +5,17 @@
 #include "data_reader.h"
 #include "misc_utilities.h"
 
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 
 #include <fmt/core.h>
 
-#include "csv.hpp"
+#include "thread_pool.h"
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
@@ -26,81 +31,296 @@ DataReader::DataReader(std::string path) {
 }
 
 void DataReader::read_all() {
-    read_u_to_u_group();
-    read_lrseg_to_geography();
-    read_load_src_to_bmp_list();
-    read_animal_population();
-    read_animal_grp_bmps();
-    read_land_cost();
-    read_animal_cost();
-    read_land_bmp_cost();
-    read_animal_bmp_cost();
-    read_lrseg();
-    read_scenario();
-    read_geography_county();
+    read_tables(ALL_TABLES);
 }
 
+const std::vector<csv_table::RowError>& DataReader::get_errors() const {
+    return errors_;
+}
 
-void DataReader::read_scenario() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/TblScenario.csv", csvs_path);
-
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-
-            //"ScenarioId","ScenarioName","ScenarioDescription","SourceDataRevisionId",
-            // "BaseConditionId","ScenarioTypeId","BackoutScenarioId","NeienProgressRunId",
-            // "PointSourceDataSetId","AtmDepDataSetId","ClimateChangeDataSetId",
-            // "SoilPDataSetId","BaseLoadId","CostProfileId","CreateDate","UserId",
-            // "ScenarioStatusId","IsEditable","IsCbpoScenario","Notes","IsPublicScenario",
-            // "IsRestrictedByState","LastModifiedDate"
-            auto ScenarioId = row["ScenarioId"].get<int>();
-            json scenario_data;
-
-            scenario_data["AtmDepDataSetId"] = row["AtmDepDataSetId"].get<int>();
-            scenario_data["BackoutScenarioId"] = row["BackoutScenarioId"].get<int>();
-            scenario_data["BaseConditionId"] = row["BaseConditionId"].get<int>();
-            scenario_data["BaseLoadId"] = row["BaseLoadId"].get<int>();
-            scenario_data["CostProfileId"] = row["CostProfileId"].get<int>();
-            scenario_data["ClimateChangeDataSetId"] = row["ClimateChangeDataSetId"].get<int>();
-            scenario_data["HistoricalCropNeedScenario"]= 9999;//6608;
-            scenario_data["PointSourceDataSetId"] = row["PointSourceDataSetId"].get<int>();
-            scenario_data["ScenarioTypeId"] = row["ScenarioTypeId"].get<int>();
-            scenario_data["SoilPDataSetId"] = row["SoilPDataSetId"].get<int>();
-            scenario_data["SourceDataRevisionId"]= row["SourceDataRevisionId"].get<int>();
-            scenario_data_[ScenarioId] = scenario_data.dump();
-
-            std::string scenario_name = "";
-            int atm_dep_data_set= row["AtmDepDataSetId"].get<int>();
-            int back_out_scenario= row["BackoutScenarioId"].get<int>();
-            int base_condition= row["BaseConditionId"].get<int>();
-            int base_load= row["BaseLoadId"].get<int>();
-            int cost_profile= row["CostProfileId"].get<int>();
-            int climate_change_data_set= row["ClimateChangeDataSetId"].get<int>();
-            int historical_crop_need_scenario= 9999;//6608;
-            int point_source_data_set= row["PointSourceDataSetId"].get<int>();
-            int scenario_type= row["ScenarioTypeId"].get<int>();
-            int soil_p_data_set= row["SoilPDataSetId"].get<int>();
-            int source_data_revision= row["SourceDataRevisionId"].get<int>();
-            std::string scenario_data2 = fmt::format("{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}",scenario_name,\
-                                      atm_dep_data_set, back_out_scenario, base_condition,\
-                                      base_load, cost_profile, climate_change_data_set,\
-                                      historical_crop_need_scenario, point_source_data_set,\
-                                      scenario_type, soil_p_data_set, source_data_revision);
-
-            scenario_data2_[ScenarioId] = scenario_data2;
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
+void DataReader::add_errors(const std::vector<csv_table::RowError>& errors) {
+    // the first few rows of a table that were not loaded, then how many there were
+    constexpr size_t shown = 5;
+    for (size_t i = 0; i < std::min(errors.size(), shown); ++i) {
+        std::cerr << fmt::format("{}:{}: {}", errors[i].file, errors[i].line, errors[i].message) << std::endl;
+    }
+    if (errors.size() > shown) {
+        std::cerr << fmt::format("{}: {} rows not loaded", errors.front().file, errors.size()) << std::endl;
+    }
+    errors_.insert(errors_.end(), errors.begin(), errors.end());
+}
+
+void DataReader::read_tables(unsigned tables) {
+    auto path = [&](const std::string& name) {
+        return fmt::format("{}/{}", csvs_path, name);
+    };
+    std::vector<std::unique_ptr<csv_table::Parsed>> parsed;
+    // loads touch disjoint members, so they run concurrently; each returns
+    // what it prints, printed in this order afterwards
+    std::vector<std::function<std::string()>> loads;
+    auto add = [&](auto table) {
+        auto* added = table.get();
+        parsed.push_back(std::move(table));
+        return added;
+    };
+    using IntPair = std::pair<int, int>;
+
+    if (tables & LOAD_SRC_GROUPS) {
+        auto* table = add(std::make_unique<csv_table::Table<IntPair>>(path("load_src_to_load_src_grp.csv"),
+            std::vector<std::string>{"LoadSrcId", "LoadSrcGrpId"}, [](csv_table::Row& row) {
+                int load_src = row.get<int>(0);
+                int load_src_grp = row.get<int>(1);
+                return IntPair{load_src, load_src_grp};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const IntPair& row) {
+                u_u_group_dict[row.first] = row.second;
+            });
+            return fmt::format("Load sources to load sources read {}\n", table->rows());
+        });
+    }
+
+    if (tables & LRSEG_GEOGRAPHY) {
+        using Row = std::tuple<int, int, int>;
+        auto* table = add(std::make_unique<csv_table::Table<Row>>(path("lrseg_geo.csv"),
+            std::vector<std::string>{"LrsegId", "GeographyId", "StateId"}, [](csv_table::Row& row) {
+                int lrseg = row.get<int>(0);
+                int geography = row.get<int>(1);
+                int state = row.get<int>(2);
+                return Row{lrseg, geography, state};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const Row& row) {
+                auto [lrseg, geography, state] = row;
+                s_geography_dict[lrseg] = geography;
+                s_state_dict[lrseg] = state;
+            });
+            return fmt::format("Geographies read counter {}\n", table->rows());
+        });
+    }
+
+    if (tables & LOAD_SRC_BMPS) {
+        using Row = std::tuple<int, int, int, std::string>;
+        auto* table = add(std::make_unique<csv_table::Table<Row>>(path("TblBmpLoadSourceFromTo.csv"),
+            std::vector<std::string>{"BmpId", "FromLoadSourceId", "ToLoadSourceId"}, [](csv_table::Row& row) {
+                int bmp_id = row.get<int>(0);
+                int load_src_from = row.get<int>(1);
+                int load_src_to = row.get<int>(2);
+                return Row{bmp_id, load_src_from, load_src_to, fmt::format("{}_{}", bmp_id, load_src_from)};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const Row& row) {
+                const auto& [bmp_id, load_src_from, load_src_to, key] = row;
+                lc_bmp_from_to[key] = load_src_to;
+                load_src_to_bmp_list[load_src_from].push_back(bmp_id);
+            });
+            return fmt::format("Load sources to load sources read {}\n", table->rows());
+        });
+    }
+
+    if (tables & ANIMAL_POPULATION) {
+        // key, base_condition_county, animal units
+        using Row = std::tuple<std::string, std::string, double>;
+        auto* table = add(std::make_unique<csv_table::Table<Row>>(path("TblAnimalPopulation-filtered.csv"),
+            std::vector<std::string>{"BaseConditionId", "CountyId", "LoadSourceId", "AnimalId", "AnimalUnits"},
+            [](csv_table::Row& row) {
+                int base_condition = row.get<int>(0);
+                int county = row.get<int>(1);
+                int load_source = row.get<int>(2);
+                int animal_id = row.get<int>(3);
+                double animal_units = row.get<double>(4);
+                if (row.failed()) {
+                    return Row{};
+                }
+                return Row{fmt::format("{}_{}_{}_{}", base_condition, county, load_source, animal_id),
+                           fmt::format("{}_{}", base_condition, county), animal_units};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const Row& row) {
+                const auto& [key, key_base_county, animal_units] = row;
+                animal_[key] = animal_units;
+                animal_idx_[key_base_county].push_back(key);
+            });
+            return fmt::format("Animal read {}\n", table->rows());
+        });
+    }
+
+    if (tables & ANIMAL_GRP_BMPS) {
+        auto* table = add(std::make_unique<csv_table::Table<IntPair>>(path("TblAnimalGrpBmp.csv"),
+            std::vector<std::string>{"AnimalGrp", "Bmp"}, [](csv_table::Row& row) {
+                int animal_grp = row.get<int>(0);
+                int bmp = row.get<int>(1);
+                return IntPair{animal_grp, bmp};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const IntPair& row) {
+                animal_grp_bmps_[row.first].push_back(row.second);
+            });
+            return fmt::format("Animal Grp Bmp read {}\n", table->rows());
+        });
+    }
+
+    // both cost files feed the same members, land first, and each file is
+    // parsed once for the two loads that read it
+    csv_table::Table<BmpCost>* land_cost = nullptr;
+    csv_table::Table<BmpCost>* animal_cost = nullptr;
+    if (tables & (LAND_COST | LAND_BMP_COST)) {
+        land_cost = add(bmp_cost_table(path("TblCostBmpLand.csv")));
+    }
+    if (tables & (ANIMAL_COST | ANIMAL_BMP_COST)) {
+        //CostBmpSubmittedId,CostProfileId,SectorId,BmpId,
+        // AnimalId,LifespanYears,Capital,OandM,Opportunity,
+        // Notes,TotalCostPerUnit
+        animal_cost = add(bmp_cost_table(path("TblCostBmpAnimal-reduced.csv")));
+    }
+    if (tables & (LAND_COST | ANIMAL_COST)) {
+        loads.push_back([this, tables, land_cost, animal_cost] {
+            std::string printed;
+            if (tables & LAND_COST) {
+                printed += fmt::format("Bmp Cost read {}\n", add_bmp_cost(*land_cost));
+            }
+            if (tables & ANIMAL_COST) {
+                printed += fmt::format("Bmp Cost read {}\n", add_bmp_cost(*animal_cost));
+            }
+            return printed;
+        });
+    }
+    if (tables & (LAND_BMP_COST | ANIMAL_BMP_COST)) {
+        loads.push_back([this, tables, land_cost, animal_cost] {
+            if (tables & LAND_BMP_COST) {
+                add_bmp_cost2(*land_cost);
+            }
+            if (tables & ANIMAL_BMP_COST) {
+                add_bmp_cost2(*animal_cost);
+            }
+            return std::string();
+        });
+    }
+
+    if (tables & LRSEG) {
+        //"LrsegId","LandRiverSegment","LandSegmentGeographyId",
+        // "LandSegment","RiverSegment","FIPS","StateId","CountyId",
+        // "HgmrId","OutOfCBWS","AboveRIM","TotalAcres",
+        // "TotalAcresIncludingTidalWetlands"
+        auto* table = add(std::make_unique<csv_table::Table<std::vector<int>>>(path("TblLandRiverSegment.csv"),
+            std::vector<std::string>{"LrsegId", "LandSegmentGeographyId", "FIPS", "StateId", "CountyId"},
+            [](csv_table::Row& row) {
+                int lrseg_id = row.get<int>(0);
+                row.get<int>(1); // unused, but a row without it was never loaded
+                int fips = row.get<int>(2);
+                int state = row.get<int>(3);
+                int county = row.get<int>(4);
+                return std::vector<int>{lrseg_id, fips, state, county};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const std::vector<int>& row) {
+                lrseg_.push_back(row);
+            });
+            return fmt::format("Land River Segument Read {}\n", table->rows());
+        });
+    }
+
+    if (tables & SCENARIO) {
+        //"ScenarioId","ScenarioName","ScenarioDescription","SourceDataRevisionId",
+        // "BaseConditionId","ScenarioTypeId","BackoutScenarioId","NeienProgressRunId",
+        // "PointSourceDataSetId","AtmDepDataSetId","ClimateChangeDataSetId",
+        // "SoilPDataSetId","BaseLoadId","CostProfileId","CreateDate","UserId",
+        // "ScenarioStatusId","IsEditable","IsCbpoScenario","Notes","IsPublicScenario",
+        // "IsRestrictedByState","LastModifiedDate"
+        using Row = std::tuple<int, std::string, std::string>;
+        auto* table = add(std::make_unique<csv_table::Table<Row>>(path("TblScenario.csv"),
+            std::vector<std::string>{"ScenarioId", "AtmDepDataSetId", "BackoutScenarioId", "BaseConditionId",
+                                     "BaseLoadId", "CostProfileId", "ClimateChangeDataSetId", "PointSourceDataSetId",
+                                     "ScenarioTypeId", "SoilPDataSetId", "SourceDataRevisionId"},
+            [](csv_table::Row& row) {
+                int scenario_id = row.get<int>(0);
+                int atm_dep_data_set = row.get<int>(1);
+                int back_out_scenario = row.get<int>(2);
+                int base_condition = row.get<int>(3);
+                int base_load = row.get<int>(4);
+                int cost_profile = row.get<int>(5);
+                int climate_change_data_set = row.get<int>(6);
+                int historical_crop_need_scenario = 9999;//6608;
+                int point_source_data_set = row.get<int>(7);
+                int scenario_type = row.get<int>(8);
+                int soil_p_data_set = row.get<int>(9);
+                int source_data_revision = row.get<int>(10);
+                if (row.failed()) {
+                    return Row{};
+                }
+                json scenario_data;
+                scenario_data["AtmDepDataSetId"] = atm_dep_data_set;
+                scenario_data["BackoutScenarioId"] = back_out_scenario;
+                scenario_data["BaseConditionId"] = base_condition;
+                scenario_data["BaseLoadId"] = base_load;
+                scenario_data["CostProfileId"] = cost_profile;
+                scenario_data["ClimateChangeDataSetId"] = climate_change_data_set;
+                scenario_data["HistoricalCropNeedScenario"] = historical_crop_need_scenario;
+                scenario_data["PointSourceDataSetId"] = point_source_data_set;
+                scenario_data["ScenarioTypeId"] = scenario_type;
+                scenario_data["SoilPDataSetId"] = soil_p_data_set;
+                scenario_data["SourceDataRevisionId"] = source_data_revision;
+
+                std::string scenario_name = "";
+                std::string scenario_data2 = fmt::format("{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}", scenario_name,
+                                          atm_dep_data_set, back_out_scenario, base_condition,
+                                          base_load, cost_profile, climate_change_data_set,
+                                          historical_crop_need_scenario, point_source_data_set,
+                                          scenario_type, soil_p_data_set, source_data_revision);
+                return Row{scenario_id, scenario_data.dump(), scenario_data2};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const Row& row) {
+                const auto& [scenario_id, scenario_data, scenario_data2] = row;
+                scenario_data_[scenario_id] = scenario_data;
+                scenario_data2_[scenario_id] = scenario_data2;
+            });
+            return fmt::format("Land River Segument Read {}\n", table->rows());
+        });
+    }
+
+    if (tables & GEOGRAPHY_COUNTY) {
+        //GeographyId,CountyId,FIPS,CountyName,StateAbbreviation
+        using Row = std::tuple<int, int, int, std::string, std::string, std::string>;
+        auto* table = add(std::make_unique<csv_table::Table<Row>>(path("TblGeographyCounty.csv"),
+            std::vector<std::string>{"CountyId", "GeographyId", "GeographyType2Id", "FIPS", "CountyName", "StateAbbreviation"},
+            [](csv_table::Row& row) {
+                int county = row.get<int>(0);
+                int geography = row.get<int>(1);
+                int geography2 = row.get<int>(2);
+                return Row{county, geography, geography2, row.get<std::string>(3), row.get<std::string>(4),
+                           row.get<std::string>(5)};
+            }));
+        loads.push_back([this, table] {
+            table->for_each([&](const Row& row) {
+                const auto& [county, geography, geography2, fips, county_name, state] = row;
+                geography_county_[county] = {geography, geography2, fips, county_name, state};
+            });
+            return fmt::format("Geography County Read {}\n", table->rows());
+        });
+    }
+
+    ThreadPool pool(std::stoi(misc_utilities::get_env_var("CSV_NTHREADS", "0")));
+    std::vector<csv_table::Parsed*> to_parse;
+    for (auto& table : parsed) {
+        to_parse.push_back(table.get());
+    }
+    csv_table::parse_all(to_parse, &pool);
+    for (auto* table : to_parse) {
+        add_errors(table->errors());
+    }
+    std::vector<std::string> printed(loads.size());
+    pool.parallel_for(loads.size(), [&](size_t i) {
+        printed[i] = loads[i]();
+    });
+    for (const auto& lines : printed) {
+        fmt::print("{}", lines);
     }
-    fmt::print("Land River Segument Read {}\n", counter);
+}
+
+
+void DataReader::read_scenario() {
+    read_tables(SCENARIO);
 }
 
 std::string DataReader::get_scenario_data(int scenario_id) {
@@ -112,34 +332,7 @@ std::string DataReader::get_scenario_data2(int scenario_id) {
 }
 
 void DataReader::read_lrseg() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/TblLandRiverSegment.csv", csvs_path);
-
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-            //"LrsegId","LandRiverSegment","LandSegmentGeographyId",
-            // "LandSegment","RiverSegment","FIPS","StateId","CountyId",
-            // "HgmrId","OutOfCBWS","AboveRIM","TotalAcres",
-            // "TotalAcresIncludingTidalWetlands"
-
-            int lrseg_id = row["LrsegId"].get<int>();
-            int geography = row["LandSegmentGeographyId"].get<int>();
-            int fips = row["FIPS"].get<int>();
-            int state = row["StateId"].get<int>();
-            int county = row["CountyId"].get<int>();
-            lrseg_.push_back({lrseg_id, fips, state, county});
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Land River Segument Read {}\n", counter);
+    read_tables(LRSEG);
 }
 
 const std::vector<std::vector<int>>& DataReader::get_lrseg() const {
@@ -148,32 +341,7 @@ const std::vector<std::vector<int>>& DataReader::get_lrseg() const {
 
 
 void DataReader::read_geography_county() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/TblGeographyCounty.csv", csvs_path);
-
-    csv::CSVReader reader(filename);
-    for(auto& row: reader) {
-        try {
-            //GeographyId,CountyId,FIPS,CountyName,StateAbbreviation
-
-            int county = row["CountyId"].get<int>();
-            int geography = row["GeographyId"].get<int>();
-            int geography2 = row["GeographyType2Id"].get<int>();
-            std::string fips = row["FIPS"].get<std::string>();
-            std::string county_name = row["CountyName"].get<std::string>();
-            std::string state = row["StateAbbreviation"].get<std::string>();
-            geography_county_[county] = {geography, geography2, fips, county_name, state};
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Geography County Read {}\n", counter);
+    read_tables(GEOGRAPHY_COUNTY);
 }
 
 const std::unordered_map<int, std::tuple<int, int, std::string, std::string, std::string> >& DataReader::get_geography_county() const {
@@ -181,52 +349,47 @@ const std::unordered_map<int, std::tuple<int, int, std::string, std::string, std
 }
 
 int DataReader::read_bmp_cost(const std::string& filename) {
-    int counter = 0;
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-            //"CostBmpSubmittedId","CostProfileId","SectorId","BmpId",
-            // "LifespanYears","Capital","OandM","Opportunity","Notes",
-            // "TotalCostPerUnit"
-
-            int profile = row["CostProfileId"].get<int>();
-            int bmp = row["BmpId"].get<int>();
-            double cost = row["TotalCostPerUnit"].get<double>();
-            auto key = fmt::format("{}_{}", profile, bmp);
-            bmp_cost_[key] = cost;
-            auto profile_str = std::to_string(profile);
-            if (bmp_cost_idx_.contains(profile_str)) {
-                auto tmp_lst =  bmp_cost_idx_.at(profile_str);
-                tmp_lst.push_back(key);
-                bmp_cost_idx_[profile_str] = tmp_lst;
-            }
-            else {
-                bmp_cost_idx_[profile_str] = {key};
-            }
-
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
+    auto table = bmp_cost_table(filename);
+    csv_table::parse_all({table.get()}, nullptr);
+    add_errors(table->errors());
+    int counter = add_bmp_cost(*table);
     fmt::print("Bmp Cost read {}\n", counter);
     return counter;
 }
 
+std::unique_ptr<csv_table::Table<DataReader::BmpCost>> DataReader::bmp_cost_table(const std::string& filename) {
+    //"CostBmpSubmittedId","CostProfileId","SectorId","BmpId",
+    // "LifespanYears","Capital","OandM","Opportunity","Notes",
+    // "TotalCostPerUnit"
+    return std::make_unique<csv_table::Table<BmpCost>>(filename,
+        std::vector<std::string>{"CostProfileId", "BmpId", "TotalCostPerUnit"}, [](csv_table::Row& row) {
+            int profile = row.get<int>(0);
+            int bmp = row.get<int>(1);
+            double cost = row.get<double>(2);
+            return BmpCost{profile, bmp, cost, fmt::format("{}_{}", profile, bmp)};
+        });
+}
+
+int DataReader::add_bmp_cost(const csv_table::Table<BmpCost>& table) {
+    table.for_each([&](const BmpCost& row) {
+        bmp_cost_[row.key] = row.cost;
+        bmp_cost_idx_[std::to_string(row.profile)].push_back(row.key);
+    });
+    return table.rows();
+}
+
+int DataReader::add_bmp_cost2(const csv_table::Table<BmpCost>& table) {
+    table.for_each([&](const BmpCost& row) {
+        bmp_cost_dict_[row.profile][row.bmp] = row.cost;
+    });
+    return table.size();
+}
+
 void DataReader::read_land_cost() {
-    auto filename = fmt::format("{}/TblCostBmpLand.csv", csvs_path);
-    read_bmp_cost(filename);
+    read_tables(LAND_COST);
 }
 void DataReader::read_animal_cost() {
-    //CostBmpSubmittedId,CostProfileId,SectorId,BmpId,
-    // AnimalId,LifespanYears,Capital,OandM,Opportunity,
-    // Notes,TotalCostPerUnit
-    auto filename = fmt::format("{}/TblCostBmpAnimal-reduced.csv", csvs_path);
-    read_bmp_cost(filename);
+    read_tables(ANIMAL_COST);
 }
 
 double  DataReader::get_bmp_cost(std::string key) const {
@@ -243,35 +406,7 @@ const std::vector<std::string>& DataReader::get_bmp_cost_idx(const std::string&
 }
 
 void DataReader::read_animal_grp_bmps() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/TblAnimalGrpBmp.csv", csvs_path);
-
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-            int animal_grp = row["AnimalGrp"].get<int>();
-            int bmp = row["Bmp"].get<int>();
-
-            if (animal_grp_bmps_.contains(animal_grp)) {
-                auto tmp_lst =  animal_grp_bmps_.at(animal_grp);
-                tmp_lst.push_back(bmp);
-                animal_grp_bmps_[animal_grp] = tmp_lst;
-            }
-            else {
-                animal_grp_bmps_[animal_grp] = {bmp};
-            }
-
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Animal Grp Bmp read {}\n", counter);
+    read_tables(ANIMAL_GRP_BMPS);
 }
 
 const std::unordered_map<int, std::vector<int>>& DataReader::get_animal_grp_bmps() const {
@@ -279,42 +414,7 @@ const std::unordered_map<int, std::vector<int>>& DataReader::get_animal_grp_bmps
 }
 
 void DataReader::read_animal_population() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/TblAnimalPopulation-filtered.csv", csvs_path);
-
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-            int base_condition = row["BaseConditionId"].get<int>();
-            int county = row["CountyId"].get<int>();
-            int load_source = row["LoadSourceId"].get<int>();
-            int animal_id = row["AnimalId"].get<int>();
-            double animal_units = row["AnimalUnits"].get<double>();
-
-            auto key = fmt::format("{}_{}_{}_{}", base_condition, county, load_source, animal_id);
-            auto key_base_county = fmt::format("{}_{}", base_condition, county);
-            animal_[key] = animal_units;
-
-            if (animal_idx_.contains(key_base_county)) {
-                auto tmp_lst = animal_idx_.at(key_base_county);
-                tmp_lst.push_back(key);
-                animal_idx_[key_base_county] = tmp_lst;
-            }
-            else {
-                animal_idx_[key_base_county] = {key};
-            }
-
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Animal read {}\n", counter);
+    read_tables(ANIMAL_POPULATION);
 }
 
 const std::unordered_map<std::string, double>& DataReader::get_animal() const {
@@ -330,37 +430,7 @@ const std::vector<std::string>& DataReader::get_animal_idx(std::string key) cons
 }
 
 void DataReader::read_load_src_to_bmp_list() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/TblBmpLoadSourceFromTo.csv", csvs_path);
-
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-            int bmp_id = row["BmpId"].get<int>();
-            int load_src_from = row["FromLoadSourceId"].get<int>();
-            int load_src_to = row["ToLoadSourceId"].get<int>();
-            auto key = fmt::format("{}_{}", bmp_id, load_src_from);
-            lc_bmp_from_to[key] = load_src_to;
-            if (load_src_to_bmp_list.contains(load_src_from)) {
-                auto tmp_list =  load_src_to_bmp_list[load_src_from];
-                tmp_list.push_back(bmp_id);
-                load_src_to_bmp_list[load_src_from] = tmp_list;
-            }
-            else {
-                load_src_to_bmp_list[load_src_from] = {bmp_id};
-            }
-
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Load sources to load sources read {}\n", counter);
+    read_tables(LOAD_SRC_BMPS);
 }
 /* for livestock everything can apply except 69 (pultred, 203)
  * For poultry we can apply everying.
@@ -384,25 +454,7 @@ int  DataReader::get_lc_bmp_from_to(std::string lc_bmp_to) const {
 
 
 void DataReader::read_u_to_u_group() {
-    int counter = 0;
-
-    auto filename = fmt::format("{}/load_src_to_load_src_grp.csv", csvs_path);
-    csv::CSVReader reader2(filename);
-    for(auto& row: reader2) {
-        try {
-            int load_src = row["LoadSrcId"].get<int>();
-            int load_src_grp= row["LoadSrcGrpId"].get<int>();
-            u_u_group_dict[load_src] = load_src_grp;
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Load sources to load sources read {}\n", counter);
+    read_tables(LOAD_SRC_GROUPS);
 }
 
 
@@ -420,26 +472,7 @@ int DataReader::get_u_u_group(int load_source) const {
 }
 
 void DataReader::read_lrseg_to_geography() {
-    auto filename = fmt::format("{}/{}", csvs_path, "lrseg_geo.csv");
-    csv::CSVReader reader(filename);
-    int counter =0;
-    for(auto& row: reader) {
-        try {
-            int lrseg = row["LrsegId"].get<int>();
-            int geography = row["GeographyId"].get<int>();
-            int state = row["StateId"].get<int>();
-            s_geography_dict[lrseg] = geography;
-            s_state_dict[lrseg] = state;
-        } catch (std::exception &e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-        counter++;
-    }
-    fmt::print("Geographies read counter {}\n", counter);
+    read_tables(LRSEG_GEOGRAPHY);
 }
 
 const std::unordered_map<int, int>& DataReader::get_geographies() const {
@@ -467,36 +500,18 @@ int DataReader::get_state(int lrseg) const {
 
 
 int DataReader::read_bmp_cost2(const std::string& filename) {
-    int counter = 0;
-    csv::CSVReader reader(filename);
-
-    for(auto& row: reader) {
-        try {
-
-            int profile = row["CostProfileId"].get<int>();
-            int bmp = row["BmpId"].get<int>();
-            double cost = row["TotalCostPerUnit"].get<double>();
-            bmp_cost_dict_[profile][bmp]=cost;
-            ++counter;
-        } catch (std::exception& e) {
-            // Catch any exceptions that derive from std::exception
-            std::cerr << "Caught exception: " << e.what() << std::endl;
-        } catch (...) {
-            // Catch any other exceptions
-            std::cerr << "Caught unknown exception." << std::endl;
-        }
-    }
-    return counter;
+    auto table = bmp_cost_table(filename);
+    csv_table::parse_all({table.get()}, nullptr);
+    add_errors(table->errors());
+    return add_bmp_cost2(*table);
 }
 
 void DataReader::read_land_bmp_cost() {
-    auto filename = fmt::format("{}/TblCostBmpLand.csv", csvs_path);
-    read_bmp_cost2(filename);
+    read_tables(LAND_BMP_COST);
 }
 
 void DataReader::read_animal_bmp_cost() {
-    auto filename = fmt::format("{}/TblCostBmpAnimal-reduced.csv", csvs_path);
-    read_bmp_cost2(filename);
+    read_tables(ANIMAL_BMP_COST);
 }
 const std::unordered_map<int, std::unordered_map<int, double>>& DataReader::get_land_bmp_costs() const{
     return bmp_cost_dict_;
@@ -0,0 +1,153 @@
+// Created by: Gregorio Toscano
+//
+// Cache file layout: an 8-byte magic and a uint32 version, then one record per
+// insertion: uint64 key, double load, uint32 uuid length, uuid bytes, uint32
+// directory length, directory bytes. Scalars are stored in native byte order.
+
+#include "evaluation_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+#include "misc_utilities.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr char CACHE_MAGIC[8] = {'M', 'S', 'U', 'E', 'V', 'A', 'L', '\0'};
+    constexpr uint32_t CACHE_VERSION = 2;
+
+    template <typename T>
+    void append(std::string& buffer, const T& value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool read(std::ifstream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    // rows sorted, then every field appended; -0.0 is written as 0.0
+    template <typename Tuple>
+    uint64_t hash_rows(std::vector<Tuple> rows, uint64_t seed) {
+        std::sort(rows.begin(), rows.end());
+        std::string buffer;
+        buffer.reserve(rows.size() * sizeof(Tuple));
+        for (const auto& row : rows) {
+            std::apply([&](const auto&... fields) {
+                auto put = [&](auto field) {
+                    if constexpr (std::is_floating_point_v<decltype(field)>) {
+                        field += 0.0;
+                    }
+                    append(buffer, field);
+                };
+                (put(fields), ...);
+            }, row);
+        }
+        return misc_utilities::hash_bytes(buffer.data(), buffer.size(), seed);
+    }
+}
+
+EvaluationCache::EvaluationCache(std::string filename) : filename_(std::move(filename)) {
+    if (filename_.empty()) {
+        return;
+    }
+    std::error_code ec;
+    fs::path path(filename_);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+    load();
+    bool is_new = !fs::exists(filename_, ec) || fs::file_size(filename_, ec) == 0;
+    out_.open(filename_, std::ios::binary | std::ios::app);
+    if (!out_.is_open()) {
+        std::cerr << "Failed to open the file: " << filename_ << ", results will not be kept" << std::endl;
+        return;
+    }
+    if (is_new) {
+        std::string header(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        append(header, CACHE_VERSION);
+        out_.write(header.data(), header.size());
+        out_.flush();
+    }
+}
+
+void EvaluationCache::load() {
+    std::ifstream in(filename_, std::ios::binary);
+    if (!in.is_open()) {
+        return;
+    }
+    char magic[8];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || !read(in, version)
+            || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION) {
+        std::cerr << "Ignoring stale or corrupt evaluation cache " << filename_ << std::endl;
+        in.close();
+        fs::remove(filename_);
+        return;
+    }
+    auto end = in.tellg();
+    uint64_t key;
+    double load;
+    uint32_t uuid_size;
+    uint32_t directory_size;
+    while (read(in, key) && read(in, load) && read(in, uuid_size) && uuid_size <= 256) {
+        std::string exec_uuid(uuid_size, '\0');
+        if (!in.read(exec_uuid.data(), uuid_size) || !read(in, directory_size) || directory_size > 4096) {
+            break;
+        }
+        std::string directory(directory_size, '\0');
+        if (!in.read(directory.data(), directory_size)) {
+            break;
+        }
+        entries_[key] = Entry{load, std::move(exec_uuid), std::move(directory)};
+        end = in.tellg();
+    }
+    in.close();
+    // drop a partial last record so the next appends stay aligned
+    std::error_code ec;
+    if (static_cast<uintmax_t>(end) < fs::file_size(filename_, ec)) {
+        fs::resize_file(filename_, end, ec);
+    }
+}
+
+uint64_t EvaluationCache::solution_key(uint64_t context,
+                                       const std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+                                       const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x,
+                                       const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x) {
+    uint64_t key = misc_utilities::mix64(context ^ CACHE_VERSION);
+    key = hash_rows(lc_x, key ^ 1);
+    key = hash_rows(animal_x, key ^ 2);
+    key = hash_rows(manure_x, key ^ 3);
+    return key;
+}
+
+std::optional<EvaluationCache::Entry> EvaluationCache::find(uint64_t key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        ++misses_;
+        return std::nullopt;
+    }
+    ++hits_;
+    return it->second;
+}
+
+void EvaluationCache::insert(uint64_t key, double load, const std::string& exec_uuid, const std::string& directory) {
+    if (!entries_.emplace(key, Entry{load, exec_uuid, directory}).second || !out_.is_open()) {
+        return;
+    }
+    std::string record;
+    append(record, key);
+    append(record, load);
+    append(record, static_cast<uint32_t>(exec_uuid.size()));
+    record += exec_uuid;
+    append(record, static_cast<uint32_t>(directory.size()));
+    record += directory;
+    // one write per record, so a killed run leaves at most one partial record
+    out_.write(record.data(), record.size());
+    out_.flush();
+}
@@ -0,0 +1,262 @@
+// Created by: Gregorio Toscano
+
+#include "evaluator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+#include <fmt/core.h>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+
+#include "misc_utilities.h"
+
+namespace {
+
+    std::vector<std::string> exec_uuids(const std::vector<EvaluationRequest>& requests) {
+        std::vector<std::string> exec_uuid_vec;
+        exec_uuid_vec.reserve(requests.size());
+        for (const auto& request : requests) {
+            exec_uuid_vec.push_back(request.exec_uuid);
+        }
+        return exec_uuid_vec;
+    }
+}
+
+void Evaluator::submit(Scenario& scenario, const std::string& emo_uuid,
+                       const std::vector<EvaluationRequest>& requests) {
+    auto results = evaluate(scenario, emo_uuid, requests);
+    std::unordered_set<std::string> evaluated;
+    for (const auto& result : results) {
+        evaluated.insert(result.substr(0, result.find('_')));
+    }
+    completed_.insert(completed_.end(), results.begin(), results.end());
+    for (const auto& request : requests) {
+        if (!evaluated.contains(request.exec_uuid)) {
+            completed_.push_back(request.exec_uuid + "_");
+        }
+    }
+}
+
+std::vector<std::string> Evaluator::wait_any(Scenario&, const std::string&) {
+    return std::exchange(completed_, {});
+}
+
+size_t ModelEvaluator::RowKeyHash::operator()(const RowKey& key) const {
+    uint64_t high = (static_cast<uint64_t>(static_cast<uint32_t>(key.lrseg)) << 32) | static_cast<uint32_t>(key.agency);
+    uint64_t low = (static_cast<uint64_t>(static_cast<uint32_t>(key.load_src)) << 32) | static_cast<uint32_t>(key.bmp);
+    return misc_utilities::mix64(misc_utilities::mix64(high) ^ low);
+}
+
+std::vector<std::string> AmqpEvaluator::evaluate(Scenario& scenario, const std::string& emo_uuid,
+                                                 const std::vector<EvaluationRequest>& requests) {
+    return scenario.send_files(emo_uuid, exec_uuids(requests));
+}
+
+void AmqpEvaluator::submit(Scenario& scenario, const std::string& emo_uuid,
+                           const std::vector<EvaluationRequest>& requests) {
+    scenario.dispatch_files(emo_uuid, exec_uuids(requests));
+}
+
+std::vector<std::string> AmqpEvaluator::wait_any(Scenario& scenario, const std::string& emo_uuid) {
+    return scenario.receive_files(emo_uuid);
+}
+
+ModelEvaluator::ModelEvaluator(const Scenario& scenario) {
+    load_to_opt_ = scenario.get_load_to_opt();
+    const auto& phi_dict = scenario.get_phi();
+    auto amount = scenario.get_alpha();
+
+    for (const auto& [key, phi] : phi_dict) {
+        parcel_index(key, phi_dict, amount);
+    }
+    base_load_ = 0.0;
+    for (const auto& parcel : parcels_) {
+        base_load_ += parcel.phi * parcel.amount;
+    }
+
+    const auto& model = scenario.get_model();
+    for (size_t p = 0; p < model.lc_keys.size(); ++p) {
+        size_t from = parcel_index(model.lc_keys[p], phi_dict, amount);
+        for (size_t k = model.lc_offsets[p]; k < model.lc_offsets[p + 1]; ++k) {
+            size_t to = parcel_index(model.lc_to_keys[model.lc_to[k]], phi_dict, amount);
+            conversions_[{model.lc_lrseg[p], model.lc_agency[p], model.lc_load_src[p], model.lc_bmp[k]}] = {from, to};
+        }
+    }
+
+    // eta keys are "bmp_lrseg_loadsrc"
+    for (const auto& [key, eta] : scenario.get_eta()) {
+        std::vector<std::string> key_split;
+        misc_utilities::split_str(key, '_', key_split);
+        if (key_split.size() != 3 || eta.size() < 3) {
+            continue;
+        }
+        efficiency_[{std::stoi(key_split[1]), 0, std::stoi(key_split[2]), std::stoi(key_split[0])}] = eta[load_to_opt_ % 3];
+    }
+}
+
+size_t ModelEvaluator::parcel_index(const std::string& key, const std::unordered_map<std::string, std::vector<double>>& phi_dict,
+                                    const std::unordered_map<std::string, double>& amount) {
+    auto it = parcel_idx_.find(key);
+    if (it != parcel_idx_.end()) {
+        return it->second;
+    }
+
+    // parcels without coefficients carry no load
+    Parcel parcel{0.0, 0.0};
+    auto phi = phi_dict.find(key);
+    if (phi != phi_dict.end() && static_cast<int>(phi->second.size()) > load_to_opt_) {
+        parcel.phi = phi->second[load_to_opt_];
+    }
+    auto parcel_amount = amount.find(key);
+    if (parcel_amount != amount.end()) {
+        parcel.amount = parcel_amount->second;
+    }
+
+    size_t idx = parcels_.size();
+    parcels_.push_back(parcel);
+    parcel_idx_[key] = idx;
+
+    std::vector<std::string> key_split;
+    misc_utilities::split_str(key, '_', key_split);
+    if (key_split.size() == 3) {
+        parcel_of_[{std::stoi(key_split[0]), std::stoi(key_split[1]), std::stoi(key_split[2]), 0}] = idx;
+    }
+    return idx;
+}
+
+double ModelEvaluator::compute_load(const EvaluationRequest& request) const {
+    return request.lc_x == nullptr ? base_load_ : compute_load(*request.lc_x);
+}
+
+double ModelEvaluator::compute_load(const LandRows& lc_x) const {
+    double load = base_load_;
+
+    struct EfficiencyRow {
+        size_t parcel;
+        double acres;
+        double eta;
+    };
+    std::unordered_map<size_t, double> amount_delta;
+    std::vector<EfficiencyRow> efficiency_rows;
+
+    for (const auto& [lrseg, agency, load_src, bmp, acres] : lc_x) {
+        auto conversion = conversions_.find({lrseg, agency, load_src, bmp});
+        if (conversion != conversions_.end()) {
+            amount_delta[conversion->second.from] -= acres;
+            amount_delta[conversion->second.to] += acres;
+            continue;
+        }
+        auto eta = efficiency_.find({lrseg, 0, load_src, bmp});
+        auto parcel = parcel_of_.find({lrseg, agency, load_src, 0});
+        if (eta != efficiency_.end() && parcel != parcel_of_.end()) {
+            efficiency_rows.push_back({parcel->second, acres, eta->second});
+        }
+    }
+
+    for (const auto& [parcel, delta] : amount_delta) {
+        load += parcels_[parcel].phi * delta;
+    }
+
+    auto converted_amount = [&](size_t parcel) {
+        auto delta = amount_delta.find(parcel);
+        return parcels_[parcel].amount + (delta != amount_delta.end() ? delta->second : 0.0);
+    };
+
+    // fraction of the load left on each parcel: prod(1 - eta * pct)
+    std::unordered_map<size_t, double> remaining;
+    for (const auto& row : efficiency_rows) {
+        double alpha = converted_amount(row.parcel);
+        if (alpha <= 0.0) {
+            continue;
+        }
+        auto [it, is_new] = remaining.try_emplace(row.parcel, 1.0);
+        it->second *= 1.0 - row.eta * std::min(1.0, row.acres / alpha);
+    }
+    for (const auto& [parcel, fraction] : remaining) {
+        load -= parcels_[parcel].phi * converted_amount(parcel) * (1.0 - fraction);
+    }
+    return load;
+}
+
+ModelEvaluator::LandRows ModelEvaluator::read_submitted_land(const std::string& filename, const LandRows& lc_x) {
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool()));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader));
+
+    // the new rows are the last ones, after the base rows of a full
+    // submission: only the row groups that hold them are read
+    auto n = static_cast<int64_t>(lc_x.size());
+    auto metadata = reader->parquet_reader()->metadata();
+    if (metadata->num_rows() < n) {
+        throw std::runtime_error(fmt::format("{} has {} rows, expected at least {}", filename, metadata->num_rows(), n));
+    }
+    std::vector<int> row_groups;
+    int64_t rows = 0;
+    for (int g = metadata->num_row_groups() - 1; g >= 0 && rows < n; --g) {
+        row_groups.insert(row_groups.begin(), g);
+        rows += metadata->RowGroup(g)->num_rows();
+    }
+
+    std::shared_ptr<arrow::Schema> schema;
+    PARQUET_THROW_NOT_OK(reader->GetSchema(&schema));
+    std::vector<int> columns;
+    for (const auto& name : {"AgencyId", "BmpId", "Amount"}) {
+        int idx = schema->GetFieldIndex(name);
+        if (idx == -1) {
+            throw std::runtime_error(fmt::format("{} column not found in {}", name, filename));
+        }
+        columns.push_back(idx);
+    }
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_THROW_NOT_OK(reader->ReadRowGroups(row_groups, columns, &table));
+    PARQUET_ASSIGN_OR_THROW(table, table->CombineChunks());
+    auto agency = std::static_pointer_cast<arrow::Int32Array>(table->column(0)->chunk(0));
+    auto bmp = std::static_pointer_cast<arrow::Int32Array>(table->column(1)->chunk(0));
+    auto amount = std::static_pointer_cast<arrow::DoubleArray>(table->column(2)->chunk(0));
+
+    LandRows submitted;
+    submitted.reserve(n);
+    int64_t first = table->num_rows() - n;
+    for (int64_t i = 0; i < n; ++i) {
+        const auto& [lrseg, agency_id, load_src, bmp_id, acres] = lc_x[i];
+        submitted.emplace_back(lrseg, agency->Value(first + i), load_src, bmp->Value(first + i), amount->Value(first + i));
+    }
+    return submitted;
+}
+
+std::vector<std::string> ModelEvaluator::evaluate(Scenario& scenario, const std::string&,
+                                                  const std::vector<EvaluationRequest>& requests) {
+    std::vector<std::string> results;
+    results.reserve(requests.size());
+    for (const auto& request : requests) {
+        if (request.land_file.empty() || request.lc_x == nullptr || request.lc_x->empty()) {
+            results.push_back(fmt::format("{}_{}", request.exec_uuid, compute_load(request)));
+            continue;
+        }
+        try {
+            auto submitted = read_submitted_land(scenario.submission_filename(request.land_file), *request.lc_x);
+            results.push_back(fmt::format("{}_{}", request.exec_uuid, compute_load(submitted)));
+        } catch (const std::exception& e) {
+            std::cerr << "Could not evaluate " << request.exec_uuid << ": " << e.what() << std::endl;
+        }
+    }
+    return results;
+}
+
+std::shared_ptr<Evaluator> make_evaluator(const std::string& name, const Scenario& scenario) {
+    if (name == "cast") {
+        return std::make_shared<AmqpEvaluator>();
+    }
+    if (name == "model") {
+        return std::make_shared<ModelEvaluator>(scenario);
+    }
+    throw std::invalid_argument(fmt::format("Unknown evaluator: {} (expected \"cast\" or \"model\")", name));
+}
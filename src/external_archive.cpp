@@ -1,5 +1,9 @@
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
 #include <external_archive.h>
 
 #include <range/v3/all.hpp>
@@ -110,35 +114,136 @@ void update_non_dominated_solutions(
     std::swap(archive_gx, new_archive_gx);
 }
 
-void update_non_dominated_solutions(
+bool update_non_dominated_solutions(
     std::vector<Particle>& archive, 
-    const Particle& new_solution_x)
+    const Particle& new_solution_x,
+    size_t capacity)
 {
-    std::vector<Particle> new_archive;
-
     bool new_solution_dominated = false;
+    const auto& new_solution_fx = new_solution_x.get_fx();
+    const auto& new_soulution_gx = new_solution_x.get_gx();
 
-    for (size_t i = 0; i < archive.size(); ++i) {
-        const auto& archive_fx = archive[i].get_fx();
-        const auto& archive_gx = archive[i].get_gx();
-        const auto& new_solution_fx = new_solution_x.get_fx();
-        const auto& new_soulution_gx = new_solution_x.get_gx();
+    // members dominated by the new solution are dropped in place; the others keep their order
+    auto kept_end = std::remove_if(archive.begin(), archive.end(), [&](const Particle& member) {
+        const auto& archive_fx = member.get_fx();
+        const auto& archive_gx = member.get_gx();
 
         if (is_dominated(archive_fx, new_solution_fx, archive_gx, new_soulution_gx)) {
-            continue;
+            return true;
         }
 
         if (is_dominated(new_solution_fx, archive_fx, new_soulution_gx, archive_gx) ||  new_solution_fx == archive_fx){
             new_solution_dominated = true;
         }
+        return false;
+    });
+    archive.erase(kept_end, archive.end());
 
-        new_archive.push_back(archive[i]);
+    if (new_solution_dominated) {
+        return false;
     }
+    archive.push_back(new_solution_x);
 
-    if (!new_solution_dominated) {
-        new_archive.push_back(new_solution_x);
+    if (capacity > 0 && archive.size() > capacity) {
+        // free a tenth of the capacity at once so the next insertions do not prune again
+        prune_by_crowding(archive, capacity - capacity / 10);
     }
-    std::swap( archive, new_archive);
+    return true;
 }
 
+void prune_by_crowding(std::vector<Particle>& archive, size_t target_size) {
+    size_t n = archive.size();
+    if (n <= target_size || n == 0) {
+        return;
+    }
+    size_t nobjs = archive[0].get_fx().size();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    // per objective, a doubly linked list of the members in ascending order
+    std::vector<std::vector<size_t>> prev(nobjs, std::vector<size_t>(n));
+    std::vector<std::vector<size_t>> next(nobjs, std::vector<size_t>(n));
+    std::vector<double> range(nobjs, 0.0);
+    const size_t none = n;
+    std::vector<size_t> order(n);
+    for (size_t m = 0; m < nobjs; ++m) {
+        for (size_t i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return archive[a].get_fx()[m] < archive[b].get_fx()[m];
+        });
+        for (size_t k = 0; k < n; ++k) {
+            prev[m][order[k]] = k > 0 ? order[k - 1] : none;
+            next[m][order[k]] = k + 1 < n ? order[k + 1] : none;
+        }
+        range[m] = archive[order.back()].get_fx()[m] - archive[order.front()].get_fx()[m];
+    }
 
+    auto distance = [&](size_t i) {
+        double d = 0.0;
+        for (size_t m = 0; m < nobjs; ++m) {
+            if (prev[m][i] == none || next[m][i] == none) {
+                return inf;
+            }
+            if (range[m] > 0.0) {
+                d += (archive[next[m][i]].get_fx()[m] - archive[prev[m][i]].get_fx()[m]) / range[m];
+            }
+        }
+        return d;
+    };
+
+    // min-heap on (distance, index); entries whose distance changed since they were pushed are skipped
+    using Entry = std::pair<double, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    std::vector<double> current(n);
+    for (size_t i = 0; i < n; ++i) {
+        current[i] = distance(i);
+        heap.push({current[i], i});
+    }
+
+    std::vector<bool> removed(n, false);
+    size_t size = n;
+    while (size > target_size && !heap.empty()) {
+        auto [d, i] = heap.top();
+        heap.pop();
+        if (removed[i] || d != current[i]) {
+            continue;
+        }
+        removed[i] = true;
+        --size;
+        for (size_t m = 0; m < nobjs; ++m) {
+            size_t p = prev[m][i];
+            size_t q = next[m][i];
+            if (p != none) {
+                next[m][p] = q;
+            }
+            if (q != none) {
+                prev[m][q] = p;
+            }
+        }
+        // only the neighbours' distances change
+        for (size_t m = 0; m < nobjs; ++m) {
+            for (size_t j : {prev[m][i], next[m][i]}) {
+                if (j != none && !removed[j]) {
+                    double updated = distance(j);
+                    if (updated != current[j]) {
+                        current[j] = updated;
+                        heap.push({updated, j});
+                    }
+                }
+            }
+        }
+    }
+
+    // compact by position: remove_if does not promise to visit each element once, in order
+    size_t out = 0;
+    for (size_t k = 0; k < archive.size(); ++k) {
+        if (!removed[k]) {
+            if (out != k) {
+                archive[out] = std::move(archive[k]);
+            }
+            ++out;
+        }
+    }
+    archive.resize(out);
+}
@@ -0,0 +1,250 @@
+// Created by: Gregorio Toscano
+
+#include "file_clone.h"
+
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include <fmt/core.h>
+
+namespace fs = std::filesystem;
+
+namespace file_clone {
+    namespace {
+        std::array<std::atomic<uint64_t>, nmethods> files_;
+        std::array<std::atomic<uint64_t>, nmethods> bytes_;
+        std::atomic<uint64_t> temp_counter_{0};
+
+        [[noreturn]] void fail(const char* what, const std::string& source, const std::string& destination, int err) {
+            throw fs::filesystem_error(what, source, destination, std::error_code(err, std::generic_category()));
+        }
+
+        // errors that mean the filesystem (or the pair of them) cannot do it
+        bool is_unsupported(int err) {
+            return err == EOPNOTSUPP || err == ENOTSUP || err == EXDEV || err == EINVAL || err == ENOSYS
+                   || err == ENOTTY || err == EPERM || err == EMLINK;
+        }
+
+        class Fd {
+        public:
+            explicit Fd(int fd) : fd_(fd) {}
+            ~Fd() {
+                if (fd_ >= 0) {
+                    ::close(fd_);
+                }
+            }
+            Fd(const Fd&) = delete;
+            Fd& operator=(const Fd&) = delete;
+            int get() const { return fd_; }
+        private:
+            int fd_;
+        };
+
+        std::string temp_name(const std::string& destination) {
+            return fmt::format("{}.clone-{}-{}", destination, ::getpid(), temp_counter_++);
+        }
+
+        bool reflink(int in, int out) {
+#ifdef FICLONE
+            if (::ioctl(out, FICLONE, in) == 0) {
+                return true;
+            }
+            if (is_unsupported(errno)) {
+                return false;
+            }
+            fail("file_clone: FICLONE", "", "", errno);
+#else
+            (void) in;
+            (void) out;
+            return false;
+#endif
+        }
+
+        bool kernel_copy(int in, int out, uint64_t size) {
+#ifdef __linux__
+            uint64_t copied = 0;
+            while (copied < size) {
+                auto n = ::copy_file_range(in, nullptr, out, nullptr, size - copied, 0);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (copied == 0 && is_unsupported(errno)) {
+                        return false;
+                    }
+                    fail("file_clone: copy_file_range", "", "", errno);
+                }
+                if (n == 0) {
+                    break;
+                }
+                copied += n;
+            }
+            return true;
+#else
+            (void) in;
+            (void) out;
+            (void) size;
+            return false;
+#endif
+        }
+
+        void byte_copy(int in, int out) {
+            std::vector<char> buffer(1 << 20);
+            for (;;) {
+                auto n = ::read(in, buffer.data(), buffer.size());
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    fail("file_clone: read", "", "", errno);
+                }
+                if (n == 0) {
+                    return;
+                }
+                for (ssize_t written = 0; written < n; ) {
+                    auto w = ::write(out, buffer.data() + written, n - written);
+                    if (w < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        fail("file_clone: write", "", "", errno);
+                    }
+                    written += w;
+                }
+            }
+        }
+
+        // Fills temp, which does not exist yet, with the given method.
+        bool clone_to(Method method, const std::string& source, const std::string& temp, uint64_t& size) {
+            if (method == Method::hardlink) {
+                if (::link(source.c_str(), temp.c_str()) != 0) {
+                    if (is_unsupported(errno)) {
+                        return false;
+                    }
+                    fail("file_clone: link", source, temp, errno);
+                }
+                size = fs::file_size(temp);
+                return true;
+            }
+
+            Fd in(::open(source.c_str(), O_RDONLY | O_CLOEXEC));
+            if (in.get() < 0) {
+                fail("file_clone: open", source, temp, errno);
+            }
+            struct stat st{};
+            if (::fstat(in.get(), &st) != 0) {
+                fail("file_clone: stat", source, temp, errno);
+            }
+            Fd out(::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777));
+            if (out.get() < 0) {
+                fail("file_clone: open", source, temp, errno);
+            }
+            size = st.st_size;
+            try {
+                switch (method) {
+                    case Method::reflink: return reflink(in.get(), out.get());
+                    case Method::kernel: return kernel_copy(in.get(), out.get(), size);
+                    case Method::copy: byte_copy(in.get(), out.get()); return true;
+                    case Method::hardlink: break;
+                }
+            } catch (const fs::filesystem_error& e) {
+                throw fs::filesystem_error(e.what(), source, temp, e.code());
+            }
+            return false;
+        }
+    }
+
+    const char* to_string(Method method) {
+        switch (method) {
+            case Method::reflink: return "reflink";
+            case Method::hardlink: return "hardlink";
+            case Method::kernel: return "kernel";
+            case Method::copy: return "copy";
+        }
+        return "unknown";
+    }
+
+    bool clone_with(Method method, const std::string& source, const std::string& destination) {
+        std::error_code ec;
+        if (method == Method::hardlink && fs::equivalent(source, destination, ec)) {
+            // renaming a link over another link to the same file does nothing
+            ++files_[static_cast<size_t>(method)];
+            bytes_[static_cast<size_t>(method)] += fs::file_size(source);
+            return true;
+        }
+
+        auto temp = temp_name(destination);
+        uint64_t size = 0;
+        bool done = false;
+        try {
+            done = clone_to(method, source, temp, size);
+        } catch (...) {
+            fs::remove(temp, ec);
+            throw;
+        }
+        if (!done) {
+            fs::remove(temp, ec);
+            return false;
+        }
+        if (::rename(temp.c_str(), destination.c_str()) != 0) {
+            int err = errno;
+            fs::remove(temp, ec);
+            fail("file_clone: rename", temp, destination, err);
+        }
+        ++files_[static_cast<size_t>(method)];
+        bytes_[static_cast<size_t>(method)] += size;
+        return true;
+    }
+
+    Method clone(const std::string& source, const std::string& destination, bool immutable) {
+        if (!fs::is_regular_file(source)) {
+            fail("file_clone: not a regular file", source, destination, ENOENT);
+        }
+        for (auto method : {Method::reflink, Method::hardlink, Method::kernel}) {
+            if ((method != Method::hardlink || immutable) && clone_with(method, source, destination)) {
+                return method;
+            }
+        }
+        clone_with(Method::copy, source, destination);
+        return Method::copy;
+    }
+
+    Stats stats() {
+        Stats s;
+        for (size_t i = 0; i < nmethods; ++i) {
+            s.files[i] = files_[i];
+            s.bytes[i] = bytes_[i];
+        }
+        return s;
+    }
+
+    void reset_stats() {
+        for (size_t i = 0; i < nmethods; ++i) {
+            files_[i] = 0;
+            bytes_[i] = 0;
+        }
+    }
+
+    void print_stats() {
+        auto s = stats();
+        std::string line;
+        for (size_t i = 0; i < nmethods; ++i) {
+            if (s.files[i] > 0) {
+                line += fmt::format("{}{} {} ({:.1f} MB)", line.empty() ? "" : ", ", s.files[i],
+                                    to_string(static_cast<Method>(i)), s.bytes[i] / 1e6);
+            }
+        }
+        fmt::print("file clones: {}\n", line.empty() ? "none" : line);
+    }
+}
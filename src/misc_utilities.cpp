@@ -1,6 +1,7 @@
 //
 // Created by Gregorio Toscano on 4/1/23.
 //
+#include <cstring>
 #include <tuple>
 #include <filesystem>
 #include <iostream>
@@ -8,7 +9,7 @@
 #include <vector>
 #include <chrono>
 #include <ctime>
-#include <random>
+#include <atomic>
 #include <fstream>
 #include <nlohmann/json.hpp>
 #include <unordered_map>
@@ -21,7 +22,13 @@
 #include <arrow/io/api.h>
 #include <arrow/compute/api_aggregate.h>
 #include <parquet/arrow/reader.h>
+#include <parquet/file_reader.h>
+#include <parquet/metadata.h>
+#include <arrow/util/key_value_metadata.h>
 #include <memory>
+
+#include "file_clone.h"
+#include "rng.h"
 using json = nlohmann::json;
 
 namespace fs = std::filesystem;
@@ -85,8 +92,12 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
         
         return new_filename;
     }
+    const std::vector<std::string>& solution_file_suffixes() {
+        static const std::vector<std::string> suffixes = {"_impbmpsubmittedland.json", "_impbmpsubmittedland.parquet", "_impbmpsubmittedland_new_bmps.parquet",  "_impbmpsubmittedanimal.json", "_impbmpsubmittedanimal.parquet", "_impbmpsubmittedmanuretransport.json", "_impbmpsubmittedmanuretransport.parquet", "_reportloads.csv", "_reportloads.parquet", "_costs.json", ".csv"};
+        return suffixes;
+    }
     void move_files(const std::string& source_dir, const std::string& destination_dir, int n_sols, int delta_counter) {
-        std::vector<std::string> source_files = {"_impbmpsubmittedland.json", "_impbmpsubmittedland.parquet", "_impbmpsubmittedanimal.json", "_impbmpsubmittedanimal.parquet", "_impbmpsubmittedmanuretransport.json", "_impbmpsubmittedmanuretransport.parquet", "_reportloads.csv", "_reportloads.parquet", "_costs.json", ".csv", "_impbmpsubmittedland_new_bmps.parquet"};
+        const auto& source_files = solution_file_suffixes();
         try {
             // Create the destination directory if it doesn't exist
             if (!fs::exists(destination_dir)) {
@@ -113,7 +124,7 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
     }
 
     void move_pf(const std::string& source_dir, const std::string& destination_dir, std::vector<std::string> pf_files) {
-        std::vector<std::string> source_files = {"_impbmpsubmittedland.json", "_impbmpsubmittedland.parquet", "_impbmpsubmittedland_new_bmps.parquet",  "_impbmpsubmittedanimal.json", "_impbmpsubmittedanimal.parquet", "_impbmpsubmittedmanuretransport.json", "_impbmpsubmittedmanuretransport.parquet", "_reportloads.csv", "_reportloads.parquet", "_costs.json", ".csv"};
+        const auto& source_files = solution_file_suffixes();
         try {
             // Create the destination directory if it doesn't exist
             if (!fs::exists(destination_dir)) {
@@ -212,6 +223,40 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
         PARQUET_THROW_NOT_OK(parquet::arrow::WriteTable(*combined_table, arrow::default_memory_pool(), outfile, 1024, props));
     }
 
+    bool materialize_submission(const std::string& delta_file, const std::string& output_file) {
+        if (fs::exists(output_file)) {
+            return true;
+        }
+        if (!fs::exists(delta_file)) {
+            std::cerr << "Delta submission not found: " << delta_file << std::endl;
+            return false;
+        }
+
+        std::string base_file;
+        {
+            auto reader = parquet::ParquetFileReader::OpenFile(delta_file);
+            auto metadata = reader->metadata()->key_value_metadata();
+            if (metadata) {
+                auto found = metadata->Get("base_file");
+                if (found.ok()) {
+                    base_file = *found;
+                }
+            }
+        }
+        if (base_file.empty()) {
+            std::cerr << "Delta submission without base_file: " << delta_file << std::endl;
+            return false;
+        }
+
+        try {
+            merge_parquet_files(base_file, delta_file, output_file);
+        } catch (const std::exception& e) {
+            std::cerr << "Error materializing " << output_file << ": " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     bool is_parquet_file(const std::string& filename) {
         std::ifstream file(filename, std::ios::binary);
     
@@ -298,7 +343,15 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
             }
     
             // Copy the entire directory
-            fs::copy(source, destination, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+            for (const auto& entry : fs::recursive_directory_iterator(source)) {
+                auto to = fs::path(destination) / fs::relative(entry.path(), source);
+                if (entry.is_directory()) {
+                    fs::create_directories(to);
+                }
+                else if (entry.is_regular_file()) {
+                    file_clone::clone(entry.path().string(), to.string());
+                }
+            }
             
             return true;
         } catch (const std::exception& ex) {
@@ -307,7 +360,7 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
         }
     }
 
-    bool copy_file(const std::string& source, const std::string& destination) {
+    bool copy_file(const std::string& source, const std::string& destination, bool immutable) {
         try {
             // Check if the source file exists
             std::cout << "source: " << source << std::endl;
@@ -317,7 +370,7 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
             }
 
             // Copy the file to the destination
-            fs::copy_file(source, destination, fs::copy_options::overwrite_existing);
+            file_clone::clone(source, destination, immutable);
             return true;
         } catch (const std::exception& ex) {
             std::cerr << "Error: " << ex.what() << std::endl;
@@ -334,7 +387,7 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
                     
                     // Convert the path components to strings before formatting
                     std::string dest_file = fmt::format("{}/{}", destination, entry.path().filename().string());
-                    fs::copy_file(entry.path(), dest_file, fs::copy_options::overwrite_existing);
+                    file_clone::clone(entry.path().string(), dest_file);
                 }
             }
         } catch (const std::exception& ex) {
@@ -361,7 +414,7 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
                     std::string dest_file = fmt::format("{}/{}{}", destination, new_filename, entry.path().extension().string());
     
                     // Copy the file to the destination with the new name
-                    fs::copy_file(entry.path(), dest_file, fs::copy_options::overwrite_existing);
+                    file_clone::clone(entry.path().string(), dest_file);
                 }
             }
             return true;
@@ -370,6 +423,46 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
             return false;
         }
     }
+    // 64-bit finalizer of MurmurHash3
+    uint64_t mix64(uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // word at a time
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t seed) {
+        const char* bytes = static_cast<const char*>(data);
+        uint64_t h = seed ^ mix64(size);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            h = (h ^ mix64(word)) * 0x9e3779b97f4a7c15ULL;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, bytes + i, size - i);
+        return mix64(h ^ mix64(tail));
+    }
+
+    uint64_t hash_file(const std::string& filename, uint64_t seed) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open the file: " << filename << std::endl;
+            exit(-1);
+        }
+        std::vector<char> buffer(1 << 22);
+        uint64_t h = mix64(seed);
+        while (file) {
+            file.read(buffer.data(), buffer.size());
+            h = hash_bytes(buffer.data(), file.gcount(), h);
+        }
+        return h;
+    }
+
     std::string current_time() {
         // Get the current time
         auto now = std::chrono::system_clock::now();
@@ -384,11 +477,12 @@ std::unordered_map<std::string, double> read_loads(std::string loads_filename) {
         return oss.str();
     }
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0, 1);
+    // every call takes the next position of one shared stream: lock-free,
+    // and reproducible for a given run seed when called from one thread
+    std::atomic<uint64_t> rand_position{0};
     double rand_double(double lower_bound, double upper_bound) {
-        return lower_bound + dis(gen) * (upper_bound - lower_bound);
+        rng::Stream stream(rng::run_seed(), rng::Domain::shared, 0, 0);
+        return lower_bound + stream.uniform2(rand_position++)[0] * (upper_bound - lower_bound);
     }
 
     void mkdir(std::string dir_path) {
@@ -0,0 +1,285 @@
+// Created by: Gregorio Toscano
+
+#include "pareto_front.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <numeric>
+
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+
+using json = nlohmann::json;
+
+namespace {
+    // Feasible records of a 2-objective front: sorted by (objective1, objective2),
+    // a record is dominated unless it has the lowest objective2 of its objective1
+    // group and that is strictly below every objective2 of a lower objective1.
+    void mark_front_2d(const std::vector<CostData>& data, std::vector<size_t>& idx, std::vector<char>& on_front) {
+        std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b) {
+            if (data[a].objective1 != data[b].objective1) {
+                return data[a].objective1 < data[b].objective1;
+            }
+            return data[a].objective2 < data[b].objective2;
+        });
+        double best = std::numeric_limits<double>::infinity();
+        bool has_best = false;
+        for (size_t k = 0; k < idx.size();) {
+            double obj1 = data[idx[k]].objective1;
+            double group_min = data[idx[k]].objective2;
+            size_t end = k;
+            for (; end < idx.size() && data[idx[end]].objective1 == obj1; ++end) {
+                if (data[idx[end]].objective2 == group_min && (!has_best || group_min < best)) {
+                    on_front[idx[end]] = true;
+                }
+            }
+            if (!has_best || group_min < best) {
+                best = group_min;
+                has_best = true;
+            }
+            k = end;
+        }
+    }
+
+    // Feasible records of a 3-objective front: every dominator of a record
+    // sorts before it lexicographically, so sweeping in that order only asks
+    // whether an earlier record is no worse in objective2 and objective3. The
+    // earlier records are kept as their (objective2, objective3) staircase,
+    // objective3 decreasing as objective2 grows.
+    void mark_front_3d(const std::vector<CostData>& data, std::vector<size_t>& idx, std::vector<char>& on_front) {
+        auto key = [&](size_t i) {
+            return std::make_tuple(data[i].objective1, data[i].objective2, data[i].objective3.value());
+        };
+        std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b) {
+            return key(a) < key(b);
+        });
+        std::map<double, double> staircase;
+        for (size_t k = 0; k < idx.size();) {
+            // equal records do not dominate each other and share their fate
+            size_t end = k + 1;
+            while (end < idx.size() && key(idx[end]) == key(idx[k])) {
+                ++end;
+            }
+            double obj2 = data[idx[k]].objective2;
+            double obj3 = data[idx[k]].objective3.value();
+            auto it = staircase.upper_bound(obj2);
+            bool dominated = it != staircase.begin() && std::prev(it)->second <= obj3;
+            if (!dominated) {
+                for (size_t j = k; j < end; ++j) {
+                    on_front[idx[j]] = true;
+                }
+                it = staircase.lower_bound(obj2);
+                while (it != staircase.end() && it->second >= obj3) {
+                    it = staircase.erase(it);
+                }
+                staircase.emplace(obj2, obj3);
+            }
+            k = end;
+        }
+    }
+}
+
+/***************************************************************************/
+// Function to check if one solution dominates another
+bool dominates(const CostData& a, const CostData& b, int num_objectives, double max_budget) {
+   /*
+    Determines Pareto dominance for minimization with a budget limit.
+
+    Logic
+    First check feasibility with respect to the budget
+    If a is within budget and b is not, a dominates
+    If b is within budget and a is not, a does not dominate
+    If both exceed the budget, prefer the one with lower cost
+
+    If both are within budget, apply standard Pareto dominance
+    For two objectives, a must be no worse in both objectives and strictly better in at least one
+    For three objectives, same rule across all three and requires that both a and b have objective3 set
+
+    If the requested objective count is not supported or a third objective is missing when required, return false
+    */
+
+    if(a.objective1<=max_budget && b.objective1>max_budget){
+        return true;
+    }
+    if(a.objective1>max_budget && b.objective1<=max_budget){
+        return false;
+    }
+    if(a.objective1>max_budget && b.objective1>max_budget){
+        if(a.objective1<b.objective1){
+            return true;
+        }
+        else{
+            return false;
+        }
+    }
+    if (num_objectives == 2) {
+        return (a.objective1 <= b.objective1 && a.objective2 <= b.objective2) &&
+               (a.objective1 < b.objective1 || a.objective2 < b.objective2);
+    } else if (num_objectives == 3 && a.objective3.has_value() && b.objective3.has_value()) {
+        return (a.objective1 <= b.objective1 && a.objective2 <= b.objective2 && a.objective3.value() <= b.objective3.value()) &&
+               (a.objective1 < b.objective1 || a.objective2 < b.objective2 || a.objective3.value() < b.objective3.value());
+    }
+    return false;
+}
+
+std::vector<std::string> find_pareto_front(const std::vector<CostData>& data, int num_objectives,double max_budget) {
+    /*
+        Find the non-domintated soulutions.
+
+        Follows dominates() case by case:
+        - a record over the budget is dominated by any record within it, and
+          otherwise by every record over the budget with a lower cost, so it
+          is on the front only when nothing is within the budget and its cost
+          is the lowest.
+        - records within the budget are only dominated by each other, through
+          the 2- or 3-objective sort-based sweeps.
+        - comparisons with NaN are false, so a record with a NaN objective
+          that dominates() reads, or without the third objective, neither
+          dominates nor is dominated by the records it is compared with.
+    */
+    if (std::isnan(max_budget)) {
+        // every budget comparison is false, as against an infinite budget
+        max_budget = std::numeric_limits<double>::infinity();
+    }
+    std::vector<char> on_front(data.size(), false);
+    std::vector<size_t> feasible;
+    bool any_feasible = false;
+    double min_infeasible = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < data.size(); ++i) {
+        const auto& record = data[i];
+        if (record.objective1 <= max_budget) {
+            any_feasible = true;
+            bool comparable = (num_objectives == 2 && !std::isnan(record.objective2))
+                || (num_objectives == 3 && record.objective3.has_value()
+                    && !std::isnan(record.objective2) && !std::isnan(record.objective3.value()));
+            if (comparable) {
+                feasible.push_back(i);
+            }
+            else {
+                on_front[i] = true;
+            }
+        }
+        else if (record.objective1 > max_budget) {
+            min_infeasible = std::min(min_infeasible, record.objective1);
+        }
+        else {
+            // NaN cost
+            on_front[i] = true;
+        }
+    }
+
+    if (num_objectives == 2) {
+        mark_front_2d(data, feasible, on_front);
+    } else if (num_objectives == 3) {
+        mark_front_3d(data, feasible, on_front);
+    }
+    if (!any_feasible) {
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (data[i].objective1 > max_budget && data[i].objective1 == min_infeasible) {
+                on_front[i] = true;
+            }
+        }
+    }
+
+    std::vector<std::string> pareto_front;
+    for (size_t i = 0; i < data.size(); ++i) {
+        if (on_front[i]) {
+            pareto_front.push_back(data[i].file_index);
+        }
+    }
+    return pareto_front;
+}
+
+void for_each_cost_record(const std::vector<std::string>& objs, const std::string& directory,
+                          const std::function<void(CostData&&)>& visit) {
+   /**
+    * @brief Reads cost data from JSON files in a specified directory, one file at a time.
+    *
+    * @param objs A vector of objective names (must contain at least two,
+    *            optionally three, corresponding to JSON keys).
+    * @param directory Path to the directory containing cost JSON files.
+    * @param visit Called with a CostData populated with the objective values
+    *            and the file index (derived from the filename prefix before
+    *            the first underscore).
+    *
+    */
+    int num_objectives = objs.size();
+
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        std::string filename = entry.path().filename().string();
+        if (filename.ends_with("_costs.json")) {
+            std::ifstream file(entry.path());
+            json j;
+            file >> j;
+
+            CostData cost_data;
+            cost_data.objective1 = j[objs[0]];
+            cost_data.objective2 = j[objs[1]];
+            if (num_objectives == 3) {
+                cost_data.objective3 = j[objs[2]];
+            } else {
+                cost_data.objective3 = std::nullopt;
+            }
+
+            // Extract and store everything before the first underscore
+            cost_data.file_index = filename.substr(0, filename.find('_'));
+
+            visit(std::move(cost_data));
+        }
+    }
+}
+
+std::vector<CostData> readCostFiles(const std::vector<std::string>& objs, const std::string& directory) {
+   /**
+    * @brief Reads cost data from JSON files in a specified directory.
+    *
+    * @return A vector of CostData objects, see for_each_cost_record.
+    */
+    std::vector<CostData> data;
+    for_each_cost_record(objs, directory, [&](CostData&& cost_data) {
+        data.push_back(std::move(cost_data));
+    });
+    return data;
+}
+
+
+std::vector<std::string> findParetoFrontFiles(const std::vector<std::string>& objs, const std::string& directory, double max_budget) {
+    /**
+    * @brief Identifies Pareto front files from a set of cost JSON files.
+    *
+    * The files are streamed. Once a record within the budget has been read,
+    * records over the budget are dropped as they arrive, and before that only
+    * those that tie or beat the lowest cost over the budget so far are kept:
+    * none of the others can be on the front or matter to the records that are.
+    *
+    * @param objs A vector of objective names (must contain at least two,
+    *             optionally three, corresponding to JSON keys).
+    * @param directory Path to the directory containing cost JSON files.
+    * @param max_budget Maximum budget constraint; solutions exceeding this
+    *                   budget are excluded from the Pareto front.
+    *
+    * @return A vector of filenames (as strings) that lie on the Pareto front.
+    */
+    int num_objectives = objs.size();
+    std::vector<CostData> data;
+    bool any_feasible = false;
+    double min_infeasible = std::numeric_limits<double>::infinity();
+    for_each_cost_record(objs, directory, [&](CostData&& cost_data) {
+        if (cost_data.objective1 > max_budget) {
+            if (any_feasible || cost_data.objective1 > min_infeasible) {
+                return;
+            }
+            min_infeasible = cost_data.objective1;
+        }
+        else if (cost_data.objective1 <= max_budget) {
+            any_feasible = true;
+        }
+        data.push_back(std::move(cost_data));
+    });
+    return find_pareto_front(data, num_objectives, max_budget);
+}
@@ -1,6 +1,6 @@
 #include <vector>
 #include <iostream>
-#include <random>
+#include <atomic>
 #include <algorithm>
 #include <crossguid/guid.hpp>
 #include <fmt/core.h>
@@ -13,12 +13,8 @@
 using json = nlohmann::json;
 
 namespace {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0, 1);
-    double rand_double(double lower_bound, double upper_bound) {
-        return lower_bound + dis(gen) * (upper_bound - lower_bound);
-    }
+    // Particles get their streams in construction order
+    std::atomic<uint32_t> next_stream{0};
 }
 
 
@@ -34,14 +30,17 @@ Particle::Particle(int dim, int nobjs, double w, double c1, double c2, double lb
     this->x = std::vector<double>(dim);
     this->v = std::vector<double>(dim);
     this->fx = std::vector<double>(nobjs);
+    this->gx_ = 0.0;
     this->pbest_x = std::vector<double>(dim);
     this->pbest_fx = std::vector<double>(nobjs);
+    this->pbest_gx_ = 0.0;
     this->lower_bound = lb; 
     this->upper_bound = ub; 
     this->uuid_ = xg::newGuid().str();
     this->lc_cost_ = 0.0; 
     this->animal_cost_ = 0.0;
     this->manure_cost_ = 0.0;
+    this->rng_ = rng::Stream(rng::run_seed(), rng::Domain::particle, next_stream++, 0);
 }
 
 
@@ -55,8 +54,10 @@ Particle::Particle(const Particle &p) {
     this->x = p.x;
     this->v = p.v;
     this->fx = p.fx;
+    this->gx_ = p.gx_;
     this->pbest_x = p.pbest_x;
     this->pbest_fx = p.pbest_fx;
+    this->pbest_gx_ = p.pbest_gx_;
     this->lower_bound = p.lower_bound;
     this->upper_bound = p.upper_bound;
     this->uuid_ = p.uuid_;
@@ -66,8 +67,7 @@ Particle::Particle(const Particle &p) {
     this->lc_cost_ = p.lc_cost_; 
     this->animal_cost_ = p.animal_cost_; 
     this->manure_cost_ = p.manure_cost_; 
-    this->amount_plus_ = p.amount_plus_;
-    this->amount_minus_ = p.amount_minus_;
+    this->rng_ = p.rng_;
 }
 
 Particle& Particle::operator=(const Particle &p) {
@@ -82,9 +82,11 @@ Particle& Particle::operator=(const Particle &p) {
     this->c2 = p.c2;
     this->x = p.x;
     this->fx = p.fx;
+    this->gx_ = p.gx_;
     this->v = p.v;
     this->pbest_x = p.pbest_x;
     this->pbest_fx = p.pbest_fx;
+    this->pbest_gx_ = p.pbest_gx_;
     this->lower_bound = p.lower_bound;
     this->upper_bound = p.upper_bound;
     this->uuid_ = p.uuid_;
@@ -94,8 +96,7 @@ Particle& Particle::operator=(const Particle &p) {
     this->lc_cost_ = p.lc_cost_; 
     this->animal_cost_ = p.animal_cost_; 
     this->manure_cost_ = p.manure_cost_; 
-    this->amount_plus_ = p.amount_plus_;
-    this->amount_minus_ = p.amount_minus_;
+    this->rng_ = p.rng_;
     return *this;
 }
 
@@ -103,7 +104,7 @@ Particle& Particle::operator=(const Particle &p) {
 void Particle::init() {
 
     for (int i = 0; i < dim; i++) {
-        x[i] = rand_double(lower_bound, upper_bound);
+        x[i] = rng_.uniform(lower_bound, upper_bound);
         v[i] = 0.0; 
     }
 
@@ -135,8 +136,8 @@ void Particle::update(const std::vector<double> &gbest_x) {
     for (int i = 0; i < dim; i++) {
         // update velocity
         double inertia = w * v[i];
-        double cognitive = c1 * rand_double(0.0, 1.0) * (pbest_x[i] - x[i]);
-        double social = c2 * rand_double(0.0, 1.0) * (gbest_x[i] - x[i]);
+        double cognitive = c1 * rng_.uniform() * (pbest_x[i] - x[i]);
+        double social = c2 * rng_.uniform() * (gbest_x[i] - x[i]);
         //v[i] = w * v[i] + c1 * rand_double(0, 1) * (pbest_x[i] - x[i]) + c2 * rand_double(0, 1) * (gbest_x[i] - x[i]);
         v[i] = inertia + cognitive + social;
 
@@ -156,23 +157,14 @@ void Particle::update(const std::vector<double> &gbest_x) {
 }
 
 
-void Particle::store_amount_plus_minus(const std::string& filename) {
-
-    json json_obj;// = json::object();
-    json_obj["plus"] = amount_plus_; 
-    json_obj["minus"] = amount_minus_;
-
-    std::ofstream file(filename);
-    file<<json_obj.dump();
-    file.close();
-}
-
-void Particle::update_pbest() {
+bool Particle::update_pbest() {
     if (is_dominated(pbest_fx, fx, pbest_gx_, gx_) || !is_dominated(fx, pbest_fx, gx_, pbest_gx_)) {
         pbest_x = x;
         pbest_fx = fx;
         pbest_gx_ = gx_; 
+        return true;
     }
+    return false;
 }
 
 
@@ -16,15 +16,22 @@
 
 #include <range/v3/all.hpp>
 
+#include "evaluation_cache.h"
 #include "external_archive.h"
+#include "file_clone.h"
 #include "particle.h"
 #include "pso.h"
+#include "rng.h"
 #include "scenario.h"
 #include "misc_utilities.h"
+#include "thread_pool.h"
 
 #include <crossguid/guid.hpp>
 #include <fmt/core.h>
 #include <regex>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <filesystem>
 #include <boost/algorithm/string.hpp>
 #include <optional>
@@ -58,142 +65,6 @@ namespace fs = std::filesystem;
 using json = nlohmann::json;
 
 /***************************************************************************/
-struct CostData {
-    double objective1;
-    double objective2;
-    std::optional<double> objective3; // Optional third objective
-    std::string file_index;
-};
-
-// Function to check if one solution dominates another
-bool dominates(const CostData& a, const CostData& b, int num_objectives, double max_budget) {
-   /* 
-    Determines Pareto dominance for minimization with a budget limit.
-
-    Logic
-    First check feasibility with respect to the budget
-    If a is within budget and b is not, a dominates
-    If b is within budget and a is not, a does not dominate
-    If both exceed the budget, prefer the one with lower cost
-
-    If both are within budget, apply standard Pareto dominance
-    For two objectives, a must be no worse in both objectives and strictly better in at least one
-    For three objectives, same rule across all three and requires that both a and b have objective3 set
-
-    If the requested objective count is not supported or a third objective is missing when required, return false
-    */
-
-    if(a.objective1<=max_budget && b.objective1>max_budget){
-        return true;
-    }
-    if(a.objective1>max_budget && b.objective1<=max_budget){
-        return false;
-    }
-    if(a.objective1>max_budget && b.objective1>max_budget){
-        if(a.objective1<b.objective1){
-            return true;
-        }
-        else{
-            return false;
-        }
-    } 
-    if (num_objectives == 2) {
-        return (a.objective1 <= b.objective1 && a.objective2 <= b.objective2) &&
-               (a.objective1 < b.objective1 || a.objective2 < b.objective2);
-    } else if (num_objectives == 3 && a.objective3.has_value() && b.objective3.has_value()) {
-        return (a.objective1 <= b.objective1 && a.objective2 <= b.objective2 && a.objective3.value() <= b.objective3.value()) &&
-               (a.objective1 < b.objective1 || a.objective2 < b.objective2 || a.objective3.value() < b.objective3.value());
-    }
-    return false;
-}
-
-std::vector<std::string> find_pareto_front(const std::vector<CostData>& data, int num_objectives,double max_budget) {
-    /*
-        Find the non-domintated soulutions 
-    */
-    std::vector<std::string> pareto_front;
-
-    for (const auto& current : data) {
-        bool is_dominated = false;
-
-        for (const auto& other : data) {
-            std::cout << "Current Cost: " << current.objective1 << ", Other Cost: " << other.objective1 <<std::endl;
-            std::cout << "Results: " <<  dominates(other, current, num_objectives, max_budget) << std::endl;
-            if (dominates(other, current, num_objectives, max_budget)) {
-                is_dominated = true;
-                break;
-            }
-        }
-
-        if (!is_dominated) {
-            pareto_front.push_back(current.file_index);
-        }
-    }
-
-    return pareto_front;
-}
-
-std::vector<CostData> readCostFiles(const std::vector<std::string>& objs, const std::string& directory) {
-   /**
-    * @brief Reads cost data from JSON files in a specified directory.
-    *
-    * @param objs A vector of objective names (must contain at least two, 
-    *            optionally three, corresponding to JSON keys).
-    * @param directory Path to the directory containing cost JSON files.
-    *
-    * @return A vector of CostData objects populated with objective values 
-    *         and the file index (derived from the filename prefix before 
-    *         the first underscore).
-    *
-    */
-    std::vector<CostData> data;
-    int num_objectives = objs.size();
-
-    for (const auto& entry : fs::directory_iterator(directory)) {
-        std::string filename = entry.path().filename().string();
-        if (filename.ends_with("_costs.json")) {
-            std::ifstream file(entry.path());
-            json j;
-            file >> j;
-
-            CostData cost_data;
-            cost_data.objective1 = j[objs[0]];
-            cost_data.objective2 = j[objs[1]];
-            if (num_objectives == 3) {
-                cost_data.objective3 = j[objs[2]];
-            } else {
-                cost_data.objective3 = std::nullopt;
-            }
-
-            // Extract and store everything before the first underscore
-            cost_data.file_index = filename.substr(0, filename.find('_'));
-
-            data.push_back(cost_data);
-        }
-    }
-
-    return data;
-}
-
-
-std::vector<std::string> findParetoFrontFiles(const std::vector<std::string>& objs, const std::string& directory, double max_budget) {
-    /**
-    * @brief Identifies Pareto front files from a set of cost JSON files.
-    *
-    * @param objs A vector of objective names (must contain at least two, 
-    *             optionally three, corresponding to JSON keys).
-    * @param directory Path to the directory containing cost JSON files.
-    * @param max_budget Maximum budget constraint; solutions exceeding this 
-    *                   budget are excluded from the Pareto front.
-    *
-    * @return A vector of filenames (as strings) that lie on the Pareto front.
-    */
-    int num_objectives = objs.size();
-    std::vector<CostData> data;
-    data = readCostFiles(objs, directory);
-    return find_pareto_front(data, num_objectives, max_budget);
-}
-
 void writeCSV(const std::vector<CostData>& data, const std::string& output_file, const std::vector<std::string>& objs) {
     /**
         @brief Write objective values to a CSV file sorted by file_index
@@ -239,9 +110,6 @@ void writeCSV(const std::vector<CostData>& data, const std::string& output_file,
 
 
 namespace {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-
     std::string replace_ending(const std::string& str, const std::string& oldEnding, const std::string& newEnding) {
         if (str.ends_with(oldEnding)) {
             return str.substr(0, str.size() - oldEnding.size()) + newEnding;
@@ -407,292 +275,6 @@ namespace {
 }
 
 
-std::vector<BmpRowLand> read_parquet_file_land(const std::string& file_name) {
-    /**
-    @brief Load BmpRowLand rows from a Parquet file using Apache Arrow 
-    @param file_name path to the Parquet file to read
-    @return std::vector<BmpRowLand> one element per row in the file
-    */
-
-  // 1) Open file
-  arrow::MemoryPool* pool = arrow::default_memory_pool();
-  std::shared_ptr<arrow::io::ReadableFile> infile;
-  PARQUET_ASSIGN_OR_THROW(
-    infile,
-    arrow::io::ReadableFile::Open(file_name, pool)
-  );
-
-  // 2) Open Parquet reader
-  std::unique_ptr<parquet::arrow::FileReader> reader;
-  PARQUET_THROW_NOT_OK(
-    parquet::arrow::OpenFile(infile, pool, &reader)
-  );
-
-  // 3) Read entire file into a Table
-  std::shared_ptr<arrow::Table> table;
-  PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
-  const int64_t num_rows = table->num_rows();
-  if (num_rows == 0) return {};
-
-  // Helper to get a single (possibly concatenated) Array by column name
-  auto get_array = [&](const std::string& name) -> std::shared_ptr<arrow::Array> {
-    int idx = table->schema()->GetFieldIndex(name);
-    if (idx < 0) throw std::runtime_error("Column not found: " + name);
-    auto col = table->column(idx);
-    if (col->num_chunks() == 1) {
-      return col->chunk(0);
-    } else {
-      std::shared_ptr<arrow::Array> concatenated;
-      PARQUET_ASSIGN_OR_THROW(
-        concatenated,
-        arrow::Concatenate(col->chunks(), pool)
-      );
-      return concatenated;
-    }
-  };
-
-  // 4) Extract each column
-  auto arr0  = get_array("BmpSubmittedId");
-  auto arr1  = get_array("AgencyId");
-  auto arr2  = get_array("StateUniqueIdentifier");
-  auto arr3  = get_array("StateId");
-  auto arr4  = get_array("BmpId");
-  auto arr5  = get_array("GeographyId");
-  auto arr6  = get_array("LoadSourceGroupId");
-  auto arr7  = get_array("UnitId");
-  auto arr8  = get_array("Amount");
-  auto arr9  = get_array("IsValid");
-  auto arr10 = get_array("ErrorMessage");
-  auto arr11 = get_array("RowIndex");
-
-  // 5) Cast to the right Array types
-  auto col0  = std::static_pointer_cast<arrow::Int32Array>(arr0);
-  auto col1  = std::static_pointer_cast<arrow::Int32Array>(arr1);
-  auto col2  = std::static_pointer_cast<arrow::StringArray>(arr2);
-  auto col3  = std::static_pointer_cast<arrow::Int32Array>(arr3);
-  auto col4  = std::static_pointer_cast<arrow::Int32Array>(arr4);
-  auto col5  = std::static_pointer_cast<arrow::Int32Array>(arr5);
-  auto col6  = std::static_pointer_cast<arrow::Int32Array>(arr6);
-  auto col7  = std::static_pointer_cast<arrow::Int32Array>(arr7);
-  auto col8  = std::static_pointer_cast<arrow::DoubleArray>(arr8);
-  auto col9  = std::static_pointer_cast<arrow::BooleanArray>(arr9);
-  auto col10 = std::static_pointer_cast<arrow::StringArray>(arr10);
-  auto col11 = std::static_pointer_cast<arrow::Int32Array>(arr11);
-
-  // 6) Pull out each row into your vector
-  std::vector<BmpRowLand> result;
-  result.reserve(num_rows);
-  for (int64_t i = 0; i < num_rows; ++i) {
-    BmpRowLand row;
-    row.BmpSubmittedId       = col0->Value(i);
-    row.AgencyId             = col1->Value(i);
-    row.StateUniqueIdentifier = col2->GetString(i);
-    row.StateId              = col3->Value(i);
-    row.BmpId                = col4->Value(i);
-    row.GeographyId          = col5->Value(i);
-    row.LoadSourceGroupId    = col6->Value(i);
-    row.UnitId               = col7->Value(i);
-    row.Amount               = col8->Value(i);
-    row.IsValid              = col9->Value(i);
-    // handle nullable ErrorMessage
-    row.ErrorMessage         = col10->IsNull(i) 
-                               ? std::string("") 
-                               : col10->GetString(i);
-    row.RowIndex             = col11->Value(i);
-    result.push_back(std::move(row));
-  }
-
-  return result;
-}
-
-std::vector<BmpRowAnimal> read_parquet_file_animal(const std::string& file_name) {
-    /** 
-        @brief Load BmpRowAnimal rows from a Parquet file using Apache Arrow 
-        @param file_name path to the Parquet file to read
-        @return std::vector<BmpRowAnimal> one element per row in the file
-    */
-    std::cout << "file_name: " << file_name << std::endl;
-    using arrow::default_memory_pool;
-    using parquet::arrow::FileReader;
-
-    // --- (open file, open reader, read table) ---
-    std::shared_ptr<arrow::io::ReadableFile> infile;
-    PARQUET_ASSIGN_OR_THROW(
-      infile,
-      arrow::io::ReadableFile::Open(file_name, default_memory_pool())
-    );
-
-    std::unique_ptr<FileReader> reader;
-    PARQUET_THROW_NOT_OK(
-      parquet::arrow::OpenFile(infile, default_memory_pool(), &reader)
-    );
-
-    std::shared_ptr<arrow::Table> table;
-    PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
-    int64_t nrows = table->num_rows();
-    if (nrows == 0) return {};
-
-    // Helper: concatenate all chunks of column idx
-    auto concat_column = [&](int idx) {
-      auto col = table->column(idx);
-      if (col->num_chunks() == 1) return col->chunk(0);
-      std::shared_ptr<arrow::Array> all;
-      PARQUET_ASSIGN_OR_THROW(
-        all,
-        arrow::Concatenate(col->chunks(), default_memory_pool())
-      );
-      return all;
-    };
-
-    // 3) Cast each column once:
-    auto arr0  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(0));
-    auto arr1  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(1));
-    auto arr2  = std::static_pointer_cast<arrow::Int32Array>(  concat_column(2));
-    auto arr3  = std::static_pointer_cast<arrow::StringArray>(   concat_column(3));
-    auto arr4  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(4));
-    auto arr5  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(5));
-    auto arr6  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(6));
-    auto arr7  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(7));
-    auto arr8  = std::static_pointer_cast<arrow::Int32Array>(   concat_column(8));
-    auto arr9  = std::static_pointer_cast<arrow::DoubleArray>(  concat_column(9));
-    auto arr10  = std::static_pointer_cast<arrow::DoubleArray>(  concat_column(10));
-    auto arr11  = std::static_pointer_cast<arrow::DoubleArray>(  concat_column(11));
-    auto arr12  = std::static_pointer_cast<arrow::BooleanArray>( concat_column(12));
-    auto arr13 = std::static_pointer_cast<arrow::StringArray>(  concat_column(13));
-    auto arr14 = std::static_pointer_cast<arrow::Int32Array>(   concat_column(14));
-
-    // 4) Pull out rows into vector<Row>
-    std::vector<BmpRowAnimal> result;
-    result.reserve(nrows);
-    for (int64_t i = 0; i < nrows; ++i) {
-      BmpRowAnimal r;
-      r.BmpSubmittedId       = arr0->Value(i);
-      r.BmpId                = arr1->Value(i);
-      r.AgencyId             = arr2->Value(i);
-      r.StateUniqueIdentifier= arr3->GetString(i);
-      r.StateId              = arr4->Value(i);
-      r.GeographyId          = arr5->Value(i);
-      r.AnimalGroupId        = arr6->Value(i);
-      r.LoadSourceGroupId    = arr7->Value(i);
-      r.UnitId               = arr8->Value(i);
-      r.Amount               = arr9->Value(i);
-      r.NReductionFraction    = arr10->Value(i);
-      r.PReductionFraction    = arr11->Value(i);
-      r.IsValid              = arr12->Value(i);
-      r.ErrorMessage         = arr13->GetString(i);
-      r.RowIndex             = arr14->Value(i);
-      result.push_back(std::move(r));
-    }
-
-    std::cout << "result size Animal: " << result.size() << std::endl;
-
-    return result;
-}
-
-std::vector<BmpRowManure> read_parquet_file_manure(const std::string& file_name) {
-    /** 
-        @brief Load BmpRowManure rows from a Parquet file using Apache Arrow 
-        @param file_name path to the Parquet file to read
-        @return std::vector<BmpRowManure> one element per row in the file
-    */
-    std::cout << "file_name: " << file_name << std::endl;
-    using arrow::default_memory_pool;
-    using parquet::arrow::FileReader;
-
-    std::shared_ptr<arrow::io::ReadableFile> infile;
-    PARQUET_ASSIGN_OR_THROW(
-        infile,
-        arrow::io::ReadableFile::Open(file_name, default_memory_pool())
-    );
-
-    std::unique_ptr<FileReader> reader;
-    PARQUET_THROW_NOT_OK(
-        parquet::arrow::OpenFile(infile, default_memory_pool(), &reader)
-    );
-
-    std::shared_ptr<arrow::Table> table;
-    PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
-
-    int64_t nrows = table->num_rows();
-    if (nrows == 0) return {};
-
-    auto concat_column = [&](int idx) -> std::shared_ptr<arrow::Array> {
-        auto col = table->column(idx);
-        if (col->num_chunks() == 1) return col->chunk(0);
-        std::shared_ptr<arrow::Array> all;
-        PARQUET_ASSIGN_OR_THROW(
-            all,
-            arrow::Concatenate(col->chunks(), default_memory_pool())
-        );
-        return all;
-    };
-
-    // 0  BmpSubmittedId        int32
-    // 1  BmpId                 int32
-    // 2  AgencyId              int32
-    // 3  StateUniqueIdentifier string
-    // 4  StateId               int32
-    // 5  HasStateReference     bool
-    // 6  CountyIdFrom          int32
-    // 7  CountyIdTo            int32
-    // 8  FIPSFrom              string
-    // 9  FIPSTo                string
-    // 10 AnimalGroupId         int32
-    // 11 LoadSourceGroupId     int32
-    // 12 UnitId                int32
-    // 13 Amount                double
-    // 14 IsValid               bool
-    // 15 ErrorMessage          string
-    // 16 RowIndex              int32
-
-    auto a0  = std::static_pointer_cast<arrow::Int32Array>(    concat_column(0));
-    auto a1  = std::static_pointer_cast<arrow::Int32Array>(    concat_column(1));
-    auto a2  = std::static_pointer_cast<arrow::Int32Array>(    concat_column(2));
-    auto a3  = std::static_pointer_cast<arrow::StringArray>(   concat_column(3));
-    auto a4  = std::static_pointer_cast<arrow::Int32Array>(    concat_column(4));
-    auto a5  = std::static_pointer_cast<arrow::BooleanArray>(  concat_column(5));
-    auto a6  = std::static_pointer_cast<arrow::Int32Array>(    concat_column(6));
-    auto a7  = std::static_pointer_cast<arrow::Int32Array>(    concat_column(7));
-    auto a8  = std::static_pointer_cast<arrow::StringArray>(   concat_column(8));
-    auto a9  = std::static_pointer_cast<arrow::StringArray>(   concat_column(9));
-    auto a10 = std::static_pointer_cast<arrow::Int32Array>(    concat_column(10));
-    auto a11 = std::static_pointer_cast<arrow::Int32Array>(    concat_column(11));
-    auto a12 = std::static_pointer_cast<arrow::Int32Array>(    concat_column(12));
-    auto a13 = std::static_pointer_cast<arrow::DoubleArray>(   concat_column(13));
-    auto a14 = std::static_pointer_cast<arrow::BooleanArray>(  concat_column(14));
-    auto a15 = std::static_pointer_cast<arrow::StringArray>(   concat_column(15));
-    auto a16 = std::static_pointer_cast<arrow::Int32Array>(    concat_column(16));
-
-    std::vector<BmpRowManure> result;
-    result.reserve(nrows);
-
-    for (int64_t i = 0; i < nrows; ++i) {
-        BmpRowManure r;
-        r.BmpSubmittedId        = a0->Value(i);
-        r.BmpId                 = a1->Value(i);
-        r.AgencyId              = a2->Value(i);
-        r.StateUniqueIdentifier = a3->GetString(i);
-        r.StateId               = a4->Value(i);
-        r.HasStateReference     = a5->Value(i);
-        r.CountyIdFrom          = a6->Value(i);
-        r.CountyIdTo            = a7->Value(i);
-        r.FIPSFrom              = a8->GetString(i);
-        r.FIPSTo                = a9->GetString(i);
-        r.AnimalGroupId         = a10->Value(i);
-        r.LoadSourceGroupId     = a11->Value(i);
-        r.UnitId                = a12->Value(i);
-        r.Amount                = a13->Value(i);
-        r.IsValid               = a14->Value(i);
-        r.ErrorMessage          = a15->GetString(i);
-        r.RowIndex              = a16->Value(i);
-        result.push_back(std::move(r));
-    }
-
-    std::cout << "result size Manure: " << result.size() << std::endl;
-    return result;
-}
-
-
 std::vector<std::tuple<int, int, int, int, int, double>> read_parquet_file(std::string file_name) {
     /**
         @brief Read selected columns from a Parquet file into a vector of tuples
@@ -813,7 +395,26 @@ PSO::PSO(int nparts, int nobjs, int max_iter, double w, double c1, double c2, do
     lc_size_ = 0;
     animal_size_ = 0;
     manure_size_ = 0;
+    nthreads_ = std::stoi(misc_utilities::get_env_var("PSO_NTHREADS", "0"));
+    if (nthreads_ <= 0) {
+        nthreads_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // A run is reproducible from its seed, whatever PSO_NTHREADS is; an unset PSO_SEED draws one.
+    uint64_t seed = std::stoull(misc_utilities::get_env_var("PSO_SEED", "0"));
+    if (seed != 0) {
+        rng::set_run_seed(seed);
+    }
+    fmt::print("seed: {}\n", rng::run_seed());
     init_cast(input_filename, scenario_filename, manure_nutrients_file);
+    evaluator_ = make_evaluator(misc_utilities::get_env_var("PSO_EVALUATOR", "cast"), scenario_);
+    archive_capacity_ = std::stoul(misc_utilities::get_env_var("PSO_ARCHIVE_SIZE", "0"));
+    is_async_ = misc_utilities::get_env_var("PSO_MODE", "generational") == "async";
+    max_in_flight_ = std::stoul(misc_utilities::get_env_var("PSO_MAX_IN_FLIGHT", "0"));
+    max_evaluations_ = std::stoul(misc_utilities::get_env_var("PSO_MAX_EVALUATIONS", "0"));
+    checkpoint_every_ = std::stoul(misc_utilities::get_env_var("PSO_CHECKPOINT_EVERY", "1"));
+    checkpoint_file_ = fmt::format("/opt/opt4cast/output/nsga3/{}/pso_checkpoint.bin", exec_uuid_);
+    iteration_ = 0;
+    resumed_ = false;
     input_filename_ = input_filename;
     scenario_filename_ = scenario_filename;
     this->nparts = nparts;
@@ -837,12 +438,34 @@ PSO::PSO(int nparts, int nobjs, int max_iter, double w, double c1, double c2, do
     base_land_bmp_inputs_ = read_parquet_file_land(base_land_bmp_file);
     base_animal_bmp_inputs_ = read_parquet_file_animal(base_animal_bmp_file);
     base_manure_bmp_inputs_ = read_parquet_file_manure(base_manure_bmp_file);
+    scenario_.set_base_inputs(base_land_bmp_inputs_, base_animal_bmp_inputs_, base_manure_bmp_inputs_);
+    artifacts_ = ArtifactWriter::from_env();
+    scenario_.set_artifact_writer(artifacts_);
+
+    // Delta layout: the base rows are written once per run and each particle
+    // only writes its own rows (see SubmissionLayout).
+    if (misc_utilities::get_env_var("PSO_SUBMISSION_LAYOUT", "full") == "delta") {
+        std::string exec_path = fmt::format("/opt/opt4cast/output/nsga3/{}", exec_uuid_);
+        scenario_.set_submission_layout(SubmissionLayout::Delta);
+        if (is_lc_enabled_) {
+            scenario_.write_land_base(fmt::format("{}/base_impbmpsubmittedland.parquet", exec_path), base_land_bmp_inputs_);
+        }
+        if (is_animal_enabled_) {
+            scenario_.write_animal_base(fmt::format("{}/base_impbmpsubmittedanimal.parquet", exec_path), base_animal_bmp_inputs_);
+        }
+        if (is_manure_enabled_) {
+            scenario_.write_manure_base(fmt::format("{}/base_impbmpsubmittedmanuretransport.parquet", exec_path), base_manure_bmp_inputs_);
+        }
+    }
 
     // Read in the scecario file to get the constraint
     std::ifstream in(scenario_filename_);
     json scenario;
     in >> scenario;
     max_budget_ = (scenario["total_budget"].get<double>() > 0 )  ? scenario["total_budget"].get<double>(): std::numeric_limits<double>::infinity(); 
+
+    open_cache();
+    results_ = std::make_shared<ResultsStore>(ResultsStore::run_filename(exec_uuid_));
     
 }
 
@@ -860,10 +483,27 @@ PSO::PSO(const PSO &p) {
     this->c1 = p.c1;
     this->c2 = p.c2;
     this->particles = p.particles;
+    this->swarm_ = p.swarm_;
     this->gbest_x = p.gbest_x;
     this->gbest_fx = p.gbest_fx;
     this->lower_bound = p.lower_bound;
     this->upper_bound = p.upper_bound;
+    this->nthreads_ = p.nthreads_;
+    this->evaluator_ = p.evaluator_;
+    this->archive_capacity_ = p.archive_capacity_;
+    this->is_async_ = p.is_async_;
+    this->max_in_flight_ = p.max_in_flight_;
+    this->max_evaluations_ = p.max_evaluations_;
+    this->cache_ = p.cache_;
+    this->cache_context_ = p.cache_context_;
+    this->results_ = p.results_;
+    this->artifacts_ = p.artifacts_;
+    this->checkpoint_file_ = p.checkpoint_file_;
+    this->checkpoint_every_ = p.checkpoint_every_;
+    this->iteration_ = p.iteration_;
+    this->resumed_ = p.resumed_;
+    this->has_pbest_ = p.has_pbest_;
+    this->pending_ = p.pending_;
 
     this->is_ef_enabled_ = p.is_ef_enabled_;
     this->is_lc_enabled_ = p.is_lc_enabled_;
@@ -877,6 +517,9 @@ PSO::PSO(const PSO &p) {
     this->manure_size_ = p.manure_size_;
     this->exec_uuid_log_ = p.exec_uuid_log_;
     this->scenario_ = p.scenario_;
+    this->base_land_bmp_inputs_ = p.base_land_bmp_inputs_;
+    this->base_animal_bmp_inputs_ = p.base_animal_bmp_inputs_;
+    this->base_manure_bmp_inputs_ = p.base_manure_bmp_inputs_;
     this->execute = p.execute;
     this->gbest_ = p.gbest_;
     //this->logger_ = p.logger_;
@@ -902,10 +545,27 @@ PSO& PSO::operator=(const PSO &p) {
     this->c1 = p.c1;
     this->c2 = p.c2;
     this->particles = p.particles;
+    this->swarm_ = p.swarm_;
     this->gbest_x = p.gbest_x;
     this->gbest_fx = p.gbest_fx;
     this->lower_bound = p.lower_bound;
     this->upper_bound = p.upper_bound;
+    this->nthreads_ = p.nthreads_;
+    this->evaluator_ = p.evaluator_;
+    this->archive_capacity_ = p.archive_capacity_;
+    this->is_async_ = p.is_async_;
+    this->max_in_flight_ = p.max_in_flight_;
+    this->max_evaluations_ = p.max_evaluations_;
+    this->cache_ = p.cache_;
+    this->cache_context_ = p.cache_context_;
+    this->results_ = p.results_;
+    this->artifacts_ = p.artifacts_;
+    this->checkpoint_file_ = p.checkpoint_file_;
+    this->checkpoint_every_ = p.checkpoint_every_;
+    this->iteration_ = p.iteration_;
+    this->resumed_ = p.resumed_;
+    this->has_pbest_ = p.has_pbest_;
+    this->pending_ = p.pending_;
 
 
     return *this;
@@ -917,6 +577,11 @@ PSO::~PSO() {
     */
     //TODO remove old code
     //delete_tmp_eiles();
+
+    // the queued files may refer to scenario_
+    if (artifacts_) {
+        artifacts_->flush();
+    }
 }
 
 
@@ -924,25 +589,40 @@ void PSO::delete_tmp_files(){
     /**
     * @brief Deletes temporary output files associated with the current PSO execution.
     *
-    * Iterates over execution UUIDs recorded in exec_uuid_log_, searches for 
-    * matching files in the PSO output directory, and attempts to remove them. 
-    * Any files that cannot be found or deleted are logged to stdout/stderr.
+    * Iterates over execution UUIDs recorded in exec_uuid_log_ and removes the
+    * files the results log lists for each of them. A solution missing from
+    * the log falls back to searching the PSO output directory for files with
+    * its UUID. Any files that cannot be found or deleted are logged to
+    * stdout/stderr.
     *
     * @note May not get called 
     */
 
-    int counter = 0;
     std::string directory = fmt::format("/opt/opt4cast/output/nsga3/{}", exec_uuid_);
     for (const auto& exec_uuid_vec : exec_uuid_log_) {
         for (const auto& exec_uuid: exec_uuid_vec) {
-            auto list_files = misc_utilities::find_files(directory, exec_uuid);
+            std::vector<std::string> list_files;
+            std::string file_directory = directory;
+            auto record = results_ ? results_->read(exec_uuid) : std::nullopt;
+            if (record && record->origin == ResultOrigin::front) {
+                continue;
+            }
+            if (record) {
+                file_directory = record->directory;
+                for (const auto& suffix : record->files) {
+                    list_files.push_back(record->prefix + suffix);
+                }
+            }
+            else {
+                list_files = misc_utilities::find_files(directory, exec_uuid);
+            }
             for (const auto &file : list_files) {
-                auto full_path = fmt::format("{}/{}", directory, file);
+                auto full_path = fmt::format("{}/{}", file_directory, file);
                 try {
                     if (fs::exists(full_path)) {
                         fs::remove(full_path);
                         //std::cout << "\t\tDeleted: " << full_path << std::endl;
-                    } else {
+                    } else if (!record) {
                         //logger_->error("File not found: {}", full_path);
                         std::cout << "\t\tFile not found: " << full_path << std::endl;
                     }
@@ -955,6 +635,48 @@ void PSO::delete_tmp_files(){
 }
 
 
+void PSO::set_evaluator(std::shared_ptr<Evaluator> evaluator) {
+    evaluator_ = std::move(evaluator);
+    open_cache();
+}
+
+void PSO::open_cache() {
+    /**
+    * @brief Opens the evaluation cache file of the current evaluation context.
+    *
+    * One cache file per context; an empty PSO_EVAL_CACHE_DIR disables the cache.
+    */
+    cache_.reset();
+    cache_context_ = evaluation_context();
+    auto cache_dir = misc_utilities::get_env_var("PSO_EVAL_CACHE_DIR",
+            fmt::format("{}/eval_cache", misc_utilities::get_env_var("MSU_CBPO_PATH", "/opt/opt4cast")));
+    if (!cache_dir.empty()) {
+        cache_ = std::make_shared<EvaluationCache>(fmt::format("{}/{:016x}.cache", cache_dir, cache_context_));
+    }
+}
+
+uint64_t PSO::evaluation_context() const {
+    /**
+    * @brief Hash of everything besides the decision rows that the load of a solution depends on.
+    *
+    * The backend is part of it: the model's loads are not CAST's, and they
+    * come from the input file as well as the scenario.
+    */
+    auto evaluator_name = evaluator_ ? evaluator_->name() : std::string();
+    uint64_t context = misc_utilities::hash_bytes(evaluator_name.data(), evaluator_name.size(), 0);
+    auto scenario_data_str = scenario_.get_scenario_string();
+    context = misc_utilities::hash_bytes(scenario_data_str.data(), scenario_data_str.size(), context);
+    context = misc_utilities::hash_file(scenario_filename_, context);
+    context = std::filesystem::exists(input_filename_) ? misc_utilities::hash_file(input_filename_, context)
+                                                       : misc_utilities::hash_bytes(input_filename_.data(), input_filename_.size(), context);
+    for (const auto& filename : {base_land_bmp_file_, base_animal_bmp_file_, base_manure_bmp_file_}) {
+        context = std::filesystem::exists(filename) ? misc_utilities::hash_file(filename, context)
+                                                    : misc_utilities::hash_bytes(filename.data(), filename.size(), context);
+    }
+    uint8_t flags = (is_lc_enabled_ ? 1 : 0) | (is_animal_enabled_ ? 2 : 0) | (is_manure_enabled_ ? 4 : 0);
+    return misc_utilities::hash_bytes(&flags, sizeof(flags), context);
+}
+
 void PSO::init_cast(const std::string& input_filename, const std::string& scenario_filename, const std::string& manure_nutrients_file) {
     /**
     * @brief Initializes CAST scenario data and PSO problem dimensions.
@@ -984,18 +706,11 @@ void PSO::init_cast(const std::string& input_filename, const std::string& scenar
     nobjs = 2;
 }
 
-void PSO::init() {
-    /**
-    * @brief Initializes the particle swarm population for optimization.
-    *
-    * Reserves space for all particles, creates each particle with the defined 
-    * problem dimensions and PSO hyperparameters, and initializes their 
-    * decision vectors using the scenario configuration. Each particle is 
-    * evaluated, its personal best (pbest) is established, and the global 
-    * best (gbest) is updated for the swarm.
-    */
-
+void PSO::create_particles() {
     particles.reserve(nparts);
+    swarm_ = Swarm(nparts, dim, w, c1, c2, lower_bound, upper_bound);
+    has_pbest_.assign(nparts, 0);
+    pending_.assign(nparts, 0);
     for (int i = 0; i < nparts; i++) {
         particles.emplace_back(dim, nobjs, w, c1, c2, lower_bound, upper_bound);
 
@@ -1007,28 +722,56 @@ void PSO::init() {
         //TODO remove code 
         //particles[i].init();
         particles[i].init(x);
+        swarm_.init(i, x);
     }
+}
+
+void PSO::init() {
+    /**
+    * @brief Initializes the particle swarm population for optimization.
+    *
+    * Reserves space for all particles, creates each particle with the defined 
+    * problem dimensions and PSO hyperparameters, and initializes their 
+    * decision vectors using the scenario configuration. Each particle is 
+    * evaluated, its personal best (pbest) is established, and the global 
+    * best (gbest) is updated for the swarm.
+    */
+
+    create_particles();
     evaluate();
     for (int i = 0; i < nparts; i++) {
         particles[i].init_pbest();
+        swarm_.store_pbest(i);
+        has_pbest_[i] = 1;
     }
     update_gbest();
 }
 
 void PSO::optimize() {
-    init();
+    if (is_async_) {
+        optimize_async();
+    }
+    else {
+        if (resumed_) {
+            fmt::print("resuming after iteration {}\n", iteration_);
+        }
+        else {
+            init();
+            iteration_ = 0;
+            save_checkpoint();
+        }
 
-    for (int i = 0; i < max_iter; i++) {
-        fmt::print(" =================================================================\n                      iteration: {}\n=================================================================\n", i);
-        for (int j = 0; j < nparts; j++) {
-            std::uniform_int_distribution<> dis(0, gbest_.size() - 1);
-            int index = dis(gen);
-            const auto& curr_gbest = gbest_[index].get_x();
-            particles[j].update(curr_gbest);
+        for (int i = static_cast<int>(iteration_); i < max_iter; i++) {
+            fmt::print(" =================================================================\n                      iteration: {}\n=================================================================\n", i);
+            move_particles();
+            evaluate();
+            update_pbest();
+            update_gbest();
+            iteration_ = i + 1;
+            if (checkpoint_every_ > 0 && iteration_ % checkpoint_every_ == 0) {
+                save_checkpoint();
+            }
         }
-        evaluate();
-        update_pbest();
-        update_gbest();
     }
 
     //exec_ipopt();
@@ -1047,9 +790,184 @@ void PSO::optimize() {
 }
 
 
+void PSO::move_particle(int i) {
+    const auto& curr_gbest = gbest_[choose_leader(i)].get_x();
+    swarm_.update(i, curr_gbest);
+    particles[i].set_x(swarm_.x(i));
+}
+
+void PSO::move_particles() {
+    /**
+    * @brief Moves every particle towards its pbest and a random gbest member, as one swarm step.
+    *
+    * The velocity and position updates run across nthreads_ workers.
+    */
+    std::vector<std::span<const double>> guides;
+    guides.reserve(nparts);
+    for (int i = 0; i < nparts; i++) {
+        guides.emplace_back(gbest_[choose_leader(i)].get_x());
+    }
+    ThreadPool pool(std::min(nthreads_, nparts));
+    swarm_.update(guides, &pool);
+    for (int i = 0; i < nparts; i++) {
+        particles[i].set_x(swarm_.x(i));
+    }
+}
+
+int PSO::choose_leader(int i) const {
+    // keyed by the particle and its step, like its velocity coefficients
+    rng::Stream stream(rng::run_seed(), rng::Domain::leader, static_cast<uint32_t>(swarm_.steps(i)), i);
+    return static_cast<int>(stream.below(gbest_.size()));
+}
+
+void PSO::optimize_async() {
+    /**
+    * @brief Steady-state optimization: every particle is dispatched again as soon as its own result arrives.
+    *
+    * Up to max_in_flight_ evaluations are outstanding at any time. When a
+    * result arrives, only that particle's pbest and the gbest archive are
+    * updated; its next position is computed from the archive as it is when
+    * the particle is dispatched again. The run stops after max_evaluations_
+    * evaluations (the first nparts included), which replaces max_iter. A
+    * solution that fails to be written or evaluated counts against the budget
+    * with an infeasible fitness, so its particle simply moves on.
+    *
+    * Checkpoints are taken every checkpoint_every_ * nparts evaluations. On
+    * resume, the particles that were in flight are dispatched again first,
+    * from the position they had been dispatched at.
+    */
+    size_t max_in_flight = max_in_flight_ > 0 ? max_in_flight_ : nparts;
+    size_t max_evaluations = max_evaluations_ > 0 ? max_evaluations_ : static_cast<size_t>(nparts) * (max_iter + 1);
+    std::string exec_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", exec_uuid_);
+
+    if (resumed_) {
+        fmt::print("resuming after evaluation {}\n", iteration_);
+    }
+    else {
+        create_particles();
+        iteration_ = 0;
+    }
+    std::vector<double> total_cost_vec(nparts, 0.0);
+    std::deque<int> ready;
+    for (int i = 0; i < nparts; i++) {
+        if (pending_[i]) {
+            ready.push_back(i);
+        }
+    }
+    for (int i = 0; i < nparts; i++) {
+        if (!pending_[i]) {
+            ready.push_back(i);
+        }
+    }
+    std::unordered_map<std::string, int> in_flight;
+    size_t completed = iteration_;
+    size_t dispatched = completed;
+    size_t checkpoint_interval = checkpoint_every_ * nparts;
+
+    auto fail = [&](int i) {
+        particles[i].set_fx(9999999999999.99, 9999999999999.99);
+        particles[i].set_gx(9999999999999.99);
+    };
+    auto complete = [&](int i) {
+        if (has_pbest_[i]) {
+            if (particles[i].update_pbest()) {
+                swarm_.store_pbest(i);
+            }
+        }
+        else {
+            particles[i].init_pbest();
+            swarm_.store_pbest(i);
+            has_pbest_[i] = 1;
+        }
+        pending_[i] = 0;
+        update_non_dominated_solutions(gbest_, particles[i], archive_capacity_);
+        const auto& fx = particles[i].get_fx();
+        fmt::print("evaluation {}/{} particle {}: [{}, {}] (archive: {}, in flight: {})\n",
+                   ++completed, max_evaluations, i, fx[0], fx[1], gbest_.size(), in_flight.size());
+        ready.push_back(i);
+        iteration_ = completed;
+        if (checkpoint_interval > 0 && completed % checkpoint_interval == 0) {
+            save_checkpoint();
+        }
+    };
+
+    while (completed < max_evaluations) {
+        std::vector<int> batch;
+        while (!ready.empty() && in_flight.size() + batch.size() < max_in_flight && dispatched + batch.size() < max_evaluations) {
+            int i = ready.front();
+            ready.pop_front();
+            if (has_pbest_[i] && !gbest_.empty() && !pending_[i]) {
+                move_particle(i);
+            }
+            pending_[i] = 1;
+            batch.push_back(i);
+        }
+        if (!batch.empty()) {
+            dispatched += batch.size();
+            auto written = write_particles(batch, exec_path, total_cost_vec);
+            std::vector<EvaluationRequest> requests;
+            std::vector<std::string> exec_uuid_vec;
+            for (int i : written) {
+                const auto& exec_uuid = particles[i].get_uuid();
+                in_flight[exec_uuid] = i;
+                exec_uuid_vec.push_back(exec_uuid);
+                requests.push_back({exec_uuid, &particles[i].get_lc_x(), &particles[i].get_animal_x(), &particles[i].get_manure_x(),
+                                    is_lc_enabled_ ? fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path, exec_uuid) : ""});
+            }
+            for (int i : batch) {
+                if (!in_flight.contains(particles[i].get_uuid())) {
+                    // cached, or write_particle_files already gave it an infeasible fitness
+                    complete(i);
+                }
+            }
+            if (!requests.empty()) {
+                materialize_for_cast(exec_path, requests);
+                evaluator_->submit(scenario_, exec_uuid_, requests);
+                exec_uuid_log_.push_back(exec_uuid_vec);
+            }
+        }
+        if (in_flight.empty()) {
+            continue;
+        }
+
+        auto results = evaluator_->wait_any(scenario_, exec_uuid_);
+        flush_artifacts();
+        if (results.empty()) {
+            // the evaluator has nothing outstanding: the rest were never dispatched
+            auto lost = std::exchange(in_flight, {});
+            for (const auto& [exec_uuid, i] : lost) {
+                std::cerr << "Solution " << exec_uuid << " was lost by the evaluator" << std::endl;
+                fail(i);
+                complete(i);
+            }
+            continue;
+        }
+        for (const auto& result : results) {
+            auto sep = result.find('_');
+            auto it = in_flight.find(result.substr(0, sep));
+            if (it == in_flight.end()) {
+                continue;
+            }
+            int i = it->second;
+            in_flight.erase(it);
+            std::string load = sep == std::string::npos ? "" : result.substr(sep + 1);
+            if (load.empty()) {
+                fail(i);
+            }
+            else {
+                record_result(i, total_cost_vec[i], std::stod(load));
+            }
+            complete(i);
+        }
+    }
+    print_cache_stats();
+}
+
 void PSO::update_pbest() {
     for (int j = 0; j < nparts; j++) {
-        particles[j].update_pbest();
+        if (particles[j].update_pbest()) {
+            swarm_.store_pbest(j);
+        }
     }
 }
 
@@ -1151,6 +1069,77 @@ std::vector<Particle> PSO::get_min_mid_max_ipopt_position() {
     return {min_val, mid_val, max_val};
 }
 
+void PSO::materialize_submissions(const std::string& path, const std::string& uuid) {
+    /**
+    * @brief Rebuilds the full impbmpsubmitted* files of a particle written in the delta layout.
+    *
+    * Only the particles that leave the swarm (e.g. the ones handed to Ipopt)
+    * need the full files, so they are merged on demand instead of per evaluation.
+    *
+    * @param path Directory holding the particle files.
+    * @param uuid Execution UUID of the particle.
+    */
+    if (scenario_.get_submission_layout() != SubmissionLayout::Delta) {
+        return;
+    }
+    for (const auto& suffix : {"impbmpsubmittedland", "impbmpsubmittedanimal", "impbmpsubmittedmanuretransport"}) {
+        auto full_filename = fmt::format("{}/{}_{}.parquet", path, uuid, suffix);
+        if (!fs::exists(full_filename)) {
+            scenario_.materialize_submission(full_filename);
+        }
+    }
+}
+
+void PSO::materialize_for_cast(const std::string& path, const std::vector<EvaluationRequest>& requests) {
+    /**
+    * @brief Rebuilds the full files of the solutions about to be sent to CAST.
+    *
+    * The CAST worker only reads full files, so in the delta layout they are
+    * spliced from the pre-encoded base row groups and each particle's delta
+    * just before the solutions are sent. The in-process model reads the
+    * deltas and needs nothing.
+    */
+    if (scenario_.get_submission_layout() != SubmissionLayout::Delta
+            || dynamic_cast<AmqpEvaluator*>(evaluator_.get()) == nullptr) {
+        return;
+    }
+    ThreadPool pool(std::min<size_t>(nthreads_, requests.size()));
+    pool.parallel_for(requests.size(), [&](size_t k) {
+        materialize_submissions(path, requests[k].exec_uuid);
+    });
+}
+
+size_t PSO::relocate_ipopt_sols(const std::string& source_path, const std::string& ipopt_path, int delta_counter) {
+    /**
+    * @brief Moves the eps_cnstr solutions logged under source_path to ipopt_path.
+    *
+    * Solution {step} becomes {step + delta_counter}, and the results log is
+    * updated to the new location.
+    *
+    * @return The number of solutions moved.
+    */
+    if (!results_) {
+        return 0;
+    }
+    // eps_cnstr appended to the log while this run waited for it
+    results_->refresh();
+    size_t moved = 0;
+    for (const auto& uuid : results_->uuids(ResultOrigin::ipopt)) {
+        if (results_->find(uuid)->directory != source_path) {
+            continue;
+        }
+        auto record = results_->read(uuid);
+        if (!record) {
+            continue;
+        }
+        auto prefix = std::to_string(std::stoi(record->prefix) + delta_counter);
+        auto files = transfer_solution_files(*record, ipopt_path, prefix, false);
+        results_->relocate(uuid, ipopt_path, prefix, std::move(files), ResultOrigin::ipopt);
+        ++moved;
+    }
+    return moved;
+}
+
 void PSO::exec_ipopt_all_sols(){
     Execute execute;
 
@@ -1158,6 +1147,7 @@ void PSO::exec_ipopt_all_sols(){
     std::string path = fmt::format("/opt/opt4cast/output/nsga3/{}", exec_uuid_);
     std::string ipopt_path = fmt::format("{}/ipopt", path);
     int counter = 0;
+    bool is_any_moved_by_name = false;
     //json scenario_json = misc_utilities::read_json_file(fmt::format("{}/scenario.json", path));
    for (const auto& particle : particle_vec) { 
         auto lc_cost = particle.get_lc_cost();
@@ -1166,6 +1156,7 @@ void PSO::exec_ipopt_all_sols(){
         auto parent_uuid = particle.get_uuid();
         auto parent_uuid_path = fmt::format("{}/{}", path, parent_uuid);
         misc_utilities::mkdir(parent_uuid_path);
+        materialize_submissions(path, parent_uuid);
 
 
         // Make the cost.json file and move to parent uuid path 
@@ -1231,7 +1222,12 @@ void PSO::exec_ipopt_all_sols(){
 
         fmt::print("before move_files\n");
         std::cout << "Parent uuid path: " << parent_uuid_path << '\n' << "ipop_path " << ipopt_path << '\n' <<std::endl;
-        misc_utilities::move_files(parent_uuid_path, ipopt_path, nsteps, counter*nsteps);
+        // eps_cnstr logged its solutions as {parent_uuid_path}/{step}; the files
+        // of the ones it did not log are still moved by name
+        if (relocate_ipopt_sols(parent_uuid_path, ipopt_path, counter*nsteps) < static_cast<size_t>(nsteps)) {
+            misc_utilities::move_files(parent_uuid_path, ipopt_path, nsteps, counter*nsteps);
+            is_any_moved_by_name = true;
+        }
 
 
         /*
@@ -1265,10 +1261,55 @@ void PSO::exec_ipopt_all_sols(){
 
     fmt::print("before find pareto  \n");
     std::cout << "Max Budget: " << max_budget_ << std::endl;
-    std::vector<std::string> pf_files = findParetoFrontFiles(objectives, directory, max_budget_);
-    misc_utilities::move_pf(ipopt_path, pf_path, pf_files);
-
-    std::vector<CostData> pf_data = readCostFiles(objectives, pf_path);
+    std::vector<CostData> pf_data;
+    if (results_ && !results_->uuids(ResultOrigin::ipopt).empty()) {
+        // the front straight from the results log: no directory scan, no JSON
+        auto data = results_->cost_data(ResultOrigin::ipopt);
+        // unless some solutions were moved by name: those are only in their
+        // *_costs.json files, keyed by prefix instead of uuid
+        std::unordered_map<std::string, CostData> unlogged;
+        if (is_any_moved_by_name) {
+            std::unordered_set<std::string> logged;
+            for (const auto& uuid : results_->uuids(ResultOrigin::ipopt)) {
+                const auto* entry = results_->find(uuid);
+                if (entry->directory == ipopt_path) {
+                    logged.insert(entry->prefix);
+                }
+            }
+            for (auto& cost_data : readCostFiles(objectives, ipopt_path)) {
+                if (!logged.contains(cost_data.file_index)) {
+                    data.push_back(cost_data);
+                    unlogged.emplace(cost_data.file_index, std::move(cost_data));
+                }
+            }
+        }
+        auto pf_ids = find_pareto_front(data, objectives.size(), max_budget_);
+        for (const auto& id : pf_ids) {
+            auto prefix = std::to_string(pf_data.size());
+            if (auto it = unlogged.find(id); it != unlogged.end()) {
+                ResultRecord record;
+                record.directory = ipopt_path;
+                record.prefix = id;
+                record.files = misc_utilities::solution_file_suffixes();
+                transfer_solution_files(record, pf_path, prefix, false);
+                pf_data.push_back(CostData{it->second.objective1, it->second.objective2, it->second.objective3, prefix});
+                continue;
+            }
+            auto record = results_->read(id);
+            if (!record) {
+                continue;
+            }
+            auto files = transfer_solution_files(*record, pf_path, prefix, false);
+            results_->relocate(id, pf_path, prefix, std::move(files), ResultOrigin::front);
+            pf_data.push_back(CostData{record->objectives[0], record->objectives[1], std::nullopt, prefix});
+        }
+        results_->sync();
+    }
+    else {
+        std::vector<std::string> pf_files = findParetoFrontFiles(objectives, directory, max_budget_);
+        misc_utilities::move_pf(ipopt_path, pf_path, pf_files);
+        pf_data = readCostFiles(objectives, pf_path);
+    }
 
     writeCSV(pf_data, csv_path, objectives);
 
@@ -1279,6 +1320,7 @@ void PSO::evaluate_ipopt_sols(const std::string& sub_dir, const std::string& ipo
     
     std::vector<std::string> exec_uuid_vec;
     std::unordered_map<std::string, double> total_cost_map;
+    std::unordered_map<std::string, std::vector<std::tuple<int, int, int, int, double>>> combined_map;
     //get_parent_solution
 
     std::string emo_path = fmt::format("/opt/opt4cast/output/nsga3/{}", exec_uuid_);
@@ -1307,7 +1349,9 @@ void PSO::evaluate_ipopt_sols(const std::string& sub_dir, const std::string& ipo
         exec_uuid_vec.emplace_back(exec_uuid);
         auto land_filename = fmt::format("{}/{}_impbmpsubmittedland.parquet", emo_path, exec_uuid);
         scenario_.write_land(combined, land_filename, base_land_bmp_inputs_);
-        scenario_.write_land_json(combined, replace_ending(land_filename, ".parquet", ".json"));
+        artifacts_->submit(replace_ending(land_filename, ".parquet", ".json"), [this, combined](const std::string& filename) {
+            scenario_.write_land_json(combined, filename);
+        });
         // Just doe write land for now 
 
         if(is_animal_enabled_){
@@ -1321,9 +1365,17 @@ void PSO::evaluate_ipopt_sols(const std::string& sub_dir, const std::string& ipo
         }
 
         total_cost_map[exec_uuid] = scenario_.compute_cost(combined) + animal_cost + manure_cost;
+        combined_map[exec_uuid] = std::move(combined);
     }
 
-    auto results = scenario_.send_files(exec_uuid_, exec_uuid_vec);
+    std::vector<EvaluationRequest> requests;
+    for (const auto& exec_uuid : exec_uuid_vec) {
+        requests.push_back({exec_uuid, &combined_map[exec_uuid], nullptr, nullptr,
+                            fmt::format("{}/{}_impbmpsubmittedland.parquet", emo_path, exec_uuid)});
+    }
+    materialize_for_cast(emo_path, requests);
+    auto results = evaluator_->evaluate(scenario_, exec_uuid_, requests);
+    flush_artifacts();
 
     //ipopt_results
     auto dir_path = fmt::format("{}/config/{}", emo_path, sub_dir);
@@ -1339,13 +1391,28 @@ void PSO::evaluate_ipopt_sols(const std::string& sub_dir, const std::string& ipo
         auto exec_uuid = result_vec[0];
         result_fx.push_back({total_cost_map[exec_uuid], std::stod(result_vec[1])});
 
-        std::regex pattern (exec_uuid);
         auto str_replacement = std::to_string(counter);
-        auto found_files =  misc_utilities::find_files(emo_path, exec_uuid);
-        for (const auto& filename : found_files) {
-            fmt::print("filename: {}\n", filename);
-            auto filename_dst = std::regex_replace(filename, pattern, str_replacement);
-            misc_utilities::copy_file(fmt::format("{}/{}", emo_path, filename), fmt::format("{}/{}", dir_path, filename_dst));
+        if (results_) {
+            ResultRecord record;
+            record.uuid = exec_uuid;
+            record.origin = ResultOrigin::ipopt;
+            record.objectives = result_fx.back();
+            record.constraint = find_gx(total_cost_map[exec_uuid]);
+            record.values = {{"animal_cost", animal_cost}, {"manure_cost", manure_cost}};
+            record.directory = emo_path;
+            record.prefix = exec_uuid;
+            record.files = solution_files(emo_path, exec_uuid);
+            results_->append(record);
+            transfer_solution_files(record, dir_path, str_replacement, true);
+        }
+        else {
+            std::regex pattern (exec_uuid);
+            auto found_files =  misc_utilities::find_files(emo_path, exec_uuid);
+            for (const auto& filename : found_files) {
+                fmt::print("filename: {}\n", filename);
+                auto filename_dst = std::regex_replace(filename, pattern, str_replacement);
+                misc_utilities::copy_file(fmt::format("{}/{}", emo_path, filename), fmt::format("{}/{}", dir_path, filename_dst));
+            }
         }
         counter++;
     } 
@@ -1419,7 +1486,7 @@ void PSO::update_gbest() {
 
 void PSO::update_gbest() {
     for (int j = 0; j < nparts; j++) {
-        update_non_dominated_solutions(gbest_, particles[j]);
+        update_non_dominated_solutions(gbest_, particles[j], archive_capacity_);
     } 
 }
 
@@ -1442,150 +1509,392 @@ void PSO::print() {
     std::cout<<"--------------------------\n";
 }
 
-void PSO::evaluate() {
+double PSO::normalize_particle(int i) {
+    /**
+    * @brief Builds the decision tuples of particle i from its position.
+    *
+    * Only particle i and read-only Scenario state are touched, so different
+    * particles can be processed concurrently by evaluate().
+    *
+    * @param i Index of the particle in the swarm.
+    * @return total BMP cost of the particle.
+    */
+    std::vector<std::tuple<int, int, int, int, double>> lc_x;
+    std::vector<std::tuple<int, int, int, int, int, double>> animal_x;
+    std::vector<std::tuple<int, int, int, int, int, double>> manure_x;
+    // land moved out of each parcel and into each land use; only needed while normalizing
+    thread_local std::vector<double> amount_minus;
+    thread_local std::vector<double> amount_plus;
+    double total_cost = 0.0;
+
+    const auto& x = particles[i].get_x();
+    if(is_ef_enabled_){
+        //total_cost += scenario_.normalize_ef(x, ef_x);
+        //particles[i].set_ef_x(lc_x);
+    }
 
+    if(is_lc_enabled_){
+        double lc_cost  = scenario_.normalize_lc(x, lc_x, amount_minus, amount_plus);
+        particles[i].set_lc_cost(lc_cost);
+        //fmt::print("lc_cost: {}\n", lc_cost);
+        total_cost += lc_cost;
+        particles[i].set_lc_x(lc_x);
+    }
 
-    //std::cout << " This is a test to see if one continaer can be build with out doing the whole thing" << std::endl; 
+    if(is_animal_enabled_){
+        auto animal_cost = scenario_.normalize_animal(x, animal_x); 
+        //fmt::print("animal_cost: {}\n", animal_cost);
+        particles[i].set_animal_cost(animal_cost);
+        total_cost += animal_cost;
+        particles[i].set_animal_x(animal_x);
+    }
 
-    std::vector<std::string> exec_uuid_vec;
-    std::vector<double> total_cost_vec(nparts, 0.0);
-    std::unordered_map<std::string, int> generation_uuid_idx;
-    std::string emo_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", emo_uuid_);
-    std::string exec_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", exec_uuid_);
+    if(is_manure_enabled_){
+        auto manure_cost = scenario_.normalize_manure(x, manure_x); 
+        //fmt::print("manure_cost: {}\n", manure_cost);
+        particles[i].set_manure_cost(manure_cost);
+        total_cost += manure_cost;
+        particles[i].set_manure_x(manure_x);
+    }
+    return total_cost;
+}
 
-    for (int i = 0; i < nparts; i++) {
-        std::vector<std::tuple<int, int, int, int, double>> lc_x;
-        std::vector<std::tuple<int, int, int, int, int, double>> animal_x;
-        std::vector<std::tuple<int, int, int, int, int, double>> manure_x;
-        std::unordered_map<std::string, double> amount_minus;
-        std::unordered_map<std::string, double> amount_plus;
-        double total_cost = 0.0;
-
-        const auto& x = particles[i].get_x();
-        // std::string exec_uuid = std::string("PSO-exec-uuid-") + xg::newGuid().str();
-        std::string exec_uuid = xg::newGuid().str();
-        particles[i].set_uuid(exec_uuid);
-        std::cout << "=========================================PSO emo_uuid_ and exec_uuid , " << emo_uuid_ << " " << exec_uuid << std::endl; 
-        bool flag = true;
-        if(is_ef_enabled_){
-            //total_cost += scenario_.normalize_ef(x, ef_x);
-            //particles[i].set_ef_x(lc_x);
-        }
-        
-        if(is_lc_enabled_){
-            double lc_cost  = scenario_.normalize_lc(x, lc_x, amount_minus, amount_plus);
-            particles[i].set_amount_minus(amount_minus);
-            particles[i].set_amount_plus(amount_plus);
-            particles[i].set_lc_cost(lc_cost);
-            //fmt::print("lc_cost: {}\n", lc_cost);
-            total_cost += lc_cost;
-            particles[i].set_lc_x(lc_x);
-            //fmt::print("exec_uuid: {}\n", exec_uuid);  
-            auto land_filename = fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path, exec_uuid);
-            std::cout << "Writing the land file" << std::endl;
-            scenario_.write_land(lc_x, land_filename, base_land_bmp_inputs_);
-            if (!std::filesystem::exists(land_filename)) {
-                total_cost = 9999999999999.99;
-                particles[i].set_lc_cost(lc_cost);
-                particles[i].set_fx(total_cost, total_cost);
-                particles[i].set_gx(total_cost); 
-                flag = false;
-                //continue;
-            }
+bool PSO::write_particle_files(int i, const std::string& exec_path, double& total_cost) {
+    /**
+    * @brief Writes the submission files of particle i, already built by normalize_particle().
+    *
+    * Only particle i and read-only Scenario state are touched, so different
+    * particles can be processed concurrently by evaluate().
+    *
+    * @param i Index of the particle in the swarm.
+    * @param exec_path Directory where the particle's files are written.
+    * @param total_cost Total BMP cost of the particle; set to the infeasible
+    *        value when a file could not be produced.
+    * @return false if one of the submission files could not be produced.
+    */
+    const auto& lc_x = particles[i].get_lc_x();
+    const auto& animal_x = particles[i].get_animal_x();
+    const auto& manure_x = particles[i].get_manure_x();
 
-            scenario_.write_land_json(lc_x, replace_ending(land_filename, ".parquet", ".json"));
-        }else {
-            auto land_filename = fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path, exec_uuid);
-            std::filesystem::copy(base_land_bmp_file_,land_filename, std::filesystem::copy_options::overwrite_existing);
-            std::cout << "Land Disabled file path:" << land_filename << std::endl;
+    const std::string& exec_uuid = particles[i].get_uuid();
+    bool flag = true;
+    if(is_lc_enabled_){
+        //fmt::print("exec_uuid: {}\n", exec_uuid);  
+        auto land_filename = fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path, exec_uuid);
+        scenario_.write_land(lc_x, land_filename, base_land_bmp_inputs_);
+        if (!std::filesystem::exists(scenario_.submission_filename(land_filename))) {
+            total_cost = 9999999999999.99;
+            particles[i].set_fx(total_cost, total_cost);
+            particles[i].set_gx(total_cost); 
+            flag = false;
+            //continue;
         }
 
-        if(is_animal_enabled_){
-            auto animal_cost = scenario_.normalize_animal(x, animal_x); 
-            //fmt::print("animal_cost: {}\n", animal_cost);
-            particles[i].set_animal_cost(animal_cost);
-            total_cost += animal_cost;
-            particles[i].set_animal_x(animal_x);
-            auto animal_filename = fmt::format("{}/{}_impbmpsubmittedanimal.parquet", exec_path, exec_uuid);
-            std::cout << "Writing the animal file" << std::endl;
-            auto flag = scenario_.write_animal(animal_x, animal_filename, base_animal_bmp_inputs_);
-            if(flag == 0){
-                std::filesystem::path exec_path_obj(exec_path);
-                std::filesystem::path exec_uuid_str(exec_uuid);
-
-                // Handle animal files
-                std::filesystem::path animal_filename = exec_path_obj / (exec_uuid_str.string() + "_impbmpsubmittedanimal.parquet");
-                std::filesystem::copy(base_animal_bmp_file_, animal_filename, std::filesystem::copy_options::overwrite_existing);
-                std::cout << "Animal Disabled file path:" << animal_filename << std::endl;
-                scenario_.write_animal_json(animal_x, replace_ending(animal_filename, ".parquet", ".json"));
-            }
-            else{
-                if (!std::filesystem::exists(animal_filename)) {
-                    total_cost = 9999999999999.99;
-                    particles[i].set_animal_cost(animal_cost);
-                    particles[i].set_fx(total_cost, total_cost);
-                    particles[i].set_gx(total_cost); 
-                    flag = false;
-                    //continue;
-                }
-                scenario_.write_animal_json(animal_x, replace_ending(animal_filename, ".parquet", ".json"));
-            }
-        }else{ 
+        artifacts_->submit(replace_ending(land_filename, ".parquet", ".json"), [this, lc_x](const std::string& filename) {
+            scenario_.write_land_json(lc_x, filename);
+        });
+    }else {
+        auto land_filename = fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path, exec_uuid);
+        // the base files are inputs of the run, never rewritten: the copy may be a hardlink
+        file_clone::clone(base_land_bmp_file_, land_filename, true);
+    }
+
+    if(is_animal_enabled_){
+        auto animal_filename = fmt::format("{}/{}_impbmpsubmittedanimal.parquet", exec_path, exec_uuid);
+        auto flag = scenario_.write_animal(animal_x, animal_filename, base_animal_bmp_inputs_);
+        if(flag == 0){
             std::filesystem::path exec_path_obj(exec_path);
             std::filesystem::path exec_uuid_str(exec_uuid);
 
             // Handle animal files
             std::filesystem::path animal_filename = exec_path_obj / (exec_uuid_str.string() + "_impbmpsubmittedanimal.parquet");
-            std::filesystem::copy(base_animal_bmp_file_, animal_filename, std::filesystem::copy_options::overwrite_existing);
-            std::cout << "Animal Disabled file path:" << animal_filename << std::endl;
+            file_clone::clone(base_animal_bmp_file_, animal_filename.string(), true);
+            artifacts_->submit(replace_ending(animal_filename, ".parquet", ".json"), [this, animal_x](const std::string& filename) {
+                scenario_.write_animal_json(animal_x, filename);
+            });
         }
-        
-        if(is_manure_enabled_){
-            auto manure_cost = scenario_.normalize_manure(x, manure_x); 
-            //fmt::print("manure_cost: {}\n", manure_cost);
-            particles[i].set_manure_cost(manure_cost);
-            total_cost += manure_cost;
-
-            particles[i].set_manure_x(manure_x);
-            auto manure_filename = fmt::format("{}/{}_impbmpsubmittedmanuretransport.parquet", exec_path, exec_uuid);
-            scenario_.write_manure(manure_x, manure_filename, base_manure_bmp_inputs_);
-            if (!std::filesystem::exists(manure_filename)) {
+        else{
+            if (!std::filesystem::exists(scenario_.submission_filename(animal_filename))) {
                 total_cost = 9999999999999.99;
-                particles[i].set_manure_cost(manure_cost);
                 particles[i].set_fx(total_cost, total_cost);
                 particles[i].set_gx(total_cost); 
                 flag = false;
                 //continue;
             }
-            scenario_.write_manure_json(manure_x, replace_ending(manure_filename, ".parquet", ".json"));
-        }else{
-           
-            std::filesystem::path exec_path_obj(exec_path);
-            std::filesystem::path exec_uuid_str(exec_uuid);
-            std::filesystem::path manure_filename = exec_path_obj / (exec_uuid_str.string() + "_impbmpsubmittedmanuretransport.parquet");
+            artifacts_->submit(replace_ending(animal_filename, ".parquet", ".json"), [this, animal_x](const std::string& filename) {
+                scenario_.write_animal_json(animal_x, filename);
+            });
+        }
+    }else{ 
+        std::filesystem::path exec_path_obj(exec_path);
+        std::filesystem::path exec_uuid_str(exec_uuid);
+
+        // Handle animal files
+        std::filesystem::path animal_filename = exec_path_obj / (exec_uuid_str.string() + "_impbmpsubmittedanimal.parquet");
+        file_clone::clone(base_animal_bmp_file_, animal_filename.string(), true);
+    }
+    
+    if(is_manure_enabled_){
+        auto manure_filename = fmt::format("{}/{}_impbmpsubmittedmanuretransport.parquet", exec_path, exec_uuid);
+        scenario_.write_manure(manure_x, manure_filename, base_manure_bmp_inputs_);
+        if (!std::filesystem::exists(scenario_.submission_filename(manure_filename))) {
+            total_cost = 9999999999999.99;
+            particles[i].set_fx(total_cost, total_cost);
+            particles[i].set_gx(total_cost); 
+            flag = false;
+            //continue;
+        }
+        artifacts_->submit(replace_ending(manure_filename, ".parquet", ".json"), [this, manure_x](const std::string& filename) {
+            scenario_.write_manure_json(manure_x, filename);
+        });
+    }else{
+       
+        std::filesystem::path exec_path_obj(exec_path);
+        std::filesystem::path exec_uuid_str(exec_uuid);
+        std::filesystem::path manure_filename = exec_path_obj / (exec_uuid_str.string() + "_impbmpsubmittedmanuretransport.parquet");
+
+        file_clone::clone(base_manure_bmp_file_, manure_filename.string(), true);
+    }
+    return flag;
+}
+
+std::vector<int> PSO::write_particles(const std::vector<int>& indices, const std::string& exec_path, std::vector<double>& total_cost_vec) {
+    /**
+    * @brief Builds the listed particles and writes the submission files of those that need an evaluation.
+    *
+    * Every particle gets a uuid of its own. One whose submission is in the
+    * evaluation cache takes the cached load and a clone, under its uuid, of
+    * the files of the solution that was evaluated; when some of those files
+    * are gone it is evaluated again. Work on different particles runs
+    * concurrently.
+    *
+    * @return The indices, in order, that still have to be evaluated. The
+    *         others already have their fitness: the cached one, or the
+    *         infeasible one when a file could not be written.
+    */
+    // UUIDs are assigned serially so the particle -> file mapping does not
+    // depend on how the workers get scheduled.
+    for (int i : indices) {
+        // std::string exec_uuid = std::string("PSO-exec-uuid-") + xg::newGuid().str();
+        particles[i].set_uuid(xg::newGuid().str());
+    }
+    solution_keys_.resize(nparts);
+
+    ThreadPool pool(std::min<size_t>(nthreads_, indices.size()));
+    pool.parallel_for(indices.size(), [&](size_t k) {
+        int i = indices[k];
+        total_cost_vec[i] = normalize_particle(i);
+        if (cache_) {
+            solution_keys_[i] = EvaluationCache::solution_key(cache_context_, particles[i].get_lc_x(),
+                                                              particles[i].get_animal_x(), particles[i].get_manure_x());
+        }
+    });
+
+    std::vector<std::optional<EvaluationCache::Entry>> entries(indices.size());
+    if (cache_) {
+        for (size_t k = 0; k < indices.size(); k++) {
+            entries[k] = cache_->find(solution_keys_[indices[k]]);
+        }
+    }
+
+    std::vector<char> is_cloned(indices.size(), 0);
+    pool.parallel_for(indices.size(), [&](size_t k) {
+        if (entries[k]) {
+            const auto& directory = entries[k]->directory.empty() ? exec_path : entries[k]->directory;
+            is_cloned[k] = clone_solution_files(directory, entries[k]->exec_uuid, exec_path, particles[indices[k]].get_uuid());
+        }
+    });
+
+    std::vector<size_t> to_write;
+    for (size_t k = 0; k < indices.size(); k++) {
+        int i = indices[k];
+        if (is_cloned[k]) {
+            particles[i].set_gx(find_gx(total_cost_vec[i])); // total cost - upper limit
+            particles[i].set_fx(total_cost_vec[i], entries[k]->load);
+            store_result(i);
+        }
+        else {
+            to_write.push_back(k);
+        }
+    }
+
+    std::vector<char> is_written(indices.size(), 0);
+    pool.parallel_for(to_write.size(), [&](size_t n) {
+        int i = indices[to_write[n]];
+        is_written[to_write[n]] = write_particle_files(i, exec_path, total_cost_vec[i]);
+    });
+
+    std::vector<int> written;
+    for (size_t k : to_write) {
+        if (is_written[k]) {
+            written.push_back(indices[k]);
+        }
+    }
+    // one line per batch: the workers above print nothing
+    fmt::print("{} particles in {}: {} to evaluate, {} from the evaluation cache, {} infeasible\n", indices.size(), exec_path,
+               written.size(), indices.size() - to_write.size(), to_write.size() - written.size());
+    return written;
+}
 
-            std::filesystem::copy(base_manure_bmp_file_, manure_filename, std::filesystem::copy_options::overwrite_existing);
-            std::cout << "Manure Disabled file path:" << manure_filename << std::endl;
+bool PSO::clone_solution_files(const std::string& directory, const std::string& uuid,
+                               const std::string& exec_path, const std::string& new_uuid) const {
+    /**
+    * @brief Copies the files of the evaluated solution uuid in directory to new_uuid in exec_path.
+    *
+    * @return false, copying nothing, if a submission file or, with CAST, a
+    *         _reportloads file of the solution is missing.
+    */
+    auto files = solution_files(directory, uuid);
+    for (const auto& [is_enabled, suffix] : {std::pair{is_lc_enabled_, "_impbmpsubmittedland.parquet"},
+                                             std::pair{is_animal_enabled_, "_impbmpsubmittedanimal.parquet"},
+                                             std::pair{is_manure_enabled_, "_impbmpsubmittedmanuretransport.parquet"}}) {
+        if (std::find(files.begin(), files.end(), is_enabled ? scenario_.submission_filename(suffix) : suffix) == files.end()) {
+            return false;
+        }
+    }
+    if (dynamic_cast<const AmqpEvaluator*>(evaluator_.get()) != nullptr) {
+        for (auto suffix : {"_reportloads.csv", "_reportloads.parquet"}) {
+            if (std::find(files.begin(), files.end(), suffix) == files.end()) {
+                return false;
+            }
         }
+    }
+    try {
+        for (const auto& suffix : files) {
+            file_clone::clone(fmt::format("{}/{}{}", directory, uuid, suffix),
+                              fmt::format("{}/{}{}", exec_path, new_uuid, suffix));
+        }
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << "Could not copy the files of " << uuid << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
 
-        if(flag){
-            generation_uuid_idx[exec_uuid] = i;
-            total_cost_vec[i] = total_cost;
-            exec_uuid_vec.push_back(exec_uuid);
+void PSO::record_result(int i, double total_cost, double load) {
+    particles[i].set_gx(find_gx(total_cost)); // total cost - upper limit
+    particles[i].set_fx(total_cost, load);
+    if (cache_) {
+        cache_->insert(solution_keys_[i], load, particles[i].get_uuid(),
+                       fmt::format("/opt/opt4cast/output/nsga3/{}", exec_uuid_));
+    }
+    store_result(i);
+}
+
+std::vector<std::string> PSO::solution_files(const std::string& directory, const std::string& uuid) const {
+    /**
+    * @brief Suffixes of the files solution uuid left in directory.
+    *
+    * Out of the submissions as written for the current layout, their JSON
+    * copies, and the loads CAST writes back, those that exist.
+    */
+    std::vector<std::string> suffixes;
+    for (const auto& [is_enabled, suffix] : {std::pair{is_lc_enabled_, "impbmpsubmittedland"},
+                                             std::pair{is_animal_enabled_, "impbmpsubmittedanimal"},
+                                             std::pair{is_manure_enabled_, "impbmpsubmittedmanuretransport"}}) {
+        auto filename = fmt::format("_{}.parquet", suffix);
+        suffixes.push_back(is_enabled ? scenario_.submission_filename(filename) : filename);
+        if (is_enabled) {
+            suffixes.push_back(fmt::format("_{}.json", suffix));
+        }
+    }
+    suffixes.push_back("_reportloads.csv");
+    suffixes.push_back("_reportloads.parquet");
+
+    std::vector<std::string> files;
+    for (auto& suffix : suffixes) {
+        if (std::filesystem::exists(fmt::format("{}/{}{}", directory, uuid, suffix))) {
+            files.push_back(std::move(suffix));
         }
     }
+    return files;
+}
+
+void PSO::store_result(int i) {
+    /**
+    * @brief Appends particle i, which just got its fitness, to the results log.
+    */
+    const auto& uuid = particles[i].get_uuid();
+    if (!results_ || results_->find(uuid) != nullptr) {
+        return;
+    }
+    ResultRecord record;
+    record.uuid = uuid;
+    record.origin = ResultOrigin::pso;
+    record.objectives = particles[i].get_fx();
+    record.constraint = particles[i].get_gx();
+    record.values = {{"lc_cost", particles[i].get_lc_cost()},
+                     {"animal_cost", particles[i].get_animal_cost()},
+                     {"manure_cost", particles[i].get_manure_cost()}};
+    record.directory = fmt::format("/opt/opt4cast/output/nsga3/{}", exec_uuid_);
+    record.prefix = uuid;
+    record.files = solution_files(record.directory, uuid);
+    results_->append(record);
+}
+
+void PSO::print_cache_stats() const {
+    if (cache_) {
+        fmt::print("evaluation cache: {} hits, {} misses ({:.1f}% hit rate), {} entries\n",
+                   cache_->hits(), cache_->misses(), 100.0 * cache_->hit_rate(), cache_->size());
+    }
+}
+
+void PSO::flush_artifacts() {
+    /**
+    * @brief Waits for the files queued on the artifact writer, so that every
+    * file of the solutions evaluated so far is complete, and reports the
+    * files written and cloned so far.
+    */
+    if (!artifacts_->flush()) {
+        std::cerr << "Some JSON or _new_bmps files could not be written" << std::endl;
+    }
+    artifacts_->print_stats();
+    file_clone::print_stats();
+}
+
+void PSO::evaluate() {
+
+
+    //std::cout << " This is a test to see if one continaer can be build with out doing the whole thing" << std::endl; 
+
+    std::vector<std::string> exec_uuid_vec;
+    std::vector<double> total_cost_vec(nparts, 0.0);
+    std::unordered_map<std::string, int> generation_uuid_idx;
+    std::string emo_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", emo_uuid_);
+    std::string exec_path = fmt::format("/opt/opt4cast/output/nsga3/{}/", exec_uuid_);
+
+    std::vector<int> indices(nparts);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<EvaluationRequest> requests;
+    for (int i : write_particles(indices, exec_path, total_cost_vec)) {
+        const auto& exec_uuid = particles[i].get_uuid();
+        generation_uuid_idx[exec_uuid] = i;
+        exec_uuid_vec.push_back(exec_uuid);
+        requests.push_back({exec_uuid, &particles[i].get_lc_x(), &particles[i].get_animal_x(), &particles[i].get_manure_x(),
+                            is_lc_enabled_ ? fmt::format("{}/{}_impbmpsubmittedland.parquet", exec_path, exec_uuid) : ""});
+    }
 
     //send files and wait for them
-    auto results = scenario_.send_files(exec_uuid_, exec_uuid_vec);
+    materialize_for_cast(exec_path, requests);
+    auto results = evaluator_->evaluate(scenario_, exec_uuid_, requests);
+    // the JSON mirrors and _new_bmps copies were written while CAST evaluated
+    flush_artifacts();
 
     for (auto const& key : results) {
         std::vector<std::string> result_vec;
         misc_utilities::split_str(key, '_', result_vec);
         auto stored_idx = generation_uuid_idx[result_vec[0]];
-        particles[stored_idx].set_gx(find_gx(total_cost_vec[stored_idx])); // total cost - upper limit 
-        particles[stored_idx].set_fx(total_cost_vec[stored_idx], std::stod(result_vec[1]));
+        record_result(stored_idx, total_cost_vec[stored_idx], std::stod(result_vec[1]));
+        generation_uuid_idx.erase(result_vec[0]);
     } 
 
+    // what is left was given up by the evaluator; it must not keep the fitness of its previous position
+    for (const auto& [exec_uuid, i] : generation_uuid_idx) {
+        fmt::print("Solution {} was not evaluated, marking it infeasible\n", exec_uuid);
+        particles[i].set_fx(9999999999999.99, 9999999999999.99);
+        particles[i].set_gx(9999999999999.99);
+    }
+
     for (int i = 0; i < nparts; i++) {
         const auto& new_solution_fx = particles[i].get_fx();
         if (new_solution_fx[1] >= 9999999999999.0) {
@@ -1596,6 +1905,7 @@ void PSO::evaluate() {
             fmt::print("new_solution_fx[{}]: [{}, {}]\n", i, new_solution_fx[0], new_solution_fx[1]);
         }
     }
+    print_cache_stats();
     exec_uuid_log_.push_back(exec_uuid_vec);
 }
 
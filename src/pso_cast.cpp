@@ -110,7 +110,9 @@ int main (int argc, char *argv[]) {
         manure_parquet_file_path,          argv[11] base_manure_bmp_file
         str(uuid),                         argv[12] exec_uuid
         str(base_scenario_uuid),           argv[13] base_scenario_uuid
+        --resume                           argv[14] optional: continue from the run's last checkpoint
     */
+    bool is_resume = false;
     if (argc > 1) {
         input_filename = argv[1]; 
         scenario_filename = argv[2];
@@ -125,15 +127,20 @@ int main (int argc, char *argv[]) {
         base_manure_bmp_file = argv[11];
         exec_uuid = argv[12];
         base_scenario_uuid = argv[13];
+        is_resume = argc > 14 && std::string(argv[14]) == "--resume";
     } 
     
     // Create the running logs forlder that all pring statment got to
     auto  logPath = fmt::format("{}/running.log", dir_output);
-    std::freopen(logPath.c_str(), "w", stdout); 
+    // a resumed run keeps the log of the run it continues
+    std::freopen(logPath.c_str(), is_resume ? "a" : "w", stdout); 
     
 
     PSO pso(nparts, nobjs, max_iter, w, c1, c2, lb, ub, input_filename, scenario_filename, dir_output, is_ef_enabled, is_lc_enabled, is_animal_enabled, is_manure_enabled, 
             manure_nutrients_file, base_land_bmp_file, base_animal_bmp_file, base_manure_bmp_file, exec_uuid, base_scenario_uuid);
+    if (is_resume && !pso.resume()) {
+        fmt::print("nothing to resume from {}, starting over\n", pso.get_checkpoint_file());
+    }
     pso.optimize();
     pso.save_gbest(dir_output);
 
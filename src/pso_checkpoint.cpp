@@ -0,0 +1,261 @@
+// Created by: Gregorio Toscano
+//
+// Binary checkpoint of a PSO run.
+//
+// Layout: a CheckpointHeader followed by the payload (binary_io.h): the run
+// shape and enabled BMP categories, the run seed and iteration, every
+// particle (fitness, costs, swarm rows and step count), the gbest archive and
+// exec_uuid_log_. The header key is the evaluation context, so a checkpoint is
+// only resumed against the same scenario and base submissions. Bump
+// CHECKPOINT_VERSION whenever the payload changes.
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "binary_io.h"
+#include "misc_utilities.h"
+#include "pso.h"
+#include "rng.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr char CHECKPOINT_MAGIC[8] = {'M', 'S', 'U', 'C', 'K', 'P', 'T', '\0'};
+    constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+    struct CheckpointHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t key;
+        uint64_t payload_size;
+        uint64_t payload_hash;
+    };
+
+    // what the archive and the current particles share: everything but the swarm rows
+    void put_solution(binary_io::Writer& writer, const Particle& particle) {
+        writer.put(particle.get_uuid());
+        writer.put(particle.get_fx());
+        writer.put(particle.get_gx());
+        writer.put(particle.get_lc_cost());
+        writer.put(particle.get_animal_cost());
+        writer.put(particle.get_manure_cost());
+    }
+
+    void get_solution(binary_io::Reader& reader, Particle& particle) {
+        particle.set_uuid(reader.get<std::string>());
+        auto fx = reader.get<std::vector<double>>();
+        if (fx.size() != 2) {
+            throw std::runtime_error("unexpected number of objectives");
+        }
+        particle.set_fx(fx[0], fx[1]);
+        particle.set_gx(reader.get<double>());
+        particle.set_lc_cost(reader.get<double>());
+        particle.set_animal_cost(reader.get<double>());
+        particle.set_manure_cost(reader.get<double>());
+    }
+}
+
+bool PSO::save_checkpoint() const {
+    /**
+    * @brief Writes the swarm state to checkpoint_file_, atomically.
+    *
+    * Either the previous checkpoint or the new one is on disk at any time,
+    * never a partial file. The data is fsync'ed before it replaces the old
+    * checkpoint, since the point is to survive a crash.
+    *
+    * @return false if checkpoints are disabled or the file could not be written.
+    */
+    if (checkpoint_file_.empty() || checkpoint_every_ == 0) {
+        return false;
+    }
+    // the results log is never behind the checkpoint that resumes the run
+    if (results_) {
+        results_->sync();
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    binary_io::Writer writer;
+    writer.reserve((3 * static_cast<size_t>(nparts) + gbest_.size()) * dim * sizeof(double));
+    writer.put<uint32_t>(nparts);
+    writer.put<uint32_t>(dim);
+    writer.put<uint8_t>(is_async_);
+    writer.put<uint8_t>(is_ef_enabled_);
+    writer.put<uint8_t>(is_lc_enabled_);
+    writer.put<uint8_t>(is_animal_enabled_);
+    writer.put<uint8_t>(is_manure_enabled_);
+    writer.put<uint64_t>(swarm_.seed());
+    writer.put<uint64_t>(iteration_);
+
+    for (int i = 0; i < nparts; i++) {
+        const auto& particle = particles[i];
+        put_solution(writer, particle);
+        writer.put(particle.get_pbest_fx());
+        writer.put(particle.get_pbest_gx());
+        writer.put<uint8_t>(has_pbest_[i]);
+        writer.put<uint8_t>(pending_[i]);
+        writer.put<uint64_t>(swarm_.steps(i));
+        auto x = swarm_.x(i);
+        auto pbest_x = swarm_.pbest_x(i);
+        writer.put_array(x.data(), x.size());
+        writer.put_array(swarm_.v(i).data(), dim);
+        // right after a pbest update the two rows are equal; store it once
+        bool pbest_is_x = std::memcmp(x.data(), pbest_x.data(), dim * sizeof(double)) == 0;
+        writer.put<uint8_t>(pbest_is_x);
+        if (!pbest_is_x) {
+            writer.put_array(pbest_x.data(), dim);
+        }
+    }
+
+    writer.put<uint64_t>(gbest_.size());
+    for (const auto& member : gbest_) {
+        put_solution(writer, member);
+        writer.put(member.get_x());
+    }
+    writer.put(exec_uuid_log_);
+    const auto& payload = writer.bytes();
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.header_size = sizeof(CheckpointHeader);
+    header.key = cache_context_;
+    header.payload_size = payload.size();
+    header.payload_hash = misc_utilities::hash_bytes(payload.data(), payload.size(), header.key);
+
+    std::error_code ec;
+    fs::path path(checkpoint_file_);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+    if (!binary_io::write_file_atomically(checkpoint_file_, {{&header, sizeof(header)}, {payload.data(), payload.size()}}, true)) {
+        std::cerr << "Failed to write the checkpoint " << checkpoint_file_ << std::endl;
+        return false;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fmt::print("checkpoint {}: {} bytes in {:.1f} ms\n", iteration_, sizeof(header) + payload.size(), ms);
+    return true;
+}
+
+bool PSO::resume() {
+    if (!load_checkpoint(checkpoint_file_)) {
+        return false;
+    }
+    fmt::print("resumed from {} (seed {}, iteration {}, archive {})\n", checkpoint_file_, rng::run_seed(), iteration_, gbest_.size());
+    return true;
+}
+
+bool PSO::load_checkpoint(const std::string& filename) {
+    binary_io::MappedFile file(filename);
+    if (file.data() == nullptr || file.size() < sizeof(CheckpointHeader)) {
+        std::cerr << "No checkpoint to resume from at " << filename << std::endl;
+        return false;
+    }
+    CheckpointHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const char* payload = file.data() + sizeof(header);
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0
+            || header.version != CHECKPOINT_VERSION
+            || header.header_size != sizeof(CheckpointHeader)
+            || header.payload_size != file.size() - sizeof(header)
+            || header.payload_hash != misc_utilities::hash_bytes(payload, header.payload_size, header.key)) {
+        std::cerr << "Ignoring stale or corrupt checkpoint " << filename << std::endl;
+        return false;
+    }
+    if (header.key != cache_context_) {
+        std::cerr << "Checkpoint " << filename << " belongs to another scenario or base submission" << std::endl;
+        exit(-1);
+    }
+
+    // decode into scratch state so a bad payload leaves this run as it was
+    std::vector<Particle> loaded_particles;
+    std::vector<Particle> loaded_gbest;
+    std::vector<std::vector<std::string>> loaded_log;
+    std::vector<char> loaded_has_pbest(nparts);
+    std::vector<char> loaded_pending(nparts);
+    uint64_t seed = 0;
+    uint64_t iteration = 0;
+    Swarm loaded_swarm;
+    try {
+        binary_io::Reader reader(payload, header.payload_size);
+        auto saved_nparts = reader.get<uint32_t>();
+        auto saved_dim = reader.get<uint32_t>();
+        bool saved_async = reader.get<uint8_t>();
+        bool saved_ef = reader.get<uint8_t>();
+        bool saved_lc = reader.get<uint8_t>();
+        bool saved_animal = reader.get<uint8_t>();
+        bool saved_manure = reader.get<uint8_t>();
+        if (saved_nparts != static_cast<uint32_t>(nparts) || saved_dim != static_cast<uint32_t>(dim) || saved_async != is_async_
+                || saved_ef != is_ef_enabled_ || saved_lc != is_lc_enabled_ || saved_animal != is_animal_enabled_ || saved_manure != is_manure_enabled_) {
+            std::cerr << fmt::format("Checkpoint {} is for {} particles of dim {} ({} mode, categories ef={} lc={} animal={} manure={}), "
+                                     "this run has {} particles of dim {}", filename, saved_nparts, saved_dim,
+                                     saved_async ? "async" : "generational", saved_ef, saved_lc, saved_animal, saved_manure, nparts, dim) << std::endl;
+            exit(-1);
+        }
+        seed = reader.get<uint64_t>();
+        iteration = reader.get<uint64_t>();
+
+        loaded_swarm = Swarm(nparts, dim, w, c1, c2, lower_bound, upper_bound, seed);
+        std::vector<double> x(dim);
+        std::vector<double> v(dim);
+        std::vector<double> pbest_x(dim);
+        for (int i = 0; i < nparts; i++) {
+            Particle particle(dim, nobjs, w, c1, c2, lower_bound, upper_bound);
+            get_solution(reader, particle);
+            auto pbest_fx = reader.get<std::vector<double>>();
+            auto pbest_gx = reader.get<double>();
+            loaded_has_pbest[i] = reader.get<uint8_t>();
+            loaded_pending[i] = reader.get<uint8_t>();
+            auto steps = reader.get<uint64_t>();
+            reader.get_array(x.data(), dim);
+            reader.get_array(v.data(), dim);
+            if (reader.get<uint8_t>()) {
+                pbest_x = x;
+            }
+            else {
+                reader.get_array(pbest_x.data(), dim);
+            }
+            particle.set_x(x);
+            particle.set_pbest(pbest_x, pbest_fx, pbest_gx);
+            loaded_swarm.restore(i, x, v, pbest_x, steps);
+            loaded_particles.push_back(std::move(particle));
+        }
+
+        auto archive_size = reader.get<uint64_t>();
+        for (uint64_t k = 0; k < archive_size; k++) {
+            Particle member(dim, nobjs, w, c1, c2, lower_bound, upper_bound);
+            get_solution(reader, member);
+            auto member_x = reader.get<std::vector<double>>();
+            if (member_x.size() != static_cast<size_t>(dim)) {
+                throw std::runtime_error("archive member of the wrong dimension");
+            }
+            member.set_x(member_x);
+            loaded_gbest.push_back(std::move(member));
+        }
+        reader.get(loaded_log);
+        if (!reader.at_end()) {
+            throw std::runtime_error("trailing bytes");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring checkpoint " << filename << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    rng::set_run_seed(seed);
+    particles = std::move(loaded_particles);
+    swarm_ = std::move(loaded_swarm);
+    gbest_ = std::move(loaded_gbest);
+    exec_uuid_log_ = std::move(loaded_log);
+    has_pbest_ = std::move(loaded_has_pbest);
+    pending_ = std::move(loaded_pending);
+    iteration_ = iteration;
+    resumed_ = true;
+    return true;
+}
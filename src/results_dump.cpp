@@ -0,0 +1,91 @@
+// Created by: Gregorio Toscano
+//
+// Prints a results log (ResultsStore) as tab-separated lines, one per record.
+//
+// usage: results_dump results.log [--latest] [--origin pso|ipopt|front]
+//   --latest  only the last record of each solution, in first-appended order
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "results_store.h"
+
+namespace {
+    std::string join(const std::vector<double>& values) {
+        std::string joined;
+        for (double value : values) {
+            joined += fmt::format("{}{}", joined.empty() ? "" : ",", value);
+        }
+        return joined;
+    }
+
+    void print(uint64_t offset, const ResultRecord& record) {
+        std::string values;
+        for (const auto& [name, value] : record.values) {
+            values += fmt::format("{}{}={}", values.empty() ? "" : ",", name, value);
+        }
+        std::string files;
+        for (const auto& suffix : record.files) {
+            files += fmt::format("{}{}", files.empty() ? "" : ",", suffix);
+        }
+        fmt::print("{}\t{}\t{}\t{}\t{}\t{}/{}\t{}\t{}\n", offset, record.uuid, to_string(record.origin), join(record.objectives),
+                   record.constraint, record.directory, record.prefix, files, values);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " results.log [--latest] [--origin pso|ipopt|front]" << std::endl;
+        return -1;
+    }
+    std::string filename = argv[1];
+    bool latest = false;
+    std::string origin;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--latest") {
+            latest = true;
+        } else if (arg == "--origin" && i + 1 < argc) {
+            origin = argv[++i];
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    size_t count = 0;
+    std::vector<std::pair<uint64_t, ResultRecord>> last;
+    std::unordered_map<std::string, size_t> position;
+    fmt::print("offset\tuuid\torigin\tobjectives\tconstraint\tlocation\tfiles\tvalues\n");
+    auto end = ResultsStore::scan(filename, [&](uint64_t offset, ResultRecord&& record) {
+        ++count;
+        if (!latest) {
+            if (origin.empty() || origin == to_string(record.origin)) {
+                print(offset, record);
+            }
+            return;
+        }
+        auto [it, is_new] = position.try_emplace(record.uuid, last.size());
+        if (is_new) {
+            last.emplace_back(offset, std::move(record));
+        }
+        else {
+            last[it->second] = {offset, std::move(record)};
+        }
+    });
+    if (end == 0) {
+        std::cerr << filename << " is not a results log" << std::endl;
+        return -1;
+    }
+    for (const auto& [offset, record] : last) {
+        if (origin.empty() || origin == to_string(record.origin)) {
+            print(offset, record);
+        }
+    }
+    std::cerr << fmt::format("{} records, {} bytes\n", count, end);
+    return 0;
+}
@@ -0,0 +1,328 @@
+// Created by: Gregorio Toscano
+//
+// Results log layout: an 8-byte magic and a uint32 version, then one frame per
+// append: uint32 payload size, uint64 payload hash, payload (binary_io.h):
+// uuid, origin, objectives, constraint, values, directory, prefix, files.
+// Bump RESULTS_VERSION whenever the payload changes.
+
+#include "results_store.h"
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "binary_io.h"
+#include "file_clone.h"
+#include "misc_utilities.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr char RESULTS_MAGIC[8] = {'M', 'S', 'U', 'R', 'S', 'L', 'T', '\0'};
+    constexpr uint32_t RESULTS_VERSION = 1;
+    constexpr size_t HEADER_SIZE = sizeof(RESULTS_MAGIC) + sizeof(uint32_t);
+    constexpr size_t FRAME_SIZE = sizeof(uint32_t) + sizeof(uint64_t);
+
+    bool has_header(const char* data, size_t size) {
+        uint32_t version = 0;
+        if (size < HEADER_SIZE || std::memcmp(data, RESULTS_MAGIC, sizeof(RESULTS_MAGIC)) != 0) {
+            return false;
+        }
+        std::memcpy(&version, data + sizeof(RESULTS_MAGIC), sizeof(version));
+        return version == RESULTS_VERSION;
+    }
+
+    ResultRecord decode(const char* payload, size_t size) {
+        binary_io::Reader reader(payload, size);
+        ResultRecord record;
+        reader.get(record.uuid);
+        record.origin = static_cast<ResultOrigin>(reader.get<uint8_t>());
+        reader.get(record.objectives);
+        reader.get(record.constraint);
+        reader.get(record.values);
+        reader.get(record.directory);
+        reader.get(record.prefix);
+        reader.get(record.files);
+        if (!reader.at_end()) {
+            throw std::runtime_error("trailing bytes");
+        }
+        return record;
+    }
+
+    // frames from offset on, up to the first torn or corrupt one; returns where they end
+    uint64_t scan_frames(const char* data, size_t size, uint64_t offset,
+                         const std::function<void(uint64_t, uint32_t, ResultRecord&&)>& visit) {
+        while (size - offset >= FRAME_SIZE) {
+            uint32_t payload_size;
+            uint64_t payload_hash;
+            std::memcpy(&payload_size, data + offset, sizeof(payload_size));
+            std::memcpy(&payload_hash, data + offset + sizeof(payload_size), sizeof(payload_hash));
+            const char* payload = data + offset + FRAME_SIZE;
+            if (size - offset - FRAME_SIZE < payload_size
+                    || misc_utilities::hash_bytes(payload, payload_size, RESULTS_VERSION) != payload_hash) {
+                break;
+            }
+            ResultRecord record;
+            try {
+                record = decode(payload, payload_size);
+            } catch (const std::exception&) {
+                break;
+            }
+            visit(offset, payload_size, std::move(record));
+            offset += FRAME_SIZE + payload_size;
+        }
+        return offset;
+    }
+
+    bool write_all(int fd, const std::string& bytes) {
+        const char* at = bytes.data();
+        size_t left = bytes.size();
+        while (left > 0) {
+            ssize_t written = ::write(fd, at, left);
+            if (written <= 0) {
+                return false;
+            }
+            at += written;
+            left -= written;
+        }
+        return true;
+    }
+}
+
+const char* to_string(ResultOrigin origin) {
+    switch (origin) {
+        case ResultOrigin::pso: return "pso";
+        case ResultOrigin::ipopt: return "ipopt";
+        case ResultOrigin::front: return "front";
+    }
+    return "unknown";
+}
+
+ResultsStore::ResultsStore(std::string filename) : filename_(std::move(filename)) {
+    std::error_code ec;
+    fs::path path(filename_);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+    {
+        binary_io::MappedFile file(filename_);
+        if (file.data() != nullptr && !has_header(file.data(), file.size())) {
+            auto aside = filename_ + ".corrupt";
+            std::cerr << "Moving the unreadable results log " << filename_ << " to " << aside << std::endl;
+            fs::rename(filename_, aside, ec);
+        }
+    }
+    fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open the file: " << filename_ << ", results will not be kept" << std::endl;
+        return;
+    }
+    if (::lseek(fd_, 0, SEEK_END) == 0) {
+        std::string header(RESULTS_MAGIC, sizeof(RESULTS_MAGIC));
+        header.append(reinterpret_cast<const char*>(&RESULTS_VERSION), sizeof(RESULTS_VERSION));
+        write_all(fd_, header);
+    }
+    end_ = HEADER_SIZE;
+    replay();
+    // opening the log is the one place that recovers it: anything past the
+    // intact records was left by a killed run and appends must not follow it
+    auto size = static_cast<uint64_t>(::lseek(fd_, 0, SEEK_END));
+    if (end_ < size) {
+        std::cerr << fmt::format("Dropping {} bytes of a torn record at the end of {}", size - end_, filename_) << std::endl;
+        if (::ftruncate(fd_, end_) != 0) {
+            std::cerr << "Failed to truncate " << filename_ << std::endl;
+        }
+    }
+}
+
+ResultsStore::~ResultsStore() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+std::string ResultsStore::run_filename(const std::string& exec_uuid) {
+    return fmt::format("/opt/opt4cast/output/nsga3/{}/results.log", exec_uuid);
+}
+
+std::string ResultsStore::encode(const ResultRecord& record) {
+    binary_io::Writer writer;
+    writer.put(record.uuid);
+    writer.put(static_cast<uint8_t>(record.origin));
+    writer.put(record.objectives);
+    writer.put(record.constraint);
+    writer.put(record.values);
+    writer.put(record.directory);
+    writer.put(record.prefix);
+    writer.put(record.files);
+    return writer.bytes();
+}
+
+void ResultsStore::index(uint64_t offset, uint32_t size, ResultRecord&& record) {
+    auto [it, is_new] = index_.try_emplace(record.uuid);
+    if (is_new) {
+        order_.push_back(record.uuid);
+    }
+    it->second = Entry{record.origin, std::move(record.objectives), record.constraint, offset, size,
+                       std::move(record.directory), std::move(record.prefix)};
+    ++records_;
+}
+
+void ResultsStore::replay() {
+    binary_io::MappedFile file(filename_);
+    if (file.data() == nullptr || file.size() <= end_) {
+        return;
+    }
+    // stops at a partial tail, which may be a record another process is
+    // still writing: it is picked up by the next call once it is complete
+    end_ = scan_frames(file.data(), file.size(), end_, [&](uint64_t offset, uint32_t size, ResultRecord&& record) {
+        index(offset, size, std::move(record));
+    });
+}
+
+void ResultsStore::refresh() {
+    if (fd_ >= 0) {
+        replay();
+    }
+}
+
+bool ResultsStore::append(const ResultRecord& record) {
+    if (fd_ < 0) {
+        return false;
+    }
+    auto payload = encode(record);
+    uint32_t payload_size = payload.size();
+    uint64_t payload_hash = misc_utilities::hash_bytes(payload.data(), payload.size(), RESULTS_VERSION);
+    std::string frame;
+    frame.reserve(FRAME_SIZE + payload.size());
+    frame.append(reinterpret_cast<const char*>(&payload_size), sizeof(payload_size));
+    frame.append(reinterpret_cast<const char*>(&payload_hash), sizeof(payload_hash));
+    frame += payload;
+    // one write per record, so a killed run leaves at most one torn record
+    if (!write_all(fd_, frame)) {
+        std::cerr << "Failed to append " << record.uuid << " to " << filename_ << std::endl;
+        return false;
+    }
+    // in append mode the file offset is now the end of this record
+    auto offset = static_cast<uint64_t>(::lseek(fd_, 0, SEEK_CUR)) - frame.size();
+    if (offset == end_) {
+        end_ += frame.size();
+        index(offset, payload_size, ResultRecord(record));
+    }
+    else {
+        // another process appended in between
+        replay();
+        if (end_ <= offset) {
+            // its record is not complete yet, but this one is
+            index(offset, payload_size, ResultRecord(record));
+        }
+    }
+    return true;
+}
+
+bool ResultsStore::relocate(const std::string& uuid, const std::string& directory, const std::string& prefix,
+                            std::vector<std::string> files, ResultOrigin origin) {
+    auto record = read(uuid);
+    if (!record) {
+        return false;
+    }
+    record->directory = directory;
+    record->prefix = prefix;
+    record->files = std::move(files);
+    record->origin = origin;
+    return append(*record);
+}
+
+bool ResultsStore::sync() {
+    return fd_ >= 0 && ::fdatasync(fd_) == 0;
+}
+
+const ResultsStore::Entry* ResultsStore::find(const std::string& uuid) const {
+    auto it = index_.find(uuid);
+    return it == index_.end() ? nullptr : &it->second;
+}
+
+std::optional<ResultRecord> ResultsStore::read(const std::string& uuid) const {
+    const Entry* entry = find(uuid);
+    if (entry == nullptr) {
+        return std::nullopt;
+    }
+    std::string payload(entry->size, '\0');
+    if (::pread(fd_, payload.data(), payload.size(), entry->offset + FRAME_SIZE) != static_cast<ssize_t>(payload.size())) {
+        return std::nullopt;
+    }
+    try {
+        return decode(payload.data(), payload.size());
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to read " << uuid << " from " << filename_ << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
+
+std::vector<std::string> ResultsStore::uuids(std::optional<ResultOrigin> origin) const {
+    std::vector<std::string> selected;
+    for (const auto& uuid : order_) {
+        if (!origin || index_.at(uuid).origin == *origin) {
+            selected.push_back(uuid);
+        }
+    }
+    return selected;
+}
+
+std::vector<CostData> ResultsStore::cost_data(ResultOrigin origin) const {
+    std::vector<CostData> data;
+    for (const auto& uuid : order_) {
+        const auto& entry = index_.at(uuid);
+        if (entry.origin != origin || entry.objectives.size() < 2) {
+            continue;
+        }
+        std::optional<double> objective3;
+        if (entry.objectives.size() > 2) {
+            objective3 = entry.objectives[2];
+        }
+        data.push_back(CostData{entry.objectives[0], entry.objectives[1], objective3, uuid});
+    }
+    return data;
+}
+
+uint64_t ResultsStore::scan(const std::string& filename, const std::function<void(uint64_t, ResultRecord&&)>& visit) {
+    binary_io::MappedFile file(filename);
+    if (file.data() == nullptr || !has_header(file.data(), file.size())) {
+        return 0;
+    }
+    return scan_frames(file.data(), file.size(), HEADER_SIZE, [&](uint64_t offset, uint32_t, ResultRecord&& record) {
+        visit(offset, std::move(record));
+    });
+}
+
+std::vector<std::string> transfer_solution_files(const ResultRecord& record, const std::string& directory,
+                                                 const std::string& prefix, bool copy) {
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    std::vector<std::string> transferred;
+    for (const auto& suffix : record.files) {
+        auto source = fmt::format("{}/{}{}", record.directory, record.prefix, suffix);
+        auto destination = fmt::format("{}/{}{}", directory, prefix, suffix);
+        ec.clear();
+        if (copy) {
+            try {
+                file_clone::clone(source, destination);
+            } catch (const fs::filesystem_error& e) {
+                ec = e.code();
+            }
+        }
+        else {
+            fs::rename(source, destination, ec);
+        }
+        if (!ec) {
+            transferred.push_back(suffix);
+        }
+    }
+    return transferred;
+}
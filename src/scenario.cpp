@@ -14,7 +14,7 @@
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/writer.h>
 #include <parquet/exception.h>
-#include <parquet/stream_writer.h>
+#include <parquet/file_writer.h>
 
 #include <arrow/api.h>
 #include <arrow/io/file.h>
@@ -32,14 +32,19 @@
 #include <arrow/status.h>
 #include <arrow/table.h>
 #include <arrow/compute/api_aggregate.h>
+#include <arrow/util/key_value_metadata.h>
 #include <boost/algorithm/string.hpp>   
 
+#include <algorithm>
+#include <filesystem>
+#include <charconv>
 #include <vector>
 #include <tuple>
 #include <memory>
-#include <random>
+#include <optional>
 
 #include "amqp.h"
+#include "artifact_writer.h"
 #include "misc_utilities.h"
 #include "scenario.h"
 
@@ -58,14 +63,20 @@ namespace {
     std::string REDIS_DB_OPT = misc_utilities::get_env_var("REDIS_DB_OPT", "1");
     std::string REDIS_URL = fmt::format("tcp://{}:{}/{}", REDIS_HOST, REDIS_PORT, REDIS_DB_OPT);
 
+    // Read-only replacement for map::operator[]: a missing key yields a
+    // default-constructed value without inserting it, so the lookup tables
+    // can be shared by concurrent evaluations.
+    template <typename Map>
+    const typename Map::mapped_type& find_or_default(const Map& dict, const typename Map::key_type& key) {
+        static const typename Map::mapped_type empty{};
+        auto it = dict.find(key);
+        return it == dict.end() ? empty : it->second;
+    }
 }
 
 // Function to generate a random boolean value (true or false)
 bool should_write_row() {
-    std::random_device rd; // Obtain a random number generator
-    std::mt19937 gen(rd()); // Seed the generator
-    std::uniform_int_distribution<> dis(0, 1); // Generate a random number between 0 and 1
-    return dis(gen) == 1; // Return true or false based on the random number
+    return misc_utilities::rand_double(0.0, 1.0) < 0.5;
 }
 
 
@@ -78,6 +89,7 @@ Scenario::Scenario() {
     lc_size_ = 0;
     animal_size_ = 0;
     manure_size_ = 0;
+    submission_layout_ = SubmissionLayout::Full;
     nvars_ = 0;
     ef_begin_ = 0;
     lc_begin_ = 0;
@@ -86,6 +98,39 @@ Scenario::Scenario() {
 
     std::string msu_cbpo_path = misc_utilities::get_env_var("MSU_CBPO_PATH", "/opt/opt4cast");
     csvs_path = fmt::format("{}/csvs",msu_cbpo_path);
+    snapshot_dir_ = misc_utilities::get_env_var("SCENARIO_SNAPSHOT_DIR", fmt::format("{}/snapshots", msu_cbpo_path));
+    loaded_from_snapshot_ = false;
+}
+
+void Scenario::load_inputs(const std::string& filename, const std::string& filename_scenario, const std::string& manure_nutrients_file) {
+    auto neighbors_file = fmt::format("{}/cast_neighbors.json", csvs_path);
+    std::vector<std::string> input_files = {filename, filename_scenario};
+    if (is_manure_enabled) {
+        input_files.push_back(neighbors_file);
+        input_files.push_back(manure_nutrients_file);
+    }
+
+    std::string snapshot_file;
+    uint64_t key = 0;
+    if (!snapshot_dir_.empty()) {
+        key = snapshot_key(input_files, is_manure_enabled);
+        snapshot_file = fmt::format("{}/scenario_{:016x}.snapshot", snapshot_dir_, key);
+        if (load_snapshot(snapshot_file, key)) {
+            loaded_from_snapshot_ = true;
+            std::cout << "Scenario loaded from snapshot " << snapshot_file << std::endl;
+            return;
+        }
+    }
+
+    load(filename, filename_scenario);
+    if (is_manure_enabled) {
+        // This loads all the neighboring counties 
+        load_neighbors(neighbors_file);
+        manure_dry_lbs_ = read_manure_nutrients(manure_nutrients_file); //call it after load_neighbors
+    }
+    if (!snapshot_file.empty() && !save_snapshot(snapshot_file, key)) {
+        std::cerr << "Failed to write the scenario snapshot " << snapshot_file << std::endl;
+    }
 }
 
 void Scenario::init(const std::string& filename, const std::string& filename_scenario, bool is_ef_enabled, bool is_lc_enabled, bool is_animal_enabled, bool is_manure_enabled, const std::string& manure_nutrients_file) {
@@ -95,7 +140,7 @@ void Scenario::init(const std::string& filename, const std::string& filename_sce
     this->is_animal_enabled = is_animal_enabled;
     this->is_manure_enabled = is_manure_enabled;
     nvars_ = 0;
-    load(filename, filename_scenario);
+    load_inputs(filename, filename_scenario, manure_nutrients_file);
     if (is_ef_enabled) {
         compute_efficiency_keys();
         ef_begin_ = nvars_;
@@ -117,15 +162,7 @@ void Scenario::init(const std::string& filename, const std::string& filename_sce
 
     if (is_manure_enabled) {
         //manure_counties_ = {"43"};//102: Nelson
-        
 
-        // This loads all the neighboring counties 
-        auto neighbors_file = "/opt/opt4cast/csvs/cast_neighbors.json";
-        load_neighbors(neighbors_file);
-
-        manure_dry_lbs_ = read_manure_nutrients(manure_nutrients_file); //call it after load_neighbors
-                                                                        
-                                                                        
         //print manure_dry_lbs_
         fmt::print("Manure Dry Lbs:\n");
         for (const auto& [key, value] : manure_dry_lbs_) {
@@ -139,6 +176,7 @@ void Scenario::init(const std::string& filename, const std::string& filename_sce
         manure_begin_ = nvars_;
         nvars_ += compute_manure_size();
     }
+    compile();
 }
 
 // EFICCIENCY BEGIN
@@ -752,7 +790,7 @@ void Scenario::initialize_vector(std::vector<double>& x) {
  * 
  *
  * */
-void Scenario::sum_alpha(std::unordered_map<std::string, double>& am,  const std::string& key, double acreage) {
+void Scenario::sum_alpha(std::unordered_map<std::string, double>& am,  const std::string& key, double acreage) const {
     double tmp = 0.0;
     if (am.contains(key)) {
         tmp = am.at(key);
@@ -839,51 +877,53 @@ double Scenario::normalize_efficiency(const std::vector<double>& x,
     return 0.0;
 }
 
-double Scenario::compute_cost(const std::vector<std::tuple<int, int, int, int, double>>& parcel) {
+double Scenario::compute_cost(const std::vector<std::tuple<int, int, int, int, double>>& parcel) const {
     double total_cost = 0.0;
     for(const auto& entry : parcel) { 
         auto [lrseg, agency, load_src, bmp_idx, amount] = entry;
-        auto [fips, state, county, geography] = lrseg_dict_[lrseg];
-        auto key_bmp_cost = fmt::format("{}_{}", state, bmp_idx);
-        double cost = amount * bmp_cost_[key_bmp_cost];
+        auto [fips, state, county, geography] = find_or_default(lrseg_dict_, lrseg);
+        double cost = amount * bmp_unit_cost(state, bmp_idx);
         total_cost += cost;
     }
     return total_cost;
 }
 
-double Scenario::compute_cost_animal(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel) {
+double Scenario::compute_cost_animal(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel) const {
     double total_cost = 0.0;
     for(const auto& entry : parcel) { 
         auto [base_condition, county, load_src, animal_id, bmp, amount] = entry; 
-        auto [geography, geography2_id, fips, county_name, state_abbr] = geography_county_[county];
-        auto state = counties_[county];
-        auto key_bmp_cost = fmt::format("{}_{}", state, bmp);
-        double cost = bmp_cost_[key_bmp_cost];
+        auto state = find_or_default(counties_, county);
+        double cost = bmp_unit_cost(state, bmp);
         total_cost += cost;
     }
     return total_cost;
 }
 
-double Scenario::compute_cost_manure(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel) {
+double Scenario::compute_cost_manure(const std::vector<std::tuple<int, int, int, int, int, double>>& parcel) const {
     double total_cost = 0.0;
     for(const auto& entry : parcel) { 
         auto [county_from, county_to, load_src, animal_id, bmp, amount] = entry; 
-        auto [geography_from, geography2_id_from, fips_from, county_name_from, state_abbr_from] = geography_county_[county_from];
-        auto state = counties_[county_from];
-        auto key_bmp_cost = fmt::format("{}_{}", state, bmp);
-        double cost = bmp_cost_[key_bmp_cost];
+        auto state = find_or_default(counties_, county_from);
+        double cost = bmp_unit_cost(state, bmp);
         total_cost += cost;
     }
     return total_cost;
 }
+
+double Scenario::bmp_unit_cost(int state, int bmp) const {
+    if (model_.is_compiled) {
+        return model_.unit_cost(state, bmp);
+    }
+    return find_or_default(bmp_cost_, fmt::format("{}_{}", state, bmp));
+}
 /*
  *
  * 
  * */
-double Scenario::normalize_lc(const std::vector<double>& x, 
+double Scenario::normalize_lc_keyed(const std::vector<double>& x, 
         std::vector<std::tuple<int, int, int, int, double>>& lc_x,
         std::unordered_map<std::string, double>& amount_minus,
-        std::unordered_map<std::string, double>& amount_plus) {
+        std::unordered_map<std::string, double>& amount_plus) const {
     int counter = lc_begin_;
     amount_minus.clear();
     amount_plus.clear();
@@ -891,7 +931,7 @@ double Scenario::normalize_lc(const std::vector<double>& x,
     double total_cost = 0.0;
     //std::vector<std::string> lc_altered_keys;
     for (const auto& key : lc_keys_) {
-        std::vector<std::string> bmp_group =  land_conversion_from_bmp_to[key];
+        const auto& bmp_group = find_or_default(land_conversion_from_bmp_to, key);
         std::vector<std::pair<double, std::string>> grp_tmp;
         std::vector <std::string> key_split;
         double sum = x[counter];
@@ -899,7 +939,7 @@ double Scenario::normalize_lc(const std::vector<double>& x,
         auto [lrseg, agency, load_src] = std::make_tuple(std::stoi(key_split[0]), std::stoi(key_split[1]), std::stoi(key_split[2]));
         ++counter;
 
-        for (std::string bmp : bmp_group) {
+        for (const std::string& bmp : bmp_group) {
             grp_tmp.push_back({x[counter], bmp});
             sum += x[counter];
             ++counter;
@@ -915,31 +955,31 @@ double Scenario::normalize_lc(const std::vector<double>& x,
             misc_utilities::split_str(to, '_', out_to);
             auto bmp = std::stoi(out_to[0]);
             auto key_to = fmt::format("{}_{}_{}", key_split[0], key_split[1], out_to[1]);
-            sum_alpha(amount_plus, key_to, norm_pct * amount_[key]);
+            sum_alpha(amount_plus, key_to, norm_pct * find_or_default(amount_, key));
             pct_accum += norm_pct;
-            if (norm_pct * amount_[key] > 1.0) {
-                double amount = (norm_pct * amount_[key]);
-                auto [fips, state, county, geography] = lrseg_dict_[lrseg];
+            if (norm_pct * find_or_default(amount_, key) > 1.0) {
+                double amount = (norm_pct * find_or_default(amount_, key));
+                auto [fips, state, county, geography] = find_or_default(lrseg_dict_, lrseg);
                 auto key_bmp_cost = fmt::format("{}_{}", state, bmp);
-                double cost = amount * bmp_cost_[key_bmp_cost];
+                double cost = amount * find_or_default(bmp_cost_, key_bmp_cost);
                 total_cost += cost;
-                lc_x.push_back({std::stoi(key_split[0]), std::stoi(key_split[1]), std::stoi(key_split[2]), bmp, norm_pct * amount_[key]});
+                lc_x.push_back({std::stoi(key_split[0]), std::stoi(key_split[1]), std::stoi(key_split[2]), bmp, norm_pct * find_or_default(amount_, key)});
             }
         }
-        sum_alpha(amount_minus, key, pct_accum * amount_[key]);
+        sum_alpha(amount_minus, key, pct_accum * find_or_default(amount_, key));
     }
     //std::cout<<"lc_x: "<<lc_x.size()<<std::endl;
     return total_cost;
 }
 
 
-double Scenario::normalize_animal(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& animal_x) {
+double Scenario::normalize_animal_keyed(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& animal_x) const {
     size_t counter = animal_begin_;
     double total_cost = 0.0;
     animal_x.clear();
     //std::vector<std::string> lc_altered_keys;
     for (const std::string& key : animal_keys_) {
-        std::vector<int> bmp_group =  animal_complete_[key];
+        const auto& bmp_group = find_or_default(animal_complete_, key);
 
         std::vector<std::pair<double, int>> grp_tmp;
         std::vector <std::string> key_split;
@@ -963,12 +1003,12 @@ double Scenario::normalize_animal(const std::vector<double>& x, std::vector<std:
             // std::cout << "Normalize_animal PCT: "<< pct << " Sum: " << sum << std::endl;
             // std::cout << "Norm_pct: " << norm_pct << " Animal_[key]: " << animal_[key] << std::endl;
             // std::cout << "Norm_pct * animal_[key]: " << norm_pct * animal_[key] << std::endl;
-            if (norm_pct * animal_[key] >= 0.0) { // [TEST!] Putting 0.0 as the threshold for testing
+            if (norm_pct * find_or_default(animal_, key) >= 0.0) { // [TEST!] Putting 0.0 as the threshold for testing
                 //std::cout << "Inside Threshold: " << norm_pct * animal_[key] << std::endl;
-                double amount = (norm_pct * animal_[key]);
-                auto state = counties_[county];
+                double amount = (norm_pct * find_or_default(animal_, key));
+                auto state = find_or_default(counties_, county);
                 std::string key_bmp_cost = fmt::format("{}_{}", state, bmp);
-                double cost = amount * bmp_cost_[key_bmp_cost];
+                double cost = amount * find_or_default(bmp_cost_, key_bmp_cost);
                 total_cost += cost;
                 animal_x.push_back({base_condition, county, load_source, animal_id, bmp, amount});
             }
@@ -981,7 +1021,7 @@ double Scenario::normalize_animal(const std::vector<double>& x, std::vector<std:
 
 
 
-double Scenario::normalize_manure(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& manure_x) {
+double Scenario::normalize_manure_keyed(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& manure_x) const {
     size_t counter = manure_begin_;
     double total_cost = 0.0;
     manure_x.clear();
@@ -990,7 +1030,7 @@ double Scenario::normalize_manure(const std::vector<double>& x, std::vector<std:
     
     std::cout << "Normalize_manure Manure_keys_:  " << manure_keys_.size() << std::endl;
     for (const std::string& key : manure_keys_) {
-        std::vector<int> neighbors =  manure_all_[key];
+        const auto& neighbors = find_or_default(manure_all_, key);
 
         std::vector<std::pair<double, int>> grp_tmp;
         std::vector <std::string> key_split;
@@ -1013,15 +1053,15 @@ double Scenario::normalize_manure(const std::vector<double>& x, std::vector<std:
         for (auto [pct, neighbor_to]: grp_tmp) {
 
             double norm_pct =  (MAX_PCT_MANURE_BMP*pct) / sum;
-            if (norm_pct * manure_dry_lbs_[key] >= 0.0) { // [TEST!] Putting 0.0 as the threshold for testing
-                double amount = (norm_pct * manure_dry_lbs_[key]);
+            if (norm_pct * find_or_default(manure_dry_lbs_, key) >= 0.0) { // [TEST!] Putting 0.0 as the threshold for testing
+                double amount = (norm_pct * find_or_default(manure_dry_lbs_, key));
                 //double moisture = 0.7;
                 //amount = amount / (1.0 - moisture); //convert to wet pounds 
                 amount = amount / 2000.0; //convert to wet tons
                                           //convert to dry tons
-                auto state = counties_[county];
+                auto state = find_or_default(counties_, county);
                 std::string key_bmp_cost = fmt::format("{}_{}", state, bmp);
-                double cost = amount * bmp_cost_[key_bmp_cost];
+                double cost = amount * find_or_default(bmp_cost_, key_bmp_cost);
                 total_cost += cost;
                 manure_x.push_back({county, neighbor_to, load_src, animal_id, bmp, amount});
             }
@@ -1032,25 +1072,273 @@ double Scenario::normalize_manure(const std::vector<double>& x, std::vector<std:
     return total_cost;
 }
 
-std::vector<std::string> Scenario::send_files(const std::string& emo_uuid, const std::vector<std::string>& exec_uuid_vec) {
-    std::string emo_str = scenario_data_str_;
-    std::cout << "Emo PSO uuid " << emo_uuid << "str: " << emo_str << std::endl; 
-    RabbitMQClient rabbit(emo_str, emo_uuid);
+void Scenario::compile() {
+    ScenarioModel m;
+
+    // (state, bmp) -> cost per unit. Only keys that round-trip through the
+    // "{state}_{bmp}" format are kept, so lookups match the string keys exactly.
+    std::vector<std::tuple<int, int, double>> costs;
+    for (const auto& [key, cost] : bmp_cost_) {
+        std::vector<std::string> key_split;
+        misc_utilities::split_str(key, '_', key_split);
+        if (key_split.size() != 2) {
+            continue;
+        }
+        try {
+            int state = std::stoi(key_split[0]);
+            int bmp = std::stoi(key_split[1]);
+            if (state < 0 || bmp < 0 || fmt::format("{}_{}", state, bmp) != key) {
+                continue;
+            }
+            m.max_state = std::max(m.max_state, state);
+            m.max_bmp = std::max(m.max_bmp, bmp);
+            costs.emplace_back(state, bmp, cost);
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    m.bmp_cost.assign(static_cast<size_t>(m.max_state + 1) * (m.max_bmp + 1), 0.0);
+    for (const auto& [state, bmp, cost] : costs) {
+        m.bmp_cost[static_cast<size_t>(state) * (m.max_bmp + 1) + bmp] = cost;
+    }
+
+    // Land conversion parcels, in lc_keys_ order.
+    std::unordered_map<std::string, size_t> to_idx;
+    m.lc_offsets.push_back(0);
+    for (const auto& key : lc_keys_) {
+        std::vector<std::string> key_split;
+        misc_utilities::split_str(key, '_', key_split);
+        int lrseg = std::stoi(key_split[0]);
+        auto [fips, state, county, geography] = find_or_default(lrseg_dict_, lrseg);
+        m.lc_keys.push_back(key);
+        m.lc_lrseg.push_back(lrseg);
+        m.lc_agency.push_back(std::stoi(key_split[1]));
+        m.lc_load_src.push_back(std::stoi(key_split[2]));
+        m.lc_amount.push_back(find_or_default(amount_, key));
+        for (const auto& bmp_to : find_or_default(land_conversion_from_bmp_to, key)) {
+            std::vector<std::string> out_to;
+            misc_utilities::split_str(bmp_to, '_', out_to);
+            int bmp = std::stoi(out_to[0]);
+            auto key_to = fmt::format("{}_{}_{}", key_split[0], key_split[1], out_to[1]);
+            auto [it, is_new] = to_idx.try_emplace(key_to, m.lc_to_keys.size());
+            if (is_new) {
+                m.lc_to_keys.push_back(key_to);
+            }
+            m.lc_bmp.push_back(bmp);
+            m.lc_unit_cost.push_back(m.unit_cost(state, bmp));
+            m.lc_to.push_back(it->second);
+        }
+        m.lc_offsets.push_back(m.lc_bmp.size());
+    }
+
+    // Animal parcels, in animal_keys_ order.
+    m.animal_offsets.push_back(0);
+    for (const auto& key : animal_keys_) {
+        std::vector<std::string> key_split;
+        misc_utilities::split_str(key, '_', key_split);
+        int county = std::stoi(key_split[1]);
+        int state = find_or_default(counties_, county);
+        m.animal_base_condition.push_back(std::stoi(key_split[0]));
+        m.animal_county.push_back(county);
+        m.animal_load_src.push_back(std::stoi(key_split[2]));
+        m.animal_id.push_back(std::stoi(key_split[3]));
+        m.animal_units.push_back(find_or_default(animal_, key));
+        for (int bmp : find_or_default(animal_complete_, key)) {
+            m.animal_bmp.push_back(bmp);
+            m.animal_unit_cost.push_back(m.unit_cost(state, bmp));
+        }
+        m.animal_offsets.push_back(m.animal_bmp.size());
+    }
+
+    // Manure transport parcels, in manure_keys_ order.
+    int manure_bmp = 31; //manure transport
+    m.manure_offsets.push_back(0);
+    for (const auto& key : manure_keys_) {
+        std::vector<std::string> key_split;
+        misc_utilities::split_str(key, '_', key_split);
+        int county = std::stoi(key_split[0]);
+        m.manure_county.push_back(county);
+        m.manure_load_src.push_back(std::stoi(key_split[1]));
+        m.manure_animal_id.push_back(std::stoi(key_split[2]));
+        m.manure_dry_lbs.push_back(find_or_default(manure_dry_lbs_, key));
+        m.manure_unit_cost.push_back(m.unit_cost(find_or_default(counties_, county), manure_bmp));
+        for (int neighbor_to : find_or_default(manure_all_, key)) {
+            m.manure_county_to.push_back(neighbor_to);
+        }
+        m.manure_offsets.push_back(m.manure_county_to.size());
+    }
+
+    m.is_compiled = true;
+    model_ = std::move(m);
+}
+
+double Scenario::normalize_lc(const std::vector<double>& x, 
+        std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+        std::unordered_map<std::string, double>& amount_minus,
+        std::unordered_map<std::string, double>& amount_plus) const {
+    if (!model_.is_compiled) {
+        return normalize_lc_keyed(x, lc_x, amount_minus, amount_plus);
+    }
+
+    std::vector<double> minus;
+    std::vector<double> plus;
+    double total_cost = normalize_lc(x, lc_x, minus, plus);
+
+    amount_minus.clear();
+    amount_plus.clear();
+    for (size_t p = 0; p < minus.size(); ++p) {
+        amount_minus[model_.lc_keys[p]] = minus[p];
+    }
+    for (size_t t = 0; t < plus.size(); ++t) {
+        amount_plus[model_.lc_to_keys[t]] = plus[t];
+    }
+    return total_cost;
+}
+
+double Scenario::normalize_lc(const std::vector<double>& x, 
+        std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+        std::vector<double>& amount_minus,
+        std::vector<double>& amount_plus) const {
+    const auto& m = model_;
+    size_t nparcels = m.lc_amount.size();
+    size_t counter = lc_begin_;
+    amount_minus.assign(nparcels, 0.0);
+    amount_plus.assign(m.lc_to_keys.size(), 0.0);
+    lc_x.clear();
+    double total_cost = 0.0;
+
+    for (size_t p = 0; p < nparcels; ++p) {
+        size_t begin = m.lc_offsets[p];
+        size_t end = m.lc_offsets[p + 1];
+        double amount = m.lc_amount[p];
+
+        // x[counter] is the slack variable of the group, followed by one variable per BMP
+        const double* pct = x.data() + counter + 1;
+        double sum = x[counter];
+        for (size_t k = 0; k < end - begin; ++k) {
+            sum += pct[k];
+        }
+
+        double pct_accum = 0.0;
+        for (size_t k = begin; k < end; ++k) {
+            double norm_pct = (MAX_PCT_LC_BMP * pct[k - begin]) / sum;
+            amount_plus[m.lc_to[k]] += norm_pct * amount;
+            pct_accum += norm_pct;
+            if (norm_pct * amount > 1.0) {
+                double acres = norm_pct * amount;
+                total_cost += acres * m.lc_unit_cost[k];
+                lc_x.emplace_back(m.lc_lrseg[p], m.lc_agency[p], m.lc_load_src[p], m.lc_bmp[k], acres);
+            }
+        }
+        amount_minus[p] += pct_accum * amount;
+        counter += 1 + end - begin;
+    }
+    return total_cost;
+}
 
-    for (const auto& exec_uuid : exec_uuid_vec) {
-        rabbit.send_signal(exec_uuid);
+double Scenario::normalize_animal(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& animal_x) const {
+    if (!model_.is_compiled) {
+        return normalize_animal_keyed(x, animal_x);
     }
 
-    auto output_rabbit = rabbit.wait_for_all_data();
+    const auto& m = model_;
+    size_t nparcels = m.animal_units.size();
+    size_t counter = animal_begin_;
+    double total_cost = 0.0;
+    animal_x.clear();
+
+    for (size_t p = 0; p < nparcels; ++p) {
+        size_t begin = m.animal_offsets[p];
+        size_t end = m.animal_offsets[p + 1];
+        double units = m.animal_units[p];
+
+        const double* pct = x.data() + counter + 1;
+        double sum = x[counter];
+        for (size_t k = 0; k < end - begin; ++k) {
+            sum += pct[k];
+        }
+
+        for (size_t k = begin; k < end; ++k) {
+            double norm_pct = (MAX_PCT_ANIMAL_BMP * pct[k - begin]) / sum;
+            if (norm_pct * units >= 0.0) {
+                double amount = norm_pct * units;
+                total_cost += amount * m.animal_unit_cost[k];
+                animal_x.emplace_back(m.animal_base_condition[p], m.animal_county[p], m.animal_load_src[p], m.animal_id[p], m.animal_bmp[k], amount);
+            }
+        }
+        counter += 1 + end - begin;
+    }
+    return total_cost;
+}
+
+double Scenario::normalize_manure(const std::vector<double>& x, std::vector<std::tuple<int, int, int, int, int, double>>& manure_x) const {
+    if (!model_.is_compiled) {
+        return normalize_manure_keyed(x, manure_x);
+    }
+
+    const auto& m = model_;
+    size_t nparcels = m.manure_dry_lbs.size();
+    size_t counter = manure_begin_;
+    double total_cost = 0.0;
+    int bmp = 31; //manure transport
+    manure_x.clear();
+
+    for (size_t p = 0; p < nparcels; ++p) {
+        size_t begin = m.manure_offsets[p];
+        size_t end = m.manure_offsets[p + 1];
+        double dry_lbs = m.manure_dry_lbs[p];
+
+        const double* pct = x.data() + counter + 1;
+        double sum = x[counter];
+        for (size_t k = 0; k < end - begin; ++k) {
+            sum += pct[k];
+        }
+
+        for (size_t k = begin; k < end; ++k) {
+            double norm_pct = (MAX_PCT_MANURE_BMP * pct[k - begin]) / sum;
+            if (norm_pct * dry_lbs >= 0.0) {
+                double amount = (norm_pct * dry_lbs) / 2000.0; //convert to wet tons
+                total_cost += amount * m.manure_unit_cost[p];
+                manure_x.emplace_back(m.manure_county[p], m.manure_county_to[k], m.manure_load_src[p], m.manure_animal_id[p], bmp, amount);
+            }
+        }
+        counter += 1 + end - begin;
+    }
+    return total_cost;
+}
+
+RabbitMQClient& Scenario::rabbit(const std::string& emo_uuid) {
+    if (!rabbit_ || rabbit_emo_uuid_ != emo_uuid) {
+        rabbit_.reset();
+        rabbit_ = std::make_shared<RabbitMQClient>(scenario_data_str_, emo_uuid);
+        rabbit_emo_uuid_ = emo_uuid;
+    }
+    return *rabbit_;
+}
+
+std::vector<std::string> Scenario::send_files(const std::string& emo_uuid, const std::vector<std::string>& exec_uuid_vec) {
+    std::cout << "Emo PSO uuid " << emo_uuid << "str: " << scenario_data_str_ << std::endl; 
+    auto& client = rabbit(emo_uuid);
+    client.send_signals(exec_uuid_vec);
+
+    auto output_rabbit = client.wait_for_all_data();
     return output_rabbit;
 }
 
+void Scenario::dispatch_files(const std::string& emo_uuid, const std::vector<std::string>& exec_uuid_vec) {
+    rabbit(emo_uuid).send_signals(exec_uuid_vec);
+}
+
+std::vector<std::string> Scenario::receive_files(const std::string& emo_uuid) {
+    return rabbit(emo_uuid).wait_for_any_data();
+}
+
 
 
 size_t Scenario::write_land_json(
         const std::vector<std::tuple<int, int, int, int, double>>& lc_x,
         const std::string& out_filename
-) {
+) const {
     std::unordered_map<std::string, double> land_x_to_json;
 
     for (const auto& [lrseg, agency, load_src, bmp_idx, amount] : lc_x) {
@@ -1064,7 +1352,7 @@ size_t Scenario::write_land_json(
     return lc_x.size();
 }
 
-size_t Scenario::write_animal_json(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, const std::string& out_filename) {
+size_t Scenario::write_animal_json(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, const std::string& out_filename) const {
     std::unordered_map<std::string, double> animal_x_to_json;
 
     for(auto [base_condition, county, load_src, animal_id, bmp, amount] : animal_x) {
@@ -1079,7 +1367,7 @@ size_t Scenario::write_animal_json(const std::vector<std::tuple<int, int, int, i
 }
 
 
-size_t Scenario::write_manure_json(const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x, const std::string& out_filename) {
+size_t Scenario::write_manure_json(const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x, const std::string& out_filename) const {
     std::unordered_map<std::string, double> manure_x_to_json;
 
     for(auto [county_from, county_to, load_src, animal_id, bmp, amount] : manure_x) {
@@ -1109,516 +1397,780 @@ size_t Scenario::write_manure_json(const std::vector<std::tuple<int, int, int, i
 //   int32_t  RowIndex;
 // };
 
-int Scenario::write_land(
-        const std::vector<std::tuple<int, int, int, int, double>>& lc_x,
-        const std::string& out_filename, std::vector<BmpRowLand> base_land_bmp_inputs
-) {
-    if (lc_x.size() == 0) {
-        return 0;
+namespace {
+    std::shared_ptr<parquet::schema::GroupNode> land_parquet_schema() {
+        parquet::schema::NodeVector fields;
+
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "BmpSubmittedId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "AgencyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "StateUniqueIdentifier", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "StateId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "BmpId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "GeographyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "LoadSourceGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "UnitId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "Amount", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "IsValid", parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "ErrorMessage", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "RowIndex", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+
+        return std::static_pointer_cast<parquet::schema::GroupNode>(
+                parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
+    }
+
+    std::shared_ptr<parquet::schema::GroupNode> animal_parquet_schema() {
+        parquet::schema::NodeVector fields;
+
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "BmpSubmittedId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "BmpId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "AgencyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "StateUniqueIdentifier", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "StateId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "GeographyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "AnimalGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "LoadSourceGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "UnitId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "Amount", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "NReductionFraction", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "PReductionFraction", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "IsValid", parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "ErrorMessage", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
+        ));
+        fields.push_back(parquet::schema::PrimitiveNode::Make(
+                "RowIndex", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
+        ));
+
+        return std::static_pointer_cast<parquet::schema::GroupNode>(
+                parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
+    }
+
+    std::shared_ptr<parquet::schema::GroupNode> manure_parquet_schema() {
+        parquet::schema::NodeVector fields;
+
+        fields.push_back(parquet::schema::PrimitiveNode::Make("BmpSubmittedId",parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("BmpId", parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("AgencyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("StateUniqueIdentifier", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("StateId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
+
+        fields.push_back(parquet::schema::PrimitiveNode::Make("HasStateReference",parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("CountyIdFrom", parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("CountyIdTo",parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("FipsFrom",parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY,parquet::ConvertedType::UTF8));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("FipsTo", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY,parquet::ConvertedType::UTF8));
+
+        fields.push_back(parquet::schema::PrimitiveNode::Make("AnimalGroupId",parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("LoadSourceGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("UnitId",parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("Amount", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("IsValid", parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("ErrorMessage", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY,parquet::ConvertedType::UTF8));
+        fields.push_back(parquet::schema::PrimitiveNode::Make("RowIndex", parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
+
+        return std::static_pointer_cast<parquet::schema::GroupNode>(
+                parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
+    }
+
+    std::shared_ptr<parquet::WriterProperties> submission_writer_properties() {
+        parquet::WriterProperties::Builder builder;
+        //builder.compression(parquet::Compression::ZSTD);
+        builder.version(parquet::ParquetVersion::PARQUET_1_0);
+        // different in every row, so a dictionary would only be built to be dropped
+        for (const char* column : {"BmpSubmittedId", "StateUniqueIdentifier", "RowIndex"}) {
+            builder.disable_dictionary(column);
+        }
+        return builder.build();
+    }
+
+    // The Arrow side of the schemas above, column for column. Constant and
+    // repeated strings are dictionary arrays; their parquet columns are UTF8
+    // all the same, and no Arrow schema is stored in the file.
+    std::shared_ptr<arrow::DataType> dictionary_utf8() {
+        return arrow::dictionary(arrow::int32(), arrow::utf8());
+    }
+
+    const std::shared_ptr<arrow::Schema>& land_arrow_schema() {
+        static const auto schema = arrow::schema({
+            arrow::field("BmpSubmittedId", arrow::int32(), false),
+            arrow::field("AgencyId", arrow::int32(), false),
+            arrow::field("StateUniqueIdentifier", arrow::utf8(), false),
+            arrow::field("StateId", arrow::int32(), false),
+            arrow::field("BmpId", arrow::int32(), false),
+            arrow::field("GeographyId", arrow::int32(), false),
+            arrow::field("LoadSourceGroupId", arrow::int32(), false),
+            arrow::field("UnitId", arrow::int32(), false),
+            arrow::field("Amount", arrow::float64(), false),
+            arrow::field("IsValid", arrow::boolean(), false),
+            arrow::field("ErrorMessage", dictionary_utf8(), false),
+            arrow::field("RowIndex", arrow::int32(), false),
+        });
+        return schema;
+    }
+
+    const std::shared_ptr<arrow::Schema>& animal_arrow_schema() {
+        static const auto schema = arrow::schema({
+            arrow::field("BmpSubmittedId", arrow::int32(), false),
+            arrow::field("BmpId", arrow::int32(), false),
+            arrow::field("AgencyId", arrow::int32(), false),
+            arrow::field("StateUniqueIdentifier", arrow::utf8(), false),
+            arrow::field("StateId", arrow::int32(), false),
+            arrow::field("GeographyId", arrow::int32(), false),
+            arrow::field("AnimalGroupId", arrow::int32(), false),
+            arrow::field("LoadSourceGroupId", arrow::int32(), false),
+            arrow::field("UnitId", arrow::int32(), false),
+            arrow::field("Amount", arrow::float64(), false),
+            arrow::field("NReductionFraction", arrow::float64(), false),
+            arrow::field("PReductionFraction", arrow::float64(), false),
+            arrow::field("IsValid", arrow::boolean(), false),
+            arrow::field("ErrorMessage", dictionary_utf8(), false),
+            arrow::field("RowIndex", arrow::int32(), false),
+        });
+        return schema;
+    }
+
+    const std::shared_ptr<arrow::Schema>& manure_arrow_schema() {
+        static const auto schema = arrow::schema({
+            arrow::field("BmpSubmittedId", arrow::int32(), false),
+            arrow::field("BmpId", arrow::int32(), false),
+            arrow::field("AgencyId", arrow::int32(), false),
+            arrow::field("StateUniqueIdentifier", arrow::utf8(), false),
+            arrow::field("StateId", arrow::int32(), false),
+            arrow::field("HasStateReference", arrow::boolean(), false),
+            arrow::field("CountyIdFrom", arrow::int32(), false),
+            arrow::field("CountyIdTo", arrow::int32(), false),
+            arrow::field("FipsFrom", dictionary_utf8(), false),
+            arrow::field("FipsTo", dictionary_utf8(), false),
+            arrow::field("AnimalGroupId", arrow::int32(), false),
+            arrow::field("LoadSourceGroupId", arrow::int32(), false),
+            arrow::field("UnitId", arrow::int32(), false),
+            arrow::field("Amount", arrow::float64(), false),
+            arrow::field("IsValid", arrow::boolean(), false),
+            arrow::field("ErrorMessage", dictionary_utf8(), false),
+            arrow::field("RowIndex", arrow::int32(), false),
+        });
+        return schema;
+    }
+
+    using ArrayPtr = std::shared_ptr<arrow::Array>;
+
+    template <typename Builder>
+    ArrayPtr finish(Builder& builder) {
+        ArrayPtr array;
+        PARQUET_THROW_NOT_OK(builder.Finish(&array));
+        return array;
+    }
+
+    // A column holding values as they are.
+    template <typename Builder, typename T>
+    ArrayPtr values_column(const std::vector<T>& values) {
+        Builder builder;
+        PARQUET_THROW_NOT_OK(builder.AppendValues(values));
+        return finish(builder);
+    }
+
+    // A column with get(i) for every row i of rows.
+    template <typename Builder, typename Rows, typename Get>
+    ArrayPtr rows_column(const Rows& rows, Get&& get) {
+        Builder builder;
+        PARQUET_THROW_NOT_OK(builder.Reserve(rows.size()));
+        for (int64_t i = 0; i < rows.size(); ++i) {
+            PARQUET_THROW_NOT_OK(builder.Append(get(i)));
+        }
+        return finish(builder);
     }
 
-    std::shared_ptr<arrow::Schema> schema = arrow::schema ({
-                                                                   arrow::field("BmpSubmittedId", arrow::int32()),
-                                                                   arrow::field("AgencyId", arrow::int32()),
-                                                                   arrow::field("StateUniqueIdentifier", arrow::utf8()), //it can be binary
-                                                                   arrow::field("StateId", arrow::int32()),
-                                                                   arrow::field("BmpId", arrow::int32()),
-                                                                   arrow::field("GeographyId", arrow::int32()),
-                                                                   arrow::field("LoadSourceGroupId", arrow::int32()),
-                                                                   arrow::field("UnitId", arrow::int32()),
-                                                                   arrow::field("Amount", arrow::float64()),
-                                                                   arrow::field("IsValid", arrow::boolean()),
-                                                                   arrow::field("ErrorMessage", arrow::utf8()),//it can be binary
-                                                                   arrow::field("RowIndex", arrow::int32()),
-                                                           });
-    std::unordered_map<int, double> bmp_sum;
-    arrow::Int32Builder bmp_submitted_id, agency_id;
-    arrow::StringBuilder state_unique_identifier;
-    arrow::Int32Builder state_id, bmp_id, geography_id, load_source_id, unit_id_builder;
-    arrow::DoubleBuilder amount_builder;
-    arrow::BooleanBuilder is_valid;
-    arrow::StringBuilder error_message;
-    arrow::Int32Builder row_index;
-
-
-    std::shared_ptr<arrow::io::FileOutputStream> outfile;
-    std::shared_ptr<arrow::io::FileOutputStream> new_bmps_outfile;
+    // n times value: int32_t, double or bool.
+    template <typename T>
+    ArrayPtr constant_column(T value, int64_t n) {
+        ArrayPtr array;
+        PARQUET_ASSIGN_OR_THROW(array, arrow::MakeArrayFromScalar(*arrow::MakeScalar(value), n));
+        return array;
+    }
 
-    std::string new_bmps_out_filename = out_filename;
-    auto pos = new_bmps_out_filename.rfind(".parquet");
-    if (pos != std::string::npos) {
-        new_bmps_out_filename.insert(pos, "_new_bmps");
+    // n times value as a dictionary of one string.
+    ArrayPtr constant_string(const std::string& value, int64_t n) {
+        arrow::StringBuilder dictionary;
+        PARQUET_THROW_NOT_OK(dictionary.Append(value));
+        ArrayPtr array;
+        PARQUET_ASSIGN_OR_THROW(array, arrow::DictionaryArray::FromArrays(
+                dictionary_utf8(), constant_column<int32_t>(0, n), finish(dictionary)));
+        return array;
     }
-    
 
-    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(out_filename));
-    PARQUET_ASSIGN_OR_THROW(new_bmps_outfile, arrow::io::FileOutputStream::Open(new_bmps_out_filename));
-
-    parquet::WriterProperties::Builder builder;
-    //builder.compression(parquet::Compression::ZSTD);
-    builder.version(parquet::ParquetVersion::PARQUET_1_0);
-
-    std::shared_ptr<parquet::schema::GroupNode> my_schema;
-
-    parquet::schema::NodeVector fields;
-
-
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "BmpSubmittedId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "AgencyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "StateUniqueIdentifier", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "StateId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "BmpId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "GeographyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "LoadSourceGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "UnitId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "Amount", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "IsValid", parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "ErrorMessage", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "RowIndex", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-
-    my_schema = std::static_pointer_cast<parquet::schema::GroupNode>(
-            parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
-
-    parquet::StreamWriter os{
-            parquet::ParquetFileWriter::Open(outfile, my_schema, builder.build())};
-
-    parquet::StreamWriter new_bmp_os{
-            parquet::ParquetFileWriter::Open(new_bmps_outfile, my_schema, builder.build())};
+    // first, first + 1, ..., the BmpSubmittedId and RowIndex columns.
+    ArrayPtr sequence_column(int32_t first, int64_t n) {
+        arrow::Int32Builder builder;
+        PARQUET_THROW_NOT_OK(builder.Reserve(n));
+        for (int64_t i = 0; i < n; ++i) {
+            builder.UnsafeAppend(static_cast<int32_t>(first + i));
+        }
+        return finish(builder);
+    }
+
+    // SU{first}, SU{first + 1}, ..., written straight into the value buffer.
+    ArrayPtr su_column(int32_t first, int64_t n) {
+        arrow::StringBuilder builder;
+        PARQUET_THROW_NOT_OK(builder.Reserve(n));
+        PARQUET_THROW_NOT_OK(builder.ReserveData(n * 13));
+        char su[16] = {'S', 'U'};
+        for (int64_t i = 0; i < n; ++i) {
+            auto end = std::to_chars(su + 2, su + sizeof(su), first + i).ptr;
+            builder.UnsafeAppend(su, static_cast<int32_t>(end - su));
+        }
+        return finish(builder);
+    }
+
+    // The base rows as they appear at the top of every full submission file.
+    std::shared_ptr<arrow::RecordBatch> land_base_batch(const BmpTableLand& rows) {
+        int64_t n = rows.size();
+        return arrow::RecordBatch::Make(land_arrow_schema(), n, {
+            sequence_column(1, n),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.AgencyId(i); }),
+            rows_column<arrow::StringBuilder>(rows, [&](int64_t i) { return rows.StateUniqueIdentifier(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.StateId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.BmpId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.GeographyId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.LoadSourceGroupId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.UnitId(i); }),
+            rows_column<arrow::DoubleBuilder>(rows, [&](int64_t i) { return rows.Amount(i); }),
+            rows_column<arrow::BooleanBuilder>(rows, [&](int64_t i) { return rows.IsValid(i); }),
+            rows_column<arrow::StringDictionary32Builder>(rows, [&](int64_t i) { return rows.ErrorMessage(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.RowIndex(i); }),
+        });
+    }
+
+    std::shared_ptr<arrow::RecordBatch> animal_base_batch(const BmpTableAnimal& rows) {
+        int64_t n = rows.size();
+        return arrow::RecordBatch::Make(animal_arrow_schema(), n, {
+            sequence_column(1, n),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.BmpId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.AgencyId(i); }),
+            su_column(0, n),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.StateId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.GeographyId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.AnimalGroupId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.LoadSourceGroupId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.UnitId(i); }),
+            rows_column<arrow::DoubleBuilder>(rows, [&](int64_t i) { return rows.Amount(i); }),
+            rows_column<arrow::DoubleBuilder>(rows, [&](int64_t i) { return rows.NReductionFraction(i); }),
+            rows_column<arrow::DoubleBuilder>(rows, [&](int64_t i) { return rows.PReductionFraction(i); }),
+            constant_column(true, n),
+            constant_string("", n),
+            sequence_column(1, n),
+        });
+    }
+
+    std::shared_ptr<arrow::RecordBatch> manure_base_batch(const BmpTableManure& rows) {
+        int64_t n = rows.size();
+        return arrow::RecordBatch::Make(manure_arrow_schema(), n, {
+            sequence_column(1, n),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.BmpId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.AgencyId(i); }),
+            su_column(0, n),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.StateId(i); }),
+            rows_column<arrow::BooleanBuilder>(rows, [&](int64_t i) { return rows.HasStateReference(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.CountyIdFrom(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.CountyIdTo(i); }),
+            rows_column<arrow::StringDictionary32Builder>(rows, [&](int64_t i) { return rows.FIPSFrom(i); }),
+            rows_column<arrow::StringDictionary32Builder>(rows, [&](int64_t i) { return rows.FIPSTo(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.AnimalGroupId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.LoadSourceGroupId(i); }),
+            rows_column<arrow::Int32Builder>(rows, [&](int64_t i) { return rows.UnitId(i); }),
+            rows_column<arrow::DoubleBuilder>(rows, [&](int64_t i) { return rows.Amount(i); }),
+            constant_column(true, n),
+            constant_string("", n),
+            sequence_column(1, n),
+        });
+    }
+
+    // Encodes a submission file into sink, the batches one after another in
+    // a single row group. A non-empty base_file is recorded in the footer so a
+    // delta file can later be merged back with its base rows.
+    void encode_submission(const std::shared_ptr<arrow::io::OutputStream>& sink,
+            const std::shared_ptr<parquet::schema::GroupNode>& parquet_schema,
+            const std::shared_ptr<arrow::Schema>& schema,
+            const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches,
+            const std::string& base_file = "") {
+        std::shared_ptr<const arrow::KeyValueMetadata> metadata;
+        if (!base_file.empty()) {
+            metadata = arrow::key_value_metadata({"base_file"}, {base_file});
+        }
+        // the parquet schema is given rather than derived from the Arrow one,
+        // so the files keep the exact column types CAST reads
+        std::unique_ptr<parquet::arrow::FileWriter> writer;
+        PARQUET_THROW_NOT_OK(parquet::arrow::FileWriter::Make(arrow::default_memory_pool(),
+                parquet::ParquetFileWriter::Open(sink, parquet_schema, submission_writer_properties(), metadata),
+                schema, parquet::default_arrow_writer_properties(), &writer));
+
+        std::shared_ptr<arrow::Table> table;
+        PARQUET_ASSIGN_OR_THROW(table, arrow::Table::FromRecordBatches(schema, batches));
+        PARQUET_THROW_NOT_OK(writer->WriteTable(*table, std::max<int64_t>(table->num_rows(), 1)));
+        PARQUET_THROW_NOT_OK(writer->Close());
+    }
+
+    void write_submission(const std::string& filename,
+            const std::shared_ptr<parquet::schema::GroupNode>& parquet_schema,
+            const std::shared_ptr<arrow::Schema>& schema,
+            const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches,
+            const std::string& base_file = "") {
+        std::shared_ptr<arrow::io::FileOutputStream> outfile;
+        PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(filename));
+        encode_submission(outfile, parquet_schema, schema, batches, base_file);
+        PARQUET_THROW_NOT_OK(outfile->Close());
+    }
+
+    // A Parquet file is "PAR1", its row groups, the thrift footer, the footer
+    // length (4 bytes, little endian) and "PAR1" again.
+    constexpr int64_t parquet_magic_size = 4;
+
+    int64_t footer_offset(const arrow::Buffer& file) {
+        const uint8_t* length = file.data() + file.size() - parquet_magic_size - 4;
+        uint32_t footer_size = length[0] | length[1] << 8 | length[2] << 16 | static_cast<uint32_t>(length[3]) << 24;
+        return file.size() - parquet_magic_size - 4 - footer_size;
+    }
+
+    std::shared_ptr<parquet::FileMetaData> read_footer(const arrow::Buffer& file) {
+        int64_t offset = footer_offset(file);
+        uint32_t footer_size = file.size() - parquet_magic_size - 4 - offset;
+        return parquet::FileMetaData::Make(file.data() + offset, &footer_size);
+    }
+
+    // An in-memory sink whose positions are shifted by offset, so that the
+    // offsets the parquet writer records in the footer are already those the
+    // bytes get once they are copied to offset in another file. The writer
+    // refuses to start anywhere but at 0, so the shift only applies from the
+    // first byte on.
+    class OffsetBufferStream : public arrow::io::OutputStream {
+    public:
+        explicit OffsetBufferStream(int64_t offset) : offset_(offset) {
+            PARQUET_ASSIGN_OR_THROW(buffer_, arrow::io::BufferOutputStream::Create());
+        }
 
-    int counter = 0;
-    std::cout << "Adding the base BMP land inputs" << std::endl;
-    for (const auto& bmp : base_land_bmp_inputs) {
-        // unpack all 12 fields from BmpRow:
-        const auto& [
-        BmpSubmittedId,
-        AgencyId,
-        StateUniqueIdentifier,
-        StateId,
-        BmpId,
-        GeographyId,
-        LoadSourceGroupId,
-        UnitId,
-        Amount,
-        IsValid,
-        ErrorMessage,
-        RowIndex
-        ] = bmp;
-
-        os
-        << /* row number */        counter + 1
-        << /* agency */            AgencyId
-        << /* state UID */         StateUniqueIdentifier
-        << /* state id */          StateId
-        << /* bmp id */            BmpId
-        << /* geography from dict*/GeographyId
-        << /* load source grp */   LoadSourceGroupId
-        << /* unit id */           UnitId
-        << /* amount */            Amount
-        << /* validity */          IsValid
-        << /* error msg */         ErrorMessage
-        << /* row index */         RowIndex
-        << parquet::EndRow;
+        arrow::Status Close() override {
+            return buffer_->Close();
+        }
+        bool closed() const override {
+            return buffer_->closed();
+        }
+        arrow::Result<int64_t> Tell() const override {
+            ARROW_ASSIGN_OR_RAISE(int64_t position, buffer_->Tell());
+            return position == 0 ? 0 : offset_ + position;
+        }
+        using arrow::io::OutputStream::Write;
+        arrow::Status Write(const void* data, int64_t nbytes) override {
+            return buffer_->Write(data, nbytes);
+        }
 
-        ++counter;
-    }
+        arrow::Result<std::shared_ptr<arrow::Buffer>> Finish() {
+            return buffer_->Finish();
+        }
 
-    std::cout << "Adding the new BMP inputs" << std::endl;
-    for (const auto& entry : lc_x) {
-        auto [lrseg, agency, load_src, bmp_idx, amount] = entry;
-        auto [fips, state, county, geography] = lrseg_dict_[lrseg];
-        int load_src_grp = u_u_group_dict[load_src];
-        int unit = 1; //acres
-        os
-            <<counter+1
-            <<agency
-            <<fmt::format("SU{}",counter)
-            <<state
-            <<bmp_idx
-            <<geography
-            <<load_src_grp
-            <<unit
-            <<amount
-            <<true
-            <<""
-            <<counter+1
-            <<parquet::EndRow;
-        new_bmp_os
-            <<counter+1
-            <<agency
-            <<fmt::format("SU{}",counter)
-            <<state
-            <<bmp_idx
-            <<geography
-            <<load_src_grp
-            <<unit
-            <<amount
-            <<true
-            <<""
-            <<counter+1
-            <<parquet::EndRow;
-        counter++;
-    }
-
-   
+    private:
+        int64_t offset_;
+        std::shared_ptr<arrow::io::BufferOutputStream> buffer_;
+    };
+
+    // Writes a full submission file from the base rows, already encoded as a
+    // whole file, and the new rows. The base row groups are copied as they
+    // are and only the new rows are encoded, into one more row group; the
+    // footer is the base one with that row group appended.
+    //
+    // Only row groups are spliced, so the writer properties must keep the
+    // page indexes and bloom filters off (they are by default).
+    void splice_submission(const std::string& filename,
+            const std::shared_ptr<parquet::schema::GroupNode>& parquet_schema,
+            const std::shared_ptr<arrow::Schema>& schema,
+            const arrow::Buffer& base,
+            const std::vector<std::shared_ptr<arrow::RecordBatch>>& new_rows) {
+        auto metadata = read_footer(base);
+        if (metadata->num_rows() == 0) {
+            write_submission(filename, parquet_schema, schema, new_rows);
+            return;
+        }
+        int64_t base_end = footer_offset(base);
+        int64_t nrows = 0;
+        for (const auto& batch : new_rows) {
+            nrows += batch->num_rows();
+        }
 
+        std::shared_ptr<arrow::io::FileOutputStream> outfile;
+        PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(filename));
+        PARQUET_THROW_NOT_OK(outfile->Write(base.data(), base_end));
+        if (nrows > 0) {
+            // the new rows are encoded as a file of their own whose leading
+            // "PAR1" would end where the base row groups do, and only their
+            // row group is kept
+            auto sink = std::make_shared<OffsetBufferStream>(base_end - parquet_magic_size);
+            encode_submission(sink, parquet_schema, schema, new_rows);
+            std::shared_ptr<arrow::Buffer> encoded;
+            PARQUET_ASSIGN_OR_THROW(encoded, sink->Finish());
+            PARQUET_THROW_NOT_OK(outfile->Write(encoded->data() + parquet_magic_size,
+                    footer_offset(*encoded) - parquet_magic_size));
+            metadata->AppendRowGroups(*read_footer(*encoded));
+        }
+        parquet::WriteFileMetaData(*metadata, outfile.get());
+        PARQUET_THROW_NOT_OK(outfile->Close());
+    }
 
-    return counter;
+    template <typename Rows>
+    std::shared_ptr<arrow::Buffer> encode_base(const Rows& rows, std::shared_ptr<arrow::RecordBatch> (*build)(const Rows&),
+            const std::shared_ptr<parquet::schema::GroupNode>& parquet_schema,
+            const std::shared_ptr<arrow::Schema>& schema) {
+        std::shared_ptr<arrow::io::BufferOutputStream> sink;
+        PARQUET_ASSIGN_OR_THROW(sink, arrow::io::BufferOutputStream::Create());
+        encode_submission(sink, parquet_schema, schema, {build(rows)});
+        std::shared_ptr<arrow::Buffer> file;
+        PARQUET_ASSIGN_OR_THROW(file, sink->Finish());
+        return file;
+    }
 
-    // Write just the first row
-    // bool write_row = should_write_row();
-    // // If write_row is true, proceed with writing the first row
-    // if (write_row) {
-    //     auto [lrseg, agency, load_src, bmp_idx, amount] = lc_x[0]; // Get the first element
-    //     auto [fips, state, county, geography] = lrseg_dict_[lrseg];
-    //     int load_src_grp = u_u_group_dict[load_src];
-    //     int unit = 1; // acres
+    std::shared_ptr<arrow::Buffer> land_base_file(const BmpTableLand& rows) {
+        return encode_base(rows, land_base_batch, land_parquet_schema(), land_arrow_schema());
+    }
 
-    //     os << 1 << agency << fmt::format("SU{}", 1) << state << bmp_idx << geography << load_src_grp << unit << amount << true << "" << 1 << parquet::EndRow;
-    // }
+    std::shared_ptr<arrow::Buffer> animal_base_file(const BmpTableAnimal& rows) {
+        return encode_base(rows, animal_base_batch, animal_parquet_schema(), animal_arrow_schema());
+    }
 
-    // return write_row ? 1 : 0;  // Return 1 if a row was written, 0 if not
-}
+    std::shared_ptr<arrow::Buffer> manure_base_file(const BmpTableManure& rows) {
+        return encode_base(rows, manure_base_batch, manure_parquet_schema(), manure_arrow_schema());
+    }
 
-int Scenario::write_animal( const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, const std::string& out_filename, std::vector<BmpRowAnimal> base_animal_bmp_inputs) {
-    if (animal_x.size() == 0) {
-        return 0;
+    // The file set_base_inputs() encoded for rows, or a new one if rows are
+    // not the table it was encoded from.
+    template <typename Rows>
+    std::shared_ptr<arrow::Buffer> base_file(const BaseRowGroups& cached, const Rows& rows,
+            std::shared_ptr<arrow::Buffer> (*encode)(const Rows&)) {
+        if (cached.file && cached.table == rows.table().get()) {
+            return cached.file;
+        }
+        return encode(rows);
+    }
+
+    // Writes the _new_bmps file of new_rows, or queues it on writer when there
+    // is one.
+    void write_new_bmps(ArtifactWriter* writer, const std::string& filename,
+            std::shared_ptr<parquet::schema::GroupNode> parquet_schema,
+            std::shared_ptr<arrow::Schema> schema,
+            std::shared_ptr<arrow::RecordBatch> new_rows,
+            std::string base_file) {
+        if (writer == nullptr) {
+            write_submission(filename, parquet_schema, schema, {new_rows}, base_file);
+            return;
+        }
+        writer->submit(filename, [=](const std::string& out_filename) {
+            write_submission(out_filename, parquet_schema, schema, {new_rows}, base_file);
+        });
     }
 
-    parquet::schema::NodeVector fields;
-
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "BmpSubmittedId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "BmpId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "AgencyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "StateUniqueIdentifier", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "StateId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "GeographyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "AnimalGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "LoadSourceGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "UnitId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "Amount", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "NReductionFraction", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "PReductionFraction", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "IsValid", parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "ErrorMessage", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8
-    ));
-    fields.push_back(parquet::schema::PrimitiveNode::Make(
-            "RowIndex", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32
-    ));
-
-    std::shared_ptr<arrow::io::FileOutputStream> outfile;
-    std::shared_ptr<arrow::io::FileOutputStream> new_bmps_outfile;
+    void write_buffer(const std::string& filename, const arrow::Buffer& buffer) {
+        std::shared_ptr<arrow::io::FileOutputStream> outfile;
+        PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(filename));
+        PARQUET_THROW_NOT_OK(outfile->Write(buffer.data(), buffer.size()));
+        PARQUET_THROW_NOT_OK(outfile->Close());
+    }
+}
 
+std::string Scenario::delta_filename(const std::string& out_filename) {
     std::string new_bmps_out_filename = out_filename;
     auto pos = new_bmps_out_filename.rfind(".parquet");
     if (pos != std::string::npos) {
         new_bmps_out_filename.insert(pos, "_new_bmps");
+    } else {
+        new_bmps_out_filename += "_new_bmps";
     }
+    return new_bmps_out_filename;
+}
 
-    PARQUET_ASSIGN_OR_THROW(outfile,arrow::io::FileOutputStream::Open(out_filename));
-    PARQUET_ASSIGN_OR_THROW(new_bmps_outfile, arrow::io::FileOutputStream::Open(new_bmps_out_filename));
+std::string Scenario::submission_filename(const std::string& out_filename) const {
+    return submission_layout_ == SubmissionLayout::Delta ? delta_filename(out_filename) : out_filename;
+}
 
+void Scenario::set_base_inputs(const BmpTableLand& land, const BmpTableAnimal& animal, const BmpTableManure& manure) {
+    base_land_row_groups_ = {land.table().get(), land_base_file(land)};
+    base_animal_row_groups_ = {animal.table().get(), animal_base_file(animal)};
+    base_manure_row_groups_ = {manure.table().get(), manure_base_file(manure)};
+}
+
+int Scenario::write_land_base(const std::string& out_filename, const BmpTableLand& base_land_bmp_inputs) {
+    write_buffer(out_filename, *base_file(base_land_row_groups_, base_land_bmp_inputs, land_base_file));
+    base_land_file_ = out_filename;
+    return base_land_bmp_inputs.size();
+}
 
-    std::shared_ptr<parquet::schema::GroupNode> my_schema = std::static_pointer_cast<parquet::schema::GroupNode>(
-            parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
+int Scenario::write_animal_base(const std::string& out_filename, const BmpTableAnimal& base_animal_bmp_inputs) {
+    write_buffer(out_filename, *base_file(base_animal_row_groups_, base_animal_bmp_inputs, animal_base_file));
+    base_animal_file_ = out_filename;
+    return base_animal_bmp_inputs.size();
+}
 
-    parquet::WriterProperties::Builder builder;
-    //builder.compression(parquet::Compression::ZSTD);
-    builder.version(parquet::ParquetVersion::PARQUET_1_0);
+int Scenario::write_manure_base(const std::string& out_filename, const BmpTableManure& base_manure_bmp_inputs) {
+    write_buffer(out_filename, *base_file(base_manure_row_groups_, base_manure_bmp_inputs, manure_base_file));
+    base_manure_file_ = out_filename;
+    return base_manure_bmp_inputs.size();
+}
 
-    parquet::StreamWriter os{
-        parquet::ParquetFileWriter::Open(outfile, my_schema, builder.build())};
-    parquet::StreamWriter new_bmp_os{
-        parquet::ParquetFileWriter::Open(new_bmps_outfile, my_schema, builder.build())};
+int Scenario::write_land(
+        const std::vector<std::tuple<int, int, int, int, double>>& lc_x,
+        const std::string& out_filename, const BmpTableLand& base_land_bmp_inputs
+) const {
+    if (lc_x.size() == 0) {
+        return 0;
+    }
 
-    std::cout << "Adding the base BMP Animal" << std::endl;
+    // The new rows are built once, column by column, and go to both files;
+    // their ids continue after the base rows.
+    int counter = base_land_bmp_inputs.size();
+    int64_t n = lc_x.size();
+    std::vector<int32_t> agency(n), state(n), bmp(n), geography(n), load_src_grp(n);
+    std::vector<double> amount(n);
+    for (int64_t i = 0; i < n; ++i) {
+        const auto& [lrseg, agency_id, load_src, bmp_idx, acres] = lc_x[i];
+        const auto& [fips, state_id, county, geography_id] = find_or_default(lrseg_dict_, lrseg);
+        agency[i] = agency_id;
+        state[i] = state_id;
+        bmp[i] = bmp_idx;
+        geography[i] = geography_id;
+        load_src_grp[i] = find_or_default(u_u_group_dict, load_src);
+        amount[i] = acres;
+    }
+    auto new_rows = arrow::RecordBatch::Make(land_arrow_schema(), n, {
+        sequence_column(counter + 1, n),
+        values_column<arrow::Int32Builder>(agency),
+        su_column(counter, n),
+        values_column<arrow::Int32Builder>(state),
+        values_column<arrow::Int32Builder>(bmp),
+        values_column<arrow::Int32Builder>(geography),
+        values_column<arrow::Int32Builder>(load_src_grp),
+        constant_column<int32_t>(1, n), // acres
+        values_column<arrow::DoubleBuilder>(amount),
+        constant_column(true, n),
+        constant_string("", n),
+        sequence_column(counter + 1, n),
+    });
+
+    // In the delta layout only the new rows are written; the base rows are
+    // kept in the shared base file.
+    bool is_delta = submission_layout_ == SubmissionLayout::Delta;
+    if (!is_delta) {
+        splice_submission(out_filename, land_parquet_schema(), land_arrow_schema(),
+                *base_file(base_land_row_groups_, base_land_bmp_inputs, land_base_file), {new_rows});
+    }
+    // CAST reads the _new_bmps file in the delta layout, so only the full
+    // layout's copy may be left to the artifact writer
+    write_new_bmps(is_delta ? nullptr : artifacts_.get(), delta_filename(out_filename),
+            land_parquet_schema(), land_arrow_schema(), new_rows, is_delta ? base_land_file_ : "");
+
+    return counter + n;
+}
 
-    // This adds the base animal bmps 
-    int counter = 0;
-    double total_cost = 0.0; 
-    for(auto bmp : base_animal_bmp_inputs){
-        const auto& [
-        BmpSubmittedId,
-        BmpId,
-        AgencyId,
-        StateUniqueIdentifier,
-        StateId,
-        GeographyId,
-        AnimalGroupId,
-        LoadSourceGroupId,
-        UnitId,
-        Amount,
-        NReductionFraction,
-        PReductionFraction,
-        IsValid,
-        ErrorMessage,
-        RowIndex
-        ] = bmp;
-
-        os
-            <<counter+1
-            <<BmpId
-            <<AgencyId
-            <<fmt::format("SU{}",counter)
-            <<StateId
-            <<GeographyId
-            <<AnimalGroupId
-            <<LoadSourceGroupId
-            <<UnitId
-            <<Amount
-            <<NReductionFraction
-            <<PReductionFraction
-            <<true
-            <<""
-            <<counter+1
-            <<parquet::EndRow;
-
-        counter++;
-    }
-
-    // This part add the additonal animal bmps
-    for(auto [base_condition, county, load_src, animal_id, bmp, amount] : animal_x) {
-        auto [geography, geography2_id, fips, county_name, state_abbr] = geography_county_[county];
-        auto state = counties_[county];
-        int unit_id = 13; // au unit (unit id table)
-        auto key_bmp_cost = fmt::format("{}_{}", state, bmp);
-        double cost = bmp_cost_[key_bmp_cost];
-        int agency = 9; // Non-Federal
-        double nreduction=0.0;
-        double preduction=0.0;
-
-        os
-            <<counter+1
-            <<bmp
-            <<agency
-            <<fmt::format("SU{}",counter)
-            <<state
-            <<geography2_id
-            <<animal_id
-            <<u_u_group_dict[load_src]
-            <<unit_id
-            <<amount
-            <<nreduction
-            <<preduction
-            <<true
-            <<""
-            <<counter+1
-            <<parquet::EndRow;
-
-        new_bmp_os
-            <<counter+1
-            <<bmp
-            <<agency
-            <<fmt::format("SU{}",counter)
-            <<state
-            <<geography2_id
-            <<animal_id
-            <<u_u_group_dict[load_src]
-            <<unit_id
-            <<amount
-            <<nreduction
-            <<preduction
-            <<true
-            <<""
-            <<counter+1
-            <<parquet::EndRow;
-
-        counter++;
+int Scenario::write_animal( const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, const std::string& out_filename, const BmpTableAnimal& base_animal_bmp_inputs) const {
+    if (animal_x.size() == 0) {
+        return 0;
     }
 
-    return counter;
+    int counter = base_animal_bmp_inputs.size();
+    int64_t n = animal_x.size();
+    std::vector<int32_t> bmp(n), state(n), geography(n), animal(n), load_src_grp(n);
+    std::vector<double> amount(n);
+    for (int64_t i = 0; i < n; ++i) {
+        const auto& [base_condition, county, load_src, animal_id, bmp_id, au] = animal_x[i];
+        bmp[i] = bmp_id;
+        state[i] = find_or_default(counties_, county);
+        geography[i] = std::get<1>(find_or_default(geography_county_, county));
+        animal[i] = animal_id;
+        load_src_grp[i] = find_or_default(u_u_group_dict, load_src);
+        amount[i] = au;
+    }
+    auto new_rows = arrow::RecordBatch::Make(animal_arrow_schema(), n, {
+        sequence_column(counter + 1, n),
+        values_column<arrow::Int32Builder>(bmp),
+        constant_column<int32_t>(9, n), // Non-Federal
+        su_column(counter, n),
+        values_column<arrow::Int32Builder>(state),
+        values_column<arrow::Int32Builder>(geography),
+        values_column<arrow::Int32Builder>(animal),
+        values_column<arrow::Int32Builder>(load_src_grp),
+        constant_column<int32_t>(13, n), // au unit (unit id table)
+        values_column<arrow::DoubleBuilder>(amount),
+        constant_column(0.0, n),
+        constant_column(0.0, n),
+        constant_column(true, n),
+        constant_string("", n),
+        sequence_column(counter + 1, n),
+    });
+
+    bool is_delta = submission_layout_ == SubmissionLayout::Delta;
+    if (!is_delta) {
+        splice_submission(out_filename, animal_parquet_schema(), animal_arrow_schema(),
+                *base_file(base_animal_row_groups_, base_animal_bmp_inputs, animal_base_file), {new_rows});
+    }
+    write_new_bmps(is_delta ? nullptr : artifacts_.get(), delta_filename(out_filename),
+            animal_parquet_schema(), animal_arrow_schema(), new_rows, is_delta ? base_animal_file_ : "");
+
+    return counter + n;
 }
 
-int Scenario::write_manure(const std::vector<std::tuple<int,int,int,int,int,double>>& manure_x,const std::string& out_filename, const std::vector<BmpRowManure>& base_manure_bmp_inputs
-) {
+int Scenario::write_manure(const std::vector<std::tuple<int,int,int,int,int,double>>& manure_x,const std::string& out_filename, const BmpTableManure& base_manure_bmp_inputs
+) const {
 
     if (manure_x.size() == 0 && base_manure_bmp_inputs.size() == 0) {
         std::cout << "manure inputs are empty" << std::endl;
         return 0;
     }
 
-    parquet::schema::NodeVector fields;
-
-    fields.push_back(parquet::schema::PrimitiveNode::Make("BmpSubmittedId",parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("BmpId", parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("AgencyId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("StateUniqueIdentifier", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY, parquet::ConvertedType::UTF8));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("StateId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
-
-    fields.push_back(parquet::schema::PrimitiveNode::Make("HasStateReference",parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("CountyIdFrom", parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("CountyIdTo",parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("FipsFrom",parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY,parquet::ConvertedType::UTF8));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("FipsTo", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY,parquet::ConvertedType::UTF8));
-
-    fields.push_back(parquet::schema::PrimitiveNode::Make("AnimalGroupId",parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("LoadSourceGroupId", parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("UnitId",parquet::Repetition::REQUIRED, parquet::Type::INT32, parquet::ConvertedType::INT_32));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("Amount", parquet::Repetition::REQUIRED, parquet::Type::DOUBLE));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("IsValid", parquet::Repetition::REQUIRED, parquet::Type::BOOLEAN));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("ErrorMessage", parquet::Repetition::REQUIRED, parquet::Type::BYTE_ARRAY,parquet::ConvertedType::UTF8));
-    fields.push_back(parquet::schema::PrimitiveNode::Make("RowIndex", parquet::Repetition::REQUIRED, parquet::Type::INT32,parquet::ConvertedType::INT_32));
-
-    std::shared_ptr<arrow::io::FileOutputStream> outfile;
-    std::shared_ptr<arrow::io::FileOutputStream> new_bmps_outfile;
+    int counter = base_manure_bmp_inputs.size();
+    int64_t n = manure_x.size();
+    std::vector<int32_t> bmp(n), state(n), county_from(n), county_to(n), animal(n), load_src_grp(n);
+    std::vector<double> amount(n);
+    arrow::StringDictionary32Builder fips_from;
+    arrow::StringDictionary32Builder fips_to;
+    PARQUET_THROW_NOT_OK(fips_from.Reserve(n));
+    PARQUET_THROW_NOT_OK(fips_to.Reserve(n));
+    for (int64_t i = 0; i < n; ++i) {
+        const auto& [from, to, load_src, animal_id, bmp_id, wet_tons] = manure_x[i];
+        bmp[i] = bmp_id;
+        state[i] = find_or_default(counties_, from);
+        county_from[i] = from;
+        county_to[i] = to;
+        PARQUET_THROW_NOT_OK(fips_from.Append(std::get<2>(find_or_default(geography_county_, from))));
+        PARQUET_THROW_NOT_OK(fips_to.Append(std::get<2>(find_or_default(geography_county_, to))));
+        animal[i] = animal_id;
+        load_src_grp[i] = find_or_default(u_u_group_dict, load_src);
+        amount[i] = wet_tons;
+    }
+    auto new_rows = arrow::RecordBatch::Make(manure_arrow_schema(), n, {
+        sequence_column(counter + 1, n),
+        values_column<arrow::Int32Builder>(bmp),
+        constant_column<int32_t>(9, n), // Non-Federal
+        su_column(counter, n),
+        values_column<arrow::Int32Builder>(state),
+        constant_column(true, n),
+        values_column<arrow::Int32Builder>(county_from),
+        values_column<arrow::Int32Builder>(county_to),
+        finish(fips_from),
+        finish(fips_to),
+        values_column<arrow::Int32Builder>(animal),
+        values_column<arrow::Int32Builder>(load_src_grp),
+        constant_column<int32_t>(12, n), // wet tons
+        values_column<arrow::DoubleBuilder>(amount),
+        constant_column(true, n),
+        constant_string("", n),
+        sequence_column(counter + 1, n),
+    });
+
+    bool is_delta = submission_layout_ == SubmissionLayout::Delta;
+    if (!is_delta) {
+        splice_submission(out_filename, manure_parquet_schema(), manure_arrow_schema(),
+                *base_file(base_manure_row_groups_, base_manure_bmp_inputs, manure_base_file), {new_rows});
+    }
+    write_new_bmps(is_delta ? nullptr : artifacts_.get(), delta_filename(out_filename),
+            manure_parquet_schema(), manure_arrow_schema(), new_rows, is_delta ? base_manure_file_ : "");
+
+    return counter + n;
+}
 
-    std::string new_bmps_out_filename = out_filename;
-    auto pos = new_bmps_out_filename.rfind(".parquet");
-    if (pos != std::string::npos) {
-        new_bmps_out_filename.insert(pos, "_new_bmps");
-    } else {
-        new_bmps_out_filename += "_new_bmps";
+bool Scenario::materialize_submission(const std::string& out_filename) const {
+    auto delta = delta_filename(out_filename);
+    if (!std::filesystem::exists(delta)) {
+        return false;
+    }
+    const BaseRowGroups* base = nullptr;
+    const std::string* base_filename = nullptr;
+    std::shared_ptr<parquet::schema::GroupNode> parquet_schema;
+    if (out_filename.find("impbmpsubmittedland") != std::string::npos) {
+        base = &base_land_row_groups_;
+        base_filename = &base_land_file_;
+        parquet_schema = land_parquet_schema();
+    }
+    else if (out_filename.find("impbmpsubmittedanimal") != std::string::npos) {
+        base = &base_animal_row_groups_;
+        base_filename = &base_animal_file_;
+        parquet_schema = animal_parquet_schema();
+    }
+    else if (out_filename.find("impbmpsubmittedmanuretransport") != std::string::npos) {
+        base = &base_manure_row_groups_;
+        base_filename = &base_manure_file_;
+        parquet_schema = manure_parquet_schema();
     }
 
-    PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(out_filename));
-    PARQUET_ASSIGN_OR_THROW(new_bmps_outfile, arrow::io::FileOutputStream::Open(new_bmps_out_filename));
-
-    std::shared_ptr<parquet::schema::GroupNode> my_schema =
-        std::static_pointer_cast<parquet::schema::GroupNode>(
-            parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
-
-    parquet::WriterProperties::Builder builder;
-    builder.version(parquet::ParquetVersion::PARQUET_1_0);
-
-    parquet::StreamWriter os{ parquet::ParquetFileWriter::Open(outfile, my_schema, builder.build()) };
-    parquet::StreamWriter new_bmp_os{ parquet::ParquetFileWriter::Open(new_bmps_outfile, my_schema, builder.build()) };
-
-    int counter = 0;
-
-    // Write base manure rows first to the main file only
-    for (const auto& bmp : base_manure_bmp_inputs) {
-        // keep SU pattern and counters consistent with your animal writer
-        std::string su = fmt::format("SU{}", counter);
-
-        os
-            << (counter + 1)
-            << bmp.BmpId
-            << bmp.AgencyId
-            << su
-            << bmp.StateId
-            << bmp.HasStateReference
-            << bmp.CountyIdFrom
-            << bmp.CountyIdTo
-            << bmp.FIPSFrom
-            << bmp.FIPSTo
-            << bmp.AnimalGroupId
-            << bmp.LoadSourceGroupId
-            << bmp.UnitId
-            << bmp.Amount
-            << true
-            << ""
-            << (counter + 1)
-            << parquet::EndRow;
-
-        counter += 1;
-    }
-
-    // Append new manure rows and mirror them to the new_bmps file
-    for (auto [county_from, county_to, load_src, animal_id, bmp_id, amount] : manure_x) {
-        auto [geography_from, geography2_id_from, fips_from, county_name_from, state_abbr_from] = geography_county_[county_from];
-        auto [geography_to, geography2_id_to,fips_to, county_name_to, state_abbr_to] = geography_county_[county_to];
-
-        int state_id = counties_[county_from];
-        int unit_id = 12;  // wet tons
-        int agency = 9;   // Non Federal per your animal writer
-        std::string su = fmt::format("SU{}", counter);
-
-        // main file
-        os
-            << (counter + 1)
-            << bmp_id
-            << agency
-            << su
-            << state_id
-            << true
-            << county_from
-            << county_to
-            << fips_from
-            << fips_to
-            << animal_id
-            << u_u_group_dict[load_src]
-            << unit_id
-            << amount
-            << true
-            << ""
-            << (counter + 1)
-            << parquet::EndRow;
-
-        // only new rows file
-        new_bmp_os
-            << (counter + 1)
-            << bmp_id
-            << agency
-            << su
-            << state_id
-            << true
-            << county_from
-            << county_to
-            << fips_from
-            << fips_to
-            << animal_id
-            << u_u_group_dict[load_src]
-            << unit_id
-            << amount
-            << true
-            << ""
-            << (counter + 1)
-            << parquet::EndRow;
-
-        counter += 1;
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(delta, arrow::default_memory_pool()));
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader));
+    std::string delta_base;
+    if (auto metadata = reader->parquet_reader()->metadata()->key_value_metadata()) {
+        if (auto found = metadata->Get("base_file"); found.ok()) {
+            delta_base = *found;
+        }
+    }
+    // a delta of another run, or written before set_base_inputs: merged the slow way
+    if (base == nullptr || !base->file || delta_base.empty() || delta_base != *base_filename) {
+        return misc_utilities::materialize_submission(delta, out_filename);
     }
 
-    return counter;
+    // only the delta rows are encoded again; the base row groups are copied
+    std::shared_ptr<arrow::Table> table;
+    PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+    std::vector<std::shared_ptr<arrow::RecordBatch>> new_rows;
+    arrow::TableBatchReader batches(*table);
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (batches.ReadNext(&batch).ok() && batch) {
+        new_rows.push_back(batch);
+    }
+    splice_submission(out_filename, parquet_schema, table->schema(), *base->file, new_rows);
+    return true;
 }
 
 std::unordered_map<std::string, double> Scenario::read_manure_nutrients(const std::string& filename) {
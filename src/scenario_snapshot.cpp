@@ -0,0 +1,141 @@
+// Created by: Gregorio Toscano
+//
+// Binary snapshot of a loaded Scenario.
+//
+// Layout: a SnapshotHeader followed by the payload, which holds the tables in
+// the order of SNAPSHOT_FIELDS below. Scalars are stored in native byte order,
+// strings and containers as a uint64 element count followed by the elements
+// (binary_io.h).
+// Bump SNAPSHOT_VERSION whenever the payload or the way load() filters its
+// inputs changes, so stale snapshots are rebuilt instead of read.
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "binary_io.h"
+#include "misc_utilities.h"
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr char SNAPSHOT_MAGIC[8] = {'M', 'S', 'U', 'S', 'N', 'A', 'P', '\0'};
+    constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t key;
+        uint64_t payload_size;
+        uint64_t payload_hash;
+    };
+}
+
+// Every table filled by load(), load_neighbors() and read_manure_nutrients(), in payload order.
+#define SNAPSHOT_FIELDS(F) \
+    F(scenario_id_) \
+    F(scenario_data_str_) \
+    F(select_neigbors_) \
+    F(manure_counties_) \
+    F(amount_) \
+    F(phi_dict_) \
+    F(efficiency_) \
+    F(bmp_cost_) \
+    F(valid_lc_bmps_) \
+    F(land_conversion_from_bmp_to) \
+    F(animal_complete_) \
+    F(animal_) \
+    F(lrseg_dict_) \
+    F(u_u_group_dict) \
+    F(counties_) \
+    F(geography_county_) \
+    F(pct_by_valid_load_) \
+    F(neighbors_dict_) \
+    F(manure_all_) \
+    F(manure_dry_lbs_)
+
+uint64_t Scenario::snapshot_key(const std::vector<std::string>& input_files, bool is_manure_enabled) {
+    uint64_t key = misc_utilities::mix64(SNAPSHOT_VERSION) ^ (is_manure_enabled ? 1 : 0);
+    for (const auto& filename : input_files) {
+        key = misc_utilities::hash_file(filename, key);
+    }
+    return key;
+}
+
+bool Scenario::save_snapshot(const std::string& filename, uint64_t key) const {
+    binary_io::Writer writer;
+#define SNAPSHOT_PUT(field) writer.put(field);
+    SNAPSHOT_FIELDS(SNAPSHOT_PUT)
+#undef SNAPSHOT_PUT
+    const auto& payload = writer.bytes();
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.key = key;
+    header.payload_size = payload.size();
+    header.payload_hash = misc_utilities::hash_bytes(payload.data(), payload.size(), key);
+
+    std::error_code ec;
+    fs::path path(filename);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+    // concurrent runs on the same inputs each write their own file and rename it into place
+    return binary_io::write_file_atomically(filename, {{&header, sizeof(header)}, {payload.data(), payload.size()}});
+}
+
+bool Scenario::load_snapshot(const std::string& filename, uint64_t key) {
+    binary_io::MappedFile file(filename);
+    if (file.data() == nullptr || file.size() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const char* payload = file.data() + sizeof(header);
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+            || header.version != SNAPSHOT_VERSION
+            || header.header_size != sizeof(SnapshotHeader)
+            || header.key != key
+            || header.payload_size != file.size() - sizeof(header)
+            || header.payload_hash != misc_utilities::hash_bytes(payload, header.payload_size, key)) {
+        std::cerr << "Ignoring stale or corrupt scenario snapshot " << filename << std::endl;
+        return false;
+    }
+
+    // decode into a scratch copy so a bad payload leaves this scenario as it was
+    Scenario loaded;
+    try {
+        binary_io::Reader reader(payload, header.payload_size);
+#define SNAPSHOT_GET(field) reader.get(loaded.field);
+        SNAPSHOT_FIELDS(SNAPSHOT_GET)
+#undef SNAPSHOT_GET
+        if (!reader.at_end()) {
+            throw std::runtime_error("trailing bytes");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring scenario snapshot " << filename << ": " << e.what() << std::endl;
+        return false;
+    }
+#define SNAPSHOT_MOVE(field) field = std::move(loaded.field);
+    SNAPSHOT_FIELDS(SNAPSHOT_MOVE)
+#undef SNAPSHOT_MOVE
+    return true;
+}
+
+bool Scenario::same_loaded_state(const Scenario& other) const {
+#define SNAPSHOT_EQUAL(field) if (!(field == other.field)) { return false; }
+    SNAPSHOT_FIELDS(SNAPSHOT_EQUAL)
+#undef SNAPSHOT_EQUAL
+    return true;
+}
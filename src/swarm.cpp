@@ -0,0 +1,89 @@
+// Created by: Gregorio Toscano
+
+#include "swarm.h"
+
+#include <algorithm>
+
+#include "rng.h"
+#include "thread_pool.h"
+
+Swarm::Swarm(int nparts, int dim, double w, double c1, double c2, double lb, double ub, uint64_t seed)
+        : nparts_(nparts), dim_(dim), w_(w), c1_(c1), c2_(c2), lower_bound_(lb), upper_bound_(ub) {
+    constexpr size_t per_line = ALIGNMENT / sizeof(double);
+    stride_ = (static_cast<size_t>(dim) + per_line - 1) / per_line * per_line;
+    x_.assign(nparts * stride_, 0.0);
+    v_.assign(nparts * stride_, 0.0);
+    pbest_x_.assign(nparts * stride_, 0.0);
+    coefficients_.assign(2 * nparts * stride_, 0.0);
+
+    seed_ = seed != 0 ? seed : rng::run_seed();
+    steps_.assign(nparts, 0);
+}
+
+void Swarm::init() {
+    for (int i = 0; i < nparts_; ++i) {
+        double* x = x_.data() + row(i);
+        rng::Stream stream(seed_, rng::Domain::swarm_init, 0, i);
+        stream.fill_uniform(x, dim_);
+        for (int d = 0; d < dim_; ++d) {
+            x[d] = lower_bound_ + x[d] * (upper_bound_ - lower_bound_);
+        }
+        std::fill_n(v_.data() + row(i), dim_, 0.0);
+    }
+}
+
+void Swarm::init(int i, std::span<const double> x) {
+    std::copy_n(x.begin(), dim_, x_.data() + row(i));
+    std::fill_n(v_.data() + row(i), dim_, 0.0);
+}
+
+void Swarm::restore(int i, std::span<const double> x, std::span<const double> v, std::span<const double> pbest_x, uint64_t steps) {
+    std::copy_n(x.begin(), dim_, x_.data() + row(i));
+    std::copy_n(v.begin(), dim_, v_.data() + row(i));
+    std::copy_n(pbest_x.begin(), dim_, pbest_x_.data() + row(i));
+    steps_[i] = steps;
+}
+
+void Swarm::store_pbest(int i) {
+    std::copy_n(x_.data() + row(i), dim_, pbest_x_.data() + row(i));
+}
+
+void Swarm::update(int i, std::span<const double> guide) {
+    // r1 and r2 of dimension d are the two numbers at position d of the
+    // (step, particle) stream; drawn up front so the loop below vectorizes
+    rng::Stream stream(seed_, rng::Domain::velocity, static_cast<uint32_t>(steps_[i]++), i);
+    double* __restrict r1 = coefficients_.data() + 2 * row(i);
+    double* __restrict r2 = r1 + stride_;
+    for (int d = 0; d < dim_; ++d) {
+        auto r = stream.uniform2(d);
+        r1[d] = r[0];
+        r2[d] = r[1];
+    }
+
+    double* __restrict x = x_.data() + row(i);
+    double* __restrict v = v_.data() + row(i);
+    const double* __restrict pbest = pbest_x_.data() + row(i);
+    const double* __restrict g = guide.data();
+    const double w = w_;
+    const double c1 = c1_;
+    const double c2 = c2_;
+    const double lb = lower_bound_;
+    const double ub = upper_bound_;
+    for (int d = 0; d < dim_; ++d) {
+        double vd = w * v[d] + c1 * r1[d] * (pbest[d] - x[d]) + c2 * r2[d] * (g[d] - x[d]);
+        v[d] = vd;
+        x[d] = std::min(std::max(x[d] + vd, lb), ub);
+    }
+}
+
+void Swarm::update(const std::vector<std::span<const double>>& guides, ThreadPool* pool) {
+    if (pool == nullptr || pool->size() <= 1) {
+        for (int i = 0; i < nparts_; ++i) {
+            update(i, guides[i]);
+        }
+        return;
+    }
+    pool->parallel_for(nparts_, [&](size_t i) {
+        update(static_cast<int>(i), guides[i]);
+    });
+}
@@ -0,0 +1,152 @@
+// Checks that RabbitMQClient::send_signals produces the same Redis keys and
+// AMQP messages as one send_signal call per solution, and times both paths.
+// Run it against a disposable local Redis and RabbitMQ (REDIS_HOST, REDIS_DB_OPT,
+// AMQP_HOST, ... as for the optimizer); no CAST worker may be consuming
+// opt4cast_execution while it runs. It replaces the scenario_ids worker pool
+// while it runs, so it only does so with AMQP_DISPATCH_TEST=1 and an explicit
+// REDIS_DB_OPT, and puts the pool back afterwards; otherwise it is skipped
+// (exit code 77).
+//
+// usage: AMQP_DISPATCH_TEST=1 REDIS_DB_OPT=<db> amqp_dispatch_test [nsolutions]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+#include <SimpleAmqpClient/SimpleAmqpClient.h>
+#include <sw/redis++/redis++.h>
+
+#include "amqp.h"
+#include "misc_utilities.h"
+
+namespace {
+    struct Dispatched {
+        std::vector<std::string> emo_data;
+        std::vector<std::string> to_execute;
+        std::vector<std::string> messages;
+        double ms;
+    };
+
+    template <typename F>
+    Dispatched dispatch(sw::redis::Redis& redis, AmqpClient::Channel::ptr_t channel, const std::string& consumer_tag,
+                        const std::vector<std::string>& exec_uuids, F&& send) {
+        Dispatched out;
+        auto start = std::chrono::steady_clock::now();
+        send();
+        out.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (const auto& exec_uuid : exec_uuids) {
+            out.emo_data.push_back(redis.hget("emo_data", exec_uuid).value_or("<missing>"));
+            out.to_execute.push_back(redis.hget("solution_to_execute_dict", exec_uuid).value_or("<missing>"));
+        }
+        AmqpClient::Envelope::ptr_t envelope;
+        while (out.messages.size() < exec_uuids.size() && channel->BasicConsumeMessage(consumer_tag, envelope, 2000)) {
+            out.messages.push_back(envelope->Message()->Body());
+        }
+        redis.hdel("emo_data", exec_uuids.begin(), exec_uuids.end());
+        redis.hdel("solution_to_execute_dict", exec_uuids.begin(), exec_uuids.end());
+        return out;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (misc_utilities::get_env_var("AMQP_DISPATCH_TEST", "") != "1" || std::getenv("REDIS_DB_OPT") == nullptr) {
+        std::cerr << "skipped: set AMQP_DISPATCH_TEST=1 and REDIS_DB_OPT to a Redis database no CAST worker uses" << std::endl;
+        return 77;
+    }
+    int nsolutions = argc > 1 ? std::stoi(argv[1]) : 200;
+    std::string emo_data = "{\"scenario\": \"dispatch_test\"}";
+
+    auto redis_url = fmt::format("tcp://{}:{}/{}",
+                                 misc_utilities::get_env_var("REDIS_HOST", "127.0.0.1"),
+                                 misc_utilities::get_env_var("REDIS_PORT", "6379"),
+                                 misc_utilities::get_env_var("REDIS_DB_OPT", "1"));
+    sw::redis::Redis redis(redis_url);
+
+    AmqpClient::Channel::OpenOpts opts;
+    opts.host = misc_utilities::get_env_var("AMQP_HOST", "127.0.0.1");
+    opts.port = std::stoi(misc_utilities::get_env_var("AMQP_PORT", "5672"));
+    opts.vhost = "/";
+    opts.auth = AmqpClient::Channel::OpenOpts::BasicAuth(misc_utilities::get_env_var("AMQP_USERNAME", "guest"),
+                                                           misc_utilities::get_env_var("AMQP_PASSWORD", "guest"));
+    auto channel = AmqpClient::Channel::Open(opts);
+    channel->DeclareExchange("opt4cast_exchange", AmqpClient::Channel::EXCHANGE_TYPE_DIRECT, false, true, false);
+    auto queue_name = channel->DeclareQueue("", false, false, true, true);
+    channel->BindQueue(queue_name, "opt4cast_exchange", "opt4cast_execution");
+    auto consumer_tag = channel->BasicConsume(queue_name, "", false, true, true, 1);
+
+    // both paths must pop the same scenario ids in the same order
+    std::vector<std::string> scenario_ids;
+    for (int i = 0; i < nsolutions; ++i) {
+        scenario_ids.push_back(fmt::format("dispatch_test_{}", i));
+    }
+    std::vector<std::string> ref_uuids;
+    std::vector<std::string> batch_uuids;
+    for (int i = 0; i < nsolutions; ++i) {
+        ref_uuids.push_back(fmt::format("dispatch_ref_{}", i));
+        batch_uuids.push_back(fmt::format("dispatch_batch_{}", i));
+    }
+
+    // the pool of the database, put back once both paths have run
+    std::vector<std::string> saved_ids;
+    redis.lrange("scenario_ids", 0, -1, std::back_inserter(saved_ids));
+
+    redis.del("scenario_ids");
+    redis.rpush("scenario_ids", scenario_ids.begin(), scenario_ids.end());
+    RabbitMQClient ref_client(emo_data, "dispatch_ref");
+    auto ref = dispatch(redis, channel, consumer_tag, ref_uuids, [&] {
+        for (const auto& exec_uuid : ref_uuids) {
+            ref_client.send_signal(exec_uuid);
+        }
+    });
+
+    redis.del("scenario_ids");
+    redis.rpush("scenario_ids", scenario_ids.begin(), scenario_ids.end());
+    RabbitMQClient batch_client(emo_data, "dispatch_batch");
+    auto batch = dispatch(redis, channel, consumer_tag, batch_uuids, [&] {
+        batch_client.send_signals(batch_uuids);
+    });
+    redis.del("scenario_ids");
+    if (!saved_ids.empty()) {
+        redis.rpush("scenario_ids", saved_ids.begin(), saved_ids.end());
+    }
+
+    int errors = 0;
+    if (ref.messages != ref_uuids) {
+        std::cerr << "send_signal published " << ref.messages.size() << " unexpected messages" << std::endl;
+        ++errors;
+    }
+    if (batch.messages != batch_uuids) {
+        std::cerr << "send_signals published " << batch.messages.size() << " unexpected messages" << std::endl;
+        ++errors;
+    }
+    for (int i = 0; i < nsolutions; ++i) {
+        if (ref.emo_data[i] != emo_data || batch.emo_data[i] != emo_data) {
+            std::cerr << "emo_data differs for solution " << i << std::endl;
+            ++errors;
+        }
+        if (ref.to_execute[i] != fmt::format("dispatch_ref_{}", scenario_ids[i]) ||
+            batch.to_execute[i] != fmt::format("dispatch_batch_{}", scenario_ids[i])) {
+            std::cerr << "solution_to_execute_dict differs for solution " << i << ": "
+                      << ref.to_execute[i] << " vs " << batch.to_execute[i] << std::endl;
+            ++errors;
+        }
+    }
+    if (ref_client.transfers_remaining() != nsolutions || batch_client.transfers_remaining() != nsolutions) {
+        std::cerr << "pending transfers differ: " << ref_client.transfers_remaining() << " vs "
+                  << batch_client.transfers_remaining() << std::endl;
+        ++errors;
+    }
+
+    fmt::print("{} solutions: send_signal {:.2f} ms, send_signals {:.2f} ms\n", nsolutions, ref.ms, batch.ms);
+    if (errors > 0) {
+        std::cerr << errors << " mismatches" << std::endl;
+        return -1;
+    }
+    fmt::print("same keys and messages\n");
+    return 0;
+}
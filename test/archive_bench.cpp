@@ -0,0 +1,125 @@
+// Insertion throughput and memory of the gbest archive (update_non_dominated_solutions)
+// at archive sizes of 10^3 to 10^5. Candidates lie on one 2-objective front, so
+// every insertion is accepted and a bounded archive keeps pruning by crowding
+// distance. The copy-on-insert version it replaced is timed for comparison
+// at the smaller sizes.
+//
+// usage: archive_bench [dim] [ninserts]
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "external_archive.h"
+#include "particle.h"
+
+namespace {
+    double rss_mb() {
+        std::ifstream statm("/proc/self/statm");
+        long pages_total = 0;
+        long pages_resident = 0;
+        statm >> pages_total >> pages_resident;
+        return pages_resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+    }
+
+    // the implementation before the archive was updated in place
+    void copy_on_insert(std::vector<Particle>& archive, const Particle& new_solution_x) {
+        std::vector<Particle> new_archive;
+        bool new_solution_dominated = false;
+        for (size_t i = 0; i < archive.size(); ++i) {
+            const auto& archive_fx = archive[i].get_fx();
+            const auto& new_solution_fx = new_solution_x.get_fx();
+            if (is_dominated(archive_fx, new_solution_fx, archive[i].get_gx(), new_solution_x.get_gx())) {
+                continue;
+            }
+            if (is_dominated(new_solution_fx, archive_fx, new_solution_x.get_gx(), archive[i].get_gx()) || new_solution_fx == archive_fx) {
+                new_solution_dominated = true;
+            }
+            new_archive.push_back(archive[i]);
+        }
+        if (!new_solution_dominated) {
+            new_archive.push_back(new_solution_x);
+        }
+        std::swap(archive, new_archive);
+    }
+
+    Particle on_front(const Particle& prototype, double t) {
+        Particle particle(prototype);
+        particle.set_fx(t, 1.0 - std::sqrt(t));
+        particle.set_gx(0.0);
+        return particle;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int dim = argc > 1 ? std::stoi(argv[1]) : 100;
+    int ninserts = argc > 2 ? std::stoi(argv[2]) : 1000;
+
+    Particle prototype(dim, 2, 0.7, 1.5, 1.5, 0.0, 1.0);
+    prototype.init();
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    int errors = 0;
+    fmt::print("{:>8} {:>16} {:>12} {:>12} {:>10}\n", "size", "method", "us/insert", "final size", "rss MB");
+    for (size_t size : {size_t(1000), size_t(10000), size_t(100000)}) {
+        std::vector<Particle> seed;
+        seed.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            seed.push_back(on_front(prototype, (i + 0.5) / size));
+        }
+        std::vector<Particle> candidates;
+        double min_f1 = seed.front().get_fx()[0];
+        double min_f2 = seed.back().get_fx()[1];
+        for (int i = 0; i < ninserts; ++i) {
+            candidates.push_back(on_front(prototype, dist(gen)));
+            min_f1 = std::min(min_f1, candidates.back().get_fx()[0]);
+            min_f2 = std::min(min_f2, candidates.back().get_fx()[1]);
+        }
+
+        double rss_before = rss_mb();
+        auto archive = seed;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& candidate : candidates) {
+            update_non_dominated_solutions(archive, candidate, size);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fmt::print("{:>8} {:>16} {:>12.2f} {:>12} {:>10.1f}\n", size, "in place", 1e6 * seconds / ninserts, archive.size(), rss_mb() - rss_before);
+
+        if (archive.size() > size) {
+            std::cerr << "archive exceeds its capacity " << size << std::endl;
+            ++errors;
+        }
+        // the extremes of the front must survive pruning
+        bool has_first = false;
+        bool has_last = false;
+        for (const auto& particle : archive) {
+            has_first = has_first || particle.get_fx()[0] == min_f1;
+            has_last = has_last || particle.get_fx()[1] == min_f2;
+        }
+        if (!has_first || !has_last) {
+            std::cerr << "pruning dropped an extreme solution (size " << size << ")" << std::endl;
+            ++errors;
+        }
+
+        if (size <= 10000) {
+            auto unbounded = seed;
+            start = std::chrono::steady_clock::now();
+            for (const auto& candidate : candidates) {
+                copy_on_insert(unbounded, candidate);
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            fmt::print("{:>8} {:>16} {:>12.2f} {:>12} {:>10}\n", size, "copy on insert", 1e6 * seconds / ninserts, unbounded.size(), "");
+        }
+    }
+    return errors > 0 ? -1 : 0;
+}
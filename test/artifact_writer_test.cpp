@@ -0,0 +1,212 @@
+// Created by: Gregorio Toscano
+//
+// Queues files on an ArtifactWriter and checks that every one of them is
+// written once flush() returns: with a queue small enough to stall submit(),
+// with failing jobs, with no threads and when the writer is destroyed. Then
+// writes full layout submissions with and without a writer on the Scenario,
+// checks that the _new_bmps copies come out the same and times how long the
+// caller waits for write_* either way.
+//
+// usage: artifact_writer_test [base_rows] [new_rows] [nfiles] [out_dir]
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "artifact_writer.h"
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::string read_file(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    void write_file(const std::string& filename, const std::string& content) {
+        std::ofstream out(filename, std::ios::binary);
+        out << content;
+    }
+
+    std::string content_of(int i) {
+        return fmt::format("{{\"file\": {}, \"padding\": \"{}\"}}\n", i, std::string(100 + i % 37, 'x'));
+    }
+
+    int expect(bool ok, const std::string& what) {
+        if (!ok) {
+            std::cerr << "FAILED: " << what << std::endl;
+        }
+        return ok ? 0 : 1;
+    }
+
+    // Slow files on a small queue: submit() has to wait for the workers, and
+    // every file is there after flush().
+    int check_queue(const std::string& dir, int nfiles) {
+        int errors = 0;
+        size_t capacity = 4;
+        ArtifactWriter writer(3, capacity);
+        uint64_t bytes = 0;
+        for (int i = 0; i < nfiles; ++i) {
+            auto content = content_of(i);
+            bytes += content.size();
+            writer.submit(fmt::format("{}/queue_{}.json", dir, i), [content](const std::string& filename) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                write_file(filename, content);
+            });
+        }
+        errors += expect(writer.flush(), "flush after the queued files");
+        for (int i = 0; i < nfiles; ++i) {
+            errors += expect(read_file(fmt::format("{}/queue_{}.json", dir, i)) == content_of(i), fmt::format("contents of queue_{}.json", i));
+        }
+        auto stats = writer.stats();
+        writer.print_stats();
+        errors += expect(stats.files == static_cast<uint64_t>(nfiles), fmt::format("{} files counted, {} written", stats.files, nfiles));
+        errors += expect(stats.bytes == bytes, fmt::format("{} bytes counted, {} written", stats.bytes, bytes));
+        errors += expect(stats.failed == 0, "no failed files");
+        errors += expect(stats.max_depth <= capacity, fmt::format("queue depth {} within {}", stats.max_depth, capacity));
+        errors += expect(stats.stall_seconds > 0.0, "submit() stalled on the full queue");
+        return errors;
+    }
+
+    // A job that throws and one that writes nothing fail the next flush() only;
+    // the files around them are still written.
+    int check_failures(const std::string& dir) {
+        int errors = 0;
+        ArtifactWriter writer(2, 8);
+        writer.submit(dir + "/before.json", [](const std::string& filename) { write_file(filename, "before"); });
+        writer.submit(dir + "/throws.json", [](const std::string&) { throw std::runtime_error("disk full"); });
+        writer.submit(dir + "/missing.json", [](const std::string&) {});
+        writer.submit(dir + "/after.json", [](const std::string& filename) { write_file(filename, "after"); });
+        errors += expect(!writer.flush(), "flush reports the failed files");
+        errors += expect(read_file(dir + "/before.json") == "before" && read_file(dir + "/after.json") == "after", "the other files are written");
+        errors += expect(writer.stats().failed == 2 && writer.stats().files == 2, "two files written and two failed");
+        errors += expect(writer.flush(), "the failures are reported once");
+        return errors;
+    }
+
+    // Without threads the file is there when submit() returns, and the
+    // destructor of a threaded writer waits for its queue.
+    int check_inline_and_destructor(const std::string& dir, int nfiles) {
+        int errors = 0;
+        {
+            ArtifactWriter writer(0);
+            writer.submit(dir + "/inline.json", [](const std::string& filename) { write_file(filename, "inline"); });
+            errors += expect(read_file(dir + "/inline.json") == "inline", "written by submit() without threads");
+            errors += expect(writer.stats().files == 1, "inline file counted");
+        }
+        {
+            ArtifactWriter writer(2, 4);
+            for (int i = 0; i < nfiles; ++i) {
+                writer.submit(fmt::format("{}/destroyed_{}.json", dir, i), [i](const std::string& filename) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    write_file(filename, content_of(i));
+                });
+            }
+        }
+        for (int i = 0; i < nfiles; ++i) {
+            errors += expect(read_file(fmt::format("{}/destroyed_{}.json", dir, i)) == content_of(i), fmt::format("destroyed_{}.json written before the destructor returned", i));
+        }
+        return errors;
+    }
+
+    std::vector<BmpRowLand> make_land_base(int n) {
+        std::vector<BmpRowLand> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 9, fmt::format("SU{}", i), 11, 7 + i % 50, 1000 + i % 300, 4 + i % 20, 1,
+                            10.0 + i % 97, true, "", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<std::tuple<int, int, int, int, double>> make_lc_x(int n, int seed) {
+        std::vector<std::tuple<int, int, int, int, double>> lc_x;
+        lc_x.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            lc_x.push_back({100 + (i * 7 + seed) % 900, 9 + i % 3, 10 + i % 30, 1 + (i + seed) % 40, 1.0 + (i * 13 + seed) % 500});
+        }
+        return lc_x;
+    }
+
+    // The full layout with the _new_bmps copies on the writer gives the same
+    // files as without it.
+    int check_scenario(const std::string& dir, int base_rows, int new_rows, int nfiles) {
+        int errors = 0;
+        auto land_table = BmpTableLand::from_rows(make_land_base(base_rows));
+        auto write_files = [&](Scenario& scenario, const std::string& prefix) {
+            for (int i = 0; i < nfiles; ++i) {
+                scenario.write_land(make_lc_x(new_rows, i), fmt::format("{}/{}_{}_land.parquet", dir, prefix, i), land_table);
+            }
+        };
+
+        Scenario sync;
+        sync.set_base_inputs(land_table, BmpTableAnimal{}, BmpTableManure{});
+        double sync_ms = time_ms([&] { write_files(sync, "sync"); });
+
+        Scenario queued;
+        queued.set_base_inputs(land_table, BmpTableAnimal{}, BmpTableManure{});
+        auto writer = std::make_shared<ArtifactWriter>(1, 64);
+        queued.set_artifact_writer(writer);
+        double submit_ms = time_ms([&] { write_files(queued, "queued"); });
+        double flush_ms = time_ms([&] { errors += expect(writer->flush(), "flush after the _new_bmps copies"); });
+        writer->print_stats();
+
+        for (int i = 0; i < nfiles; ++i) {
+            for (auto filename : {fmt::format("{}_land.parquet", i), Scenario::delta_filename(fmt::format("{}_land.parquet", i))}) {
+                auto expected = read_file(fmt::format("{}/sync_{}", dir, filename));
+                errors += expect(!expected.empty() && read_file(fmt::format("{}/queued_{}", dir, filename)) == expected, fmt::format("queued_{} matches sync_{}", filename, filename));
+            }
+        }
+        errors += expect(writer->stats().files == static_cast<uint64_t>(nfiles), "one _new_bmps copy per file");
+        fmt::print("{} land files of {} + {} rows: write_land takes {:.1f} ms/file, {:.1f} ms/file with the copies queued "
+                   "(+{:.1f} ms in flush)\n",
+                   nfiles, base_rows, new_rows, sync_ms / nfiles, submit_ms / nfiles, flush_ms);
+        return errors;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int base_rows = argc > 1 ? std::stoi(argv[1]) : 200000;
+    int new_rows = argc > 2 ? std::stoi(argv[2]) : 50000;
+    int nfiles = argc > 3 ? std::stoi(argv[3]) : 20;
+    std::string dir = argc > 4 ? argv[4] : (fs::temp_directory_path() / fmt::format("artifact_writer_test_{}", getpid())).string();
+    fs::create_directories(dir);
+    int errors = 0;
+
+    errors += check_queue(dir, 200);
+    errors += check_failures(dir);
+    errors += check_inline_and_destructor(dir, 50);
+    errors += check_scenario(dir, base_rows, new_rows, nfiles);
+
+    if (argc <= 4) {
+        fs::remove_all(dir);
+    }
+    if (errors > 0) {
+        std::cerr << errors << " checks failed" << std::endl;
+        return 1;
+    }
+    fmt::print("artifact writer checks passed\n");
+    return 0;
+}
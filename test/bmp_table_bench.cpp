@@ -0,0 +1,308 @@
+// Reads base land, animal and manure submission files of n rows into the
+// BmpTable* views and, the way read_parquet_file_* used to, into vectors of
+// BmpRow* structs. Checks that both give the same rows and compares the
+// memory each keeps for the run, the read time and the cost of a copy.
+//
+// usage: bmp_table_bench [n rows] [out_dir]
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/util/byte_size.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+
+#include "bmp_table.h"
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::string state_unique_identifier(int i) {
+        return fmt::format("PA-{:06}-{:04}-{}", i, i % 7919, i % 3 == 0 ? "FEDERAL" : "NONFEDERAL");
+    }
+
+    std::vector<BmpRowLand> make_land(int n) {
+        std::vector<BmpRowLand> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 9, state_unique_identifier(i), 11, 7 + i % 50, 1000 + i % 300, 4 + i % 20, 1,
+                            10.0 + i % 97, i % 11 != 0, i % 11 != 0 ? "" : "Amount exceeds the available acres", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<BmpRowAnimal> make_animal(int n) {
+        std::vector<BmpRowAnimal> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 3 + i % 17, 9, fmt::format("SU{}", i), 24, 500 + i % 90, 2 + i % 8, 6 + i % 5, 13,
+                            1.5 * (i % 40), 0.0, 0.0, true, "", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<BmpRowManure> make_manure(int n) {
+        std::vector<BmpRowManure> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 40 + i % 3, 9, fmt::format("SU{}", i), 42, true, 100 + i % 60, 100 + (i * 7) % 60,
+                            fmt::format("42{:03}", i % 60), fmt::format("42{:03}", (i * 7) % 60), 2 + i % 8, 6, 12,
+                            20.0 + i % 33, true, "", i + 1});
+        }
+        return rows;
+    }
+
+    std::shared_ptr<arrow::Table> read_table(const std::string& filename) {
+        std::shared_ptr<arrow::io::ReadableFile> infile;
+        PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(filename));
+        std::unique_ptr<parquet::arrow::FileReader> reader;
+        PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader));
+        std::shared_ptr<arrow::Table> table;
+        PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+        PARQUET_ASSIGN_OR_THROW(table, table->CombineChunks());
+        return table;
+    }
+
+    std::vector<std::shared_ptr<arrow::Array>> columns(const std::shared_ptr<arrow::Table>& table) {
+        std::vector<std::shared_ptr<arrow::Array>> arrays;
+        for (const auto& column : table->columns()) {
+            arrays.push_back(column->chunk(0));
+        }
+        return arrays;
+    }
+
+    template <typename Array>
+    const Array& at(const std::vector<std::shared_ptr<arrow::Array>>& arrays, int k) {
+        return static_cast<const Array&>(*arrays[k]);
+    }
+
+    // The row-by-row copies read_parquet_file_* made before.
+    std::vector<BmpRowLand> read_land_rows(const std::string& filename) {
+        auto table = read_table(filename);
+        std::vector<BmpRowLand> rows;
+        auto arrays = columns(table);
+        rows.reserve(table->num_rows());
+        for (int64_t i = 0; i < table->num_rows(); ++i) {
+            rows.push_back({at<arrow::Int32Array>(arrays, 0).Value(i), at<arrow::Int32Array>(arrays, 1).Value(i),
+                            at<arrow::StringArray>(arrays, 2).GetString(i), at<arrow::Int32Array>(arrays, 3).Value(i),
+                            at<arrow::Int32Array>(arrays, 4).Value(i), at<arrow::Int32Array>(arrays, 5).Value(i),
+                            at<arrow::Int32Array>(arrays, 6).Value(i), at<arrow::Int32Array>(arrays, 7).Value(i),
+                            at<arrow::DoubleArray>(arrays, 8).Value(i), at<arrow::BooleanArray>(arrays, 9).Value(i),
+                            at<arrow::StringArray>(arrays, 10).GetString(i), at<arrow::Int32Array>(arrays, 11).Value(i)});
+        }
+        return rows;
+    }
+
+    std::vector<BmpRowAnimal> read_animal_rows(const std::string& filename) {
+        auto table = read_table(filename);
+        std::vector<BmpRowAnimal> rows;
+        auto arrays = columns(table);
+        rows.reserve(table->num_rows());
+        for (int64_t i = 0; i < table->num_rows(); ++i) {
+            rows.push_back({at<arrow::Int32Array>(arrays, 0).Value(i), at<arrow::Int32Array>(arrays, 1).Value(i),
+                            at<arrow::Int32Array>(arrays, 2).Value(i), at<arrow::StringArray>(arrays, 3).GetString(i),
+                            at<arrow::Int32Array>(arrays, 4).Value(i), at<arrow::Int32Array>(arrays, 5).Value(i),
+                            at<arrow::Int32Array>(arrays, 6).Value(i), at<arrow::Int32Array>(arrays, 7).Value(i),
+                            at<arrow::Int32Array>(arrays, 8).Value(i), at<arrow::DoubleArray>(arrays, 9).Value(i),
+                            at<arrow::DoubleArray>(arrays, 10).Value(i), at<arrow::DoubleArray>(arrays, 11).Value(i),
+                            at<arrow::BooleanArray>(arrays, 12).Value(i), at<arrow::StringArray>(arrays, 13).GetString(i),
+                            at<arrow::Int32Array>(arrays, 14).Value(i)});
+        }
+        return rows;
+    }
+
+    std::vector<BmpRowManure> read_manure_rows(const std::string& filename) {
+        auto table = read_table(filename);
+        std::vector<BmpRowManure> rows;
+        auto arrays = columns(table);
+        rows.reserve(table->num_rows());
+        for (int64_t i = 0; i < table->num_rows(); ++i) {
+            rows.push_back({at<arrow::Int32Array>(arrays, 0).Value(i), at<arrow::Int32Array>(arrays, 1).Value(i),
+                            at<arrow::Int32Array>(arrays, 2).Value(i), at<arrow::StringArray>(arrays, 3).GetString(i),
+                            at<arrow::Int32Array>(arrays, 4).Value(i), at<arrow::BooleanArray>(arrays, 5).Value(i),
+                            at<arrow::Int32Array>(arrays, 6).Value(i), at<arrow::Int32Array>(arrays, 7).Value(i),
+                            at<arrow::StringArray>(arrays, 8).GetString(i), at<arrow::StringArray>(arrays, 9).GetString(i),
+                            at<arrow::Int32Array>(arrays, 10).Value(i), at<arrow::Int32Array>(arrays, 11).Value(i),
+                            at<arrow::Int32Array>(arrays, 12).Value(i), at<arrow::DoubleArray>(arrays, 13).Value(i),
+                            at<arrow::BooleanArray>(arrays, 14).Value(i), at<arrow::StringArray>(arrays, 15).GetString(i),
+                            at<arrow::Int32Array>(arrays, 16).Value(i)});
+        }
+        return rows;
+    }
+
+    // heap a std::string keeps beyond its own bytes
+    size_t heap_bytes(const std::string& s) {
+        return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+    }
+
+    size_t held_bytes(const std::vector<BmpRowLand>& rows) {
+        size_t total = rows.capacity() * sizeof(BmpRowLand);
+        for (const auto& row : rows) {
+            total += heap_bytes(row.StateUniqueIdentifier) + heap_bytes(row.ErrorMessage);
+        }
+        return total;
+    }
+
+    size_t held_bytes(const std::vector<BmpRowAnimal>& rows) {
+        size_t total = rows.capacity() * sizeof(BmpRowAnimal);
+        for (const auto& row : rows) {
+            total += heap_bytes(row.StateUniqueIdentifier) + heap_bytes(row.ErrorMessage);
+        }
+        return total;
+    }
+
+    size_t held_bytes(const std::vector<BmpRowManure>& rows) {
+        size_t total = rows.capacity() * sizeof(BmpRowManure);
+        for (const auto& row : rows) {
+            total += heap_bytes(row.StateUniqueIdentifier) + heap_bytes(row.FIPSFrom) + heap_bytes(row.FIPSTo)
+                + heap_bytes(row.ErrorMessage);
+        }
+        return total;
+    }
+
+    size_t held_bytes(const bmp_table::Table& table) {
+        return table.empty() ? 0 : arrow::util::TotalBufferSize(*table.table());
+    }
+
+    int64_t differences(const std::vector<BmpRowLand>& rows, const BmpTableLand& table) {
+        int64_t n = rows.size() == static_cast<size_t>(table.size()) ? 0 : 1;
+        for (int64_t i = 0; n == 0 && i < table.size(); ++i) {
+            const auto& r = rows[i];
+            n += r.BmpSubmittedId != table.BmpSubmittedId(i) || r.AgencyId != table.AgencyId(i)
+                || r.StateUniqueIdentifier != table.StateUniqueIdentifier(i) || r.StateId != table.StateId(i)
+                || r.BmpId != table.BmpId(i) || r.GeographyId != table.GeographyId(i)
+                || r.LoadSourceGroupId != table.LoadSourceGroupId(i) || r.UnitId != table.UnitId(i)
+                || r.Amount != table.Amount(i) || r.IsValid != table.IsValid(i)
+                || r.ErrorMessage != table.ErrorMessage(i) || r.RowIndex != table.RowIndex(i);
+        }
+        return n;
+    }
+
+    int64_t differences(const std::vector<BmpRowAnimal>& rows, const BmpTableAnimal& table) {
+        int64_t n = rows.size() == static_cast<size_t>(table.size()) ? 0 : 1;
+        for (int64_t i = 0; n == 0 && i < table.size(); ++i) {
+            const auto& r = rows[i];
+            n += r.BmpSubmittedId != table.BmpSubmittedId(i) || r.BmpId != table.BmpId(i) || r.AgencyId != table.AgencyId(i)
+                || r.StateUniqueIdentifier != table.StateUniqueIdentifier(i) || r.StateId != table.StateId(i)
+                || r.GeographyId != table.GeographyId(i) || r.AnimalGroupId != table.AnimalGroupId(i)
+                || r.LoadSourceGroupId != table.LoadSourceGroupId(i) || r.UnitId != table.UnitId(i)
+                || r.Amount != table.Amount(i) || r.NReductionFraction != table.NReductionFraction(i)
+                || r.PReductionFraction != table.PReductionFraction(i) || r.IsValid != table.IsValid(i)
+                || r.ErrorMessage != table.ErrorMessage(i) || r.RowIndex != table.RowIndex(i);
+        }
+        return n;
+    }
+
+    int64_t differences(const std::vector<BmpRowManure>& rows, const BmpTableManure& table) {
+        int64_t n = rows.size() == static_cast<size_t>(table.size()) ? 0 : 1;
+        for (int64_t i = 0; n == 0 && i < table.size(); ++i) {
+            const auto& r = rows[i];
+            n += r.BmpSubmittedId != table.BmpSubmittedId(i) || r.BmpId != table.BmpId(i) || r.AgencyId != table.AgencyId(i)
+                || r.StateUniqueIdentifier != table.StateUniqueIdentifier(i) || r.StateId != table.StateId(i)
+                || r.HasStateReference != table.HasStateReference(i) || r.CountyIdFrom != table.CountyIdFrom(i)
+                || r.CountyIdTo != table.CountyIdTo(i) || r.FIPSFrom != table.FIPSFrom(i) || r.FIPSTo != table.FIPSTo(i)
+                || r.AnimalGroupId != table.AnimalGroupId(i) || r.LoadSourceGroupId != table.LoadSourceGroupId(i)
+                || r.UnitId != table.UnitId(i) || r.Amount != table.Amount(i) || r.IsValid != table.IsValid(i)
+                || r.ErrorMessage != table.ErrorMessage(i) || r.RowIndex != table.RowIndex(i);
+        }
+        return n;
+    }
+
+    template <typename Rows, typename View, typename ReadRows, typename ReadView>
+    int compare(const std::string& name, const std::string& filename, ReadRows&& read_rows, ReadView&& read_view) {
+        Rows rows;
+        View view;
+        double rows_ms = time_ms([&] { rows = read_rows(filename); });
+        double view_ms = time_ms([&] { view = read_view(filename); });
+        auto n = differences(rows, view);
+        if (n > 0) {
+            std::cerr << name << ": " << n << " rows differ" << std::endl;
+        }
+
+        // what handing the inputs over by value cost per particle
+        size_t sink = 0;
+        double copy_rows_ms = time_ms([&] {
+            Rows copy = rows;
+            sink += copy.size();
+        });
+        double copy_view_ms = time_ms([&] {
+            View copy = view;
+            sink += copy.size();
+        });
+
+        fmt::print("{:<8} {:>10} rows  {:>9.1f} MB  {:>9.1f} MB  {:>8.1f}x  {:>9.1f} ms  {:>9.1f} ms  {:>9.3f} ms  {:>9.4f} ms\n",
+                   name, view.size(), held_bytes(rows) / 1e6, held_bytes(view) / 1e6,
+                   static_cast<double>(held_bytes(rows)) / std::max<size_t>(held_bytes(view), 1),
+                   rows_ms, view_ms, copy_rows_ms, copy_view_ms);
+        return n > 0 && sink > 0;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? std::stoi(argv[1]) : 1000000;
+    std::string dir = argc > 2 ? argv[2] : (fs::temp_directory_path() / fmt::format("bmp_table_bench_{}", getpid())).string();
+    fs::create_directories(dir);
+    int errors = 0;
+
+    auto land_file = dir + "/land.parquet";
+    auto animal_file = dir + "/animal.parquet";
+    auto manure_file = dir + "/manure.parquet";
+    {
+        Scenario scenario;
+        scenario.write_land_base(land_file, BmpTableLand::from_rows(make_land(n)));
+        scenario.write_animal_base(animal_file, BmpTableAnimal::from_rows(make_animal(n)));
+        scenario.write_manure_base(manure_file, BmpTableManure::from_rows(make_manure(n)));
+    }
+
+    fmt::print("{:<8} {:>15}  {:>12}  {:>12}  {:>9}  {:>12}  {:>12}  {:>12}  {:>12}\n", "", "", "BmpRow MB", "BmpTable MB",
+               "", "BmpRow read", "BmpTable read", "BmpRow copy", "BmpTable copy");
+    errors += compare<std::vector<BmpRowLand>, BmpTableLand>("land", land_file, read_land_rows, read_parquet_file_land);
+    errors += compare<std::vector<BmpRowAnimal>, BmpTableAnimal>("animal", animal_file, read_animal_rows, read_parquet_file_animal);
+    errors += compare<std::vector<BmpRowManure>, BmpTableManure>("manure", manure_file, read_manure_rows, read_parquet_file_manure);
+
+    // a null ErrorMessage reads as ""
+    {
+        auto schema = arrow::schema({arrow::field("ErrorMessage", arrow::utf8())});
+        arrow::StringBuilder builder;
+        PARQUET_THROW_NOT_OK(builder.AppendNull());
+        PARQUET_THROW_NOT_OK(builder.Append("x"));
+        std::shared_ptr<arrow::Array> messages;
+        PARQUET_THROW_NOT_OK(builder.Finish(&messages));
+        auto rows = make_land(2);
+        rows[0].ErrorMessage = "";
+        rows[1].ErrorMessage = "x";
+        auto table = BmpTableLand::from_rows(rows).table();
+        PARQUET_ASSIGN_OR_THROW(table, table->SetColumn(10, arrow::field("ErrorMessage", arrow::utf8()),
+                                                        std::make_shared<arrow::ChunkedArray>(messages)));
+        if (differences(rows, BmpTableLand(table)) > 0) {
+            std::cerr << "a null ErrorMessage does not read as \"\"" << std::endl;
+            ++errors;
+        }
+    }
+    fs::remove_all(dir);
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
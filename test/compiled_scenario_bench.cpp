@@ -0,0 +1,106 @@
+// Times the string-keyed normalize_* against the compiled ScenarioModel path
+// on random decision vectors and checks that both produce identical results,
+// and that the dense normalize_lc the PSO uses agrees with the map-based one.
+//
+// usage: compiled_scenario_bench <input.json> <scenario.json> <manure_nutrients.json> [nsamples]
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "scenario.h"
+
+namespace {
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0] << " <input.json> <scenario.json> <manure_nutrients.json> [nsamples]" << std::endl;
+        return -1;
+    }
+    std::string filename = argv[1];
+    std::string filename_scenario = argv[2];
+    std::string manure_nutrients_file = argv[3];
+    int nsamples = argc > 4 ? std::stoi(argv[4]) : 100;
+
+    Scenario scenario;
+    scenario.init(filename, filename_scenario, false, true, true, true, manure_nutrients_file);
+    const auto& model = scenario.get_model();
+    fmt::print("nvars: {}, land parcels: {}, animal parcels: {}, manure parcels: {}\n",
+               scenario.get_nvars(), model.lc_amount.size(), model.animal_units.size(), model.manure_dry_lbs.size());
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<std::vector<double>> samples(nsamples, std::vector<double>(scenario.get_nvars()));
+    for (auto& x : samples) {
+        for (auto& xi : x) {
+            xi = dist(gen);
+        }
+    }
+
+    std::vector<std::tuple<int, int, int, int, double>> lc_x, lc_x_ref, lc_x_dense;
+    std::vector<std::tuple<int, int, int, int, int, double>> animal_x, animal_x_ref;
+    std::vector<std::tuple<int, int, int, int, int, double>> manure_x, manure_x_ref;
+    std::unordered_map<std::string, double> amount_minus, amount_minus_ref;
+    std::unordered_map<std::string, double> amount_plus, amount_plus_ref;
+    std::vector<double> minus, plus;
+
+    int mismatches = 0;
+    double keyed_ms = 0.0;
+    double compiled_ms = 0.0;
+    double compiled_dense_ms = 0.0;
+    for (const auto& x : samples) {
+        double cost_ref = 0.0;
+        double cost = 0.0;
+        double lc_cost = 0.0;
+        double lc_cost_dense = 0.0;
+        keyed_ms += time_ms([&] {
+            cost_ref += scenario.normalize_lc_keyed(x, lc_x_ref, amount_minus_ref, amount_plus_ref);
+            cost_ref += scenario.normalize_animal_keyed(x, animal_x_ref);
+            cost_ref += scenario.normalize_manure_keyed(x, manure_x_ref);
+        });
+        compiled_ms += time_ms([&] {
+            lc_cost = scenario.normalize_lc(x, lc_x, amount_minus, amount_plus);
+            cost += lc_cost;
+            cost += scenario.normalize_animal(x, animal_x);
+            cost += scenario.normalize_manure(x, manure_x);
+        });
+        compiled_dense_ms += time_ms([&] {
+            lc_cost_dense = scenario.normalize_lc(x, lc_x_dense, minus, plus);
+        });
+        bool is_dense_equal = lc_cost_dense == lc_cost && lc_x_dense == lc_x;
+        for (size_t p = 0; p < minus.size(); ++p) {
+            is_dense_equal = is_dense_equal && amount_minus.at(model.lc_keys[p]) == minus[p];
+        }
+        for (size_t t = 0; t < plus.size(); ++t) {
+            is_dense_equal = is_dense_equal && amount_plus.at(model.lc_to_keys[t]) == plus[t];
+        }
+
+        if (cost != cost_ref || lc_x != lc_x_ref || animal_x != animal_x_ref || manure_x != manure_x_ref ||
+            amount_minus != amount_minus_ref || amount_plus != amount_plus_ref || !is_dense_equal) {
+            ++mismatches;
+        }
+    }
+
+    fmt::print("keyed:    {:>10.3f} ms/sample\n", keyed_ms / nsamples);
+    fmt::print("compiled: {:>10.3f} ms/sample (land with dense alpha: {:.3f} ms)\n", compiled_ms / nsamples, compiled_dense_ms / nsamples);
+    fmt::print("speedup:  {:>10.2f}x\n", keyed_ms / compiled_ms);
+    if (mismatches > 0) {
+        std::cerr << mismatches << " of " << nsamples << " samples differ between the keyed and compiled paths" << std::endl;
+        return -1;
+    }
+    fmt::print("all {} samples identical\n", nsamples);
+    return 0;
+}
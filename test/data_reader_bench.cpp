@@ -0,0 +1,521 @@
+// DataReader::read_all against the csv.hpp loader it replaced, kept here as
+// the reference: every table must load to the same state, on a synthetic
+// CAST-sized CSV set with malformed rows, CRLF lines, blank lines and quoted
+// fields, or on a real csvs directory. Then times both, with CSV_NTHREADS=1
+// and with one thread per core (at least 4), and checks that csv_table::File
+// gives the same rows whatever the chunk size.
+//
+// usage: data_reader_bench [csvs dir | animal population rows]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "csv.hpp"
+#include "csv_table.h"
+#include "data_reader.h"
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // the loaders of DataReader before csv_table, minus the printing
+    struct Reference {
+        std::unordered_map<int, int> u_u_group_dict;
+        std::unordered_map<int, int> s_geography_dict;
+        std::unordered_map<int, std::tuple<int, int, std::string, std::string, std::string>> geography_county;
+        std::unordered_map<int, int> s_state_dict;
+        std::unordered_map<int, std::unordered_map<int, double>> bmp_cost_dict;
+        std::unordered_map<std::string, double> bmp_cost;
+        std::unordered_map<int, std::vector<int>> load_src_to_bmp_list;
+        std::unordered_map<std::string, int> lc_bmp_from_to;
+        std::unordered_map<std::string, double> animal;
+        std::unordered_map<std::string, std::vector<std::string>> animal_idx;
+        std::unordered_map<int, std::vector<int>> animal_grp_bmps;
+        std::unordered_map<std::string, std::vector<std::string>> bmp_cost_idx;
+        std::vector<std::vector<int>> lrseg;
+        std::unordered_map<int, std::string> scenario_data;
+        std::unordered_map<int, std::string> scenario_data2;
+        size_t exceptions = 0;
+
+        template <typename F>
+        void each_row(const std::string& filename, F&& f) {
+            csv::CSVReader reader(filename);
+            for (auto& row : reader) {
+                try {
+                    f(row);
+                } catch (std::exception&) {
+                    ++exceptions;
+                }
+            }
+        }
+
+        void read_all(const std::string& dir) {
+            each_row(dir + "/load_src_to_load_src_grp.csv", [&](csv::CSVRow& row) {
+                int load_src = row["LoadSrcId"].get<int>();
+                int load_src_grp = row["LoadSrcGrpId"].get<int>();
+                u_u_group_dict[load_src] = load_src_grp;
+            });
+            each_row(dir + "/lrseg_geo.csv", [&](csv::CSVRow& row) {
+                int lrseg = row["LrsegId"].get<int>();
+                int geography = row["GeographyId"].get<int>();
+                int state = row["StateId"].get<int>();
+                s_geography_dict[lrseg] = geography;
+                s_state_dict[lrseg] = state;
+            });
+            each_row(dir + "/TblBmpLoadSourceFromTo.csv", [&](csv::CSVRow& row) {
+                int bmp_id = row["BmpId"].get<int>();
+                int load_src_from = row["FromLoadSourceId"].get<int>();
+                int load_src_to = row["ToLoadSourceId"].get<int>();
+                auto key = fmt::format("{}_{}", bmp_id, load_src_from);
+                lc_bmp_from_to[key] = load_src_to;
+                if (load_src_to_bmp_list.contains(load_src_from)) {
+                    auto tmp_list = load_src_to_bmp_list[load_src_from];
+                    tmp_list.push_back(bmp_id);
+                    load_src_to_bmp_list[load_src_from] = tmp_list;
+                }
+                else {
+                    load_src_to_bmp_list[load_src_from] = {bmp_id};
+                }
+            });
+            each_row(dir + "/TblAnimalPopulation-filtered.csv", [&](csv::CSVRow& row) {
+                int base_condition = row["BaseConditionId"].get<int>();
+                int county = row["CountyId"].get<int>();
+                int load_source = row["LoadSourceId"].get<int>();
+                int animal_id = row["AnimalId"].get<int>();
+                double animal_units = row["AnimalUnits"].get<double>();
+                auto key = fmt::format("{}_{}_{}_{}", base_condition, county, load_source, animal_id);
+                auto key_base_county = fmt::format("{}_{}", base_condition, county);
+                animal[key] = animal_units;
+                if (animal_idx.contains(key_base_county)) {
+                    auto tmp_lst = animal_idx.at(key_base_county);
+                    tmp_lst.push_back(key);
+                    animal_idx[key_base_county] = tmp_lst;
+                }
+                else {
+                    animal_idx[key_base_county] = {key};
+                }
+            });
+            each_row(dir + "/TblAnimalGrpBmp.csv", [&](csv::CSVRow& row) {
+                int animal_grp = row["AnimalGrp"].get<int>();
+                int bmp = row["Bmp"].get<int>();
+                if (animal_grp_bmps.contains(animal_grp)) {
+                    auto tmp_lst = animal_grp_bmps.at(animal_grp);
+                    tmp_lst.push_back(bmp);
+                    animal_grp_bmps[animal_grp] = tmp_lst;
+                }
+                else {
+                    animal_grp_bmps[animal_grp] = {bmp};
+                }
+            });
+            for (const auto* name : {"/TblCostBmpLand.csv", "/TblCostBmpAnimal-reduced.csv"}) {
+                each_row(dir + name, [&](csv::CSVRow& row) {
+                    int profile = row["CostProfileId"].get<int>();
+                    int bmp = row["BmpId"].get<int>();
+                    double cost = row["TotalCostPerUnit"].get<double>();
+                    auto key = fmt::format("{}_{}", profile, bmp);
+                    bmp_cost[key] = cost;
+                    auto profile_str = std::to_string(profile);
+                    if (bmp_cost_idx.contains(profile_str)) {
+                        auto tmp_lst = bmp_cost_idx.at(profile_str);
+                        tmp_lst.push_back(key);
+                        bmp_cost_idx[profile_str] = tmp_lst;
+                    }
+                    else {
+                        bmp_cost_idx[profile_str] = {key};
+                    }
+                });
+            }
+            size_t before = exceptions;
+            for (const auto* name : {"/TblCostBmpLand.csv", "/TblCostBmpAnimal-reduced.csv"}) {
+                each_row(dir + name, [&](csv::CSVRow& row) {
+                    int profile = row["CostProfileId"].get<int>();
+                    int bmp = row["BmpId"].get<int>();
+                    double cost = row["TotalCostPerUnit"].get<double>();
+                    bmp_cost_dict[profile][bmp] = cost;
+                });
+            }
+            // DataReader parses each cost file once, so reports its rows once
+            exceptions = before;
+            each_row(dir + "/TblLandRiverSegment.csv", [&](csv::CSVRow& row) {
+                int lrseg_id = row["LrsegId"].get<int>();
+                row["LandSegmentGeographyId"].get<int>();
+                int fips = row["FIPS"].get<int>();
+                int state = row["StateId"].get<int>();
+                int county = row["CountyId"].get<int>();
+                lrseg.push_back({lrseg_id, fips, state, county});
+            });
+            each_row(dir + "/TblScenario.csv", [&](csv::CSVRow& row) {
+                auto ScenarioId = row["ScenarioId"].get<int>();
+                json data;
+                data["AtmDepDataSetId"] = row["AtmDepDataSetId"].get<int>();
+                data["BackoutScenarioId"] = row["BackoutScenarioId"].get<int>();
+                data["BaseConditionId"] = row["BaseConditionId"].get<int>();
+                data["BaseLoadId"] = row["BaseLoadId"].get<int>();
+                data["CostProfileId"] = row["CostProfileId"].get<int>();
+                data["ClimateChangeDataSetId"] = row["ClimateChangeDataSetId"].get<int>();
+                data["HistoricalCropNeedScenario"] = 9999;
+                data["PointSourceDataSetId"] = row["PointSourceDataSetId"].get<int>();
+                data["ScenarioTypeId"] = row["ScenarioTypeId"].get<int>();
+                data["SoilPDataSetId"] = row["SoilPDataSetId"].get<int>();
+                data["SourceDataRevisionId"] = row["SourceDataRevisionId"].get<int>();
+                scenario_data[ScenarioId] = data.dump();
+                scenario_data2[ScenarioId] = fmt::format("{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}_{}", "",
+                    row["AtmDepDataSetId"].get<int>(), row["BackoutScenarioId"].get<int>(),
+                    row["BaseConditionId"].get<int>(), row["BaseLoadId"].get<int>(), row["CostProfileId"].get<int>(),
+                    row["ClimateChangeDataSetId"].get<int>(), 9999, row["PointSourceDataSetId"].get<int>(),
+                    row["ScenarioTypeId"].get<int>(), row["SoilPDataSetId"].get<int>(),
+                    row["SourceDataRevisionId"].get<int>());
+            });
+            each_row(dir + "/TblGeographyCounty.csv", [&](csv::CSVRow& row) {
+                int county = row["CountyId"].get<int>();
+                int geography = row["GeographyId"].get<int>();
+                int geography2 = row["GeographyType2Id"].get<int>();
+                std::string fips = row["FIPS"].get<std::string>();
+                std::string county_name = row["CountyName"].get<std::string>();
+                std::string state = row["StateAbbreviation"].get<std::string>();
+                geography_county[county] = {geography, geography2, fips, county_name, state};
+            });
+        }
+    };
+
+    // Writes one CSV, with the odd malformed value, short row, blank line and
+    // CRLF ending; returns the number of short rows, which csv.hpp skips.
+    class Writer {
+    public:
+        Writer(const fs::path& filename, const std::vector<std::string>& header, std::mt19937& gen, double odd)
+            : out_(filename, std::ios::binary), gen_(gen), odd_(odd) {
+            for (size_t i = 0; i < header.size(); ++i) {
+                out_ << (i > 0 ? "," : "") << header[i];
+            }
+            out_ << "\n";
+        }
+
+        bool odd() {
+            return odd_ > 0 && dist_(gen_) < odd_;
+        }
+        // an integer field, now and then not one
+        std::string id(int value) {
+            if (odd()) {
+                static const std::vector<std::string> bad = {"NA", "", "1.5", "99999999999", "-", "12a", " "};
+                return bad[gen_() % bad.size()];
+            }
+            return std::to_string(value);
+        }
+        void row(const std::vector<std::string>& fields) {
+            if (odd()) {
+                out_ << "\n";
+            }
+            size_t n = fields.size();
+            bool short_row = odd();
+            if (short_row) {
+                n = gen_() % n;
+            }
+            std::string line;
+            for (size_t i = 0; i < n; ++i) {
+                line += (i > 0 ? "," : "") + fields[i];
+            }
+            // an empty line is skipped, not reported
+            short_rows_ += short_row && !line.empty();
+            out_ << line << (odd() ? "\r\n" : "\n");
+        }
+        size_t short_rows() const {
+            return short_rows_;
+        }
+
+    private:
+        std::ofstream out_;
+        std::mt19937& gen_;
+        std::uniform_real_distribution<double> dist_{0.0, 1.0};
+        double odd_;
+        size_t short_rows_ = 0;
+    };
+
+    std::string number(std::mt19937& gen, double scale) {
+        std::uniform_real_distribution<double> dist(0.0, scale);
+        switch (gen() % 4) {
+            case 0: return fmt::format("{:.2f}", dist(gen));
+            case 1: return fmt::format("{}", dist(gen));
+            case 2: return fmt::format("{:e}", dist(gen));
+            default: return std::to_string(gen() % 1000);
+        }
+    }
+
+    std::string quoted(const std::string& text) {
+        std::string out = "\"";
+        for (char c : text) {
+            out += c;
+            if (c == '"') {
+                out += '"';
+            }
+        }
+        return out + "\"";
+    }
+
+    size_t write_csvs(const fs::path& dir, size_t animal_rows, std::mt19937& gen) {
+        fs::create_directories(dir);
+        const double odd = 0.002;
+        size_t short_rows = 0;
+        auto r = [&](int n) {
+            return static_cast<int>(gen() % n);
+        };
+        {
+            Writer w(dir / "load_src_to_load_src_grp.csv", {"LoadSrcId", "LoadSrcGrpId"}, gen, odd);
+            for (int i = 0; i < 300; ++i) {
+                w.row({w.id(r(250)), w.id(r(40))});
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            Writer w(dir / "lrseg_geo.csv", {"LrsegId", "GeographyId", "StateId"}, gen, odd);
+            for (int i = 0; i < 2800; ++i) {
+                w.row({w.id(r(3000)), w.id(r(800)), w.id(r(8))});
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            Writer w(dir / "TblBmpLoadSourceFromTo.csv", {"BmpLoadSourceFromToId", "BmpId", "FromLoadSourceId", "ToLoadSourceId"}, gen, odd);
+            for (int i = 0; i < 3000; ++i) {
+                w.row({std::to_string(i), w.id(r(300)), w.id(r(250)), w.id(r(250))});
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            Writer w(dir / "TblAnimalPopulation-filtered.csv",
+                     {"BaseConditionId", "CountyId", "LoadSourceId", "AnimalId", "AnimalUnits", "AnimalCount"}, gen, odd);
+            for (size_t i = 0; i < animal_rows; ++i) {
+                w.row({w.id(r(40)), w.id(r(210)), w.id(r(250)), w.id(r(30)),
+                       w.odd() ? "NaN" : number(gen, 5e3), std::to_string(r(100000))});
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            Writer w(dir / "TblAnimalGrpBmp.csv", {"AnimalGrp", "Bmp"}, gen, odd);
+            for (int i = 0; i < 500; ++i) {
+                w.row({w.id(r(30)), w.id(r(300))});
+            }
+            short_rows += w.short_rows();
+        }
+        for (auto [name, rows] : {std::pair{"TblCostBmpLand.csv", 30000}, std::pair{"TblCostBmpAnimal-reduced.csv", 20000}}) {
+            Writer w(dir / name, {"CostBmpSubmittedId", "CostProfileId", "SectorId", "BmpId", "LifespanYears", "Capital",
+                                  "OandM", "Opportunity", "Notes", "TotalCostPerUnit"}, gen, odd);
+            for (int i = 0; i < rows; ++i) {
+                w.row({std::to_string(i), w.id(r(60)), std::to_string(r(9)), w.id(r(300)), std::to_string(r(30)),
+                       number(gen, 1e4), number(gen, 1e3), number(gen, 1e2),
+                       r(10) == 0 ? quoted("a note, with \"quotes\"\nand a line") : "", number(gen, 1e4)});
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            Writer w(dir / "TblLandRiverSegment.csv",
+                     {"LrsegId", "LandRiverSegment", "LandSegmentGeographyId", "LandSegment", "RiverSegment", "FIPS",
+                      "StateId", "CountyId", "HgmrId", "OutOfCBWS", "AboveRIM", "TotalAcres",
+                      "TotalAcresIncludingTidalWetlands"}, gen, odd);
+            for (int i = 0; i < 2800; ++i) {
+                w.row({w.id(i), fmt::format("N{}_{}", r(99999), r(9999)), w.id(r(800)), fmt::format("N{}", r(99999)),
+                       fmt::format("XU{}", r(9999)), w.id(r(60000)), w.id(r(8)), w.id(r(210)), std::to_string(r(20)),
+                       std::to_string(r(2)), std::to_string(r(2)), number(gen, 1e5), number(gen, 1e5)});
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            std::vector<std::string> header = {"ScenarioId", "ScenarioName", "ScenarioDescription", "SourceDataRevisionId",
+                "BaseConditionId", "ScenarioTypeId", "BackoutScenarioId", "NeienProgressRunId", "PointSourceDataSetId",
+                "AtmDepDataSetId", "ClimateChangeDataSetId", "SoilPDataSetId", "BaseLoadId", "CostProfileId",
+                "CreateDate", "UserId", "ScenarioStatusId", "IsEditable", "IsCbpoScenario", "Notes",
+                "IsPublicScenario", "IsRestrictedByState", "LastModifiedDate"};
+            Writer w(dir / "TblScenario.csv", header, gen, odd);
+            for (int i = 0; i < 5000; ++i) {
+                std::vector<std::string> fields = {w.id(r(6000)), quoted(fmt::format("Scenario, {}", i)),
+                    r(5) == 0 ? quoted("multi\r\nline \"description\"") : "plain"};
+                for (size_t k = 3; k < header.size(); ++k) {
+                    fields.push_back(k == 14 || k == 22 ? "2023-04-01 10:00:00" : w.id(r(9000)));
+                }
+                w.row(fields);
+            }
+            short_rows += w.short_rows();
+        }
+        {
+            Writer w(dir / "TblGeographyCounty.csv",
+                     {"GeographyId", "CountyId", "GeographyType2Id", "FIPS", "CountyName", "StateAbbreviation"}, gen, odd);
+            for (int i = 0; i < 250; ++i) {
+                w.row({w.id(r(900)), w.id(r(210)), w.id(r(50)), fmt::format("{:05}", r(60000)),
+                       r(3) == 0 ? quoted(fmt::format("County {}, \"City\"", i)) : fmt::format("County {}", i),
+                       r(2) == 0 ? "VA" : "\"MD\""});
+            }
+            short_rows += w.short_rows();
+        }
+        return short_rows;
+    }
+
+    int compare(const Reference& ref, DataReader& reader) {
+        int errors = 0;
+        auto check = [&](bool same, const char* name) {
+            if (!same) {
+                std::cerr << name << " differs" << std::endl;
+                ++errors;
+            }
+        };
+        check(ref.u_u_group_dict == reader.get_u_u_groups(), "load source groups");
+        check(ref.s_geography_dict == reader.get_geographies(), "lrseg geographies");
+        check(ref.s_state_dict == reader.get_states(), "lrseg states");
+        check(ref.load_src_to_bmp_list == reader.get_load_src_to_bmp_dict(), "load source bmps");
+        check(ref.lc_bmp_from_to == reader.get_lc_bmp_from_to(), "bmp from to");
+        check(ref.animal == reader.get_animal(), "animal population");
+        check(ref.animal_grp_bmps == reader.get_animal_grp_bmps(), "animal group bmps");
+        check(ref.bmp_cost == reader.get_bmp_cost(), "bmp cost");
+        check(ref.bmp_cost_dict == reader.get_land_bmp_costs(), "bmp cost by profile");
+        check(ref.lrseg == reader.get_lrseg(), "lrseg");
+        check(ref.geography_county == reader.get_geography_county(), "geography county");
+
+        for (const auto& [key, keys] : ref.animal_idx) {
+            check(keys == reader.get_animal_idx(key), "animal index");
+        }
+        for (const auto& [profile, keys] : ref.bmp_cost_idx) {
+            check(keys == reader.get_bmp_cost_idx(profile), "bmp cost index");
+        }
+        for (const auto& [id, data] : ref.scenario_data) {
+            check(data == reader.get_scenario_data(id), "scenario data");
+            check(ref.scenario_data2.at(id) == reader.get_scenario_data2(id), "scenario data2");
+        }
+        for (int id = -1; id < 10000; ++id) {
+            if (!ref.scenario_data.contains(id)) {
+                bool loaded = true;
+                try {
+                    reader.get_scenario_data(id);
+                } catch (const std::out_of_range&) {
+                    loaded = false;
+                }
+                check(!loaded, "scenario ids");
+            }
+        }
+        return errors;
+    }
+
+    // the same rows and errors out of csv_table::File for any chunk size
+    int check_chunks(const fs::path& filename, const std::vector<std::string>& columns) {
+        auto rows_of = [&](size_t chunk_bytes) {
+            csv_table::Table<std::vector<std::string>> table(filename.string(), columns, [&](csv_table::Row& row) {
+                std::vector<std::string> values;
+                for (size_t k = 0; k < columns.size(); ++k) {
+                    values.push_back(row.get<std::string>(k));
+                }
+                row.get<int>(0);
+                return values;
+            }, chunk_bytes);
+            csv_table::parse_all({&table}, nullptr);
+            std::vector<std::vector<std::string>> rows;
+            table.for_each([&](const auto& values) {
+                rows.push_back(values);
+            });
+            std::vector<size_t> lines;
+            for (const auto& error : table.errors()) {
+                lines.push_back(error.line);
+            }
+            return std::tuple{rows, lines, table.rows(), table.chunks()};
+        };
+        auto whole = rows_of(size_t{1} << 40);
+        int errors = 0;
+        for (size_t chunk_bytes : {1, 7, 64, 1000, 100000}) {
+            auto chunked = rows_of(chunk_bytes);
+            if (std::get<0>(chunked) != std::get<0>(whole) || std::get<1>(chunked) != std::get<1>(whole)
+                    || std::get<2>(chunked) != std::get<2>(whole)) {
+                std::cerr << fmt::format("{} in {} byte chunks ({}) differs", filename.filename().string(), chunk_bytes,
+                                         std::get<3>(chunked)) << std::endl;
+                ++errors;
+            }
+        }
+        return errors;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::mt19937 gen(20);
+    fs::path dir;
+    bool synthetic = true;
+    size_t animal_rows = 400000;
+    if (argc > 1 && fs::is_directory(argv[1])) {
+        dir = argv[1];
+        synthetic = false;
+    }
+    else {
+        if (argc > 1) {
+            animal_rows = std::stoul(argv[1]);
+        }
+        dir = fs::temp_directory_path() / fmt::format("data_reader_bench_{}", getpid());
+    }
+    size_t short_rows = synthetic ? write_csvs(dir, animal_rows, gen) : 0;
+    size_t bytes = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() == ".csv") {
+            bytes += entry.file_size();
+        }
+    }
+    int errors = 0;
+
+    Reference ref;
+    double ref_ms = time_ms([&] { ref.read_all(dir.string()); });
+
+    setenv("CSV_NTHREADS", "1", 1);
+    DataReader serial(dir.string());
+    double serial_ms = time_ms([&] { serial.read_all(); });
+    errors += compare(ref, serial);
+
+    // at least 4, to go through the concurrent loads even on a small machine
+    unsigned nthreads = std::max(4u, std::thread::hardware_concurrency());
+    setenv("CSV_NTHREADS", std::to_string(nthreads).c_str(), 1);
+    DataReader parallel(dir.string());
+    double parallel_ms = time_ms([&] { parallel.read_all(); });
+    errors += compare(ref, parallel);
+
+    if (synthetic && parallel.get_errors().size() != ref.exceptions + short_rows) {
+        std::cerr << fmt::format("{} rows reported, {} expected ({} conversions, {} short rows)",
+                                 parallel.get_errors().size(), ref.exceptions + short_rows, ref.exceptions, short_rows)
+                  << std::endl;
+        ++errors;
+    }
+
+    fmt::print("\n{} CSV files, {:.1f} MB, {} animal population rows, {} rows not loaded\n",
+               synthetic ? "synthetic" : dir.string(), bytes / (1024.0 * 1024.0), ref.animal.size(),
+               parallel.get_errors().size());
+    fmt::print("{:<40} {:>12.1f} ms\n", "csv.hpp loaders", ref_ms);
+    fmt::print("{:<40} {:>12.1f} ms\n", "read_all, CSV_NTHREADS=1", serial_ms);
+    fmt::print("{:<40} {:>12.1f} ms\n", fmt::format("read_all, CSV_NTHREADS={}", nthreads), parallel_ms);
+
+    errors += check_chunks(dir / "TblScenario.csv", {"ScenarioId", "ScenarioName", "ScenarioDescription"});
+    errors += check_chunks(dir / "TblCostBmpLand.csv", {"CostProfileId", "Notes", "TotalCostPerUnit"});
+    errors += check_chunks(dir / "TblGeographyCounty.csv", {"CountyId", "CountyName", "StateAbbreviation"});
+    if (synthetic) {
+        fs::remove_all(dir);
+    }
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Runs a swarm-like sequence of land solutions through the in-process
+// ModelEvaluator twice: once evaluating every solution, once through an
+// EvaluationCache as PSO::evaluate does. Both must produce identical fitness
+// values; the cache file must give the same loads and directories back when
+// reopened, and a reordered submission must map to the same key.
+//
+// usage: evaluation_cache_test <input.json> <scenario.json> <manure_nutrients.json> [generations]
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "evaluation_cache.h"
+#include "evaluator.h"
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using LandRows = std::vector<std::tuple<int, int, int, int, double>>;
+    const std::vector<std::tuple<int, int, int, int, int, double>> NO_ROWS;
+
+    double load_of(const std::string& result) {
+        return std::stod(result.substr(result.find('_') + 1));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0] << " <input.json> <scenario.json> <manure_nutrients.json> [generations]" << std::endl;
+        return -1;
+    }
+    int generations = argc > 4 ? std::stoi(argv[4]) : 30;
+    int nparticles = 20;
+
+    Scenario scenario;
+    scenario.init(argv[1], argv[2], false, true, false, false, argv[3]);
+    ModelEvaluator evaluator(scenario);
+
+    // particles that stay put, or move and get clamped to the bounds as in Particle::update
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::normal_distribution<double> step(0.0, 0.3);
+    std::vector<std::vector<double>> x(nparticles, std::vector<double>(scenario.get_nvars()));
+    for (auto& position : x) {
+        for (auto& xi : position) {
+            xi = dist(gen);
+        }
+    }
+    std::unordered_map<std::string, double> amount_minus;
+    std::unordered_map<std::string, double> amount_plus;
+    std::vector<std::vector<LandRows>> lc_x(generations, std::vector<LandRows>(nparticles));
+    for (int g = 0; g < generations; ++g) {
+        for (int i = 0; i < nparticles; ++i) {
+            if (g > 0 && dist(gen) < 0.5) {
+                for (auto& xi : x[i]) {
+                    xi = std::clamp(xi + step(gen), 0.0, 1.0);
+                }
+            }
+            scenario.normalize_lc(x[i], lc_x[g][i], amount_minus, amount_plus);
+        }
+    }
+
+    auto cache_file = fs::temp_directory_path() / fmt::format("evaluation_cache_test_{}.cache", getpid());
+    fs::remove(cache_file);
+    uint64_t context = 42;
+    int errors = 0;
+    std::vector<uint64_t> keys;
+    std::vector<double> loads;
+    {
+        EvaluationCache cache(cache_file.string());
+        for (int g = 0; g < generations; ++g) {
+            std::vector<EvaluationRequest> all;
+            for (int i = 0; i < nparticles; ++i) {
+                all.push_back({fmt::format("g{}-p{}", g, i), &lc_x[g][i], nullptr, nullptr});
+            }
+            std::vector<double> fx_off(nparticles);
+            auto results = evaluator.evaluate(scenario, "cache-off", all);
+            for (int i = 0; i < nparticles; ++i) {
+                fx_off[i] = load_of(results[i]);
+            }
+
+            // cache on: hits are not evaluated at all
+            std::vector<double> fx_on(nparticles);
+            std::vector<EvaluationRequest> misses;
+            std::vector<int> miss_idx;
+            std::vector<uint64_t> generation_keys;
+            for (int i = 0; i < nparticles; ++i) {
+                generation_keys.push_back(EvaluationCache::solution_key(context, lc_x[g][i], NO_ROWS, NO_ROWS));
+                if (auto entry = cache.find(generation_keys[i])) {
+                    fx_on[i] = entry->load;
+                }
+                else {
+                    misses.push_back(all[i]);
+                    miss_idx.push_back(i);
+                }
+            }
+            auto miss_results = evaluator.evaluate(scenario, "cache-on", misses);
+            for (size_t k = 0; k < miss_idx.size(); ++k) {
+                int i = miss_idx[k];
+                fx_on[i] = load_of(miss_results[k]);
+                cache.insert(generation_keys[i], fx_on[i], misses[k].exec_uuid, fmt::format("/tmp/g{}", g));
+            }
+            keys.insert(keys.end(), generation_keys.begin(), generation_keys.end());
+            loads.insert(loads.end(), fx_off.begin(), fx_off.end());
+
+            for (int i = 0; i < nparticles; ++i) {
+                if (fx_on[i] != fx_off[i]) {
+                    std::cerr << fmt::format("generation {} particle {}: {} with the cache, {} without", g, i, fx_on[i], fx_off[i]) << std::endl;
+                    ++errors;
+                }
+            }
+        }
+        fmt::print("{} evaluations: {} hits, {} misses ({:.1f}% hit rate), {} distinct submissions\n",
+                   cache.hits() + cache.misses(), cache.hits(), cache.misses(), 100.0 * cache.hit_rate(), cache.size());
+        if (cache.hits() == 0) {
+            std::cerr << "no submission repeated; the cache was not exercised" << std::endl;
+            ++errors;
+        }
+    }
+
+    // a later run reads every result back
+    EvaluationCache reopened(cache_file.string());
+    for (size_t n = 0; n < keys.size(); ++n) {
+        auto entry = reopened.find(keys[n]);
+        if (!entry || entry->load != loads[n] || !entry->directory.starts_with("/tmp/g")) {
+            std::cerr << fmt::format("generation {} particle {} is missing or wrong after reopening",
+                                     n / nparticles, n % nparticles) << std::endl;
+            ++errors;
+        }
+    }
+
+    LandRows reordered = lc_x[0][0];
+    std::shuffle(reordered.begin(), reordered.end(), gen);
+    if (EvaluationCache::solution_key(context, reordered, NO_ROWS, NO_ROWS) != keys[0]
+            || EvaluationCache::solution_key(context + 1, lc_x[0][0], NO_ROWS, NO_ROWS) == keys[0]) {
+        std::cerr << "the key depends on the row order or ignores the context" << std::endl;
+        ++errors;
+    }
+
+    fs::remove(cache_file);
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    fmt::print("identical fitness values with the cache on and off\n");
+    return 0;
+}
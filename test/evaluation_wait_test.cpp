@@ -0,0 +1,200 @@
+// Fault injection for PendingEvaluations, the deadline/retry wait used by
+// RabbitMQClient. A local broker stand-in plays the CAST workers: every
+// dispatch completes after a random delay, a few are stragglers, some
+// completion messages are dropped, some workers store no result and some
+// notices arrive twice. Each generation must settle every solution exactly
+// once, with the right load, and the tail latency is reported per generation.
+//
+// usage: evaluation_wait_test [generations] [solutions] [drop_pct]
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "evaluation_wait.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    std::string load_of(const std::string& exec_uuid) {
+        return std::to_string(std::hash<std::string>{}(exec_uuid) % 100000);
+    }
+
+    class FakeBroker {
+        public:
+            FakeBroker(unsigned seed, double drop_pct) : gen_(seed), drop_pct_(drop_pct) {}
+
+            void dispatch(const std::string& exec_uuid) {
+                ++dispatches_;
+                std::uniform_real_distribution<double> pct(0.0, 100.0);
+                // typical evaluations, plus 2% stragglers slower than the deadline
+                double ms = pct(gen_) < 2.0 ? std::uniform_real_distribution<double>(300.0, 500.0)(gen_)
+                                            : std::lognormal_distribution<double>(2.5, 0.6)(gen_);
+                bool stores_result = pct(gen_) >= 1.0;
+                if (stores_result) {
+                    results_[exec_uuid] = load_of(exec_uuid);
+                }
+                if (pct(gen_) < drop_pct_) {
+                    ++dropped_;
+                    return;
+                }
+                auto at = Clock::now() + std::chrono::microseconds(static_cast<long>(ms * 1000));
+                queue_.push({at, exec_uuid});
+                if (pct(gen_) < 1.0) {
+                    queue_.push({at + std::chrono::milliseconds(5), exec_uuid});
+                }
+            }
+
+            // Transport
+            std::optional<std::string> receive(std::chrono::milliseconds timeout) {
+                auto until = Clock::now() + timeout;
+                if (!queue_.empty() && queue_.top().first <= until) {
+                    std::this_thread::sleep_until(queue_.top().first);
+                    auto exec_uuid = queue_.top().second;
+                    queue_.pop();
+                    return exec_uuid;
+                }
+                std::this_thread::sleep_until(until);
+                return std::nullopt;
+            }
+            bool resend(const std::string& exec_uuid) {
+                dispatch(exec_uuid);
+                return true;
+            }
+            std::optional<std::string> collect(const std::string& exec_uuid) {
+                auto it = results_.find(exec_uuid);
+                if (it == results_.end()) {
+                    return std::nullopt;
+                }
+                auto load = it->second;
+                results_.erase(it);
+                return load;
+            }
+            void drop(const std::string& exec_uuid) {
+                results_.erase(exec_uuid);
+            }
+
+            int dispatches() const {
+                return dispatches_;
+            }
+            int dropped() const {
+                return dropped_;
+            }
+        private:
+            using Delivery = std::pair<Clock::time_point, std::string>;
+            std::mt19937 gen_;
+            double drop_pct_;
+            std::priority_queue<Delivery, std::vector<Delivery>, std::greater<>> queue_;
+            std::unordered_map<std::string, std::string> results_;
+            int dispatches_ = 0;
+            int dropped_ = 0;
+    };
+
+    double percentile(std::vector<double> values, double p) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(p / 100.0 * values.size()))];
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int generations = argc > 1 ? std::stoi(argv[1]) : 6;
+    int nsolutions = argc > 2 ? std::stoi(argv[2]) : 200;
+    double drop_pct = argc > 3 ? std::stod(argv[3]) : 3.0;
+
+    WaitOptions options;
+    options.deadline = std::chrono::milliseconds(150);
+    options.max_retries = 2;
+    options.poll = std::chrono::milliseconds(50);
+
+    int errors = 0;
+    fmt::print("{:>3} {:>5} {:>6} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8}\n", "gen", "mode", "scored", "unscored",
+               "resent", "dropped", "p50 ms", "p95 ms", "p99 ms", "max ms");
+    for (int g = 0; g < generations; ++g) {
+        // odd generations settle solutions as they come, like the asynchronous PSO
+        bool any = g % 2 == 1;
+        FakeBroker broker(17 + g, drop_pct);
+        PendingEvaluations pending(options);
+        std::vector<std::string> exec_uuids;
+        for (int i = 0; i < nsolutions; ++i) {
+            exec_uuids.push_back(fmt::format("gen{}-solution{}", g, i));
+            broker.dispatch(exec_uuids.back());
+            pending.dispatched(exec_uuids.back());
+        }
+
+        auto start = Clock::now();
+        WaitOutcome outcome;
+        while (!pending.empty()) {
+            auto part = pending.wait(broker, any);
+            if (part.scored.empty() && part.unscored.empty()) {
+                std::cerr << "generation " << g << ": wait() settled nothing" << std::endl;
+                ++errors;
+                break;
+            }
+            outcome.scored.insert(outcome.scored.end(), part.scored.begin(), part.scored.end());
+            outcome.unscored.insert(outcome.unscored.end(), part.unscored.begin(), part.unscored.end());
+            outcome.latency_ms.insert(outcome.latency_ms.end(), part.latency_ms.begin(), part.latency_ms.end());
+            outcome.redispatched += part.redispatched;
+        }
+        double wall_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::unordered_set<std::string> settled;
+        for (const auto& result : outcome.scored) {
+            auto sep = result.find('_');
+            auto exec_uuid = result.substr(0, sep);
+            if (!settled.insert(exec_uuid).second) {
+                std::cerr << exec_uuid << " settled twice" << std::endl;
+                ++errors;
+            }
+            if (result.substr(sep + 1) != load_of(exec_uuid)) {
+                std::cerr << exec_uuid << " has a wrong load: " << result << std::endl;
+                ++errors;
+            }
+        }
+        for (const auto& exec_uuid : outcome.unscored) {
+            if (!settled.insert(exec_uuid).second) {
+                std::cerr << exec_uuid << " settled twice" << std::endl;
+                ++errors;
+            }
+        }
+        if (settled.size() != exec_uuids.size() || outcome.latency_ms.size() != outcome.scored.size()) {
+            std::cerr << "generation " << g << ": " << settled.size() << " of " << exec_uuids.size() << " settled" << std::endl;
+            ++errors;
+        }
+        if (broker.dispatches() != nsolutions + outcome.redispatched) {
+            std::cerr << "generation " << g << ": " << broker.dispatches() << " dispatches for "
+                      << outcome.redispatched << " retries" << std::endl;
+            ++errors;
+        }
+        // nothing may wait much longer than all its attempts' deadlines
+        double bound_ms = (options.max_retries + 1) * (options.deadline + options.poll).count() + 100.0;
+        if (wall_ms > bound_ms) {
+            std::cerr << "generation " << g << " took " << wall_ms << " ms, more than " << bound_ms << " ms" << std::endl;
+            ++errors;
+        }
+
+        fmt::print("{:>3} {:>5} {:>6} {:>8} {:>8} {:>8} {:>8.1f} {:>8.1f} {:>8.1f} {:>8.1f}\n", g, any ? "any" : "all",
+                   outcome.scored.size(), outcome.unscored.size(), outcome.redispatched, broker.dropped(),
+                   percentile(outcome.latency_ms, 50), percentile(outcome.latency_ms, 95),
+                   percentile(outcome.latency_ms, 99), percentile(outcome.latency_ms, 100));
+    }
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    fmt::print("every solution settled exactly once\n");
+    return 0;
+}
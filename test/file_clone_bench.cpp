@@ -0,0 +1,146 @@
+// Created by: Gregorio Toscano
+//
+// The copies of one PSO generation with a disabled category: every particle
+// gets the base animal and manure submission files, and the front directory
+// is copied out by save_gbest. Times them and measures the space they take
+// (statvfs) with fs::copy_file as before, with copy_file_range and with
+// file_clone::clone, in each directory given, so that one run compares the
+// filesystems they are on (ext4, xfs, tmpfs, ...).
+//
+// usage: file_clone_bench [nparts] [base_mb] [generations] [dir...]
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "file_clone.h"
+#include "misc_utilities.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double used_mb(const std::string& dir) {
+        struct statvfs st{};
+        ::statvfs(dir.c_str(), &st);
+        return static_cast<double>(st.f_blocks - st.f_bfree) * st.f_frsize / 1e6;
+    }
+
+    std::string filesystem_of(const std::string& dir) {
+        std::ifstream mounts("/proc/mounts");
+        std::string device, mount_point, type, rest, best_type = "?";
+        size_t best = 0;
+        auto path = fs::canonical(dir).string();
+        while (mounts >> device >> mount_point >> type && std::getline(mounts, rest)) {
+            if (path.starts_with(mount_point) && mount_point.size() >= best) {
+                best = mount_point.size();
+                best_type = type;
+            }
+        }
+        return best_type;
+    }
+
+    void write_file(const std::string& filename, size_t size, uint64_t seed) {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; i += 8) {
+            uint64_t v = misc_utilities::mix64(seed + i);
+            content.replace(i, std::min<size_t>(8, size - i), reinterpret_cast<const char*>(&v), std::min<size_t>(8, size - i));
+        }
+        std::ofstream(filename, std::ios::binary) << content;
+    }
+
+    using Copy = std::function<void(const std::string&, const std::string&, bool immutable)>;
+
+    // One generation: the disabled-category base files for every particle,
+    // then the front directory.
+    void generation(const std::string& dir, int nparts, int gen, const Copy& copy) {
+        auto exec_path = fmt::format("{}/gen_{}", dir, gen);
+        fs::create_directories(exec_path + "/front");
+        for (int i = 0; i < nparts; ++i) {
+            copy(dir + "/base_animal.parquet", fmt::format("{}/{}_{}_impbmpsubmittedanimal.parquet", exec_path, gen, i), true);
+            copy(dir + "/base_manure.parquet", fmt::format("{}/{}_{}_impbmpsubmittedmanuretransport.parquet", exec_path, gen, i), true);
+        }
+        for (int i = 0; i < nparts / 4; ++i) {
+            for (auto suffix : {"_impbmpsubmittedanimal.parquet", "_impbmpsubmittedmanuretransport.parquet"}) {
+                auto name = fmt::format("{}_{}{}", gen, i, suffix);
+                copy(fmt::format("{}/{}", exec_path, name), fmt::format("{}/front/{}", exec_path, name), false);
+            }
+        }
+    }
+
+    void bench(const std::string& root, int nparts, double base_mb, int generations) {
+        auto dir = fmt::format("{}/file_clone_bench_{}", root, getpid());
+        fs::create_directories(dir);
+        write_file(dir + "/base_animal.parquet", static_cast<size_t>(base_mb * 1e6), 1);
+        write_file(dir + "/base_manure.parquet", static_cast<size_t>(base_mb * 0.5e6), 2);
+        double logical_mb = (nparts + nparts / 4) * base_mb * 1.5;
+
+        fmt::print("{} ({}): {} generations of {} particles, {:.1f} MB of copies each\n",
+                   root, filesystem_of(root), generations, nparts, logical_mb);
+        std::vector<std::pair<std::string, Copy>> strategies = {
+            {"fs::copy_file", [](const std::string& s, const std::string& d, bool) {
+                fs::copy_file(s, d, fs::copy_options::overwrite_existing);
+            }},
+            {"copy_file_range", [](const std::string& s, const std::string& d, bool) {
+                if (!file_clone::clone_with(file_clone::Method::kernel, s, d)) {
+                    file_clone::clone_with(file_clone::Method::copy, s, d);
+                }
+            }},
+            {"file_clone::clone", [](const std::string& s, const std::string& d, bool immutable) {
+                file_clone::clone(s, d, immutable);
+            }},
+        };
+        for (const auto& [name, copy] : strategies) {
+            file_clone::reset_stats();
+            ::sync();
+            double before = used_mb(dir);
+            double ms = 0.0;
+            for (int gen = 0; gen < generations; ++gen) {
+                ms += time_ms([&] { generation(dir, nparts, gen, copy); });
+            }
+            ::sync();
+            double space = used_mb(dir) - before;
+            fmt::print("  {:<18} {:8.1f} ms/generation {:8.1f} MB/generation on disk  ", name, ms / generations, space / generations);
+            file_clone::print_stats();
+            for (int gen = 0; gen < generations; ++gen) {
+                fs::remove_all(fmt::format("{}/gen_{}", dir, gen));
+            }
+        }
+        fs::remove_all(dir);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int nparts = argc > 1 ? std::stoi(argv[1]) : 40;
+    double base_mb = argc > 2 ? std::stod(argv[2]) : 20.0;
+    int generations = argc > 3 ? std::stoi(argv[3]) : 3;
+    std::vector<std::string> dirs;
+    for (int i = 4; i < argc; ++i) {
+        dirs.emplace_back(argv[i]);
+    }
+    if (dirs.empty()) {
+        dirs.push_back(fs::temp_directory_path().string());
+    }
+
+    for (const auto& dir : dirs) {
+        bench(dir, nparts, base_mb, generations);
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Created by: Gregorio Toscano
+//
+// Clones files with every method the filesystem of out_dir supports and
+// checks that each clone is byte-identical to its source, that a clone of an
+// overwritten destination leaves the files hardlinked to the old one alone,
+// that only immutable sources are hardlinked, and that the misc_utilities
+// copies (single files, prefixed files, whole directories) give the same
+// bytes as their sources.
+//
+// usage: file_clone_test [out_dir]
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "file_clone.h"
+#include "misc_utilities.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::string read_file(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    // size bytes of noise, so a clone that drops or shifts a block shows
+    void write_random_file(const std::string& filename, size_t size, uint64_t seed) {
+        std::string content(size, '\0');
+        uint64_t state = seed;
+        for (auto& c : content) {
+            state = misc_utilities::mix64(state + 1);
+            c = static_cast<char>(state);
+        }
+        std::ofstream(filename, std::ios::binary) << content;
+    }
+
+    bool same_inode(const std::string& a, const std::string& b) {
+        std::error_code ec;
+        return fs::equivalent(a, b, ec);
+    }
+
+    int expect(bool ok, const std::string& what) {
+        if (!ok) {
+            std::cerr << "FAILED: " << what << std::endl;
+        }
+        return ok ? 0 : 1;
+    }
+
+    int check_methods(const std::string& dir) {
+        int errors = 0;
+        // empty, smaller than a block, unaligned and a few MB
+        for (size_t size : {size_t{0}, size_t{100}, size_t{4096 * 3 + 17}, size_t{5 << 20}}) {
+            auto source = fmt::format("{}/source_{}.parquet", dir, size);
+            write_random_file(source, size, size);
+            auto expected = read_file(source);
+            for (size_t m = 0; m < file_clone::nmethods; ++m) {
+                auto method = static_cast<file_clone::Method>(m);
+                auto destination = fmt::format("{}/{}_{}.parquet", dir, file_clone::to_string(method), size);
+                if (!file_clone::clone_with(method, source, destination)) {
+                    fmt::print("{:>8} not supported in {}\n", file_clone::to_string(method), dir);
+                    errors += expect(!fs::exists(destination), fmt::format("no {} left behind", destination));
+                    continue;
+                }
+                errors += expect(read_file(destination) == expected, fmt::format("{} clone of {} bytes is identical", file_clone::to_string(method), size));
+                errors += expect(same_inode(source, destination) == (method == file_clone::Method::hardlink),
+                                 fmt::format("{} clone of {} bytes shares the source only if hardlinked", file_clone::to_string(method), size));
+            }
+        }
+        // copies always work
+        errors += expect(file_clone::stats().files[static_cast<size_t>(file_clone::Method::copy)] == 4, "four byte copies counted");
+        return errors;
+    }
+
+    int check_overwrite(const std::string& dir) {
+        int errors = 0;
+        auto base = dir + "/base.parquet";
+        auto other = dir + "/other.parquet";
+        write_random_file(base, 300000, 1);
+        write_random_file(other, 200000, 2);
+        auto base_bytes = read_file(base);
+        auto other_bytes = read_file(other);
+
+        // an immutable source may be linked
+        auto linked = dir + "/linked.parquet";
+        auto method = file_clone::clone(base, linked, true);
+        errors += expect(read_file(linked) == base_bytes, "clone of an immutable source is identical");
+        fmt::print("immutable source cloned with {}\n", file_clone::to_string(method));
+        errors += expect(method == file_clone::Method::reflink || method == file_clone::Method::hardlink,
+                         "an immutable source is reflinked or hardlinked");
+        // cloning again over a link to the same file leaves one file
+        errors += expect(file_clone::clone(base, linked, true) == method, "cloned again the same way");
+        errors += expect(read_file(linked) == base_bytes, "clone over a link to the same file is identical");
+
+        // a destination hardlinked to the base is replaced, not written through
+        errors += expect(file_clone::clone(other, linked) != file_clone::Method::hardlink, "a mutable source is not hardlinked");
+        errors += expect(read_file(linked) == other_bytes, "the destination holds the new source");
+        errors += expect(read_file(base) == base_bytes, "the file the old destination was linked to is unchanged");
+
+        int leftovers = 0;
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            leftovers += entry.path().filename().string().find(".clone-") != std::string::npos;
+        }
+        errors += expect(leftovers == 0, "no temporary files left behind");
+
+        try {
+            file_clone::clone(dir + "/missing.parquet", dir + "/never.parquet");
+            errors += expect(false, "cloning a missing file throws");
+        } catch (const fs::filesystem_error&) {
+        }
+        errors += expect(!misc_utilities::copy_file(dir + "/missing.parquet", dir + "/never.parquet"), "copy_file of a missing file is false");
+        errors += expect(!fs::exists(dir + "/never.parquet"), "nothing written for a missing source");
+        return errors;
+    }
+
+    int check_misc_utilities(const std::string& dir) {
+        int errors = 0;
+        auto from = dir + "/run";
+        fs::create_directories(from + "/front/nested");
+        write_random_file(from + "/abc_impbmpsubmittedland.parquet", 1 << 20, 3);
+        write_random_file(from + "/abc_costs.json", 500, 4);
+        write_random_file(from + "/front/nested/0_reportloads.parquet", 70000, 5);
+        ::chmod((from + "/abc_costs.json").c_str(), 0640);
+
+        auto to = dir + "/copied";
+        errors += expect(misc_utilities::copy_full_directory(from, to), "copy_full_directory");
+        for (const auto& name : {"abc_impbmpsubmittedland.parquet", "abc_costs.json", "front/nested/0_reportloads.parquet"}) {
+            errors += expect(read_file(fmt::format("{}/{}", to, name)) == read_file(fmt::format("{}/{}", from, name)), fmt::format("{} copied with its directory", name));
+        }
+        errors += expect((fs::status(to + "/abc_costs.json").permissions() & fs::perms::all) == (fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read),
+                         "permissions copied");
+
+        errors += expect(misc_utilities::copy_prefix_in_to_prefix_out(from, to, "abc", "xyz"), "copy_prefix_in_to_prefix_out");
+        errors += expect(read_file(to + "/xyz_impbmpsubmittedland.parquet") == read_file(from + "/abc_impbmpsubmittedland.parquet"), "prefixed copy is identical");
+        errors += expect(misc_utilities::copy_file(from + "/abc_costs.json", to + "/abc_costs.json"), "copy_file over an existing file");
+        errors += expect(read_file(to + "/abc_costs.json") == read_file(from + "/abc_costs.json"), "copy_file is identical");
+        return errors;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string dir = argc > 1 ? argv[1] : fs::temp_directory_path().string();
+    dir = fmt::format("{}/file_clone_test_{}", dir, getpid());
+    fs::create_directories(dir);
+    int errors = 0;
+
+    errors += check_methods(dir);
+    errors += check_overwrite(dir);
+    errors += check_misc_utilities(dir);
+    file_clone::print_stats();
+
+    fs::remove_all(dir);
+    if (errors > 0) {
+        std::cerr << errors << " checks failed" << std::endl;
+        return 1;
+    }
+    fmt::print("file clone checks passed\n");
+    return 0;
+}
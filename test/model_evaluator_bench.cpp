@@ -0,0 +1,95 @@
+// Throughput of the in-process ModelEvaluator on random land solutions, with
+// no Redis, RabbitMQ or CAST worker involved. Also checks that an empty
+// submission evaluates to the base load, that evaluation is repeatable, and
+// that solutions evaluated from their written land files (full and delta
+// layouts) get the same loads, while a missing file is left out.
+//
+// usage: model_evaluator_bench <input.json> <scenario.json> <manure_nutrients.json> [nsolutions]
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "evaluator.h"
+#include "scenario.h"
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0] << " <input.json> <scenario.json> <manure_nutrients.json> [nsolutions]" << std::endl;
+        return -1;
+    }
+    int nsolutions = argc > 4 ? std::stoi(argv[4]) : 10000;
+
+    Scenario scenario;
+    scenario.init(argv[1], argv[2], false, true, false, false, argv[3]);
+    ModelEvaluator evaluator(scenario);
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<double> x(scenario.get_nvars());
+    std::unordered_map<std::string, double> amount_minus;
+    std::unordered_map<std::string, double> amount_plus;
+    std::vector<std::vector<std::tuple<int, int, int, int, double>>> lc_x(nsolutions);
+    for (auto& solution : lc_x) {
+        for (auto& xi : x) {
+            xi = dist(gen);
+        }
+        scenario.normalize_lc(x, solution, amount_minus, amount_plus);
+    }
+
+    std::vector<EvaluationRequest> requests;
+    for (int i = 0; i < nsolutions; ++i) {
+        requests.push_back({fmt::format("solution-{}", i), &lc_x[i], nullptr, nullptr});
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = evaluator.evaluate(scenario, "bench", requests);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fmt::print("{} solutions in {:.3f} s: {:.0f} evaluations/s (base load {})\n",
+               nsolutions, seconds, nsolutions / seconds, evaluator.get_base_load());
+
+    int errors = 0;
+    std::vector<std::tuple<int, int, int, int, double>> empty;
+    if (evaluator.compute_load({"empty", &empty, nullptr, nullptr}) != evaluator.get_base_load()) {
+        std::cerr << "an empty submission does not evaluate to the base load" << std::endl;
+        ++errors;
+    }
+    if (evaluator.evaluate(scenario, "bench", requests) != results) {
+        std::cerr << "evaluation is not repeatable" << std::endl;
+        ++errors;
+    }
+
+    // from the submission files
+    auto dir = std::filesystem::temp_directory_path() / fmt::format("model_evaluator_bench_{}", getpid());
+    std::filesystem::create_directories(dir);
+    int nfiles = std::min(nsolutions, 20);
+    for (auto layout : {SubmissionLayout::Full, SubmissionLayout::Delta}) {
+        scenario.set_submission_layout(layout);
+        if (layout == SubmissionLayout::Delta) {
+            scenario.write_land_base((dir / "base_land.parquet").string(), BmpTableLand{});
+        }
+        std::vector<EvaluationRequest> file_requests;
+        for (int i = 0; i < nfiles; ++i) {
+            auto land_file = (dir / fmt::format("{}_impbmpsubmittedland.parquet", i)).string();
+            scenario.write_land(lc_x[i], land_file, BmpTableLand{});
+            file_requests.push_back({requests[i].exec_uuid, &lc_x[i], nullptr, nullptr, land_file});
+        }
+        file_requests.push_back({"missing", &lc_x[0], nullptr, nullptr, (dir / "missing.parquet").string()});
+        auto file_results = evaluator.evaluate(scenario, "bench", file_requests);
+        if (file_results != std::vector<std::string>(results.begin(), results.begin() + nfiles)) {
+            std::cerr << "loads from the submission files differ from those of the rows" << std::endl;
+            ++errors;
+        }
+    }
+    std::filesystem::remove_all(dir);
+    return errors > 0 ? -1 : 0;
+}
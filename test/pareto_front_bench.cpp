@@ -0,0 +1,156 @@
+// find_pareto_front against the pairwise dominates() scan it replaced: the
+// fronts must be equal, in the same order, for 2 and 3 objectives with
+// records over the budget, ties, duplicates, missing third objectives and
+// NaNs. Then times both on n records (the pairwise scan only up to 2 * 10^4)
+// and findParetoFrontFiles on a directory of *_costs.json files.
+//
+// usage: pareto_front_bench [n records] [n files] [dir]
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "pareto_front.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::string> pairwise_front(const std::vector<CostData>& data, int num_objectives, double max_budget) {
+        std::vector<std::string> pareto_front;
+        for (const auto& current : data) {
+            bool is_dominated = false;
+            for (const auto& other : data) {
+                if (dominates(other, current, num_objectives, max_budget)) {
+                    is_dominated = true;
+                    break;
+                }
+            }
+            if (!is_dominated) {
+                pareto_front.push_back(current.file_index);
+            }
+        }
+        return pareto_front;
+    }
+
+    // costs in [0, 1e6) and emissions in [0, 1e4) on a curved trade-off,
+    // rounded to `levels` values so that ties and duplicates are common
+    std::vector<CostData> make_records(size_t n, int num_objectives, int levels, double odd_fraction, std::mt19937& gen) {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        auto round = [&](double v) {
+            return levels > 0 ? std::floor(v * levels) / levels : v;
+        };
+        std::vector<CostData> data;
+        data.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            double t = dist(gen);
+            double obj1 = 1e6 * round(t);
+            double obj2 = 1e4 * round((1.0 - t) * (1.0 - t) + 0.3 * dist(gen));
+            std::optional<double> obj3;
+            if (num_objectives == 3) {
+                obj3 = 1e3 * round(dist(gen));
+            }
+            if (dist(gen) < odd_fraction) {
+                switch (static_cast<int>(dist(gen) * 4)) {
+                    case 0: obj1 = std::numeric_limits<double>::quiet_NaN(); break;
+                    case 1: obj2 = std::numeric_limits<double>::quiet_NaN(); break;
+                    case 2: obj3.reset(); break;
+                    default: obj3 = std::numeric_limits<double>::quiet_NaN(); break;
+                }
+            }
+            data.push_back(CostData{obj1, obj2, obj3, std::to_string(i)});
+        }
+        return data;
+    }
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? std::stoul(argv[1]) : 100000;
+    size_t nfiles = argc > 2 ? std::stoul(argv[2]) : 10000;
+    fs::path dir = argc > 3 ? fs::path(argv[3]) : fs::temp_directory_path() / fmt::format("pareto_front_bench_{}", getpid());
+    std::mt19937 gen(7);
+
+    int errors = 0;
+    int cases = 0;
+    for (int num_objectives : {2, 3}) {
+        for (double max_budget : {1e300, 6e5, 5e3, -1.0, std::numeric_limits<double>::quiet_NaN()}) {
+            for (int levels : {0, 10, 100}) {
+                for (double odd_fraction : {0.0, 0.05}) {
+                    for (size_t size : {0, 1, 2, 7, 50, 2000}) {
+                        auto data = make_records(size, num_objectives, levels, odd_fraction, gen);
+                        ++cases;
+                        if (find_pareto_front(data, num_objectives, max_budget) != pairwise_front(data, num_objectives, max_budget)) {
+                            std::cerr << fmt::format("fronts differ: {} objectives, budget {}, {} levels, {} odd, {} records",
+                                                     num_objectives, max_budget, levels, odd_fraction, size) << std::endl;
+                            ++errors;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    fmt::print("{} cases checked against the pairwise scan\n\n", cases);
+
+    fmt::print("{:>12} {:>6} {:>10} {:>14} {:>14}\n", "records", "objs", "front", "sorted ms", "pairwise ms");
+    for (int num_objectives : {2, 3}) {
+        for (size_t size = 1000; size <= n; size *= 10) {
+            auto data = make_records(size, num_objectives, 0, 0.0, gen);
+            std::vector<std::string> front;
+            double sorted_ms = time_ms([&] { front = find_pareto_front(data, num_objectives, 8e5); });
+            std::string pairwise = "-";
+            if (size <= 20000) {
+                std::vector<std::string> reference;
+                pairwise = fmt::format("{:.1f}", time_ms([&] { reference = pairwise_front(data, num_objectives, 8e5); }));
+                if (front != reference) {
+                    std::cerr << size << " records, " << num_objectives << " objectives: fronts differ" << std::endl;
+                    ++errors;
+                }
+            }
+            fmt::print("{:>12} {:>6} {:>10} {:>14.1f} {:>14}\n", size, num_objectives, front.size(), sorted_ms, pairwise);
+        }
+    }
+
+    // the same records on disk, a third of them over the budget
+    fs::create_directories(dir);
+    std::vector<std::string> objs = {"cost", "EoS-N"};
+    auto data = make_records(nfiles, 2, 0, 0.0, gen);
+    for (auto& record : data) {
+        std::ofstream(dir / fmt::format("{}_costs.json", record.file_index))
+            << fmt::format("{{\"cost\": {}, \"EoS-N\": {}}}", record.objective1, record.objective2);
+    }
+    std::vector<std::string> from_files;
+    std::vector<std::string> from_records;
+    double files_ms = time_ms([&] { from_files = findParetoFrontFiles(objs, dir.string(), 6.6e5); });
+    double read_ms = time_ms([&] { from_records = find_pareto_front(readCostFiles(objs, dir.string()), 2, 6.6e5); });
+    fmt::print("\n{} files: findParetoFrontFiles {:.1f} ms, readCostFiles + find_pareto_front {:.1f} ms, front {}\n",
+               nfiles, files_ms, read_ms, from_files.size());
+    if (from_files != from_records) {
+        std::cerr << "findParetoFrontFiles differs from the front of readCostFiles" << std::endl;
+        ++errors;
+    }
+    fs::remove_all(dir);
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
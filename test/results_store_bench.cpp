@@ -0,0 +1,189 @@
+// ResultsStore on n solutions: append, reopen (replay), lookups and the
+// Pareto front from the index, against writing and scanning one
+// *_costs.json per solution. Also checks that a torn last record is dropped
+// on reopen, that relocated records replace the earlier ones, that
+// refresh() picks up what another ResultsStore appended, and that refresh()
+// and append() leave a partial record at the end alone.
+//
+// usage: results_store_bench [n solutions] [n json files] [dir]
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "pareto_front.h"
+#include "results_store.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    const std::vector<std::string> SUFFIXES = {
+        "_impbmpsubmittedland.parquet", "_impbmpsubmittedland.json", "_impbmpsubmittedanimal.parquet",
+        "_impbmpsubmittedanimal.json", "_impbmpsubmittedmanuretransport.parquet",
+        "_impbmpsubmittedmanuretransport.json", "_reportloads.parquet", "_costs.json"};
+
+    ResultRecord make_record(size_t i, std::mt19937& gen, const std::string& dir) {
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        double t = dist(gen);
+        double lc_cost = 6e5 * t;
+        double animal_cost = 2e5 * dist(gen);
+        double load = 1e4 * ((1.0 - t) * (1.0 - t) + 0.3 * dist(gen));
+        auto uuid = fmt::format("{:08x}-{:04x}-4000-8000-{:012x}", static_cast<uint32_t>(gen()), i & 0xffff, i);
+        return ResultRecord{uuid, ResultOrigin::pso, {lc_cost + animal_cost, load}, lc_cost + animal_cost - 7e5,
+                            {{"lc_cost", lc_cost}, {"animal_cost", animal_cost}, {"manure_cost", 0.0}},
+                            dir, uuid, SUFFIXES};
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? std::stoul(argv[1]) : 100000;
+    size_t nfiles = argc > 2 ? std::stoul(argv[2]) : 10000;
+    fs::path dir = argc > 3 ? fs::path(argv[3]) : fs::temp_directory_path() / fmt::format("results_store_bench_{}", getpid());
+    fs::create_directories(dir);
+    auto filename = (dir / "results.log").string();
+    std::mt19937 gen(11);
+    int errors = 0;
+
+    std::vector<ResultRecord> records;
+    records.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        records.push_back(make_record(i, gen, dir.string()));
+    }
+
+    double append_ms = time_ms([&] {
+        ResultsStore store(filename);
+        for (const auto& record : records) {
+            store.append(record);
+        }
+        store.sync();
+    });
+    auto log_size = fs::file_size(filename);
+
+    std::vector<std::string> front;
+    double open_ms = 0.0;
+    double lookup_ms = 0.0;
+    double front_ms = 0.0;
+    {
+        std::unique_ptr<ResultsStore> store;
+        open_ms = time_ms([&] { store = std::make_unique<ResultsStore>(filename); });
+        if (store->size() != n) {
+            std::cerr << "reopened " << store->size() << " of " << n << " solutions" << std::endl;
+            ++errors;
+        }
+        size_t found = 0;
+        lookup_ms = time_ms([&] {
+            for (const auto& record : records) {
+                found += store->find(record.uuid) != nullptr;
+            }
+        });
+        if (found != n) {
+            std::cerr << "found " << found << " of " << n << " solutions" << std::endl;
+            ++errors;
+        }
+        for (size_t i : {size_t{0}, n / 2, n - 1}) {
+            auto read = store->read(records[i].uuid);
+            if (!read || read->objectives != records[i].objectives || read->values != records[i].values || read->files != records[i].files) {
+                std::cerr << "record " << i << " did not round-trip" << std::endl;
+                ++errors;
+            }
+        }
+        front_ms = time_ms([&] { front = find_pareto_front(store->cost_data(ResultOrigin::pso), 2, 7e5); });
+    }
+
+    // the same solutions as one *_costs.json each, up to nfiles of them
+    size_t njson = std::min(n, nfiles);
+    std::vector<std::string> objs = {"cost", "EoS-N"};
+    auto json_dir = dir / "json";
+    fs::create_directories(json_dir);
+    double json_write_ms = time_ms([&] {
+        for (size_t i = 0; i < njson; ++i) {
+            std::ofstream(json_dir / fmt::format("{}_costs.json", records[i].uuid))
+                << fmt::format("{{\"cost\": {}, \"EoS-N\": {}}}", records[i].objectives[0], records[i].objectives[1]);
+        }
+    });
+    std::vector<std::string> json_front;
+    double json_front_ms = time_ms([&] { json_front = findParetoFrontFiles(objs, json_dir.string(), 7e5); });
+    if (njson == n) {
+        std::sort(front.begin(), front.end());
+        std::sort(json_front.begin(), json_front.end());
+        if (front != json_front) {
+            std::cerr << "the front of the store differs from the front of the json files" << std::endl;
+            ++errors;
+        }
+    }
+    fs::remove_all(json_dir);
+
+    fmt::print("{} solutions, log {:.1f} MB\n", n, log_size / (1024.0 * 1024.0));
+    fmt::print("{:<40} {:>12.1f} ms\n", "append + sync", append_ms);
+    fmt::print("{:<40} {:>12.1f} ms\n", "reopen (replay)", open_ms);
+    fmt::print("{:<40} {:>12.1f} ms\n", "find every uuid", lookup_ms);
+    fmt::print("{:<40} {:>12.1f} ms  (front {})\n", "Pareto front from the index", front_ms, front.size());
+    fmt::print("{:<40} {:>12.1f} ms\n", fmt::format("write {} *_costs.json", njson), json_write_ms);
+    fmt::print("{:<40} {:>12.1f} ms\n", fmt::format("findParetoFrontFiles on {}", njson), json_front_ms);
+
+    // a torn record at the end is dropped, and appends carry on after it
+    {
+        std::ofstream(filename, std::ios::binary | std::ios::app) << std::string("\x40\x00\x00\x00torn", 8);
+        ResultsStore store(filename);
+        if (store.size() != n || fs::file_size(filename) != log_size) {
+            std::cerr << "the torn record was not dropped" << std::endl;
+            ++errors;
+        }
+        if (!store.relocate(records[0].uuid, (dir / "front").string(), "0", {"_costs.json"}, ResultOrigin::front)) {
+            std::cerr << "could not relocate " << records[0].uuid << std::endl;
+            ++errors;
+        }
+        ResultsStore other(filename);
+        other.append(make_record(n, gen, dir.string()));
+        store.refresh();
+        if (store.size() != n + 1 || store.records() != n + 2) {
+            std::cerr << "refresh did not pick up the other store's record" << std::endl;
+            ++errors;
+        }
+        // a record another process is still writing is left alone
+        std::ofstream(filename, std::ios::binary | std::ios::app) << std::string("\x40\x00\x00\x00torn", 8);
+        auto torn_size = fs::file_size(filename);
+        store.refresh();
+        auto after_torn = make_record(n + 1, gen, dir.string());
+        store.append(after_torn);
+        if (fs::file_size(filename) <= torn_size || store.size() != n + 2 || store.find(after_torn.uuid) == nullptr) {
+            std::cerr << "refresh or append cut off a partial record" << std::endl;
+            ++errors;
+        }
+    }
+    {
+        ResultsStore store(filename);
+        auto moved = store.read(records[0].uuid);
+        if (!moved || moved->origin != ResultOrigin::front || moved->prefix != "0" || store.uuids().front() != records[0].uuid
+                || store.uuids(ResultOrigin::front).size() != 1) {
+            std::cerr << "the relocated record did not replace the first one" << std::endl;
+            ++errors;
+        }
+    }
+    fs::remove_all(dir);
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Throughput of the counter-based streams (rng.h) against std::mt19937, and
+// checks that Philox4x32-10 matches the Random123 known-answer vectors and
+// that filling (iteration, particle) streams gives the same numbers serially
+// and across threads.
+//
+// usage: rng_bench [millions of numbers] [nthreads]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "rng.h"
+#include "thread_pool.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // keeps the draws from being optimized away
+    volatile double sink = 0.0;
+
+    template <typename F>
+    void run(const std::string& name, size_t n, F&& draw) {
+        auto start = Clock::now();
+        double sum = draw();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        sink = sink + sum;
+        fmt::print("{:<40} {:>12.3e} {:>10.2f}\n", name, n / seconds, 1e9 * seconds / n);
+    }
+
+    // the stream of each particle of one iteration, as Swarm::update draws it
+    void fill_iteration(std::vector<double>& out, int nparticles, size_t dim, uint32_t iteration, ThreadPool* pool) {
+        auto fill = [&](size_t i) {
+            rng::Stream stream(42, rng::Domain::velocity, iteration, static_cast<uint32_t>(i));
+            stream.fill_uniform(out.data() + i * dim, dim);
+        };
+        if (pool == nullptr) {
+            for (int i = 0; i < nparticles; ++i) {
+                fill(i);
+            }
+        }
+        else {
+            pool->parallel_for(nparticles, fill);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = static_cast<size_t>((argc > 1 ? std::stod(argv[1]) : 20.0) * 1e6);
+    int nthreads = argc > 2 ? std::stoi(argv[2]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    int errors = 0;
+    struct Kat {
+        rng::Counter ctr;
+        rng::Key key;
+        rng::Counter expected;
+    };
+    std::vector<Kat> kats = {
+        {{0, 0, 0, 0}, {0, 0}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+        {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+        {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+    };
+    for (const auto& kat : kats) {
+        if (rng::philox4x32(kat.ctr, kat.key) != kat.expected) {
+            std::cerr << "philox4x32 does not match a known-answer vector" << std::endl;
+            ++errors;
+        }
+    }
+
+    fmt::print("{:<40} {:>12} {:>10}\n", "generator", "numbers/s", "ns/number");
+    run("mt19937 + uniform_real_distribution", n, [&] {
+        std::mt19937 gen(1);
+        std::uniform_real_distribution<> dis(0, 1);
+        double sum = 0.0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += dis(gen);
+        }
+        return sum;
+    });
+    run("mt19937_64, 53 bits", n, [&] {
+        std::mt19937_64 gen(1);
+        double sum = 0.0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += static_cast<double>(gen() >> 11) * 0x1.0p-53;
+        }
+        return sum;
+    });
+    run("rng::Stream::uniform", n, [&] {
+        rng::Stream stream(1, rng::Domain::shared, 0, 0);
+        double sum = 0.0;
+        for (size_t k = 0; k < n; ++k) {
+            sum += stream.uniform();
+        }
+        return sum;
+    });
+    std::vector<double> buffer(n);
+    run("rng::Stream::fill_uniform", n, [&] {
+        rng::Stream(1, rng::Domain::shared, 0, 0).fill_uniform(buffer.data(), n);
+        return buffer[n / 2];
+    });
+
+    // one iteration of a 64-particle swarm, one stream per particle
+    int nparticles = 64;
+    size_t dim = n / nparticles;
+    std::vector<double> serial(nparticles * dim);
+    std::vector<double> threaded(nparticles * dim);
+    ThreadPool pool(nthreads);
+    run("streams per particle, 1 thread", nparticles * dim, [&] {
+        fill_iteration(serial, nparticles, dim, 7, nullptr);
+        return serial[0];
+    });
+    run(fmt::format("streams per particle, {} threads", pool.size()), nparticles * dim, [&] {
+        fill_iteration(threaded, nparticles, dim, 7, &pool);
+        return threaded[0];
+    });
+    if (serial != threaded) {
+        std::cerr << "the streams differ between 1 and " << pool.size() << " threads" << std::endl;
+        ++errors;
+    }
+    fill_iteration(threaded, nparticles, dim, 8, &pool);
+    if (serial == threaded) {
+        std::cerr << "two iterations drew the same numbers" << std::endl;
+        ++errors;
+    }
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Loads a scenario from its JSON inputs, then again from the binary snapshot
+// the first load wrote, and checks that both hold exactly the same tables and
+// compiled model. A corrupted snapshot must be ignored and rebuilt.
+//
+// usage: scenario_snapshot_test <input.json> <scenario.json> <manure_nutrients.parquet>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string only_snapshot(const fs::path& dir) {
+        std::string found;
+        int count = 0;
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            if (entry.path().extension() == ".snapshot") {
+                found = entry.path().string();
+                ++count;
+            }
+        }
+        return count == 1 ? found : std::string();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "usage: " << argv[0] << " <input.json> <scenario.json> <manure_nutrients.parquet>" << std::endl;
+        return -1;
+    }
+    std::string filename = argv[1];
+    std::string filename_scenario = argv[2];
+    std::string manure_nutrients_file = argv[3];
+
+    auto snapshot_dir = fs::temp_directory_path() / fmt::format("scenario_snapshot_test_{}", getpid());
+    fs::remove_all(snapshot_dir);
+    setenv("SCENARIO_SNAPSHOT_DIR", snapshot_dir.c_str(), 1);
+
+    auto init = [&](Scenario& scenario) {
+        return time_ms([&] { scenario.init(filename, filename_scenario, true, true, true, true, manure_nutrients_file); });
+    };
+    int errors = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        if (!ok) {
+            std::cerr << what << std::endl;
+            ++errors;
+        }
+    };
+
+    Scenario cold;
+    double cold_ms = init(cold);
+    auto snapshot_file = only_snapshot(snapshot_dir);
+    check(!cold.is_loaded_from_snapshot(), "the first load did not parse the inputs");
+    check(!snapshot_file.empty(), "the first load did not write a snapshot");
+
+    Scenario warm;
+    double warm_ms = init(warm);
+    fmt::print("json: {:.1f} ms, snapshot: {:.1f} ms ({} bytes)\n", cold_ms, warm_ms,
+               snapshot_file.empty() ? 0 : fs::file_size(snapshot_file));
+    check(warm.is_loaded_from_snapshot(), "the second load did not use the snapshot");
+    check(warm.same_loaded_state(cold), "snapshot tables differ from the JSON ones");
+    check(warm.get_nvars() == cold.get_nvars(), "number of variables differs");
+    check(warm.get_model() == cold.get_model(), "compiled models differ");
+
+    if (!snapshot_file.empty()) {
+        // flip one payload byte
+        std::fstream file(snapshot_file, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(fs::file_size(snapshot_file) / 2);
+        char byte = 0;
+        file.read(&byte, 1);
+        byte = static_cast<char>(~byte);
+        file.seekp(fs::file_size(snapshot_file) / 2);
+        file.write(&byte, 1);
+    }
+    Scenario corrupted;
+    init(corrupted);
+    check(!corrupted.is_loaded_from_snapshot(), "a corrupted snapshot was accepted");
+    check(corrupted.same_loaded_state(cold), "the fallback load differs from the JSON one");
+
+    Scenario rebuilt;
+    init(rebuilt);
+    check(rebuilt.is_loaded_from_snapshot() && rebuilt.same_loaded_state(cold), "the snapshot was not rebuilt");
+
+    fs::remove_all(snapshot_dir);
+    if (errors > 0) {
+        return -1;
+    }
+    fmt::print("snapshot and JSON loads agree\n");
+    return 0;
+}
@@ -41,7 +41,7 @@ int main (int argc, char *argv[]) {
     scenario.initialize_vector(x);
     
     std::vector<std::tuple<int, int, int, int, double>> lc_x;
-    std::vector<std::tuple<int, int, int, int, double>> land_bmp_inputs;
+    BmpTableLand land_bmp_inputs;
     std::unordered_map<std::string, double> amount_minus;
     std::unordered_map<std::string, double> amount_plus;
 
@@ -0,0 +1,100 @@
+// Compares the Full and Delta submission layouts (see SubmissionLayout):
+// bytes written and wall time per generation for synthetic land submissions.
+//
+// usage: submission_layout_bench [base_rows] [new_rows] [nparts] [out_dir]
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "misc_utilities.h"
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::vector<BmpRowLand> make_base_rows(int n) {
+        std::vector<BmpRowLand> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 9, fmt::format("SU{}", i), 11, 7 + i % 50, 1000 + i % 300, 4 + i % 20, 1, 10.0 + i % 97, true, "", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<std::tuple<int, int, int, int, double>> make_lc_x(int n, int seed) {
+        std::vector<std::tuple<int, int, int, int, double>> lc_x;
+        lc_x.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            lc_x.push_back({100 + (i * 7 + seed) % 900, 9, 10 + i % 30, 1 + (i + seed) % 40, 1.0 + (i * 13 + seed) % 500});
+        }
+        return lc_x;
+    }
+
+    uintmax_t dir_bytes(const std::string& dir) {
+        uintmax_t total = 0;
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            total += entry.file_size();
+        }
+        return total;
+    }
+
+    void run(const std::string& name, SubmissionLayout layout, const BmpTableLand& base,
+             int new_rows, int nparts, const std::string& out_dir) {
+        std::string dir = fmt::format("{}/{}", out_dir, name);
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+
+        Scenario scenario;
+        scenario.set_submission_layout(layout);
+
+        auto start = std::chrono::steady_clock::now();
+        if (layout == SubmissionLayout::Delta) {
+            scenario.write_land_base(fmt::format("{}/base_impbmpsubmittedland.parquet", dir), base);
+        }
+        auto base_end = std::chrono::steady_clock::now();
+        uintmax_t base_bytes = dir_bytes(dir);
+
+        for (int i = 0; i < nparts; ++i) {
+            auto lc_x = make_lc_x(new_rows, i);
+            scenario.write_land(lc_x, fmt::format("{}/{}_impbmpsubmittedland.parquet", dir, i), base);
+        }
+        auto end = std::chrono::steady_clock::now();
+        uintmax_t generation_bytes = dir_bytes(dir) - base_bytes;
+
+        // what a consumer pays to get one particle back in the full layout
+        double materialize_ms = 0.0;
+        if (layout == SubmissionLayout::Delta) {
+            auto full = fmt::format("{}/0_impbmpsubmittedland.parquet", dir);
+            auto m_start = std::chrono::steady_clock::now();
+            misc_utilities::materialize_submission(Scenario::delta_filename(full), full);
+            materialize_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+        }
+
+        double base_ms = std::chrono::duration<double, std::milli>(base_end - start).count();
+        double generation_ms = std::chrono::duration<double, std::milli>(end - base_end).count();
+        fmt::print("{:>6}: per-run base {:>12} bytes {:>9.2f} ms | per-generation {:>12} bytes {:>9.2f} ms | materialize one {:>8.2f} ms\n",
+                   name, base_bytes, base_ms, generation_bytes, generation_ms, materialize_ms);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int base_rows = argc > 1 ? std::stoi(argv[1]) : 50000;
+    int new_rows = argc > 2 ? std::stoi(argv[2]) : 500;
+    int nparts = argc > 3 ? std::stoi(argv[3]) : 20;
+    std::string out_dir = argc > 4 ? argv[4] : (fs::temp_directory_path() / "submission_layout_bench").string();
+
+    fmt::print("base rows: {}, new rows per particle: {}, particles: {}\n", base_rows, new_rows, nparts);
+    auto base = BmpTableLand::from_rows(make_base_rows(base_rows));
+
+    run("full", SubmissionLayout::Full, base, new_rows, nparts, out_dir);
+    run("delta", SubmissionLayout::Delta, base, new_rows, nparts, out_dir);
+
+    fs::remove_all(out_dir);
+    return 0;
+}
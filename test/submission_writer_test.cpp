@@ -0,0 +1,464 @@
+// Writes the land, animal and manure submission files with Scenario::write_*
+// and with the row-by-row StreamWriter code they replaced, reads both back
+// and checks that CAST gets the same tables, parquet schemas and base_file
+// footers, in the Full and Delta layouts, and that delta submissions
+// materialized for CAST match the Full ones. Then times both writers on land
+// submissions, with the base rows encoded once and for every file.
+//
+// The Scenario is not loaded, so every lookup (state, geography, load source
+// group, FIPS) gives its default on both sides.
+//
+// usage: submission_writer_test [base_rows] [new_rows] [nfiles] [out_dir]
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/util/key_value_metadata.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+#include <parquet/stream_writer.h>
+
+#include "scenario.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double time_ms(F&& f) {
+        auto start = Clock::now();
+        f();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::vector<BmpRowLand> make_land_base(int n) {
+        std::vector<BmpRowLand> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 9, fmt::format("SU{}", i), 11, 7 + i % 50, 1000 + i % 300, 4 + i % 20, 1,
+                            10.0 + i % 97, i % 11 != 0, i % 11 == 0 ? "" : "out of range", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<BmpRowAnimal> make_animal_base(int n) {
+        std::vector<BmpRowAnimal> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 3 + i % 17, 9, fmt::format("A{}", i), 24, 500 + i % 90, 2 + i % 8, 6 + i % 5, 13,
+                            1.5 * (i % 40), 0.1 * (i % 3), 0.05 * (i % 4), true, "", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<BmpRowManure> make_manure_base(int n) {
+        std::vector<BmpRowManure> rows;
+        rows.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            rows.push_back({i + 1, 40 + i % 3, 9, fmt::format("M{}", i), 42, i % 2 == 0, 100 + i % 60, 100 + (i * 7) % 60,
+                            fmt::format("42{:03}", i % 60), fmt::format("42{:03}", (i * 7) % 60), 2 + i % 8, 6, 12,
+                            20.0 + i % 33, true, "", i + 1});
+        }
+        return rows;
+    }
+
+    std::vector<std::tuple<int, int, int, int, double>> make_lc_x(int n, int seed) {
+        std::vector<std::tuple<int, int, int, int, double>> lc_x;
+        lc_x.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            lc_x.push_back({100 + (i * 7 + seed) % 900, 9 + i % 3, 10 + i % 30, 1 + (i + seed) % 40, 1.0 + (i * 13 + seed) % 500});
+        }
+        return lc_x;
+    }
+
+    std::vector<std::tuple<int, int, int, int, int, double>> make_animal_x(int n, int seed) {
+        std::vector<std::tuple<int, int, int, int, int, double>> animal_x;
+        animal_x.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            animal_x.push_back({1, 100 + (i + seed) % 60, 10 + i % 30, 2 + i % 8, 3 + (i * 5 + seed) % 17, 0.5 * (1 + i % 70)});
+        }
+        return animal_x;
+    }
+
+    std::vector<std::tuple<int, int, int, int, int, double>> make_manure_x(int n, int seed) {
+        std::vector<std::tuple<int, int, int, int, int, double>> manure_x;
+        manure_x.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            manure_x.push_back({100 + (i + seed) % 60, 100 + (i * 3) % 60, 10 + i % 30, 2 + i % 8, 40 + i % 3, 3.0 * (1 + i % 25)});
+        }
+        return manure_x;
+    }
+
+    // The writer Scenario::write_* used before, with the lookups left at
+    // their defaults like those of an unloaded Scenario.
+    class Reference {
+    public:
+        Reference(const std::string& filename, const std::shared_ptr<parquet::schema::GroupNode>& schema,
+                  const std::string& base_file = "") {
+            std::shared_ptr<arrow::io::FileOutputStream> outfile;
+            PARQUET_ASSIGN_OR_THROW(outfile, arrow::io::FileOutputStream::Open(filename));
+            parquet::WriterProperties::Builder builder;
+            builder.version(parquet::ParquetVersion::PARQUET_1_0);
+            std::shared_ptr<const arrow::KeyValueMetadata> metadata;
+            if (!base_file.empty()) {
+                metadata = arrow::key_value_metadata({"base_file"}, {base_file});
+            }
+            os_ = parquet::StreamWriter{parquet::ParquetFileWriter::Open(outfile, schema, builder.build(), metadata)};
+        }
+
+        int land(const std::vector<BmpRowLand>& base, int counter = 0) {
+            for (const auto& row : base) {
+                os_ << counter + 1 << row.AgencyId << row.StateUniqueIdentifier << row.StateId << row.BmpId << row.GeographyId
+                    << row.LoadSourceGroupId << row.UnitId << row.Amount << row.IsValid << row.ErrorMessage << row.RowIndex
+                    << parquet::EndRow;
+                ++counter;
+            }
+            return counter;
+        }
+
+        int land(const std::vector<std::tuple<int, int, int, int, double>>& lc_x, int counter) {
+            for (const auto& [lrseg, agency, load_src, bmp_idx, amount] : lc_x) {
+                os_ << counter + 1 << agency << fmt::format("SU{}", counter) << 0 << bmp_idx << 0 << 0 << 1 << amount << true
+                    << "" << counter + 1 << parquet::EndRow;
+                ++counter;
+            }
+            return counter;
+        }
+
+        int animal(const std::vector<BmpRowAnimal>& base, int counter = 0) {
+            for (const auto& row : base) {
+                os_ << counter + 1 << row.BmpId << row.AgencyId << fmt::format("SU{}", counter) << row.StateId << row.GeographyId
+                    << row.AnimalGroupId << row.LoadSourceGroupId << row.UnitId << row.Amount << row.NReductionFraction
+                    << row.PReductionFraction << true << "" << counter + 1 << parquet::EndRow;
+                ++counter;
+            }
+            return counter;
+        }
+
+        int animal(const std::vector<std::tuple<int, int, int, int, int, double>>& animal_x, int counter) {
+            for (const auto& [base_condition, county, load_src, animal_id, bmp, amount] : animal_x) {
+                os_ << counter + 1 << bmp << 9 << fmt::format("SU{}", counter) << 0 << 0 << animal_id << 0 << 13 << amount
+                    << 0.0 << 0.0 << true << "" << counter + 1 << parquet::EndRow;
+                ++counter;
+            }
+            return counter;
+        }
+
+        int manure(const std::vector<BmpRowManure>& base, int counter = 0) {
+            for (const auto& row : base) {
+                os_ << counter + 1 << row.BmpId << row.AgencyId << fmt::format("SU{}", counter) << row.StateId
+                    << row.HasStateReference << row.CountyIdFrom << row.CountyIdTo << row.FIPSFrom << row.FIPSTo
+                    << row.AnimalGroupId << row.LoadSourceGroupId << row.UnitId << row.Amount << true << "" << counter + 1
+                    << parquet::EndRow;
+                ++counter;
+            }
+            return counter;
+        }
+
+        int manure(const std::vector<std::tuple<int, int, int, int, int, double>>& manure_x, int counter) {
+            for (const auto& [county_from, county_to, load_src, animal_id, bmp_id, amount] : manure_x) {
+                os_ << counter + 1 << bmp_id << 9 << fmt::format("SU{}", counter) << 0 << true << county_from << county_to
+                    << "" << "" << animal_id << 0 << 12 << amount << true << "" << counter + 1 << parquet::EndRow;
+                ++counter;
+            }
+            return counter;
+        }
+
+    private:
+        parquet::StreamWriter os_;
+    };
+
+    // The schemas the StreamWriter code wrote with.
+    std::shared_ptr<parquet::schema::GroupNode> make_schema(const std::vector<std::pair<std::string, parquet::Type::type>>& columns) {
+        parquet::schema::NodeVector fields;
+        for (const auto& [name, type] : columns) {
+            auto converted = type == parquet::Type::INT32 ? parquet::ConvertedType::INT_32
+                : type == parquet::Type::BYTE_ARRAY ? parquet::ConvertedType::UTF8 : parquet::ConvertedType::NONE;
+            fields.push_back(parquet::schema::PrimitiveNode::Make(name, parquet::Repetition::REQUIRED, type, converted));
+        }
+        return std::static_pointer_cast<parquet::schema::GroupNode>(
+                parquet::schema::GroupNode::Make("schema", parquet::Repetition::REQUIRED, fields));
+    }
+
+    constexpr auto INT32 = parquet::Type::INT32;
+    constexpr auto STRING = parquet::Type::BYTE_ARRAY;
+    constexpr auto DOUBLE = parquet::Type::DOUBLE;
+    constexpr auto BOOLEAN = parquet::Type::BOOLEAN;
+
+    const auto LAND_SCHEMA = make_schema({
+        {"BmpSubmittedId", INT32}, {"AgencyId", INT32}, {"StateUniqueIdentifier", STRING}, {"StateId", INT32},
+        {"BmpId", INT32}, {"GeographyId", INT32}, {"LoadSourceGroupId", INT32}, {"UnitId", INT32}, {"Amount", DOUBLE},
+        {"IsValid", BOOLEAN}, {"ErrorMessage", STRING}, {"RowIndex", INT32}});
+    const auto ANIMAL_SCHEMA = make_schema({
+        {"BmpSubmittedId", INT32}, {"BmpId", INT32}, {"AgencyId", INT32}, {"StateUniqueIdentifier", STRING},
+        {"StateId", INT32}, {"GeographyId", INT32}, {"AnimalGroupId", INT32}, {"LoadSourceGroupId", INT32},
+        {"UnitId", INT32}, {"Amount", DOUBLE}, {"NReductionFraction", DOUBLE}, {"PReductionFraction", DOUBLE},
+        {"IsValid", BOOLEAN}, {"ErrorMessage", STRING}, {"RowIndex", INT32}});
+    const auto MANURE_SCHEMA = make_schema({
+        {"BmpSubmittedId", INT32}, {"BmpId", INT32}, {"AgencyId", INT32}, {"StateUniqueIdentifier", STRING},
+        {"StateId", INT32}, {"HasStateReference", BOOLEAN}, {"CountyIdFrom", INT32}, {"CountyIdTo", INT32},
+        {"FipsFrom", STRING}, {"FipsTo", STRING}, {"AnimalGroupId", INT32}, {"LoadSourceGroupId", INT32},
+        {"UnitId", INT32}, {"Amount", DOUBLE}, {"IsValid", BOOLEAN}, {"ErrorMessage", STRING}, {"RowIndex", INT32}});
+
+    std::string base_file_of(const std::string& filename) {
+        auto metadata = parquet::ParquetFileReader::OpenFile(filename)->metadata()->key_value_metadata();
+        if (!metadata) {
+            return "";
+        }
+        auto found = metadata->Get("base_file");
+        return found.ok() ? *found : "";
+    }
+
+    std::shared_ptr<arrow::Table> read_table(const std::string& filename) {
+        std::shared_ptr<arrow::io::ReadableFile> infile;
+        PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(filename));
+        std::unique_ptr<parquet::arrow::FileReader> reader;
+        PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader));
+        std::shared_ptr<arrow::Table> table;
+        PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+        return table;
+    }
+
+    // Whether filename reads back exactly like expected.
+    bool same_file(const std::string& filename, const std::string& expected) {
+        if (!fs::exists(filename)) {
+            std::cerr << filename << " was not written" << std::endl;
+            return false;
+        }
+        auto metadata = parquet::ParquetFileReader::OpenFile(filename)->metadata();
+        auto expected_metadata = parquet::ParquetFileReader::OpenFile(expected)->metadata();
+        auto schema = metadata->schema();
+        auto expected_schema = expected_metadata->schema();
+        if (!schema->Equals(*expected_schema)) {
+            std::cerr << filename << ": parquet schema differs:\n" << schema->ToString() << "expected:\n"
+                      << expected_schema->ToString() << std::endl;
+            return false;
+        }
+        if (base_file_of(filename) != base_file_of(expected)) {
+            std::cerr << filename << ": base_file is '" << base_file_of(filename) << "', expected '" << base_file_of(expected)
+                      << "'" << std::endl;
+            return false;
+        }
+        auto table = read_table(filename);
+        auto expected_table = read_table(expected);
+        if (!table->Equals(*expected_table)) {
+            std::cerr << filename << ": rows differ\n" << table->ToString().substr(0, 2000) << "expected:\n"
+                      << expected_table->ToString().substr(0, 2000) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Whether filename is the row groups of base_file, byte for byte, and one
+    // row group of new_rows rows with statistics.
+    bool is_spliced(const std::string& filename, const std::string& base_file, int new_rows) {
+        auto metadata = parquet::ParquetFileReader::OpenFile(filename)->metadata();
+        auto base_metadata = parquet::ParquetFileReader::OpenFile(base_file)->metadata();
+        int groups = metadata->num_row_groups();
+        if (groups != base_metadata->num_row_groups() + 1 || metadata->RowGroup(groups - 1)->num_rows() != new_rows
+                || !metadata->RowGroup(groups - 1)->ColumnChunk(0)->is_stats_set()) {
+            std::cerr << filename << ": " << groups << " row groups, expected the " << base_metadata->num_row_groups()
+                      << " of the base file and one of " << new_rows << " rows with statistics" << std::endl;
+            return false;
+        }
+        auto base_end = fs::file_size(base_file) - 8 - base_metadata->size();
+        std::string bytes(base_end, '\0');
+        std::string base_bytes(base_end, '\0');
+        std::ifstream(filename, std::ios::binary).read(bytes.data(), base_end);
+        std::ifstream(base_file, std::ios::binary).read(base_bytes.data(), base_end);
+        if (bytes != base_bytes) {
+            std::cerr << filename << " does not start with the base row groups" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Writes one kind of submission both ways in both layouts and compares
+    // every file; write(scenario, filename) calls Scenario::write_*, and
+    // reference(os, counter, with_base) the matching Reference methods.
+    template <typename Write, typename WriteBase, typename ReferenceRows>
+    int check(const std::string& name, const std::string& dir, Write&& write, WriteBase&& write_base,
+              ReferenceRows&& reference, const std::shared_ptr<parquet::schema::GroupNode>& schema, int base_rows) {
+        int errors = 0;
+        auto filename = fmt::format("{}/full_{}.parquet", dir, name);
+        auto expected = fmt::format("{}/expected_{}.parquet", dir, name);
+        auto expected_new = fmt::format("{}/expected_{}_new_bmps.parquet", dir, name);
+
+        Scenario full;
+        write(full, filename);
+        {
+            Reference os(expected, schema);
+            reference(os, reference(os, 0, true), false);
+        }
+        {
+            Reference os(expected_new, schema);
+            reference(os, base_rows, false);
+        }
+        errors += !same_file(filename, expected);
+        errors += !same_file(Scenario::delta_filename(filename), expected_new);
+
+        auto base_file = fmt::format("{}/base_{}.parquet", dir, name);
+        auto expected_base = fmt::format("{}/expected_base_{}.parquet", dir, name);
+        auto delta = fmt::format("{}/delta_{}.parquet", dir, name);
+        auto expected_delta = fmt::format("{}/expected_delta_{}_new_bmps.parquet", dir, name);
+        Scenario scenario;
+        scenario.set_submission_layout(SubmissionLayout::Delta);
+        write_base(scenario, base_file);
+        write(scenario, delta);
+        {
+            Reference os(expected_base, schema);
+            reference(os, 0, true);
+        }
+        {
+            Reference os(expected_delta, schema, base_file);
+            reference(os, base_rows, false);
+        }
+        errors += !same_file(base_file, expected_base);
+        errors += !same_file(Scenario::delta_filename(delta), expected_delta);
+        if (fs::exists(delta)) {
+            std::cerr << "the delta layout wrote " << delta << std::endl;
+            ++errors;
+        }
+        return errors;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int base_rows = argc > 1 ? std::stoi(argv[1]) : 20000;
+    int new_rows = argc > 2 ? std::stoi(argv[2]) : 5000;
+    int nfiles = argc > 3 ? std::stoi(argv[3]) : 20;
+    std::string dir = argc > 4 ? argv[4] : (fs::temp_directory_path() / fmt::format("submission_writer_test_{}", getpid())).string();
+    fs::create_directories(dir);
+    int errors = 0;
+
+    auto land_base = make_land_base(base_rows);
+    auto animal_base = make_animal_base(base_rows);
+    auto manure_base = make_manure_base(base_rows);
+    auto land_table = BmpTableLand::from_rows(land_base);
+    auto animal_table = BmpTableAnimal::from_rows(animal_base);
+    auto manure_table = BmpTableManure::from_rows(manure_base);
+    auto lc_x = make_lc_x(new_rows, 1);
+    auto animal_x = make_animal_x(new_rows, 1);
+    auto manure_x = make_manure_x(new_rows, 1);
+
+    errors += check("land", dir,
+        [&](Scenario& s, const std::string& f) { s.write_land(lc_x, f, land_table); },
+        [&](Scenario& s, const std::string& f) { s.write_land_base(f, land_table); },
+        [&](Reference& os, int counter, bool base) { return base ? os.land(land_base) : os.land(lc_x, counter); },
+        LAND_SCHEMA, base_rows);
+    errors += check("animal", dir,
+        [&](Scenario& s, const std::string& f) { s.write_animal(animal_x, f, animal_table); },
+        [&](Scenario& s, const std::string& f) { s.write_animal_base(f, animal_table); },
+        [&](Reference& os, int counter, bool base) { return base ? os.animal(animal_base) : os.animal(animal_x, counter); },
+        ANIMAL_SCHEMA, base_rows);
+    errors += check("manure", dir,
+        [&](Scenario& s, const std::string& f) { s.write_manure(manure_x, f, manure_table); },
+        [&](Scenario& s, const std::string& f) { s.write_manure_base(f, manure_table); },
+        [&](Reference& os, int counter, bool base) { return base ? os.manure(manure_base) : os.manure(manure_x, counter); },
+        MANURE_SCHEMA, base_rows);
+
+    // base rows encoded by set_base_inputs give the same files, made of the
+    // base file's row groups, byte for byte, and one row group of new rows
+    {
+        Scenario scenario;
+        scenario.set_base_inputs(land_table, animal_table, manure_table);
+        auto filename = dir + "/prepared_land.parquet";
+        auto base_file = dir + "/prepared_base_land.parquet";
+        scenario.write_land(lc_x, filename, land_table);
+        scenario.write_land_base(base_file, land_table);
+        errors += !same_file(filename, dir + "/expected_land.parquet");
+        errors += !same_file(base_file, dir + "/expected_base_land.parquet");
+
+        errors += !is_spliced(filename, base_file, new_rows);
+    }
+
+    // a delta layout submission materialized for CAST reads back like the
+    // full layout file, and is spliced the same way
+    {
+        Scenario scenario;
+        scenario.set_base_inputs(land_table, animal_table, manure_table);
+        scenario.set_submission_layout(SubmissionLayout::Delta);
+        scenario.write_land_base(dir + "/materialized_base_land.parquet", land_table);
+        scenario.write_animal_base(dir + "/materialized_base_animal.parquet", animal_table);
+        scenario.write_manure_base(dir + "/materialized_base_manure.parquet", manure_table);
+        scenario.write_land(lc_x, dir + "/materialized_impbmpsubmittedland.parquet", land_table);
+        scenario.write_animal(animal_x, dir + "/materialized_impbmpsubmittedanimal.parquet", animal_table);
+        scenario.write_manure(manure_x, dir + "/materialized_impbmpsubmittedmanuretransport.parquet", manure_table);
+        for (const auto& [name, suffix] : {std::pair{"land", "impbmpsubmittedland"}, std::pair{"animal", "impbmpsubmittedanimal"},
+                                           std::pair{"manure", "impbmpsubmittedmanuretransport"}}) {
+            auto filename = fmt::format("{}/materialized_{}.parquet", dir, suffix);
+            if (!scenario.materialize_submission(filename)) {
+                std::cerr << filename << " was not materialized" << std::endl;
+                ++errors;
+                continue;
+            }
+            errors += !same_file(filename, fmt::format("{}/expected_{}.parquet", dir, name));
+            errors += !is_spliced(filename, fmt::format("{}/materialized_base_{}.parquet", dir, name), new_rows);
+        }
+        if (scenario.materialize_submission(dir + "/missing_impbmpsubmittedland.parquet")) {
+            std::cerr << "a submission without a delta file was materialized" << std::endl;
+            ++errors;
+        }
+    }
+
+    // an empty particle still gets its files when there are base rows
+    {
+        Scenario scenario;
+        auto filename = dir + "/empty_manure.parquet";
+        scenario.write_manure({}, filename, manure_table);
+        {
+            Reference os(dir + "/expected_empty_manure.parquet", MANURE_SCHEMA);
+            os.manure(manure_base);
+        }
+        errors += !same_file(filename, dir + "/expected_empty_manure.parquet");
+    }
+
+    // nfiles full land submissions, the way the PSO writes one per particle,
+    // with the base rows encoded once and, as without set_base_inputs, for
+    // every file
+    auto write_files = [&](Scenario& scenario) {
+        return time_ms([&] {
+            for (int i = 0; i < nfiles; ++i) {
+                scenario.write_land(make_lc_x(new_rows, i), fmt::format("{}/{}_land.parquet", dir, i), land_table);
+            }
+        });
+    };
+    Scenario scenario;
+    scenario.set_base_inputs(land_table, animal_table, manure_table);
+    double write_ms = write_files(scenario);
+    Scenario unprepared;
+    double encode_ms = write_files(unprepared);
+    double reference_ms = time_ms([&] {
+        for (int i = 0; i < nfiles; ++i) {
+            {
+                Reference os(fmt::format("{}/{}_expected_land.parquet", dir, i), LAND_SCHEMA);
+                os.land(make_lc_x(new_rows, i), os.land(land_base));
+            }
+            Reference os(fmt::format("{}/{}_expected_land_new_bmps.parquet", dir, i), LAND_SCHEMA);
+            os.land(make_lc_x(new_rows, i), base_rows);
+        }
+    });
+    fmt::print("{} land files of {} base and {} new rows\n", nfiles, base_rows, new_rows);
+    fmt::print("{:<28} {:>10.1f} ms/file\n", "StreamWriter", reference_ms / nfiles);
+    fmt::print("{:<28} {:>10.1f} ms/file\n", "base encoded per file", encode_ms / nfiles);
+    fmt::print("{:<28} {:>10.1f} ms/file\n", "base row groups spliced", write_ms / nfiles);
+    fs::remove_all(dir);
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
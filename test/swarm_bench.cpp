@@ -0,0 +1,110 @@
+// Velocity/position updates per second of the structure-of-arrays Swarm
+// against the vector<Particle> layout it replaced in PSO, at dim 10^3 to 10^5.
+// Also checks that a swarm step stays within the bounds and gives the same
+// positions serially and across threads.
+//
+// usage: swarm_bench [nparts] [steps] [nthreads]
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "particle.h"
+#include "swarm.h"
+#include "thread_pool.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    void print_row(int dim, const std::string& layout, int nparts, int steps, double seconds, double baseline) {
+        double updates = static_cast<double>(nparts) * dim * steps / seconds;
+        fmt::print("{:>8} {:>22} {:>14.3e} {:>12.2f} {:>9.2f}x\n", dim, layout, updates,
+                   1e3 * seconds / steps, baseline > 0.0 ? baseline / seconds : 1.0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int nparts = argc > 1 ? std::stoi(argv[1]) : 20;
+    int steps = argc > 2 ? std::stoi(argv[2]) : 20;
+    int nthreads = argc > 3 ? std::stoi(argv[3]) : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    double w = 0.7;
+    double c1 = 1.5;
+    double c2 = 1.5;
+
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    ThreadPool pool(nthreads);
+
+    int errors = 0;
+    fmt::print("{:>8} {:>22} {:>14} {:>12} {:>10}\n", "dim", "layout", "updates/s", "ms/step", "speedup");
+    for (int dim : {1000, 10000, 100000}) {
+        std::vector<std::vector<double>> guides(nparts, std::vector<double>(dim));
+        for (auto& guide : guides) {
+            for (auto& g : guide) {
+                g = dist(gen);
+            }
+        }
+
+        std::vector<Particle> particles;
+        for (int i = 0; i < nparts; ++i) {
+            particles.emplace_back(dim, 2, w, c1, c2, 0.0, 1.0);
+            particles.back().init();
+            particles.back().set_fx(dist(gen), dist(gen));
+            particles.back().init_pbest();
+        }
+        auto start = Clock::now();
+        for (int s = 0; s < steps; ++s) {
+            for (int i = 0; i < nparts; ++i) {
+                particles[i].update(guides[i]);
+            }
+        }
+        double baseline = std::chrono::duration<double>(Clock::now() - start).count();
+        print_row(dim, "vector<Particle>", nparts, steps, baseline, 0.0);
+
+        std::vector<std::span<const double>> guide_rows(guides.begin(), guides.end());
+        Swarm serial(nparts, dim, w, c1, c2, 0.0, 1.0, 11);
+        Swarm threaded(nparts, dim, w, c1, c2, 0.0, 1.0, 11);
+        for (auto* swarm : {&serial, &threaded}) {
+            swarm->init();
+            for (int i = 0; i < nparts; ++i) {
+                swarm->store_pbest(i);
+            }
+        }
+        start = Clock::now();
+        for (int s = 0; s < steps; ++s) {
+            serial.update(guide_rows);
+        }
+        print_row(dim, "Swarm", nparts, steps, std::chrono::duration<double>(Clock::now() - start).count(), baseline);
+        start = Clock::now();
+        for (int s = 0; s < steps; ++s) {
+            threaded.update(guide_rows, &pool);
+        }
+        print_row(dim, fmt::format("Swarm, {} threads", pool.size()), nparts, steps,
+                  std::chrono::duration<double>(Clock::now() - start).count(), baseline);
+
+        for (int i = 0; i < nparts; ++i) {
+            auto x = serial.x(i);
+            if (!std::equal(x.begin(), x.end(), threaded.x(i).begin())) {
+                std::cerr << "dim " << dim << ": particle " << i << " differs between the serial and threaded steps" << std::endl;
+                ++errors;
+            }
+            if (std::any_of(x.begin(), x.end(), [](double xd) { return xd < 0.0 || xd > 1.0; })) {
+                std::cerr << "dim " << dim << ": particle " << i << " left the bounds" << std::endl;
+                ++errors;
+            }
+        }
+    }
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    return 0;
+}
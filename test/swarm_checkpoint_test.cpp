@@ -0,0 +1,142 @@
+// Resuming a Swarm from saved rows, the way PSO::save_checkpoint stores them:
+// a swarm restored from its x, v, pbest rows and step counts must take
+// exactly the steps the original takes. Also reports the size and the
+// atomic, fsync'ed write time of such a checkpoint (swarm rows plus a gbest
+// archive of the same dimension) at dim 10^3 to 10^5.
+//
+// usage: swarm_checkpoint_test [nparts] [archive size] [dir]
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "binary_io.h"
+#include "swarm.h"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+    int nparts = argc > 1 ? std::stoi(argv[1]) : 20;
+    int archive_size = argc > 2 ? std::stoi(argv[2]) : 100;
+    fs::path dir = argc > 3 ? fs::path(argv[3]) : fs::temp_directory_path();
+    auto filename = (dir / fmt::format("swarm_checkpoint_test_{}.bin", getpid())).string();
+    double w = 0.7;
+    double c1 = 1.4;
+    double c2 = 1.4;
+
+    std::mt19937 gen(13);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    int errors = 0;
+    fmt::print("{:>8} {:>10} {:>12} {:>12} {:>12}\n", "dim", "archive", "MB", "write ms", "read ms");
+    for (int dim : {1000, 10000, 100000}) {
+        std::vector<std::vector<double>> archive(archive_size, std::vector<double>(dim));
+        for (auto& member : archive) {
+            for (auto& xd : member) {
+                xd = dist(gen);
+            }
+        }
+        std::vector<std::span<const double>> guides(nparts);
+        auto pick_guides = [&](int step) {
+            for (int i = 0; i < nparts; ++i) {
+                guides[i] = archive[(step * 7 + i) % archive_size];
+            }
+        };
+
+        Swarm swarm(nparts, dim, w, c1, c2, 0.0, 1.0, 99);
+        swarm.init();
+        for (int step = 0; step < 3; ++step) {
+            pick_guides(step);
+            swarm.update(guides);
+            // half the particles improve their pbest each step
+            for (int i = step % 2; i < nparts; i += 2) {
+                swarm.store_pbest(i);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        binary_io::Writer writer;
+        writer.put<uint64_t>(swarm.seed());
+        for (int i = 0; i < nparts; ++i) {
+            auto x = swarm.x(i);
+            auto pbest_x = swarm.pbest_x(i);
+            writer.put<uint64_t>(swarm.steps(i));
+            writer.put_array(x.data(), dim);
+            writer.put_array(swarm.v(i).data(), dim);
+            bool pbest_is_x = std::memcmp(x.data(), pbest_x.data(), dim * sizeof(double)) == 0;
+            writer.put<uint8_t>(pbest_is_x);
+            if (!pbest_is_x) {
+                writer.put_array(pbest_x.data(), dim);
+            }
+        }
+        writer.put(archive);
+        const auto& payload = writer.bytes();
+        if (!binary_io::write_file_atomically(filename, {{payload.data(), payload.size()}}, true)) {
+            std::cerr << "could not write " << filename << std::endl;
+            return -1;
+        }
+        double write_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        Swarm resumed;
+        std::vector<std::vector<double>> loaded_archive;
+        {
+            binary_io::MappedFile file(filename);
+            binary_io::Reader reader(file.data(), file.size());
+            resumed = Swarm(nparts, dim, w, c1, c2, 0.0, 1.0, reader.get<uint64_t>());
+            std::vector<double> x(dim);
+            std::vector<double> v(dim);
+            std::vector<double> pbest_x(dim);
+            for (int i = 0; i < nparts; ++i) {
+                auto steps = reader.get<uint64_t>();
+                reader.get_array(x.data(), dim);
+                reader.get_array(v.data(), dim);
+                if (reader.get<uint8_t>()) {
+                    pbest_x = x;
+                }
+                else {
+                    reader.get_array(pbest_x.data(), dim);
+                }
+                resumed.restore(i, x, v, pbest_x, steps);
+            }
+            reader.get(loaded_archive);
+            if (!reader.at_end() || loaded_archive != archive) {
+                std::cerr << "dim " << dim << ": the archive did not round-trip" << std::endl;
+                ++errors;
+            }
+        }
+        double read_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        fmt::print("{:>8} {:>10} {:>12.1f} {:>12.1f} {:>12.1f}\n", dim, archive_size, payload.size() / (1024.0 * 1024.0), write_ms, read_ms);
+
+        for (int step = 3; step < 6; ++step) {
+            pick_guides(step);
+            swarm.update(guides);
+            resumed.update(guides);
+        }
+        for (int i = 0; i < nparts; ++i) {
+            auto a = swarm.x(i);
+            auto b = resumed.x(i);
+            if (std::memcmp(a.data(), b.data(), dim * sizeof(double)) != 0) {
+                std::cerr << "dim " << dim << ": particle " << i << " diverged after resuming" << std::endl;
+                ++errors;
+            }
+        }
+    }
+    fs::remove(filename);
+
+    if (errors > 0) {
+        std::cerr << errors << " errors" << std::endl;
+        return -1;
+    }
+    fmt::print("resumed swarms took the same steps\n");
+    return 0;
+}